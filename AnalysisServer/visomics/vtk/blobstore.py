@@ -0,0 +1,92 @@
+#!/usr/bin/env python
+
+import hashlib
+import os
+import tempfile
+
+class MissingBlobs(Exception):
+  """Raised when a job references input blobs the store doesn't hold.
+
+  The client reacts to this error by submitting the job again with all of
+  its inputs attached.
+  """
+  def __init__(self, digests):
+    Exception.__init__(self, "MissingBlobs: %s" % ",".join(digests))
+    self.digests = digests
+
+class DiskBlobStore(object):
+  """Content addressed store for serialized inputs, evicting the least
+  recently used blobs once 'max_bytes' is exceeded.
+
+  Blobs are plain files named after their SHA-1 digest; the modification
+  time of a file records when the blob was last used.
+  """
+
+  def __init__(self, directory, max_bytes):
+    self.directory = directory
+    self.max_bytes = max_bytes
+    if not os.path.isdir(directory):
+      os.makedirs(directory)
+
+  @staticmethod
+  def from_config(conf):
+    directory = conf.get('VISOMICS_BLOB_STORE_DIR')
+    if not directory:
+      return None
+    max_bytes = conf.get('VISOMICS_BLOB_STORE_MAX_BYTES', 10 * 1024 ** 3)
+    return DiskBlobStore(directory, max_bytes)
+
+  def _path(self, digest):
+    if len(digest) != 40 or not all(c in '0123456789abcdef' for c in digest):
+      raise Exception("Invalid blob digest: %s" % digest)
+    return os.path.join(self.directory, digest)
+
+  def get(self, digest):
+    path = self._path(digest)
+    try:
+      with open(path, 'rb') as fp:
+        data = fp.read()
+    except IOError:
+      return None
+    # mark the blob as recently used
+    os.utime(path, None)
+    return data
+
+  def put(self, digest, data):
+    if hashlib.sha1(data).hexdigest() != digest:
+      raise Exception("Blob content doesn't match its digest: %s" % digest)
+    path = self._path(digest)
+    if os.path.exists(path):
+      os.utime(path, None)
+      return
+    # write to a temporary file first so that concurrent workers never
+    # read a partial blob
+    fd, tmp = tempfile.mkstemp(dir=self.directory, prefix='.tmp-')
+    with os.fdopen(fd, 'wb') as fp:
+      fp.write(data)
+    os.rename(tmp, path)
+    self.evict()
+
+  def evict(self):
+    entries = []
+    total = 0
+    for name in os.listdir(self.directory):
+      if name.startswith('.tmp-'):
+        continue
+      path = os.path.join(self.directory, name)
+      try:
+        stat = os.stat(path)
+      except OSError:
+        continue
+      entries.append((stat.st_mtime, stat.st_size, path))
+      total += stat.st_size
+
+    entries.sort()
+    for mtime, size, path in entries:
+      if total <= self.max_bytes:
+        break
+      try:
+        os.remove(path)
+        total -= size
+      except OSError:
+        pass
@@ -4,3 +4,8 @@ CELERY_MONGODB_BACKEND_SETTINGS = {
     "host": "arbor",
     "database": "celery"
 }
+
+# Content addressed cache of the inputs received by the workers, so that a
+# client re-running an analysis on the same data doesn't upload it again.
+VISOMICS_BLOB_STORE_DIR = "/tmp/visomics-blobs"
+VISOMICS_BLOB_STORE_MAX_BYTES = 10 * 1024 ** 3
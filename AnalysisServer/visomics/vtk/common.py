@@ -3,29 +3,133 @@
 import base64
 import json
 import os
+import struct
 import tempfile
+import time
+import zlib
 
 # import vtk wrapped version that will raise exceptions for error events
 import vtkwithexceptions as vtk
 
+from visomics.vtk.blobstore import MissingBlobs
+
+# Length-prefixed binary framing, see Base/Analysis/voRemoteAnalysisProtocol.h
+#
+#   "VOFR" | header length (uint32, big endian) | header (JSON)
+#   | frame length (uint64, big endian) | frame bytes | ...
+#
+# Frames using the "zlib" encoding hold a 4 byte big endian uncompressed
+# length followed by a zlib stream (the layout produced by Qt's qCompress).
+FRAME_SIGNATURE = 'VOFR'
+FRAME_CONTENT_TYPE = 'application/x-visomics-frames'
+COMPRESSION_THRESHOLD = 64 * 1024
+
+def is_framed(body):
+  return body[:len(FRAME_SIGNATURE)] == FRAME_SIGNATURE
+
+def read_frames(body):
+  if not is_framed(body):
+    raise Exception("Missing frame signature")
+  position = len(FRAME_SIGNATURE)
+  (header_size,) = struct.unpack('>I', body[position:position + 4])
+  position += 4
+  header = body[position:position + header_size]
+  if len(header) != header_size:
+    raise Exception("Truncated frame header")
+  position += header_size
+
+  frames = []
+  while position < len(body):
+    (frame_size,) = struct.unpack('>Q', body[position:position + 8])
+    position += 8
+    frame = body[position:position + frame_size]
+    if len(frame) != frame_size:
+      raise Exception("Truncated frame")
+    frames.append(frame)
+    position += frame_size
+
+  return header, frames
+
+def write_frames(header, frames):
+  parts = [FRAME_SIGNATURE, struct.pack('>I', len(header)), header]
+  for frame in frames:
+    parts.append(struct.pack('>Q', len(frame)))
+    parts.append(frame)
+  return ''.join(parts)
+
+def compress_payload(data):
+  if len(data) < COMPRESSION_THRESHOLD:
+    return None
+  compressed = struct.pack('>I', len(data)) + zlib.compress(data, 1)
+  if len(compressed) >= len(data):
+    return None
+  return compressed
+
+def decode_payload(encoding, data):
+  if not encoding or encoding == 'raw':
+    return data
+  elif encoding == 'zlib':
+    return zlib.decompress(data[4:])
+  raise Exception("Unsupported encoding: %s" % encoding)
+
+def encode_output(data, accept_encoding):
+  """Return the JSON fields describing the binary output 'data'."""
+  if accept_encoding == 'zlib':
+    compressed = compress_payload(data)
+    if compressed is not None:
+      return {'encoding': 'zlib', 'data': base64.b64encode(compressed)}
+  return {'encoding': 'raw', 'data': base64.b64encode(data)}
+
+class StageTimer(object):
+  """Wall clock time (in s) spent in the stages of a task.
+
+  The timings are returned to the client under the "timings" key of the
+  result, so that it can tell the time spent executing the task apart from
+  the time spent in the queue.
+  """
+  def __init__(self):
+    self.timings = {}
+    self._start = time.time()
+
+  def stage(self, name):
+    """End the stage 'name', started at the end of the previous one."""
+    now = time.time()
+    self.timings[name] = self.timings.get(name, 0) + now - self._start
+    self._start = now
+
 def parse_json(json_string):
   job_descriptor = json.loads(json_string)
+  return _parse_job_descriptor(job_descriptor, None)
+
+def parse_job(body, blob_store=None):
+  """Parse a job sent either as a framed message or as a JSON document.
 
+  The data of "vtk" inputs is returned decoded (no base64, no compression).
+  Inputs sent with their SHA-1 digest are added to 'blob_store', and inputs
+  sent by digest only are looked up in it. MissingBlobs is raised if some of
+  them can't be found.
+  """
+  if is_framed(body):
+    header, frames = read_frames(body)
+    return _parse_job_descriptor(json.loads(header), frames, blob_store)
+  return _parse_job_descriptor(json.loads(body), None, blob_store)
+
+def _parse_job_descriptor(job_descriptor, frames, blob_store=None):
   inputs = job_descriptor['inputs']
 
   job = {'name': job_descriptor['name'],
          'script': job_descriptor['script'],
-         'outputs': job_descriptor['outputs']}
+         'outputs': job_descriptor['outputs'],
+         'accept_encoding': job_descriptor.get('accept_encoding', 'raw')}
 
   parsed_inputs = []
+  missing_blobs = []
 
   for input in inputs:
     type = input['type']
     if not type:
       raise Exception("Input is missing type property")
 
-    data = input['data']
-
     name = input['name']
     if not name:
       raise Exception("Input is missing name property")
@@ -34,51 +138,70 @@ def parse_json(json_string):
     if not format:
       raise Exception("Input is missing format property")
 
+    digest = input.get('sha1')
+    if frames is not None and 'frame' in input:
+      data = decode_payload(input.get('encoding'), frames[input['frame']])
+    elif 'data' not in input and digest:
+      data = blob_store.get(digest) if blob_store else None
+      if data is None:
+        missing_blobs.append(digest)
+      else:
+        parsed_inputs.append((name, type, format, data))
+      continue
+    elif format.lower() == 'vtk':
+      data = decode_payload(input.get('encoding'), base64.b64decode(input['data']))
+    else:
+      data = input['data']
+
+    if digest and blob_store:
+      blob_store.put(digest, data)
+
     parsed_inputs.append((name, type, format, data))
 
+  if missing_blobs:
+    raise MissingBlobs(missing_blobs)
+
   job['inputs'] = parsed_inputs
 
   return job
 
-def SerializeVTKTable(table):
-  tmp = tempfile.mktemp()
+def WriteVTKTable(table):
   writer = vtk.vtkTableWriter()
-  writer.SetFileName(tmp)
+  writer.WriteToOutputStringOn()
   writer.SetFileTypeToBinary()
   writer.SetInputData(table)
   writer.Update()
-  with open(tmp, 'r') as fp:
-    data = fp.read()
-  os.remove(tmp)
-  data = base64.b64encode(data)
-  return data
-
-def DeserializeVTKTable(tableString):
-  data_tableString = base64.b64decode(tableString)
+  return writer.GetOutputStdString()
+
+def SerializeVTKTable(table):
+  return base64.b64encode(WriteVTKTable(table))
+
+def DeserializeVTKTable(tableString, base64_encoded=True):
+  if base64_encoded:
+    tableString = base64.b64decode(tableString)
   reader = vtk.vtkTableReader()
   reader.ReadFromInputStringOn()
-  reader.SetBinaryInputString(data_tableString, len(data_tableString))
+  reader.SetBinaryInputString(tableString, len(tableString))
   reader.Update()
   return reader.GetOutput()
 
-def SerializeVTKTree(tree):
-  tmp = tempfile.mktemp()
+def WriteVTKTree(tree):
   writer = vtk.vtkTreeWriter()
-  writer.SetFileName(tmp)
+  writer.WriteToOutputStringOn()
   writer.SetFileTypeToBinary()
   writer.SetInputData(tree)
   writer.Update()
-  with open(tmp, 'r') as fp:
-    data = fp.read()
-  os.remove(tmp)
-  data = base64.b64encode(data)
-  return data
-
-def DeserializeVTKTree(treeString):
-  data_treeString = base64.b64decode(treeString)
+  return writer.GetOutputStdString()
+
+def SerializeVTKTree(tree):
+  return base64.b64encode(WriteVTKTree(tree))
+
+def DeserializeVTKTree(treeString, base64_encoded=True):
+  if base64_encoded:
+    treeString = base64.b64decode(treeString)
   reader = vtk.vtkTreeReader()
   reader.ReadFromInputStringOn()
-  reader.SetBinaryInputString(data_treeString, len(data_treeString))
+  reader.SetBinaryInputString(treeString, len(treeString))
   reader.Update()
   return reader.GetOutput()
 
@@ -120,17 +243,23 @@ def LoadInput(type, format, data):
     elif format.lower() == "treestore":
       pass
     elif format.lower() == "vtk":
-      return DeserializeVTKTable(data)
+      return DeserializeVTKTable(data, base64_encoded=False)
   elif type.lower() == "tree":
     if format.lower() == "newick":
       return NewickToVTKTree(data)
     elif format.lower() == "treestore":
       pass
     elif format.lower() == "vtk":
-      return DeserializeVTKTree(data)
+      return DeserializeVTKTree(data, base64_encoded=False)
 
 def SerializeOutput(object):
   if object.GetClassName() == "vtkTable":
     return SerializeVTKTable(object)
   elif object.GetClassName() == "vtkTree":
     return SerializeVTKTree(object)
+
+def WriteOutput(object):
+  if object.GetClassName() == "vtkTable":
+    return WriteVTKTable(object)
+  elif object.GetClassName() == "vtkTree":
+    return WriteVTKTree(object)
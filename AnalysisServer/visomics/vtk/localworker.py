@@ -0,0 +1,188 @@
+#!/usr/bin/env python
+
+"""Analysis worker for clients running on the same host.
+
+Instead of posting the inputs to the analysis server, the client copies them
+into shared memory segments (files mapped in memory, in /dev/shm when
+available) and sends their descriptors over a Unix socket. The worker maps
+the segments, runs the script and writes the outputs to new segments the
+same way. See Base/Analysis/voSharedMemoryTransfer.h for the layout.
+
+Each message is a JSON document prefixed with its size (uint32, big
+endian). Requests look like the job descriptors of the analysis server, with
+"script_type" ("R" or "Python") and "segment_directory" added. Replies hold
+the "output" descriptors and the "timings" of the job, or an "error".
+
+Tables made of numeric columns are wrapped as they are (no copy) before
+being handed over to R or Python.
+
+  python -m visomics.vtk.localworker [socket path]
+
+and point the client at local://<socket path>.
+"""
+
+import imp
+import json
+import mmap
+import os
+import SocketServer
+import struct
+import sys
+import tempfile
+import traceback
+import uuid
+
+import numpy
+from vtk.util import numpy_support
+
+# import vtk wrapped version that will raise exceptions for error events
+import vtkwithexceptions as vtk
+
+from visomics.vtk import r
+from visomics.vtk.common import StageTimer, LoadInput, WriteVTKTable, WriteVTKTree
+
+SEGMENT_PREFIX = 'visomics-'
+ALIGNMENT = 64
+
+NUMERIC_TYPES = ('float64', 'float32', 'int8', 'uint8', 'int16', 'uint16',
+                 'int32', 'uint32', 'int64', 'uint64')
+
+def align(offset):
+  return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT
+
+def map_segment(descriptor, directory):
+  path = descriptor['segment']
+  if (os.path.dirname(os.path.abspath(path)) != os.path.abspath(directory)
+      or not os.path.basename(path).startswith(SEGMENT_PREFIX)):
+    raise Exception("Invalid segment: %s" % path)
+  with open(path, 'rb') as segment:
+    # Private mapping: arrays wrapping it are writable, pages are only
+    # copied if they are modified.
+    return mmap.mmap(segment.fileno(), max(descriptor['size'], 1),
+                     access=mmap.ACCESS_COPY)
+
+def read_input(descriptor, directory):
+  buffer = map_segment(descriptor, directory)
+  type = descriptor['type']
+  if descriptor['format'] == 'columns':
+    table = vtk.vtkTable()
+    rows = descriptor['rows']
+    for column in descriptor['columns']:
+      values = numpy.frombuffer(buffer, dtype=column['type'],
+                                count=rows * column['components'],
+                                offset=column['offset'])
+      if column['components'] > 1:
+        values = values.reshape(rows, column['components'])
+      # Keeps a reference to 'values', hence to the mapping
+      array = numpy_support.numpy_to_vtk(values)
+      array.SetName(column['name'])
+      table.AddColumn(array)
+    return table
+  return LoadInput(type, 'vtk', buffer[:descriptor['size']])
+
+def create_segment(directory, size):
+  path = os.path.join(directory, '%sworker-%d-%s' % (SEGMENT_PREFIX, os.getpid(),
+                                                    uuid.uuid4().hex))
+  segment = open(path, 'w+b')
+  segment.truncate(max(size, 1))
+  return path, segment, mmap.mmap(segment.fileno(), max(size, 1))
+
+def numeric_columns(dataobject):
+  if dataobject.GetClassName() != 'vtkTable':
+    return None
+  columns = []
+  for index in range(dataobject.GetNumberOfColumns()):
+    array = dataobject.GetColumn(index)
+    if not array.IsA('vtkDataArray') or array.IsA('vtkBitArray'):
+      return None
+    values = numpy_support.vtk_to_numpy(array)
+    if values.dtype.name not in NUMERIC_TYPES:
+      return None
+    columns.append((array, values))
+  return columns
+
+def write_output(name, dataobject, directory):
+  type = 'Tree' if dataobject.IsA('vtkTree') else 'Table'
+  descriptor = {'name': name, 'type': type}
+  columns = numeric_columns(dataobject)
+  if columns is None:
+    data = WriteVTKTree(dataobject) if type == 'Tree' else WriteVTKTable(dataobject)
+    path, segment, buffer = create_segment(directory, len(data))
+    buffer[:len(data)] = data
+    descriptor.update({'format': 'vtk', 'size': len(data)})
+  else:
+    size = 0
+    for array, values in columns:
+      size = align(size) + values.nbytes
+    path, segment, buffer = create_segment(directory, size)
+    descriptor.update({'format': 'columns', 'size': size,
+                       'rows': dataobject.GetNumberOfRows(), 'columns': []})
+    offset = 0
+    for array, values in columns:
+      offset = align(offset)
+      target = numpy.frombuffer(buffer, dtype=values.dtype, count=values.size, offset=offset)
+      target[:] = values.ravel()
+      descriptor['columns'].append({'name': array.GetName() or '',
+                                    'type': values.dtype.name,
+                                    'components': array.GetNumberOfComponents(),
+                                    'offset': offset})
+      offset += values.nbytes
+  buffer.close()
+  segment.close()
+  descriptor['segment'] = path
+  return descriptor
+
+def execute(job):
+  timer = StageTimer()
+  directory = job['segment_directory']
+  inputs = [(input['name'], input['type'], read_input(input, directory))
+            for input in job['inputs']]
+  timer.stage('deserialize')
+
+  if job.get('script_type') == 'Python':
+    custom = imp.new_module("custom")
+    exec job['script'] in custom.__dict__
+    outputs = custom.execute(dict((name, data) for name, type, data in inputs)).items()
+  else:
+    dataobjects = r.compute(inputs, job['outputs'], job['script'])
+    outputs = zip([output['name'] for output in job['outputs']], dataobjects)
+  timer.stage('execute')
+
+  descriptors = [write_output(name, dataobject, directory) for name, dataobject in outputs]
+  timer.stage('serialize')
+  return {'output': descriptors, 'timings': timer.timings}
+
+def read_message(stream):
+  header = stream.read(4)
+  if len(header) < 4:
+    return None
+  (size,) = struct.unpack('>I', header)
+  return json.loads(stream.read(size))
+
+def write_message(stream, message):
+  body = json.dumps(message)
+  stream.write(struct.pack('>I', len(body)) + body)
+  stream.flush()
+
+class JobHandler(SocketServer.StreamRequestHandler):
+  def handle(self):
+    job = read_message(self.rfile)
+    if job is None:
+      return
+    try:
+      reply = execute(job)
+    except Exception, e:
+      traceback.print_exc()
+      reply = {'error': str(e)}
+    write_message(self.wfile, reply)
+
+class ForkingUnixStreamServer(SocketServer.ForkingMixIn, SocketServer.UnixStreamServer):
+  pass
+
+if __name__ == '__main__':
+  path = sys.argv[1] if len(sys.argv) > 1 else os.path.join(tempfile.gettempdir(),
+                                                            'visomics-worker.sock')
+  if os.path.exists(path):
+    os.remove(path)
+  # Jobs run in their own process, like the Celery workers do
+  ForkingUnixStreamServer(path, JobHandler).serve_forever()
@@ -0,0 +1,132 @@
+#!/usr/bin/env python
+
+"""Long-poll task status and streamed task result endpoints.
+
+Serves GET <prefix>/tasks/celery/<task id>/status?wait=<seconds>. The request
+is held until the task is done or 'wait' seconds elapsed, so that clients
+learn about completion right away instead of polling at a fixed interval.
+Responses carry the "X-Visomics-Long-Poll" header, which tells the client it
+may ask again immediately.
+
+Also serves GET <prefix>/tasks/celery/<task id>/result. When the request
+accepts "application/x-visomics-frames", the outputs of a successful task are
+streamed as a framed message (see common.py), one output at a time and
+without base64, so that the client can decode each output as it arrives.
+Otherwise the result is returned as JSON, like the Celery endpoint does.
+
+Route the status URLs of the analysis server to this WSGI application, or
+run it standalone for testing:
+
+  python -m visomics.vtk.longpoll [port]
+"""
+
+import base64
+import json
+import re
+import struct
+import sys
+import time
+import urlparse
+
+from celery import Celery
+from celery.result import AsyncResult
+
+from visomics.vtk.common import FRAME_SIGNATURE
+
+celery = Celery()
+celery.config_from_object('celeryconfig')
+
+MAX_WAIT = 60
+POLL_INTERVAL = 0.05
+FINAL_STATES = ('SUCCESS', 'FAILURE', 'REVOKED')
+
+FRAMES_CONTENT_TYPE = 'application/x-visomics-frames'
+
+STATUS_URL = re.compile(r'.*/tasks/celery/([^/]+)/status/?$')
+RESULT_URL = re.compile(r'.*/tasks/celery/([^/]+)/result/?$')
+
+def wait_for_task(task_id, wait):
+  result = AsyncResult(task_id, app=celery)
+  deadline = time.time() + min(max(wait, 0), MAX_WAIT)
+  state = result.state
+  while state not in FINAL_STATES and time.time() < deadline:
+    time.sleep(POLL_INTERVAL)
+    state = result.state
+  return state
+
+def stream_frames(header, outputs):
+  """Yield a framed message, decoding one output at a time."""
+  yield FRAME_SIGNATURE + struct.pack('>I', len(header)) + header
+  for output in outputs:
+    data = base64.b64decode(output['data'])
+    yield struct.pack('>Q', len(data))
+    yield data
+
+def framed_size(header, outputs):
+  size = len(FRAME_SIGNATURE) + 4 + len(header)
+  for output in outputs:
+    # Size of the base64 decoded data, without decoding it
+    encoded = output['data']
+    size += 8 + len(encoded) * 3 / 4 - encoded[-2:].count('=')
+  return size
+
+def result(environ, start_response, task_id):
+  task = AsyncResult(task_id, app=celery)
+  value = task.result
+  accept = environ.get('HTTP_ACCEPT', '')
+  if (FRAMES_CONTENT_TYPE not in accept or task.state != 'SUCCESS'
+      or not isinstance(value, dict) or 'output' not in value):
+    if isinstance(value, Exception):
+      value = str(value)
+    body = json.dumps({'result': value})
+    start_response('200 OK', [('Content-Type', 'application/json'),
+                              ('Content-Length', str(len(body)))])
+    return [body]
+
+  outputs = value['output']
+  descriptors = []
+  for index, output in enumerate(outputs):
+    descriptor = dict((key, output[key]) for key in output if key != 'data')
+    descriptor['frame'] = index
+    descriptors.append(descriptor)
+  header = json.dumps({'result': {'output': descriptors,
+                                  'timings': value.get('timings', {})}})
+  start_response('200 OK', [('Content-Type', FRAMES_CONTENT_TYPE),
+                            ('Content-Length', str(framed_size(header, outputs)))])
+  return stream_frames(header, outputs)
+
+def status(environ, start_response, task_id):
+  query = urlparse.parse_qs(environ.get('QUERY_STRING', ''))
+  try:
+    wait = float(query.get('wait', ['0'])[0])
+  except ValueError:
+    wait = 0
+
+  body = json.dumps({'status': wait_for_task(task_id, wait)})
+  start_response('200 OK', [('Content-Type', 'application/json'),
+                            ('Content-Length', str(len(body))),
+                            ('X-Visomics-Long-Poll', '1')])
+  return [body]
+
+def application(environ, start_response):
+  path = environ.get('PATH_INFO', '')
+  if environ.get('REQUEST_METHOD') == 'GET':
+    match = STATUS_URL.match(path)
+    if match:
+      return status(environ, start_response, match.group(1))
+    match = RESULT_URL.match(path)
+    if match:
+      return result(environ, start_response, match.group(1))
+  start_response('404 Not Found', [('Content-Type', 'text/plain')])
+  return ['Not Found']
+
+if __name__ == '__main__':
+  from wsgiref.simple_server import make_server
+  from SocketServer import ThreadingMixIn
+  from wsgiref.simple_server import WSGIServer
+
+  class ThreadingWSGIServer(ThreadingMixIn, WSGIServer):
+    daemon_threads = True
+
+  port = int(sys.argv[1]) if len(sys.argv) > 1 else 8091
+  make_server('', port, application, server_class=ThreadingWSGIServer).serve_forever()
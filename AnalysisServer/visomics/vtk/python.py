@@ -3,7 +3,8 @@ import vtkwithexceptions as vtk
 
 import imp
 import tempfile
-from visomics.vtk.common import LoadInput, SerializeOutput, parse_json
+from visomics.vtk.blobstore import DiskBlobStore
+from visomics.vtk.common import LoadInput, StageTimer, WriteOutput, encode_output, parse_job
 
 from celery import Celery
 from celery import task, current_task
@@ -12,14 +13,18 @@ from celery.result import AsyncResult
 celery = Celery()
 celery.config_from_object('celeryconfig')
 
+blob_store = DiskBlobStore.from_config(celery.conf)
+
 @celery.task
 def run(input):
-  task_description =  parse_json(input);
+  timer = StageTimer()
+  task_description =  parse_job(input, blob_store);
 
   # load inputs into a dictionary
   inputs = {}
   for name, type, format, data in task_description['inputs']:
     inputs[name] = LoadInput(type, format, data)
+  timer.stage('deserialize')
 
   # load incoming Python script code into a custom module
   module_code = task_description['script']
@@ -28,14 +33,16 @@ def run(input):
 
   # call the custom Python code and get its output
   outputs = custom.execute(inputs)
+  timer.stage('execute')
 
   # wrap the output up into a dictionary & return
   output_list = []
   for name, object in outputs.iteritems():
     type = object.GetClassName()
-    data = SerializeOutput(object)
-    d = {"name": name, "type": type, "data": data }
+    d = {"name": name, "type": type}
+    d.update(encode_output(WriteOutput(object), task_description['accept_encoding']))
     output_list.append(d)
 
-  output_json = {"output": output_list}
+  timer.stage('serialize')
+  output_json = {"output": output_list, "timings": timer.timings}
   return output_json
@@ -1,26 +1,81 @@
 # import vtk wrapped version that will raise exceptions for error events
 import vtkwithexceptions as vtk
-import base64
-import os
-import tempfile
 
 from celery import Celery
 from celery import task, current_task
 from celery.result import AsyncResult
 
-from visomics.vtk.common import parse_json
+from visomics.vtk.blobstore import DiskBlobStore
+from visomics.vtk.common import StageTimer, encode_output, parse_job
 
 celery = Celery()
 celery.config_from_object('celeryconfig')
 
+blob_store = DiskBlobStore.from_config(celery.conf)
+
 @celery.task
 def run(input):
-    task_description =  parse_json(input);
+    timer = StageTimer()
+    task_description =  parse_job(input, blob_store);
+    timer.stage('deserialize')
 
     return execute(task_description['inputs'], task_description['outputs'],
-                   task_description['script'])
+                   task_description['script'],
+                   task_description['accept_encoding'], timer)
+
+def execute(inputs, outputs, script, accept_encoding='raw', timer=None):
+    if timer is None:
+        timer = StageTimer()
+
+    input_objects = []
+    for name, type, format, value in inputs:
+
+        if type == 'Table':
+            reader = vtk.vtkTableReader()
+        elif type == 'Tree':
+            reader = vtk.vtkTreeReader()
+
+        reader.SetBinaryInputString(value, len(value))
+        reader.SetReadFromInputString(1)
+        reader.Update()
+
+        input_objects.append((name, type, reader.GetOutput()))
+
+    output_dataobjects = compute(input_objects, outputs, script)
+    timer.stage('execute')
+
+    output_json  =  {'output': []}
+
+    index = 0
+
+    for dataobject in output_dataobjects:
+
+        output = outputs[index]
+        index += 1
+
+        if output['type'] == 'Table':
+            writer = vtk.vtkTableWriter()
+        elif output['type'] == 'Tree':
+            writer = vtk.vtkTreeWriter()
+
+        writer.WriteToOutputStringOn()
+        writer.SetFileTypeToBinary()
+        writer.SetInputData(dataobject)
+        writer.Update()
+
+        output_value = {'name': output['name'], 'type': output['type']}
+        output_value.update(encode_output(writer.GetOutputStdString(), accept_encoding))
+        output_json['output'].append(output_value)
+
+    timer.stage('serialize')
+    output_json['timings'] = timer.timings
+    return output_json
+
+def compute(input_objects, outputs, script):
+    """Run 'script' on the (name, type, data object) 'input_objects'.
 
-def execute(inputs, outputs, script):
+    Return the data objects of the 'outputs', in order.
+    """
 
     # prepend some R code to the beginning of the script
     # this allows us to capture useful error output information
@@ -30,23 +85,14 @@ def execute(inputs, outputs, script):
     rcalc = vtk.vtkRCalculatorFilter()
     rcalc.SetRscript(script)
 
-    readers = []
     input_tables = []
     input_trees = []
-    for name, type, format, value in inputs:
+    for name, type, dataobject in input_objects:
 
         if type == 'Table':
             input_tables.append(name)
-            input = vtk.vtkTableReader()
         elif type == 'Tree':
             input_trees.append(name)
-            input = vtk.vtkTreeReader()
-
-        data_value = base64.b64decode(value)
-        input.SetBinaryInputString(data_value, len(data_value))
-        input.SetReadFromInputString(1)
-
-        readers.append(input)
 
     names = vtk.vtkStringArray()
     names.SetNumberOfComponents(1)
@@ -67,13 +113,15 @@ def execute(inputs, outputs, script):
     rcalc.PutTrees(names)
 
     # Multi inputs
-    if len(inputs) > 1:
+    if len(input_objects) > 1:
         input = vtk.vtkMultiBlockDataGroupFilter()
 
-        for reader in readers:
-            input.AddInputConnection(reader.GetOutputPort())
+        for name, type, dataobject in input_objects:
+            input.AddInputData(dataobject)
 
-    rcalc.AddInputConnection(input.GetOutputPort())
+        rcalc.AddInputConnection(input.GetOutputPort())
+    else:
+        rcalc.AddInputData(input_objects[0][2])
 
     output_tables = []
     output_trees = []
@@ -123,34 +171,4 @@ def execute(inputs, outputs, script):
     else:
         output_dataobjects.append(output)
 
-    output_json  =  {'output': []}
-
-    index = 0
-
-    for dataobject in output_dataobjects:
-
-        output = outputs[index]
-        index += 1
-
-        if output['type'] == 'Table':
-            writer = vtk.vtkTableWriter()
-        elif output['type'] == 'Tree':
-            writer = vtk.vtkTreeWriter()
-
-        tmp = tempfile.mktemp()
-
-        writer.SetFileName(tmp)
-        writer.SetFileTypeToBinary()
-        writer.SetInputData(dataobject)
-        writer.Update()
-
-        with open(tmp, 'r') as fp:
-            data = fp.read()
-
-        os.remove(tmp)
-
-        data = base64.b64encode(data)
-
-        output_json['output'].append({'name': output['name'], 'type': output['type'], 'data': data})
-
-    return output_json
+    return output_dataobjects
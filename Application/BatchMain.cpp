@@ -0,0 +1,116 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+// Qt includes
+#include <QDebug>
+#include <QStringList>
+
+// Visomics includes
+#include "voApplication.h"
+#include "voBatchRunner.h"
+#include "voConfigure.h" // For Visomics_VERSION
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+//----------------------------------------------------------------------------
+void printUsage()
+{
+  std::cerr << "Visomics " << Visomics_VERSION << " batch runner\n"
+            << "Usage: visomics-batch <job file> [--output-directory <directory>] [--jobs <count>]\n"
+            << "  --output-directory  Overrides the output directory of the job file\n"
+            << "  --jobs              Number of datasets processed in parallel\n"
+            << "Analyses defined by scripts need the remote analysis server and are not\n"
+            << "available in batch mode." << std::endl;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  // No display is needed to run analyses
+  voApplication app(argc, argv, false);
+
+  bool exitWhenDone = false;
+  app.initialize(exitWhenDone);
+  if (exitWhenDone)
+    {
+    return EXIT_SUCCESS;
+    }
+
+  QStringList arguments = app.arguments();
+  arguments.removeFirst();
+  QString jobFileName;
+  QString outputDirectory;
+  int maximumConcurrentDatasets = 0;
+  while (!arguments.isEmpty())
+    {
+    QString argument = arguments.takeFirst();
+    if (argument == "--output-directory" && !arguments.isEmpty())
+      {
+      outputDirectory = arguments.takeFirst();
+      }
+    else if (argument == "--jobs" && !arguments.isEmpty())
+      {
+      maximumConcurrentDatasets = arguments.takeFirst().toInt();
+      }
+    else if (jobFileName.isEmpty() && !argument.startsWith("-"))
+      {
+      jobFileName = argument;
+      }
+    else
+      {
+      printUsage();
+      return EXIT_FAILURE;
+      }
+    }
+  if (jobFileName.isEmpty())
+    {
+    printUsage();
+    return EXIT_FAILURE;
+    }
+
+  voBatchRunner runner;
+  if (!runner.loadJobFile(jobFileName))
+    {
+    return EXIT_FAILURE;
+    }
+  if (!outputDirectory.isEmpty())
+    {
+    runner.setOutputDirectory(outputDirectory);
+    }
+  if (maximumConcurrentDatasets > 0)
+    {
+    runner.setMaximumConcurrentDatasets(maximumConcurrentDatasets);
+    }
+
+  int failureCount = runner.run();
+  if (failureCount > 0)
+    {
+    qCritical() << failureCount << "of" << runner.datasetCount() * runner.analysisCount()
+                << "analyses failed";
+    return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
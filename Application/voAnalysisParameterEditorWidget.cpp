@@ -21,6 +21,8 @@
 // Qt includes
 #include <QDebug>
 #include <QDialogButtonBox>
+#include <QInputDialog>
+#include <QMessageBox>
 #include <QPointer>
 #include <QPushButton>
 #include <QVBoxLayout>
@@ -31,6 +33,7 @@
 
 // Visomics includes
 #include "voAnalysis.h"
+#include "voAnalysisDriver.h"
 #include "voAnalysisParameterEditorWidget.h"
 
 class voAnalysisParameterEditorWidgetPrivate
@@ -56,6 +59,7 @@ public:
   QPushButton*            ApplyButton;
   QPushButton*            ResetButton;
   QPushButton*            OkButton;
+  QPushButton*            SweepButton;
   QPointer<voAnalysis>    Analysis;
 
   // The QtTreePropertyBrowser is associated with a "local" property manager
@@ -103,10 +107,13 @@ void voAnalysisParameterEditorWidgetPrivate::init()
   this->OkButton = dialogButton->button(QDialogButtonBox::Ok);
   this->ApplyButton->setText("Update");
   this->OkButton->setText("Clone");
+  this->SweepButton = dialogButton->addButton("Sweep...", QDialogButtonBox::ActionRole);
+  this->SweepButton->setEnabled(false);
 
   QObject::connect(this->ApplyButton, SIGNAL(clicked()), q, SLOT(updateAnalysis()));
   QObject::connect(this->ResetButton, SIGNAL(clicked()), q, SLOT(reset()));
   QObject::connect(this->OkButton, SIGNAL(clicked()), q, SLOT(cloneAnalysis()));
+  QObject::connect(this->SweepButton, SIGNAL(clicked()), q, SLOT(sweepAnalysis()));
 
   this->setButtonsEnabled(false);
 }
@@ -220,6 +227,7 @@ void voAnalysisParameterEditorWidget::setAnalysis(voAnalysis* newAnalysis)
   d->setLocalPropertyManagerConnected(true);
 
   d->setButtonsEnabled(false);
+  d->SweepButton->setEnabled(true);
 
   d->Analysis = QPointer<voAnalysis>(newAnalysis);
 }
@@ -286,3 +294,54 @@ void voAnalysisParameterEditorWidget::cloneAnalysis()
 
   emit runAnalysisRequested(d->Analysis->objectName(), parameters);
 }
+
+// --------------------------------------------------------------------------
+void voAnalysisParameterEditorWidget::sweepAnalysis()
+{
+  Q_D(voAnalysisParameterEditorWidget);
+  if (!d->Analysis)
+    {
+    return;
+    }
+
+  // Start from the current values, to be turned into lists or ranges
+  QStringList currentValues;
+  foreach(QtProperty * localProp, d->LocalPropertyManager.properties())
+    {
+    QtVariantProperty * localVariantProp = dynamic_cast<QtVariantProperty*>(localProp);
+    Q_ASSERT(localVariantProp);
+    if (localVariantProp->propertyType() == QtVariantPropertyManager::groupTypeId())
+      {
+      continue;
+      }
+    // Strings may contain the separators of the grid
+    QString value = localVariantProp->propertyType() == QVariant::String ?
+      voAnalysisDriver::quoteParameterGridValue(localVariantProp->value().toString()) :
+      localVariantProp->valueText();
+    currentValues << QString("%1=%2").arg(localVariantProp->propertyId()).arg(value);
+    }
+
+  QString spec = currentValues.join("; ");
+  while (true)
+    {
+    bool ok = false;
+    spec = QInputDialog::getText(this, "Parameter Sweep",
+      "Values of the parameters to sweep, e.g. \"id=1,2,5; id2=1..10:2\".\n"
+      "Values containing ',' or ';' are enclosed in double quotes.\n"
+      "Every combination of the values is run.",
+      QLineEdit::Normal, spec, &ok);
+    if (!ok)
+      {
+      return;
+      }
+    QString errorString;
+    QHash<QString, QVariantList> parameterGrid =
+      voAnalysisDriver::parseParameterGrid(d->Analysis, spec, errorString);
+    if (!parameterGrid.isEmpty())
+      {
+      emit sweepAnalysisRequested(d->Analysis->objectName(), parameterGrid);
+      return;
+      }
+    QMessageBox::warning(this, "Parameter Sweep", errorString);
+    }
+}
@@ -42,12 +42,14 @@ public slots:
 signals:
   void runAnalysisRequested(const QString& analysisName, const QHash<QString, QVariant>& parameters);
   void updateAnalysisRequested(voAnalysis* analysis, const QHash<QString, QVariant>& parameters);
+  void sweepAnalysisRequested(const QString& analysisName, const QHash<QString, QVariantList>& parameterGrid);
 
 protected slots:
 
   void reset();
   void updateAnalysis();
   void cloneAnalysis();
+  void sweepAnalysis();
   void onLocalValueChanged(QtProperty *localProp, const QVariant &localValue);
 
 protected:
@@ -100,14 +100,38 @@ void voDataPropertyWidget::setPropertyDataObject(voDataObject* dataObject)
 // --------------------------------------------------------------------------
 void voDataPropertyWidget::setPropertyDataModelItem(voDataModelItem* dataModelItem)
 {
+ Q_D(voDataPropertyWidget);
  if ( !dataModelItem)
   {
   return;
   }
 
+ if (d->DataObject)
+  {
+  disconnect(d->DataObject, SIGNAL(timingsChanged()), this, SLOT(updateProperties()));
+  }
+ d->DataObject = QPointer<voDataObject>(dataModelItem->dataObject());
+ if (d->DataObject)
+  {
+  // Timings are added once the data is processed or rendered
+  connect(d->DataObject, SIGNAL(timingsChanged()), this, SLOT(updateProperties()));
+  }
+
+ this->updateProperties();
+}
+
+// --------------------------------------------------------------------------
+void voDataPropertyWidget::updateProperties()
+{
+ Q_D(voDataPropertyWidget);
+
  this->clear();
+ if (!d->DataObject)
+  {
+  return;
+  }
 
- QtVariantPropertyManager * propertyManager =  dataModelItem->dataObject()->variantPropertyManager();
+ QtVariantPropertyManager * propertyManager = d->DataObject->variantPropertyManager();
 
  /*
  //enable property editing
@@ -41,6 +41,10 @@ public:
 public slots:
   void setPropertyDataModelItem(voDataModelItem* dataModelItem);
 
+protected slots:
+  /// Show the properties of the current data object.
+  void updateProperties();
+
 protected:
   QScopedPointer<voDataPropertyWidgetPrivate> d_ptr;
 
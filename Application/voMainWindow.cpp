@@ -6,12 +6,14 @@
 #include <QDebug>
 #include <QDesktopWidget>
 #include <QFileDialog>
+#include <QInputDialog>
 #include <QItemSelection>
 #include <QMenu>
 #include <QMenuBar>
 #include <QMessageBox>
 #include <QPushButton>
 #include <QStatusBar>
+#include <QStringList>
 #include <QSignalMapper>
 #include <QToolBar>
 #include <QUrl>
@@ -37,12 +39,15 @@
 #include "voApplication.h"
 #include "voDataModel.h"
 #include "voDataModelItem.h"
+#include "voDataObject.h"
 #include "voDelimitedTextImportDialog.h"
 #include "voInputFileDataObject.h"
 #include "voIOManager.h"
 #include "voMainWindow.h"
+#include "voOpenTreeFetcher.h"
 #include "voOpenTreeLoadDialog.h"
 #include "voStartupView.h"
+#include "voTrace.h"
 #ifdef Visomics_BUILD_TESTING
   #include "voTestConfigure.h"
   #include "voQtTesting.h"
@@ -51,7 +56,12 @@
 #include "voViewManager.h"
 #include "voViewStackedWidget.h"
 #include "voRemoteAnalysisConnectionDialog.h"
+#include "voRemoteAnalysisMetricsDialog.h"
 
+// VTK includes
+#include <vtkDataSetAttributes.h>
+#include <vtkStringArray.h>
+#include <vtkTree.h>
 
 // --------------------------------------------------------------------------
 class voMainWindowPrivate: public Ui_voMainWindow
@@ -72,6 +82,7 @@ public:
   #endif
   voOpenTreeLoadDialog *openTreeLoadDialog;
   voRemoteAnalysisConnectionDialog *remoteAnalysisConnectionDialog;
+  voRemoteAnalysisMetricsDialog *remoteAnalysisMetricsDialog;
 
 };
 
@@ -112,6 +123,9 @@ voMainWindow::voMainWindow(QWidget * newParent)
   d->remoteAnalysisConnectionDialog = new voRemoteAnalysisConnectionDialog(this);
   d->remoteAnalysisConnectionDialog->hide();
 
+  d->remoteAnalysisMetricsDialog = new voRemoteAnalysisMetricsDialog(this);
+  d->remoteAnalysisMetricsDialog->hide();
+
   d->ErrorLogWidget.setErrorLogModel(voApplication::application()->errorLogModel());
 
   d->ViewStackedWidget = new voViewStackedWidget(this);
@@ -138,9 +152,14 @@ voMainWindow::voMainWindow(QWidget * newParent)
   connect(d->actionLoadSampleTable, SIGNAL(triggered()), this, SLOT(loadSampleTable()));
   connect(d->actionLoadSampleTreeHeatmap, SIGNAL(triggered()), this, SLOT(loadSampleTreeHeatmap()));
   connect(d->actionViewErrorLog, SIGNAL(triggered()), this, SLOT(onViewErrorLogActionTriggered()));
+  connect(d->actionViewExportTrace, SIGNAL(triggered()), this, SLOT(onViewExportTraceActionTriggered()));
+  connect(d->actionViewRemoteAnalysisMetrics, SIGNAL(triggered()),
+          this, SLOT(onViewRemoteAnalysisMetricsActionTriggered()));
   connect(d->actionFileSaveWorkflow, SIGNAL(triggered()), this, SLOT(onFileSaveWorkflowActionTriggered()));
   connect(d->actionFileLoadWorkflow, SIGNAL(triggered()), this, SLOT(onFileLoadWorkflowActionTriggered()));
   connect(d->actionFileOpenTreeOfLife, SIGNAL(triggered()), this, SLOT(onFileOpenTreeOfLifeActionTriggered()));
+  connect(d->actionFileExpandTreeOfLifeTip, SIGNAL(triggered()),
+          this, SLOT(onFileExpandTreeOfLifeTipActionTriggered()));
   connect(d->actionFileMakeTreeHeatmap, SIGNAL(triggered()),
           this, SLOT(onFileMakeTreeHeatmapActionTriggered()));
   connect(d->actionRemoteAnalysisSettings, SIGNAL(triggered()), this, SLOT(onRemoteAnalysisSettingTriggered()));
@@ -226,6 +245,11 @@ voMainWindow::voMainWindow(QWidget * newParent)
           voApplication::application()->analysisDriver(),
           SLOT(runAnalysisForCurrentInput(const QString&, const QHash<QString, QVariant>&)));
 
+  connect(d->AnalysisParameterEditorWidget,
+          SIGNAL(sweepAnalysisRequested(const QString&, const QHash<QString, QVariantList>&)),
+          voApplication::application()->analysisDriver(),
+          SLOT(runAnalysisSweepForCurrentInput(const QString&, const QHash<QString, QVariantList>&)));
+
   connect(d->AnalysisParameterEditorWidget,
           SIGNAL(updateAnalysisRequested(voAnalysis*, const QHash<QString, QVariant>&)),
           voApplication::application()->analysisDriver(),
@@ -252,6 +276,16 @@ voMainWindow::voMainWindow(QWidget * newParent)
           voApplication::application()->analysisDriver(),
           SLOT(updateRemoteAnalysisUrl(QUrl *)));
 
+  connect(voApplication::application()->ioManager()->openTreeFetcher(),
+          SIGNAL(treeFetched(int, const QString&, int, const QString&)),
+          this,
+          SLOT(onOpenTreeFetched(int, const QString&, int, const QString&)));
+
+  connect(voApplication::application()->ioManager()->openTreeFetcher(),
+          SIGNAL(fetchFailed(int, const QString&, int, const QString&)),
+          this,
+          SLOT(onOpenTreeFetchFailed(int, const QString&, int, const QString&)));
+
   // Initialize status bar
   this->statusBar()->showMessage(tr(""), 2000);
 }
@@ -524,6 +558,32 @@ void voMainWindow::onViewErrorLogActionTriggered()
   d->ErrorLogWidget.raise();
 }
 
+// --------------------------------------------------------------------------
+void voMainWindow::onViewExportTraceActionTriggered()
+{
+  QString fileName =
+    QFileDialog::getSaveFileName(this, tr("Export Trace"), "trace.json",
+                                 tr("Chrome trace file (*.json)"));
+  if (fileName.isEmpty())
+    {
+    return;
+    }
+  if (!voTrace::exportChromeTrace(fileName))
+    {
+    QMessageBox::critical(this, tr("Export Trace"),
+                          tr("Failed to write %1").arg(fileName));
+    }
+}
+
+// --------------------------------------------------------------------------
+void voMainWindow::onViewRemoteAnalysisMetricsActionTriggered()
+{
+  Q_D(voMainWindow);
+  d->remoteAnalysisMetricsDialog->show();
+  d->remoteAnalysisMetricsDialog->activateWindow();
+  d->remoteAnalysisMetricsDialog->raise();
+}
+
 // --------------------------------------------------------------------------
 void voMainWindow::onFileSaveWorkflowActionTriggered()
 {
@@ -556,7 +616,71 @@ void voMainWindow::onFileOpenTreeOfLifeActionTriggered()
     QString maxDepth = d->openTreeLoadDialog->GetMaxDepth();
     voApplication::application()->ioManager()->loadTreeFromOpenTreeDB(
       databaseURL, ottolId, maxDepth);
+    this->statusBar()->showMessage(tr("Fetching tree %1 from OpenTreeOfLife...").arg(ottolId));
+    }
+}
+
+// --------------------------------------------------------------------------
+void voMainWindow::onFileExpandTreeOfLifeTipActionTriggered()
+{
+  Q_D(voMainWindow);
+  voDataModelItem * item = voApplication::application()->dataModel()->selectedInputObject();
+  voDataObject * treeObject = item ? item->dataObject() : 0;
+  vtkTree * tree = treeObject ? vtkTree::SafeDownCast(treeObject->dataAsVTKDataObject()) : 0;
+  vtkStringArray * names = tree ? vtkStringArray::SafeDownCast(
+    tree->GetVertexData()->GetAbstractArray("node name")) : 0;
+  QStringList tips;
+  for (vtkIdType vertex = 0; names && vertex < tree->GetNumberOfVertices(); ++vertex)
+    {
+    QString name(names->GetValue(vertex));
+    if (tree->IsLeaf(vertex) && !voOpenTreeFetcher::ottolIDFromLabel(name).isEmpty())
+      {
+      tips << name;
+      }
     }
+  if (tips.isEmpty())
+    {
+    QMessageBox::information(this, tr("Expand Tree Of Life Tip"),
+      tr("Select a tree whose tips are labelled with their OTT id, e.g. Homo_sapiens_ott770315."));
+    return;
+    }
+  tips.sort();
+
+  bool ok = false;
+  QString tip = QInputDialog::getItem(this, tr("Expand Tree Of Life Tip"),
+                                      tr("Tip:"), tips, 0, false, &ok);
+  if (!ok)
+    {
+    return;
+    }
+  int maxDepth = QInputDialog::getInt(this, tr("Expand Tree Of Life Tip"), tr("Depth:"),
+                                      d->openTreeLoadDialog->GetMaxDepth().toInt(), 1, 100, 1, &ok);
+  if (!ok)
+    {
+    return;
+    }
+  voApplication::application()->ioManager()->expandOpenTreeTip(
+    treeObject, tip, d->openTreeLoadDialog->GetHostURL(), maxDepth);
+  this->statusBar()->showMessage(tr("Fetching the descendants of %1 from OpenTreeOfLife...").arg(tip));
+}
+
+// --------------------------------------------------------------------------
+void voMainWindow::onOpenTreeFetched(int requestId, const QString& ottolID, int maxDepth,
+                                     const QString& newick)
+{
+  voApplication::application()->ioManager()->addOpenTree(requestId, ottolID, maxDepth, newick);
+  this->statusBar()->clearMessage();
+}
+
+// --------------------------------------------------------------------------
+void voMainWindow::onOpenTreeFetchFailed(int requestId, const QString& ottolID, int maxDepth,
+                                         const QString& errorMessage)
+{
+  Q_UNUSED(maxDepth);
+  voApplication::application()->ioManager()->openTreeFetchFailed(requestId);
+  this->statusBar()->clearMessage();
+  QMessageBox::warning(this, tr("Open Tree Of Life"),
+    tr("Failed to load the tree %1 from OpenTreeOfLife database!\n%2").arg(ottolID).arg(errorMessage));
 }
 
 #ifdef Visomics_BUILD_TESTING
@@ -52,12 +52,15 @@ public slots:
   void onFileOpenActionTriggered();
   void onCloseActionTriggered();
   void onViewErrorLogActionTriggered();
+  void onViewExportTraceActionTriggered();
+  void onViewRemoteAnalysisMetricsActionTriggered();
   void onFileSaveWorkflowActionTriggered();
   void onFileLoadWorkflowActionTriggered();
 #ifdef Visomics_BUILD_TESTING
   void playTest(QString filename);
 #endif
   void onFileOpenTreeOfLifeActionTriggered();
+  void onFileExpandTreeOfLifeTipActionTriggered();
   void onFileMakeTreeHeatmapActionTriggered();
 
   void about();
@@ -81,6 +84,10 @@ protected slots:
   void setViewActions(const QString& objectUuid, voView* newView);
   void makeTreeHeatmap();
   void makeTreeHeatmapDialogClosed();
+  void onOpenTreeFetched(int requestId, const QString& ottolID, int maxDepth,
+                         const QString& newick);
+  void onOpenTreeFetchFailed(int requestId, const QString& ottolID, int maxDepth,
+                             const QString& errorMessage);
 
 protected:
   QScopedPointer<voMainWindowPrivate> d_ptr;
@@ -0,0 +1,169 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+// Qt includes
+#include <QDialogButtonBox>
+#include <QHeaderView>
+#include <QPushButton>
+#include <QTableWidget>
+#include <QVBoxLayout>
+
+// Visomics includes
+#include "voRemoteAnalysisMetrics.h"
+#include "voRemoteAnalysisMetricsDialog.h"
+#include "voTrace.h"
+
+// --------------------------------------------------------------------------
+class voRemoteAnalysisMetricsDialogPrivate
+{
+  Q_DECLARE_PUBLIC(voRemoteAnalysisMetricsDialog);
+protected:
+  voRemoteAnalysisMetricsDialog* const q_ptr;
+
+public:
+  voRemoteAnalysisMetricsDialogPrivate(voRemoteAnalysisMetricsDialog& object);
+  void init();
+  void setItem(int row, int column, const QString& text);
+
+  QTableWidget* Table;
+};
+
+// --------------------------------------------------------------------------
+// voRemoteAnalysisMetricsDialogPrivate methods
+
+// --------------------------------------------------------------------------
+voRemoteAnalysisMetricsDialogPrivate::voRemoteAnalysisMetricsDialogPrivate(
+  voRemoteAnalysisMetricsDialog& object)
+  :q_ptr(&object), Table(0)
+{
+}
+
+// --------------------------------------------------------------------------
+void voRemoteAnalysisMetricsDialogPrivate::init()
+{
+  Q_Q(voRemoteAnalysisMetricsDialog);
+
+  q->setWindowTitle(voRemoteAnalysisMetricsDialog::tr("Remote Analysis Metrics"));
+
+  this->Table = new QTableWidget(q);
+  this->Table->setColumnCount(9);
+  this->Table->setHorizontalHeaderLabels(QStringList()
+    << voRemoteAnalysisMetricsDialog::tr("Analysis")
+    << voRemoteAnalysisMetricsDialog::tr("Stage")
+    << voRemoteAnalysisMetricsDialog::tr("Jobs")
+    << voRemoteAnalysisMetricsDialog::tr("Median")
+    << voRemoteAnalysisMetricsDialog::tr("90th percentile")
+    << voRemoteAnalysisMetricsDialog::tr("99th percentile")
+    << voRemoteAnalysisMetricsDialog::tr("Maximum")
+    << voRemoteAnalysisMetricsDialog::tr("Mean size")
+    << voRemoteAnalysisMetricsDialog::tr("Throughput"));
+  this->Table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+  this->Table->setSelectionBehavior(QAbstractItemView::SelectRows);
+  this->Table->verticalHeader()->hide();
+  this->Table->horizontalHeader()->setStretchLastSection(true);
+
+  QDialogButtonBox* buttonBox = new QDialogButtonBox(QDialogButtonBox::Close, Qt::Horizontal, q);
+  QPushButton* refreshButton =
+    buttonBox->addButton(voRemoteAnalysisMetricsDialog::tr("&Refresh"), QDialogButtonBox::ActionRole);
+  QPushButton* clearButton =
+    buttonBox->addButton(voRemoteAnalysisMetricsDialog::tr("C&lear"), QDialogButtonBox::ResetRole);
+  QObject::connect(refreshButton, SIGNAL(clicked()), q, SLOT(refresh()));
+  QObject::connect(clearButton, SIGNAL(clicked()), q, SLOT(clear()));
+  QObject::connect(buttonBox, SIGNAL(rejected()), q, SLOT(reject()));
+
+  QVBoxLayout* layout = new QVBoxLayout(q);
+  layout->addWidget(this->Table);
+  layout->addWidget(buttonBox);
+  q->resize(800, 400);
+}
+
+// --------------------------------------------------------------------------
+void voRemoteAnalysisMetricsDialogPrivate::setItem(int row, int column, const QString& text)
+{
+  QTableWidgetItem* item = new QTableWidgetItem(text);
+  if (column >= 2)
+    {
+    item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    }
+  this->Table->setItem(row, column, item);
+}
+
+// --------------------------------------------------------------------------
+// voRemoteAnalysisMetricsDialog methods
+
+// --------------------------------------------------------------------------
+voRemoteAnalysisMetricsDialog::voRemoteAnalysisMetricsDialog(QWidget* newParent)
+  : Superclass(newParent), d_ptr(new voRemoteAnalysisMetricsDialogPrivate(*this))
+{
+  Q_D(voRemoteAnalysisMetricsDialog);
+  d->init();
+}
+
+// --------------------------------------------------------------------------
+voRemoteAnalysisMetricsDialog::~voRemoteAnalysisMetricsDialog()
+{
+}
+
+// --------------------------------------------------------------------------
+void voRemoteAnalysisMetricsDialog::refresh()
+{
+  Q_D(voRemoteAnalysisMetricsDialog);
+  d->Table->setRowCount(0);
+  foreach(const QString& analysisName, voRemoteAnalysisMetrics::analysisNames())
+    {
+    foreach(const QString& stage, voRemoteAnalysisMetrics::stages())
+      {
+      voRemoteAnalysisMetrics::Summary summary =
+        voRemoteAnalysisMetrics::summary(analysisName, stage);
+      if (summary.Count == 0)
+        {
+        continue;
+        }
+      int row = d->Table->rowCount();
+      d->Table->insertRow(row);
+      d->setItem(row, 0, analysisName);
+      d->setItem(row, 1, stage);
+      d->setItem(row, 2, QString::number(summary.Count));
+      d->setItem(row, 3, voTrace::formatTiming(summary.Median));
+      d->setItem(row, 4, voTrace::formatTiming(summary.Percentile90));
+      d->setItem(row, 5, voTrace::formatTiming(summary.Percentile99));
+      d->setItem(row, 6, voTrace::formatTiming(summary.Maximum));
+      d->setItem(row, 7, summary.MeanBytes < 0 ? QString() :
+                 QString("%1 KB").arg(summary.MeanBytes / 1024., 0, 'f', 1));
+      d->setItem(row, 8, summary.Throughput < 0 ? QString() :
+                 QString("%1 MB/s").arg(summary.Throughput / (1024. * 1024.), 0, 'f', 2));
+      }
+    }
+  d->Table->resizeColumnsToContents();
+}
+
+// --------------------------------------------------------------------------
+void voRemoteAnalysisMetricsDialog::clear()
+{
+  voRemoteAnalysisMetrics::clear();
+  this->refresh();
+}
+
+// --------------------------------------------------------------------------
+void voRemoteAnalysisMetricsDialog::showEvent(QShowEvent* event)
+{
+  this->refresh();
+  this->Superclass::showEvent(event);
+}
@@ -0,0 +1,54 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+#ifndef __voRemoteAnalysisMetricsDialog_h
+#define __voRemoteAnalysisMetricsDialog_h
+
+// Qt includes
+#include <QDialog>
+#include <QScopedPointer>
+
+class voRemoteAnalysisMetricsDialogPrivate;
+
+/// Percentiles of the duration of each stage of the remote analysis jobs,
+/// per analysis type. See voRemoteAnalysisMetrics.
+class voRemoteAnalysisMetricsDialog : public QDialog
+{
+  Q_OBJECT
+public:
+  typedef QDialog Superclass;
+  voRemoteAnalysisMetricsDialog(QWidget* newParent = 0);
+  virtual ~voRemoteAnalysisMetricsDialog();
+
+public slots:
+  void refresh();
+  void clear();
+
+protected:
+  virtual void showEvent(QShowEvent* event);
+
+  QScopedPointer<voRemoteAnalysisMetricsDialogPrivate> d_ptr;
+
+private:
+  Q_DECLARE_PRIVATE(voRemoteAnalysisMetricsDialog);
+  Q_DISABLE_COPY(voRemoteAnalysisMetricsDialog);
+};
+
+#endif
@@ -0,0 +1,170 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+// Qt includes
+#include <QBuffer>
+#include <QByteArray>
+#include <QList>
+
+// Visomics includes
+#include "voRemoteAnalysisProtocol.h"
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+
+//-----------------------------------------------------------------------------
+int voRemoteAnalysisProtocolTest(int argc, char * argv [])
+{
+  Q_UNUSED(argc);
+  Q_UNUSED(argv);
+
+  QByteArray header("{\"name\":\"test\"}");
+  QByteArray small("small payload");
+  QByteArray large(voRemoteAnalysisProtocol::CompressionThreshold * 4, 'x');
+
+  // Small payloads are not worth compressing
+  QByteArray compressed;
+  if (voRemoteAnalysisProtocol::compressPayload(small.constData(), small.size(), compressed))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with compressPayload()"
+              << " - small payload should not be compressed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if (!voRemoteAnalysisProtocol::compressPayload(large.constData(), large.size(), compressed)
+      || compressed.size() >= large.size())
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with compressPayload()"
+              << " - large payload should be compressed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  QByteArray body;
+  voRemoteAnalysisProtocol::writeHeader(body, header);
+  voRemoteAnalysisProtocol::writeFrame(body, small.constData(), small.size());
+  voRemoteAnalysisProtocol::writeFrame(body, compressed.constData(), compressed.size());
+  voRemoteAnalysisProtocol::writeFrame(body, "", 0);
+
+  if (!voRemoteAnalysisProtocol::isFramed(body) || voRemoteAnalysisProtocol::isFramed(header))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with isFramed()" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  QByteArray readHeader;
+  QList<QByteArray> frames;
+  if (!voRemoteAnalysisProtocol::readFrames(body, readHeader, frames))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with readFrames()" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if (readHeader != header || frames.size() != 3)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with readFrames()"
+              << " - header: " << readHeader.constData()
+              << " - frame count: " << frames.size() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  QByteArray decoded;
+  if (!voRemoteAnalysisProtocol::decodePayload("raw", frames.at(0), decoded) || decoded != small)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with decodePayload(\"raw\")" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if (!voRemoteAnalysisProtocol::decodePayload("zlib", frames.at(1), decoded) || decoded != large)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with decodePayload(\"zlib\")" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if (!frames.at(2).isEmpty())
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with readFrames()"
+              << " - empty frame expected" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if (voRemoteAnalysisProtocol::decodePayload("unknown", frames.at(0), decoded))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with decodePayload()"
+              << " - unknown encoding should fail" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // A truncated message is rejected
+  if (voRemoteAnalysisProtocol::readFrames(body.left(body.size() - 10), readHeader, frames))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with readFrames()"
+              << " - truncated body should fail" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Feed the message to the incremental reader in small chunks
+  voRemoteAnalysisProtocol::FrameReader frameReader;
+  QList<QByteArray> streamedFrames;
+  const int chunkSize = 7;
+  for (int position = 0; position < body.size(); position += chunkSize)
+    {
+    QByteArray chunk = body.mid(position, chunkSize);
+    QBuffer buffer(&chunk);
+    buffer.open(QIODevice::ReadOnly);
+    if (!frameReader.read(&buffer))
+      {
+      std::cerr << "Line " << __LINE__ << " - Problem with FrameReader::read()" << std::endl;
+      return EXIT_FAILURE;
+      }
+    while (frameReader.hasFrame())
+      {
+      if (frameReader.nextFrameIndex() != streamedFrames.size())
+        {
+        std::cerr << "Line " << __LINE__ << " - Problem with FrameReader::nextFrameIndex()" << std::endl;
+        return EXIT_FAILURE;
+        }
+      streamedFrames << frameReader.takeFrame();
+      }
+    }
+
+  if (!frameReader.hasHeader() || frameReader.header() != header
+      || !frameReader.atFrameBoundary() || streamedFrames.size() != 3
+      || streamedFrames.at(0) != small || streamedFrames.at(1) != compressed
+      || !streamedFrames.at(2).isEmpty())
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with FrameReader"
+              << " - frame count: " << streamedFrames.size() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Anything but a framed message is rejected
+  QBuffer jsonBuffer(&header);
+  jsonBuffer.open(QIODevice::ReadOnly);
+  voRemoteAnalysisProtocol::FrameReader jsonReader;
+  if (jsonReader.read(&jsonBuffer))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with FrameReader::read()"
+              << " - JSON body should be rejected" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
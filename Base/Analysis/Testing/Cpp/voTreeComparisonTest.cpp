@@ -0,0 +1,201 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+// Qt includes
+#include <QApplication>
+
+// Visomics includes
+#include "voDataObject.h"
+#include "voTreeComparison.h"
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkDataSetAttributes.h>
+#include <vtkDoubleArray.h>
+#include <vtkMath.h>
+#include <vtkMutableDirectedGraph.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkStringArray.h>
+#include <vtkTable.h>
+#include <vtkTree.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+
+// --------------------------------------------------------------------------
+// Tree with a root, two internal vertices and four leaves:
+// (( names[3], names[4] )names[1], ( names[5], names[6] )names[2] )names[0]
+vtkSmartPointer<vtkTree> createTree(const char * names[7], double leafWeightOffset)
+{
+  vtkNew<vtkMutableDirectedGraph> graph;
+  vtkIdType root = graph->AddVertex();
+  vtkIdType left = graph->AddChild(root);
+  vtkIdType right = graph->AddChild(root);
+  graph->AddChild(left);
+  graph->AddChild(left);
+  graph->AddChild(right);
+  graph->AddChild(right);
+
+  vtkNew<vtkStringArray> nodeNames;
+  nodeNames->SetName("node name");
+  vtkNew<vtkDoubleArray> nodeWeights;
+  nodeWeights->SetName("node weight");
+  for (int vertex = 0; vertex < 7; ++vertex)
+    {
+    nodeNames->InsertNextValue(names[vertex]);
+    nodeWeights->InsertNextValue(vertex + (vertex >= 3 ? leafWeightOffset : 0.));
+    }
+  graph->GetVertexData()->AddArray(nodeNames.GetPointer());
+  graph->GetVertexData()->AddArray(nodeWeights.GetPointer());
+
+  vtkNew<vtkDoubleArray> weights;
+  weights->SetName("weight");
+  for (vtkIdType edge = 0; edge < graph->GetNumberOfEdges(); ++edge)
+    {
+    weights->InsertNextValue(1.);
+    }
+  graph->GetEdgeData()->AddArray(weights.GetPointer());
+
+  vtkSmartPointer<vtkTree> tree = vtkSmartPointer<vtkTree>::New();
+  tree->CheckedShallowCopy(graph.GetPointer());
+  return tree;
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int voTreeComparisonTest(int argc, char * argv [])
+{
+  QApplication app(argc, argv);
+
+  const char * referenceNames[7] = {"root", "AB", "CD", "A", "B", "C", "D"};
+  vtkSmartPointer<vtkTree> reference = createTree(referenceNames, 0.);
+  // Unnamed internal vertices, A and B are swapped with C
+  const char * swappedNames[7] = {"", "", "", "A", "C", "B", "D"};
+  vtkSmartPointer<vtkTree> swapped = createTree(swappedNames, 1.);
+
+  // Identical trees
+  QVector<double> differences;
+  voTreeComparison::Distances distances =
+    voTreeComparison::compareTrees(reference, reference, "node weight", &differences);
+  if (distances.RobinsonFoulds != 0 || distances.WeightedRobinsonFoulds != 0.
+      || distances.NumberOfSharedLeaves != 4)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with compareTrees()"
+              << " - identical trees should have a null distance !" << std::endl;
+    return EXIT_FAILURE;
+    }
+  for (int vertex = 0; vertex < differences.size(); ++vertex)
+    {
+    if (differences.at(vertex) != 0.)
+      {
+      std::cerr << "Line " << __LINE__ << " - Problem with compareTrees()"
+                << " - vertex " << vertex << " should have a null difference !" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Different topologies: clades AB and CD against AC and BD
+  distances = voTreeComparison::compareTrees(reference, swapped, "node weight", &differences);
+  if (distances.RobinsonFoulds != 4 || distances.NormalizedRobinsonFoulds != 1.
+      || fabs(distances.WeightedRobinsonFoulds - 4.) > 1e-9
+      || distances.NumberOfSharedLeaves != 4)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with compareTrees()"
+              << " - RobinsonFoulds:" << distances.RobinsonFoulds
+              << " NormalizedRobinsonFoulds:" << distances.NormalizedRobinsonFoulds
+              << " WeightedRobinsonFoulds:" << distances.WeightedRobinsonFoulds
+              << " NumberOfSharedLeaves:" << distances.NumberOfSharedLeaves << std::endl;
+    return EXIT_FAILURE;
+    }
+  // Leaves are matched by name: "B" is vertex 4 of the reference and 5 of
+  // the swapped tree.
+  if (differences.size() != 7 || differences.at(4) != 4. - 6.
+      || !vtkMath::IsNan(differences.at(1)))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with compareTrees()"
+              << " - unexpected differences !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Unnamed vertices are only matched if all their matched children share a
+  // parent: "A" is the root of the other tree, "B" a child of vertex 1.
+  const char * unnamedNames[7] = {"root", "", "CD", "A", "B", "C", "D"};
+  vtkSmartPointer<vtkTree> unnamed = createTree(unnamedNames, 0.);
+  const char * rootNames[7] = {"A", "", "", "B", "E", "F", "G"};
+  vtkSmartPointer<vtkTree> rooted = createTree(rootNames, 0.);
+  voTreeComparison::compareTrees(unnamed, rooted, "node weight", &differences);
+  if (differences.size() != 7 || !vtkMath::IsNan(differences.at(1)))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with compareTrees()"
+              << " - vertex 1 should not be matched !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Reference compared to a forest
+  voTreeComparison analysis;
+  analysis.addInput(new voDataObject("reference", reference.GetPointer()));
+  analysis.addInput(new voDataObject("same", reference.GetPointer()));
+  analysis.addInput(new voDataObject("swapped", swapped.GetPointer()));
+  analysis.initializeOutputInformation();
+  analysis.initializeParameterInformation();
+  if (!analysis.run())
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with run() !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  vtkTable * distancesTable = analysis.output("distances") ?
+    vtkTable::SafeDownCast(analysis.output("distances")->dataAsVTKDataObject()) : 0;
+  if (!distancesTable || distancesTable->GetNumberOfRows() != 2
+      || distancesTable->GetValueByName(0, "Robinson-Foulds").ToInt() != 0
+      || distancesTable->GetValueByName(1, "Robinson-Foulds").ToInt() != 4)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with run()"
+              << " - unexpected distances !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  vtkTree * comparisonTree = analysis.output("comparisonTree") ?
+    vtkTree::SafeDownCast(analysis.output("comparisonTree")->dataAsVTKDataObject()) : 0;
+  vtkDataArray * averageDifferences = comparisonTree ?
+    comparisonTree->GetVertexData()->GetArray("differences") : 0;
+  if (!averageDifferences || averageDifferences->GetTuple1(4) != -1.
+      || averageDifferences->GetTuple1(1) != 0.)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with run()"
+              << " - unexpected differences !" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (reference->GetVertexData()->GetArray("differences"))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with run()"
+              << " - the reference tree should not be modified !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
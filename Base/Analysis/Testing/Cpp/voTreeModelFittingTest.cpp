@@ -0,0 +1,207 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+// Qt includes
+#include <QApplication>
+
+// Visomics includes
+#include "voDataObject.h"
+#include "voIOManager.h"
+#include "voTableDataObject.h"
+#include "voTreeModelFitting.h"
+
+// VTK includes
+#include <vtkDataSetAttributes.h>
+#include <vtkDoubleArray.h>
+#include <vtkExtendedTable.h>
+#include <vtkMath.h>
+#include <vtkMutableDirectedGraph.h>
+#include <vtkNew.h>
+#include <vtkStringArray.h>
+#include <vtkTable.h>
+#include <vtkTree.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+
+// --------------------------------------------------------------------------
+bool fuzzyCompare(double value, double expected)
+{
+  return fabs(value - expected) < 1e-9;
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int voTreeModelFittingTest(int argc, char * argv [])
+{
+  QApplication app(argc, argv);
+
+  // ((A:1,B:2)L:1,(C:1.5,D:1)R:0.5)
+  vtkNew<vtkMutableDirectedGraph> graph;
+  vtkIdType root = graph->AddVertex();
+  vtkIdType left = graph->AddChild(root);
+  vtkIdType right = graph->AddChild(root);
+  graph->AddChild(left);
+  graph->AddChild(left);
+  graph->AddChild(right);
+  graph->AddChild(right);
+  const double branchLengths[6] = {1., 0.5, 1., 2., 1.5, 1.};
+  vtkNew<vtkDoubleArray> weights;
+  weights->SetName("weight");
+  for (int edge = 0; edge < 6; ++edge)
+    {
+    weights->InsertNextValue(branchLengths[edge]);
+    }
+  graph->GetEdgeData()->AddArray(weights.GetPointer());
+  const char * names[7] = {"", "L", "R", "A", "B", "C", "D"};
+  vtkNew<vtkStringArray> nodeNames;
+  nodeNames->SetName("node name");
+  for (int vertex = 0; vertex < 7; ++vertex)
+    {
+    nodeNames->InsertNextValue(names[vertex]);
+    }
+  graph->GetVertexData()->AddArray(nodeNames.GetPointer());
+  vtkNew<vtkTree> tree;
+  tree->CheckedShallowCopy(graph.GetPointer());
+
+  QVector<double> values(7, vtkMath::Nan());
+  values[3] = 1.;
+  values[4] = 2.5;
+  values[5] = 4.;
+  values[6] = 3.;
+
+  // Expected values are computed from the covariance matrix of the tips
+  double z0 = 0.;
+  double sigsq = 0.;
+  double logLikelihood =
+    voTreeModelFitting::logLikelihood(tree.GetPointer(), values, "BM", 0., &z0, &sigsq);
+  if (!fuzzyCompare(logLikelihood, -6.009791111283948)
+      || !fuzzyCompare(z0, 2.644578313253012) || !fuzzyCompare(sigsq, 0.6137048192771084))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with logLikelihood() for BM"
+              << " - lnL:" << logLikelihood << " z0:" << z0 << " sigsq:" << sigsq << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  logLikelihood = voTreeModelFitting::logLikelihood(tree.GetPointer(), values, "OU", 0.3);
+  if (!fuzzyCompare(logLikelihood, -6.095331856742927))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with logLikelihood() for OU"
+              << " - lnL:" << logLikelihood << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  logLikelihood = voTreeModelFitting::logLikelihood(tree.GetPointer(), values, "EB", -0.4);
+  if (!fuzzyCompare(logLikelihood, -6.031838004426241))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with logLikelihood() for EB"
+              << " - lnL:" << logLikelihood << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Tips without value are dropped
+  QVector<double> missingValues(values);
+  missingValues[6] = vtkMath::Nan();
+  logLikelihood = voTreeModelFitting::logLikelihood(tree.GetPointer(), missingValues, "BM", 0.);
+  if (!fuzzyCompare(logLikelihood, -5.107102102917814))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with logLikelihood()"
+              << " - lnL:" << logLikelihood << " with a missing value" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // BM is nested in OU and EB: their fit can only be better
+  voTreeModelFitting::Fit bmFit = voTreeModelFitting::fitModel(tree.GetPointer(), values, "BM");
+  voTreeModelFitting::Fit ouFit = voTreeModelFitting::fitModel(tree.GetPointer(), values, "OU");
+  voTreeModelFitting::Fit ebFit = voTreeModelFitting::fitModel(tree.GetPointer(), values, "EB");
+  if (!fuzzyCompare(bmFit.LogLikelihood, -6.009791111283948) || bmFit.NumberOfTips != 4
+      || ouFit.LogLikelihood < bmFit.LogLikelihood - 1e-6 || ouFit.Parameter <= 0.
+      || ebFit.LogLikelihood < bmFit.LogLikelihood - 1e-6 || ebFit.Parameter >= 0.)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with fitModel()"
+              << " - BM lnL:" << bmFit.LogLikelihood
+              << " OU lnL:" << ouFit.LogLikelihood << " alpha:" << ouFit.Parameter
+              << " EB lnL:" << ebFit.LogLikelihood << " a:" << ebFit.Parameter << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Columns of a table are fit in one run
+  vtkNew<vtkTable> table;
+  vtkNew<vtkStringArray> tipNames;
+  tipNames->SetName("tip");
+  vtkNew<vtkDoubleArray> x;
+  x->SetName("x");
+  vtkNew<vtkDoubleArray> y;
+  y->SetName("y");
+  for (int vertex = 3; vertex < 7; ++vertex)
+    {
+    tipNames->InsertNextValue(names[vertex]);
+    x->InsertNextValue(values.at(vertex));
+    y->InsertNextValue(2. * values.at(vertex));
+    }
+  table->AddColumn(tipNames.GetPointer());
+  table->AddColumn(x.GetPointer());
+  table->AddColumn(y.GetPointer());
+  vtkNew<vtkExtendedTable> extendedTable;
+  voIOManager::convertTableToExtended(table.GetPointer(), extendedTable.GetPointer());
+
+  voTreeModelFitting analysis;
+  analysis.addInput(new voDataObject("tree", tree.GetPointer()));
+  analysis.addInput(new voTableDataObject("table", extendedTable.GetPointer()));
+  analysis.initializeOutputInformation();
+  analysis.initializeParameterInformation();
+  QHash<QString, QVariant> parameters;
+  // Enumeration values are indices: "OU", "BM", "EB"
+  parameters.insert("model_type", 1);
+  analysis.setParameterValues(parameters);
+  if (!analysis.run())
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with run() !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  vtkTable * resultTable = analysis.output("resultTable") ?
+    vtkTable::SafeDownCast(analysis.output("resultTable")->dataAsVTKDataObject()) : 0;
+  // Scaling the values by 2 scales the rate by 4
+  if (!resultTable || resultTable->GetNumberOfRows() != 2
+      || !fuzzyCompare(resultTable->GetValueByName(0, "lnL").ToDouble(), -6.009791111283948)
+      || !fuzzyCompare(resultTable->GetValueByName(1, "sigsq").ToDouble(), 4. * 0.6137048192771084)
+      || !fuzzyCompare(resultTable->GetValueByName(0, "AICc").ToDouble(),
+                       16.019582222567896 + 12.))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with run()"
+              << " - unexpected result table !" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (!analysis.output("resultTree"))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with run()"
+              << " - no result tree !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
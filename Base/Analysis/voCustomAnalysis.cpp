@@ -19,6 +19,7 @@
 =========================================================================*/
 
 // Qt includes
+#include <QCryptographicHash>
 #include <QDebug>
 
 // QtPropertyBrowser includes
@@ -84,6 +85,20 @@ void voCustomAnalysis::loadInformation(voCustomAnalysisInformation *info)
   d->Information = info;
 }
 
+// --------------------------------------------------------------------------
+QByteArray voCustomAnalysis::parametersHash()const
+{
+  Q_D(const voCustomAnalysis);
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(this->Superclass::parametersHash());
+  if (d->Information)
+    {
+    hash.addData(d->Information->scriptType().toUtf8());
+    hash.addData(d->Information->script().toUtf8());
+    }
+  return hash.result().toHex();
+}
+
 // --------------------------------------------------------------------------
 void voCustomAnalysis::setOutputInformation()
 {
@@ -39,6 +39,9 @@ public:
   virtual ~voCustomAnalysis();
   void loadInformation(voCustomAnalysisInformation *info);
 
+  /// The hash includes the script of the analysis.
+  virtual QByteArray parametersHash()const;
+
 protected:
   virtual void setOutputInformation();
   virtual void setParameterInformation();
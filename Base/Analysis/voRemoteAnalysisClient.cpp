@@ -0,0 +1,569 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+// Qt includes
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QPair>
+#include <QPointer>
+#include <QQueue>
+#include <QtNetwork/QAuthenticator>
+#include <QtNetwork/QNetworkAccessManager>
+#include <QtNetwork/QNetworkReply>
+#include <QtNetwork/QNetworkRequest>
+
+// Visomics includes
+#include "voRemoteAnalysisClient.h"
+
+namespace
+{
+// --------------------------------------------------------------------------
+// Return the method name of a SLOT() signature
+QByteArray methodName(const char* member)
+{
+  // SLOT() prefixes the signature with a code, strip it along with the
+  // argument list to get the method name expected by invokeMethod().
+  QByteArray method(member);
+  if (!method.isEmpty() && method.at(0) >= '0' && method.at(0) <= '9')
+    {
+    method.remove(0, 1);
+    }
+  int parenthesis = method.indexOf('(');
+  if (parenthesis >= 0)
+    {
+    method.truncate(parenthesis);
+    }
+  return method;
+}
+
+// Number of parallel connections QNetworkAccessManager opens per host
+const int ConnectionsPerHost = 6;
+
+// Time (in s) the server may hold a status request before answering.
+const int LongPollTimeout = 30;
+}
+
+// --------------------------------------------------------------------------
+class voRemoteAnalysisClientPrivate
+{
+public:
+  struct Request
+  {
+    Request() : Id(0), Post(false), Reply(0) {}
+    int Id;
+    bool Post;
+    QNetworkRequest NetworkRequest;
+    QByteArray Data;
+    QPointer<QObject> Receiver;
+    QByteArray Method;
+    QByteArray ReadyReadMethod;
+    QNetworkReply* Reply;
+  };
+
+  voRemoteAnalysisClientPrivate();
+
+  void enqueue(Request& request, QObject* receiver, const char* member);
+  void sendQueuedRequests();
+
+  QString payloadFileName(const voRemoteAnalysisClient::PreparedInput& input)const;
+  bool writePayload(const voRemoteAnalysisClient::PreparedInput& input);
+  void trimPreparedInputDirectory();
+  void removePreparedInputFiles();
+  /// Move the least recently used inputs to disk until the memory used is
+  /// below \a maximumCost (in KiB).
+  void evictPreparedInputs(int maximumCost);
+  static int preparedInputCost(const voRemoteAnalysisClient::PreparedInput& input);
+
+  voRemoteAnalysisClient* q_ptr;
+
+  QNetworkAccessManager NetworkManager;
+  int MaximumConcurrentRequests;
+  int NextRequestId;
+  QQueue<Request> QueuedRequests;
+  QHash<int, Request> ActiveRequests;
+  QHash<QString, QSet<QByteArray> > KnownBlobs;
+  // Prepared inputs kept in memory, from the least recently used
+  QHash<QString, voRemoteAnalysisClient::PreparedInput> PreparedInputs;
+  mutable QList<QString> PreparedInputKeys;
+  int PreparedInputCost;
+  int MaximumPreparedInputCost;
+  // Digest and encoding of the prepared inputs written to disk in this session
+  QHash<QString, QPair<QByteArray, QByteArray> > PreparedInputDigests;
+  QString PreparedInputDirectory;
+  qint64 MaximumPreparedInputDiskSize;
+};
+
+// --------------------------------------------------------------------------
+// voRemoteAnalysisClientPrivate methods
+
+// --------------------------------------------------------------------------
+voRemoteAnalysisClientPrivate::voRemoteAnalysisClientPrivate()
+{
+  this->MaximumConcurrentRequests = 16;
+  this->NextRequestId = 1;
+  this->q_ptr = 0;
+  this->PreparedInputCost = 0;
+  this->MaximumPreparedInputCost = 128 * 1024;
+  this->MaximumPreparedInputDiskSize = Q_INT64_C(4) * 1024 * 1024 * 1024;
+}
+
+// --------------------------------------------------------------------------
+QString voRemoteAnalysisClientPrivate::payloadFileName(
+  const voRemoteAnalysisClient::PreparedInput& input)const
+{
+  return QDir(this->PreparedInputDirectory).filePath(
+    QString("%1.%2").arg(QString(input.Digest)).arg(QString(input.Encoding)));
+}
+
+// --------------------------------------------------------------------------
+bool voRemoteAnalysisClientPrivate::writePayload(const voRemoteAnalysisClient::PreparedInput& input)
+{
+  if (this->PreparedInputDirectory.isEmpty())
+    {
+    return false;
+    }
+  QString fileName = this->payloadFileName(input);
+  if (QFile::exists(fileName))
+    {
+    return true;
+    }
+  QDir().mkpath(this->PreparedInputDirectory);
+  // Written under another name first: an interrupted write is never read
+  QFile file(fileName + ".part");
+  if (!file.open(QIODevice::WriteOnly)
+      || file.write(input.Payload) != input.Payload.size())
+    {
+    qWarning() << "voRemoteAnalysisClient - Failed to write" << file.fileName();
+    file.remove();
+    return false;
+    }
+  file.close();
+  if (!file.rename(fileName))
+    {
+    file.remove();
+    return false;
+    }
+  this->trimPreparedInputDirectory();
+  return true;
+}
+
+// --------------------------------------------------------------------------
+void voRemoteAnalysisClientPrivate::trimPreparedInputDirectory()
+{
+  QDir directory(this->PreparedInputDirectory);
+  QFileInfoList files = directory.entryInfoList(QDir::Files, QDir::Time | QDir::Reversed);
+  qint64 totalSize = 0;
+  foreach(const QFileInfo& fileInfo, files)
+    {
+    totalSize += fileInfo.size();
+    }
+  // Sorted from the oldest
+  for (int i = 0; i < files.size() && totalSize > this->MaximumPreparedInputDiskSize; ++i)
+    {
+    if (QFile::remove(files.at(i).absoluteFilePath()))
+      {
+      totalSize -= files.at(i).size();
+      }
+    }
+}
+
+// --------------------------------------------------------------------------
+void voRemoteAnalysisClientPrivate::removePreparedInputFiles()
+{
+  // The digests are not saved: payloads are not reused across sessions
+  QHash<QString, QPair<QByteArray, QByteArray> >::const_iterator it;
+  for (it = this->PreparedInputDigests.constBegin();
+       it != this->PreparedInputDigests.constEnd(); ++it)
+    {
+    voRemoteAnalysisClient::PreparedInput stored;
+    stored.Digest = it.value().first;
+    stored.Encoding = it.value().second;
+    QFile::remove(this->payloadFileName(stored));
+    }
+  this->PreparedInputDigests.clear();
+  if (!this->PreparedInputDirectory.isEmpty())
+    {
+    QDir().rmdir(this->PreparedInputDirectory);
+    }
+}
+
+// --------------------------------------------------------------------------
+int voRemoteAnalysisClientPrivate::preparedInputCost(
+  const voRemoteAnalysisClient::PreparedInput& input)
+{
+  return input.Payload.size() / 1024 + 1;
+}
+
+// --------------------------------------------------------------------------
+void voRemoteAnalysisClientPrivate::evictPreparedInputs(int maximumCost)
+{
+  while (this->PreparedInputCost > maximumCost && !this->PreparedInputKeys.isEmpty())
+    {
+    QString key = this->PreparedInputKeys.takeFirst();
+    voRemoteAnalysisClient::PreparedInput input = this->PreparedInputs.take(key);
+    this->PreparedInputCost -= preparedInputCost(input);
+    if (this->writePayload(input))
+      {
+      this->PreparedInputDigests.insert(key, qMakePair(input.Digest, input.Encoding));
+      }
+    }
+}
+
+// --------------------------------------------------------------------------
+void voRemoteAnalysisClientPrivate::enqueue(Request& request, QObject* receiver, const char* member)
+{
+  request.Id = this->NextRequestId++;
+  request.Receiver = receiver;
+  request.Method = methodName(member);
+  // Tag the request so that its reply can be routed back to the receiver
+  request.NetworkRequest.setAttribute(QNetworkRequest::User, request.Id);
+  this->QueuedRequests.enqueue(request);
+  this->sendQueuedRequests();
+}
+
+// --------------------------------------------------------------------------
+void voRemoteAnalysisClientPrivate::sendQueuedRequests()
+{
+  while (!this->QueuedRequests.isEmpty() &&
+         this->ActiveRequests.count() < this->MaximumConcurrentRequests)
+    {
+    Request request = this->QueuedRequests.dequeue();
+    if (!request.Receiver)
+      {
+      continue;
+      }
+    if (request.Post)
+      {
+      request.Reply = this->NetworkManager.post(request.NetworkRequest, request.Data);
+      }
+    else
+      {
+      request.Reply = this->NetworkManager.get(request.NetworkRequest);
+      }
+    // The network manager holds its own reference on the data
+    request.Data.clear();
+    if (!request.ReadyReadMethod.isEmpty())
+      {
+      QObject::connect(request.Reply, SIGNAL(readyRead()), this->q_ptr, SLOT(onReadyRead()));
+      }
+    this->ActiveRequests.insert(request.Id, request);
+    }
+}
+
+// --------------------------------------------------------------------------
+// voRemoteAnalysisClient methods
+
+// --------------------------------------------------------------------------
+voRemoteAnalysisClient::voRemoteAnalysisClient(QObject* newParent):
+    Superclass(newParent), d_ptr(new voRemoteAnalysisClientPrivate)
+{
+  Q_D(voRemoteAnalysisClient);
+  d->q_ptr = this;
+  connect(&d->NetworkManager, SIGNAL(finished(QNetworkReply*)),
+          this, SLOT(onFinished(QNetworkReply*)));
+  connect(&d->NetworkManager,
+          SIGNAL(authenticationRequired(QNetworkReply*, QAuthenticator*)),
+          this, SLOT(onAuthenticationRequired(QNetworkReply*, QAuthenticator*)));
+}
+
+// --------------------------------------------------------------------------
+voRemoteAnalysisClient::~voRemoteAnalysisClient()
+{
+  Q_D(voRemoteAnalysisClient);
+  d->removePreparedInputFiles();
+}
+
+// --------------------------------------------------------------------------
+int voRemoteAnalysisClient::maximumConcurrentRequests()const
+{
+  Q_D(const voRemoteAnalysisClient);
+  return d->MaximumConcurrentRequests;
+}
+
+// --------------------------------------------------------------------------
+void voRemoteAnalysisClient::setMaximumConcurrentRequests(int maximum)
+{
+  Q_D(voRemoteAnalysisClient);
+  d->MaximumConcurrentRequests = qMax(1, maximum);
+  d->sendQueuedRequests();
+}
+
+// --------------------------------------------------------------------------
+int voRemoteAnalysisClient::activeRequestCount()const
+{
+  Q_D(const voRemoteAnalysisClient);
+  return d->ActiveRequests.count();
+}
+
+// --------------------------------------------------------------------------
+int voRemoteAnalysisClient::queuedRequestCount()const
+{
+  Q_D(const voRemoteAnalysisClient);
+  return d->QueuedRequests.count();
+}
+
+// --------------------------------------------------------------------------
+int voRemoteAnalysisClient::longPollTimeout()const
+{
+  Q_D(const voRemoteAnalysisClient);
+  // Requests held by the server keep a connection busy: leave at least a
+  // couple of connections to submissions and downloads.
+  if (d->QueuedRequests.isEmpty() &&
+      d->ActiveRequests.count() < ConnectionsPerHost - 2)
+    {
+    return LongPollTimeout;
+    }
+  return 0;
+}
+
+// --------------------------------------------------------------------------
+void voRemoteAnalysisClient::get(const QNetworkRequest& networkRequest,
+                                 QObject* receiver, const char* member,
+                                 const char* readyReadMember)
+{
+  Q_D(voRemoteAnalysisClient);
+  voRemoteAnalysisClientPrivate::Request request;
+  request.NetworkRequest = networkRequest;
+  if (readyReadMember)
+    {
+    request.ReadyReadMethod = methodName(readyReadMember);
+    }
+  d->enqueue(request, receiver, member);
+}
+
+// --------------------------------------------------------------------------
+void voRemoteAnalysisClient::post(const QNetworkRequest& networkRequest, const QByteArray& data,
+                                  QObject* receiver, const char* member)
+{
+  Q_D(voRemoteAnalysisClient);
+  voRemoteAnalysisClientPrivate::Request request;
+  request.Post = true;
+  request.NetworkRequest = networkRequest;
+  request.Data = data;
+  d->enqueue(request, receiver, member);
+}
+
+// --------------------------------------------------------------------------
+void voRemoteAnalysisClient::cancel(QObject* receiver)
+{
+  Q_D(voRemoteAnalysisClient);
+  QQueue<voRemoteAnalysisClientPrivate::Request> queuedRequests;
+  foreach(const voRemoteAnalysisClientPrivate::Request& request, d->QueuedRequests)
+    {
+    if (request.Receiver != receiver)
+      {
+      queuedRequests.enqueue(request);
+      }
+    }
+  d->QueuedRequests = queuedRequests;
+
+  QList<QNetworkReply*> repliesToAbort;
+  QHash<int, voRemoteAnalysisClientPrivate::Request>::iterator it;
+  for (it = d->ActiveRequests.begin(); it != d->ActiveRequests.end(); ++it)
+    {
+    if (it.value().Receiver == receiver)
+      {
+      // The reply will still finish, but won't be delivered
+      it.value().Receiver = 0;
+      repliesToAbort << it.value().Reply;
+      }
+    }
+  foreach(QNetworkReply* reply, repliesToAbort)
+    {
+    reply->abort();
+    }
+}
+
+// --------------------------------------------------------------------------
+QSet<QByteArray>& voRemoteAnalysisClient::knownBlobs(const QString& baseUrl)
+{
+  Q_D(voRemoteAnalysisClient);
+  return d->KnownBlobs[baseUrl];
+}
+
+// --------------------------------------------------------------------------
+bool voRemoteAnalysisClient::preparedInput(const QString& key, PreparedInput& input,
+                                           bool loadPayload)const
+{
+  Q_D(const voRemoteAnalysisClient);
+  if (d->PreparedInputs.contains(key))
+    {
+    d->PreparedInputKeys.removeOne(key);
+    d->PreparedInputKeys.append(key);
+    input = d->PreparedInputs.value(key);
+    return true;
+    }
+  if (!d->PreparedInputDigests.contains(key))
+    {
+    return false;
+    }
+  // Too large to be kept in memory, or evicted
+  PreparedInput stored;
+  stored.Digest = d->PreparedInputDigests.value(key).first;
+  stored.Encoding = d->PreparedInputDigests.value(key).second;
+  QFile file(d->payloadFileName(stored));
+  if (!loadPayload)
+    {
+    input = stored;
+    return file.exists();
+    }
+  if (!file.open(QIODevice::ReadOnly))
+    {
+    return false;
+    }
+  stored.Payload = file.readAll();
+  input = stored;
+  return true;
+}
+
+// --------------------------------------------------------------------------
+void voRemoteAnalysisClient::insertPreparedInput(const QString& key, const PreparedInput& input)
+{
+  Q_D(voRemoteAnalysisClient);
+  if (d->PreparedInputs.contains(key))
+    {
+    d->PreparedInputCost -= d->preparedInputCost(d->PreparedInputs.take(key));
+    d->PreparedInputKeys.removeOne(key);
+    }
+  int cost = d->preparedInputCost(input);
+  if (cost > d->MaximumPreparedInputCost)
+    {
+    // Only kept on disk
+    if (d->writePayload(input))
+      {
+      d->PreparedInputDigests.insert(key, qMakePair(input.Digest, input.Encoding));
+      }
+    return;
+    }
+  d->evictPreparedInputs(d->MaximumPreparedInputCost - cost);
+  d->PreparedInputs.insert(key, input);
+  d->PreparedInputKeys.append(key);
+  d->PreparedInputCost += cost;
+}
+
+// --------------------------------------------------------------------------
+int voRemoteAnalysisClient::maximumPreparedInputCost()const
+{
+  Q_D(const voRemoteAnalysisClient);
+  return d->MaximumPreparedInputCost;
+}
+
+// --------------------------------------------------------------------------
+void voRemoteAnalysisClient::setMaximumPreparedInputCost(int kilobytes)
+{
+  Q_D(voRemoteAnalysisClient);
+  d->MaximumPreparedInputCost = kilobytes;
+  d->evictPreparedInputs(kilobytes);
+}
+
+// --------------------------------------------------------------------------
+QString voRemoteAnalysisClient::preparedInputDirectory()const
+{
+  Q_D(const voRemoteAnalysisClient);
+  return d->PreparedInputDirectory;
+}
+
+// --------------------------------------------------------------------------
+void voRemoteAnalysisClient::setPreparedInputDirectory(const QString& path)
+{
+  Q_D(voRemoteAnalysisClient);
+  d->removePreparedInputFiles();
+  d->PreparedInputDirectory = path;
+}
+
+// --------------------------------------------------------------------------
+qint64 voRemoteAnalysisClient::maximumPreparedInputDiskSize()const
+{
+  Q_D(const voRemoteAnalysisClient);
+  return d->MaximumPreparedInputDiskSize;
+}
+
+// --------------------------------------------------------------------------
+void voRemoteAnalysisClient::setMaximumPreparedInputDiskSize(qint64 bytes)
+{
+  Q_D(voRemoteAnalysisClient);
+  d->MaximumPreparedInputDiskSize = bytes;
+  if (!d->PreparedInputDirectory.isEmpty())
+    {
+    d->trimPreparedInputDirectory();
+    }
+}
+
+// --------------------------------------------------------------------------
+void voRemoteAnalysisClient::onFinished(QNetworkReply* reply)
+{
+  Q_D(voRemoteAnalysisClient);
+  int id = reply->request().attribute(QNetworkRequest::User).toInt();
+  voRemoteAnalysisClientPrivate::Request request = d->ActiveRequests.take(id);
+
+  // Let the next requests go before handing the reply over: the receiver
+  // may well queue a new request of its own.
+  d->sendQueuedRequests();
+
+  if (!request.Receiver)
+    {
+    reply->deleteLater();
+    return;
+    }
+  if (!QMetaObject::invokeMethod(request.Receiver, request.Method.constData(),
+                                 Qt::DirectConnection, Q_ARG(QNetworkReply*, reply)))
+    {
+    qCritical() << "voRemoteAnalysisClient - Failed to deliver reply to"
+                << request.Receiver->objectName() << "::" << request.Method;
+    reply->deleteLater();
+    }
+}
+
+// --------------------------------------------------------------------------
+void voRemoteAnalysisClient::onReadyRead()
+{
+  Q_D(voRemoteAnalysisClient);
+  QNetworkReply* reply = qobject_cast<QNetworkReply*>(this->sender());
+  if (!reply)
+    {
+    return;
+    }
+  int id = reply->request().attribute(QNetworkRequest::User).toInt();
+  voRemoteAnalysisClientPrivate::Request request = d->ActiveRequests.value(id);
+  if (!request.Receiver || request.ReadyReadMethod.isEmpty())
+    {
+    return;
+    }
+  QMetaObject::invokeMethod(request.Receiver, request.ReadyReadMethod.constData(),
+                            Qt::DirectConnection, Q_ARG(QNetworkReply*, reply));
+}
+
+// --------------------------------------------------------------------------
+void voRemoteAnalysisClient::onAuthenticationRequired(QNetworkReply* reply,
+                                                      QAuthenticator* authenticator)
+{
+  Q_D(voRemoteAnalysisClient);
+  int id = reply->request().attribute(QNetworkRequest::User).toInt();
+  if (!d->ActiveRequests.contains(id) || !d->ActiveRequests.value(id).Receiver)
+    {
+    return;
+    }
+  emit this->authenticationRequired(d->ActiveRequests.value(id).Receiver, reply, authenticator);
+}
@@ -0,0 +1,131 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+#ifndef __voRemoteAnalysisClient_h
+#define __voRemoteAnalysisClient_h
+
+// Qt includes
+#include <QByteArray>
+#include <QObject>
+#include <QScopedPointer>
+#include <QSet>
+#include <QString>
+
+class QAuthenticator;
+class QNetworkReply;
+class QNetworkRequest;
+
+class voRemoteAnalysisClientPrivate;
+
+/// Network client shared by all the remote analyses.
+///
+/// Requests are routed back to the object that issued them: once a reply is
+/// finished, the slot given to get() or post() is invoked on the receiver
+/// with the reply as argument. The receiver is responsible for deleting the
+/// reply (using deleteLater()).
+///
+/// At most maximumConcurrentRequests() requests are sent at once, the
+/// others are queued in submission order.
+class voRemoteAnalysisClient : public QObject
+{
+  Q_OBJECT
+public:
+  typedef QObject Superclass;
+  voRemoteAnalysisClient(QObject* newParent = 0);
+  virtual ~voRemoteAnalysisClient();
+
+  int maximumConcurrentRequests()const;
+  void setMaximumConcurrentRequests(int maximum);
+
+  int activeRequestCount()const;
+  int queuedRequestCount()const;
+
+  /// Time (in s) the server may hold a status request: zero when long
+  /// polling would starve the other requests of connections.
+  int longPollTimeout()const;
+
+  /// Send a request. \a member is a slot of \a receiver taking a
+  /// QNetworkReply*, as given by the SLOT() macro.
+  /// If \a readyReadMember is set, it is invoked each time new data arrives
+  /// so that large replies can be consumed while they are downloaded.
+  void get(const QNetworkRequest& request, QObject* receiver, const char* member,
+           const char* readyReadMember = 0);
+  void post(const QNetworkRequest& request, const QByteArray& data,
+            QObject* receiver, const char* member);
+
+  /// Drop the queued requests of \a receiver and abort its active ones.
+  void cancel(QObject* receiver);
+
+  /// Hashes of the input blobs the server at \a baseUrl is known to hold.
+  QSet<QByteArray>& knownBlobs(const QString& baseUrl);
+
+  /// Input serialized for upload. Jobs submitted with the same data (e.g.
+  /// the runs of a parameter sweep) share a single conversion.
+  struct PreparedInput
+  {
+    QByteArray Digest;   // SHA-1 of the serialized data, in hex
+    QByteArray Encoding; // "raw" or "zlib"
+    QByteArray Payload;
+  };
+
+  /// Return false if no input was prepared under \a key. Unless
+  /// \a loadPayload is true, the payload of an input kept on disk is not
+  /// read, e.g. when only its digest is sent to the server.
+  bool preparedInput(const QString& key, PreparedInput& input,
+                     bool loadPayload = true)const;
+  void insertPreparedInput(const QString& key, const PreparedInput& input);
+
+  /// Memory (in KiB) used by the prepared inputs. The least recently used
+  /// inputs are moved to disk when the maximum is exceeded, and inputs larger
+  /// than the maximum are only kept on disk.
+  int maximumPreparedInputCost()const;
+  void setMaximumPreparedInputCost(int kilobytes);
+
+  /// Directory where the payloads of the prepared inputs that don't fit in
+  /// memory are written, named after their hash. The payloads written are
+  /// removed when the client is destroyed or the directory changed. Payloads
+  /// are only kept in memory if empty.
+  QString preparedInputDirectory()const;
+  void setPreparedInputDirectory(const QString& path);
+
+  /// Disk space (in bytes) used by the prepared inputs. The oldest payloads
+  /// are removed first.
+  qint64 maximumPreparedInputDiskSize()const;
+  void setMaximumPreparedInputDiskSize(qint64 bytes);
+
+signals:
+  /// Emitted when the server asks for credentials for a request of \a receiver.
+  void authenticationRequired(QObject* receiver, QNetworkReply* reply,
+                              QAuthenticator* authenticator);
+
+protected slots:
+  void onFinished(QNetworkReply* reply);
+  void onReadyRead();
+  void onAuthenticationRequired(QNetworkReply* reply, QAuthenticator* authenticator);
+
+protected:
+  QScopedPointer<voRemoteAnalysisClientPrivate> d_ptr;
+
+private:
+  Q_DECLARE_PRIVATE(voRemoteAnalysisClient);
+  Q_DISABLE_COPY(voRemoteAnalysisClient);
+};
+
+#endif
@@ -0,0 +1,215 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+// Qt includes
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+
+// Visomics includes
+#include "voRemoteAnalysisMetrics.h"
+
+// STD includes
+#include <algorithm>
+
+namespace
+{
+// --------------------------------------------------------------------------
+struct voStageSamples
+{
+  QList<double> Durations;
+  QList<qint64> Bytes;
+};
+
+// --------------------------------------------------------------------------
+struct voRemoteAnalysisMetricsState
+{
+  voRemoteAnalysisMetricsState() : MaximumSampleCount(1000) {}
+  QMutex Mutex;
+  int MaximumSampleCount;
+  QHash<QString, QHash<QString, voStageSamples> > Samples;
+
+  void trim(voStageSamples& samples)
+    {
+    while (samples.Durations.size() > this->MaximumSampleCount)
+      {
+      samples.Durations.removeFirst();
+      samples.Bytes.removeFirst();
+      }
+    }
+};
+
+Q_GLOBAL_STATIC(voRemoteAnalysisMetricsState, metricsState);
+
+} // end of anonymous namespace
+
+// --------------------------------------------------------------------------
+QStringList voRemoteAnalysisMetrics::stages()
+{
+  return QStringList() << "serialize" << "upload" << "queue" << "execute"
+                       << "download" << "deserialize" << "total";
+}
+
+// --------------------------------------------------------------------------
+void voRemoteAnalysisMetrics::addJob(const QString& analysisName,
+                                     const QList<voTrace::Event>& events)
+{
+  if (events.isEmpty())
+    {
+    return;
+    }
+  QHash<QString, double> durations;
+  QHash<QString, qint64> bytes;
+  double total = 0;
+  foreach(const voTrace::Event& event, events)
+    {
+    durations[event.Category] += event.Duration;
+    if (event.Bytes >= 0)
+      {
+      bytes[event.Category] += event.Bytes;
+      }
+    total += event.Duration;
+    }
+  durations.insert("total", total);
+
+  voRemoteAnalysisMetricsState* state = metricsState();
+  QMutexLocker locker(&state->Mutex);
+  QHash<QString, voStageSamples>& analysisSamples = state->Samples[analysisName];
+  foreach(const QString& stage, durations.keys())
+    {
+    voStageSamples& samples = analysisSamples[stage];
+    samples.Durations << durations.value(stage);
+    samples.Bytes << bytes.value(stage, -1);
+    state->trim(samples);
+    }
+}
+
+// --------------------------------------------------------------------------
+QStringList voRemoteAnalysisMetrics::analysisNames()
+{
+  voRemoteAnalysisMetricsState* state = metricsState();
+  QMutexLocker locker(&state->Mutex);
+  QStringList names = state->Samples.keys();
+  names.sort();
+  return names;
+}
+
+// --------------------------------------------------------------------------
+voRemoteAnalysisMetrics::Summary voRemoteAnalysisMetrics::summary(
+  const QString& analysisName, const QString& stage)
+{
+  voStageSamples samples;
+  {
+  voRemoteAnalysisMetricsState* state = metricsState();
+  QMutexLocker locker(&state->Mutex);
+  samples = state->Samples.value(analysisName).value(stage);
+  }
+
+  Summary summary;
+  summary.Count = samples.Durations.size();
+  if (summary.Count == 0)
+    {
+    return summary;
+    }
+
+  double sum = 0;
+  double measuredDuration = 0; // Of the samples with a known size
+  qint64 totalBytes = 0;
+  int measuredCount = 0;
+  for (int index = 0; index < summary.Count; ++index)
+    {
+    sum += samples.Durations.at(index);
+    if (samples.Bytes.at(index) >= 0)
+      {
+      measuredDuration += samples.Durations.at(index);
+      totalBytes += samples.Bytes.at(index);
+      ++measuredCount;
+      }
+    }
+  summary.Mean = sum / summary.Count;
+  if (measuredCount > 0)
+    {
+    summary.MeanBytes = totalBytes / measuredCount;
+    if (measuredDuration > 0)
+      {
+      summary.Throughput = totalBytes / (measuredDuration / 1000.);
+      }
+    }
+
+  QList<double> sortedDurations = samples.Durations;
+  std::sort(sortedDurations.begin(), sortedDurations.end());
+  summary.Median = voRemoteAnalysisMetrics::percentile(sortedDurations, 50);
+  summary.Percentile90 = voRemoteAnalysisMetrics::percentile(sortedDurations, 90);
+  summary.Percentile99 = voRemoteAnalysisMetrics::percentile(sortedDurations, 99);
+  summary.Maximum = sortedDurations.last();
+  return summary;
+}
+
+// --------------------------------------------------------------------------
+double voRemoteAnalysisMetrics::percentile(const QList<double>& sortedValues, double percent)
+{
+  if (sortedValues.isEmpty())
+    {
+    return 0;
+    }
+  double rank = qBound(0., percent, 100.) / 100. * (sortedValues.size() - 1);
+  int lower = static_cast<int>(rank);
+  if (lower + 1 >= sortedValues.size())
+    {
+    return sortedValues.last();
+    }
+  double fraction = rank - lower;
+  return sortedValues.at(lower) + fraction * (sortedValues.at(lower + 1) - sortedValues.at(lower));
+}
+
+// --------------------------------------------------------------------------
+void voRemoteAnalysisMetrics::clear()
+{
+  voRemoteAnalysisMetricsState* state = metricsState();
+  QMutexLocker locker(&state->Mutex);
+  state->Samples.clear();
+}
+
+// --------------------------------------------------------------------------
+int voRemoteAnalysisMetrics::maximumSampleCount()
+{
+  voRemoteAnalysisMetricsState* state = metricsState();
+  QMutexLocker locker(&state->Mutex);
+  return state->MaximumSampleCount;
+}
+
+// --------------------------------------------------------------------------
+void voRemoteAnalysisMetrics::setMaximumSampleCount(int count)
+{
+  voRemoteAnalysisMetricsState* state = metricsState();
+  QMutexLocker locker(&state->Mutex);
+  state->MaximumSampleCount = qMax(count, 1);
+  QMutableHashIterator<QString, QHash<QString, voStageSamples> > analysisIterator(state->Samples);
+  while (analysisIterator.hasNext())
+    {
+    analysisIterator.next();
+    QMutableHashIterator<QString, voStageSamples> stageIterator(analysisIterator.value());
+    while (stageIterator.hasNext())
+      {
+      stageIterator.next();
+      state->trim(stageIterator.value());
+      }
+    }
+}
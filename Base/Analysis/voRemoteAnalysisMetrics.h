@@ -0,0 +1,79 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+#ifndef __voRemoteAnalysisMetrics_h
+#define __voRemoteAnalysisMetrics_h
+
+// Qt includes
+#include <QList>
+#include <QStringList>
+
+// Visomics includes
+#include "voTrace.h"
+
+/// Latency and throughput of the remote analysis jobs, per analysis type.
+///
+/// Each completed job contributes one sample per stage: "serialize",
+/// "upload", "queue", "execute", "download", "deserialize" and "total".
+/// "execute" is the time reported by the server, "queue" the rest of the
+/// time spent waiting for the job to complete.
+///
+/// The most recent maximumSampleCount() samples of each stage are kept. All
+/// the methods are thread-safe.
+class voRemoteAnalysisMetrics
+{
+public:
+  struct Summary
+    {
+    Summary() : Count(0), Mean(0), Median(0), Percentile90(0), Percentile99(0),
+      Maximum(0), MeanBytes(-1), Throughput(-1) {}
+    int Count;
+    double Mean;         // Durations in milliseconds
+    double Median;
+    double Percentile90;
+    double Percentile99;
+    double Maximum;
+    qint64 MeanBytes;    // Payload size, -1 if unknown
+    double Throughput;   // In bytes per second, -1 if unknown
+    };
+
+  /// Stages of a job, in order.
+  static QStringList stages();
+
+  /// Add the timings of a job of \a analysisName. Events of the same
+  /// category are summed up.
+  static void addJob(const QString& analysisName, const QList<voTrace::Event>& events);
+
+  /// Names of the analyses with at least one job.
+  static QStringList analysisNames();
+
+  static Summary summary(const QString& analysisName, const QString& stage);
+
+  /// Value below which \a percent percent of the \a sortedValues fall,
+  /// linearly interpolated between the closest ranks.
+  static double percentile(const QList<double>& sortedValues, double percent);
+
+  static void clear();
+
+  static int maximumSampleCount();
+  static void setMaximumSampleCount(int count);
+};
+
+#endif
@@ -0,0 +1,292 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+// Qt includes
+#include <QIODevice>
+#include <QtEndian>
+
+// Visomics includes
+#include "voRemoteAnalysisProtocol.h"
+
+// STD includes
+#include <limits>
+
+namespace
+{
+const char Signature[] = "VOFR";
+const int SignatureSize = 4;
+
+// --------------------------------------------------------------------------
+void appendUInt32(QByteArray& body, quint32 value)
+{
+  uchar buffer[4];
+  qToBigEndian<quint32>(value, buffer);
+  body.append(reinterpret_cast<const char*>(buffer), 4);
+}
+
+// --------------------------------------------------------------------------
+void appendUInt64(QByteArray& body, quint64 value)
+{
+  uchar buffer[8];
+  qToBigEndian<quint64>(value, buffer);
+  body.append(reinterpret_cast<const char*>(buffer), 8);
+}
+
+} // end of anonymous namespace
+
+// --------------------------------------------------------------------------
+const char* voRemoteAnalysisProtocol::contentType()
+{
+  return "application/x-visomics-frames";
+}
+
+// --------------------------------------------------------------------------
+void voRemoteAnalysisProtocol::writeHeader(QByteArray& body, const QByteArray& header)
+{
+  body.append(Signature, SignatureSize);
+  appendUInt32(body, static_cast<quint32>(header.size()));
+  body.append(header);
+}
+
+// --------------------------------------------------------------------------
+void voRemoteAnalysisProtocol::writeFrame(QByteArray& body, const char* data, qint64 size)
+{
+  appendUInt64(body, static_cast<quint64>(size));
+  body.append(data, static_cast<int>(size));
+}
+
+// --------------------------------------------------------------------------
+bool voRemoteAnalysisProtocol::compressPayload(const char* data, qint64 size, QByteArray& compressed)
+{
+  compressed.clear();
+  if (size < CompressionThreshold || size > std::numeric_limits<int>::max())
+    {
+    return false;
+    }
+  // Fast compression level: the goal is to save bandwidth, not to spend
+  // more time compressing than uploading.
+  compressed = qCompress(reinterpret_cast<const uchar*>(data), static_cast<int>(size), 1);
+  if (compressed.isEmpty() || compressed.size() >= size)
+    {
+    compressed.clear();
+    return false;
+    }
+  return true;
+}
+
+// --------------------------------------------------------------------------
+bool voRemoteAnalysisProtocol::decodePayload(const QByteArray& encoding,
+                                             const QByteArray& payload, QByteArray& decoded)
+{
+  if (encoding.isEmpty() || encoding == "raw")
+    {
+    decoded = payload;
+    return true;
+    }
+  if (encoding == "zlib")
+    {
+    decoded = qUncompress(payload);
+    return !decoded.isEmpty();
+    }
+  return false;
+}
+
+// --------------------------------------------------------------------------
+bool voRemoteAnalysisProtocol::isFramed(const QByteArray& body)
+{
+  return body.size() >= SignatureSize && qstrncmp(body.constData(), Signature, SignatureSize) == 0;
+}
+
+// --------------------------------------------------------------------------
+bool voRemoteAnalysisProtocol::readFrames(const QByteArray& body, QByteArray& header, QList<QByteArray>& frames)
+{
+  header.clear();
+  frames.clear();
+  if (!isFramed(body) || body.size() < SignatureSize + 4)
+    {
+    return false;
+    }
+  const uchar* data = reinterpret_cast<const uchar*>(body.constData());
+  qint64 position = SignatureSize;
+  qint64 headerSize = qFromBigEndian<quint32>(data + position);
+  position += 4;
+  if (position + headerSize > body.size())
+    {
+    return false;
+    }
+  header = QByteArray::fromRawData(body.constData() + position, static_cast<int>(headerSize));
+  position += headerSize;
+
+  while (position < body.size())
+    {
+    if (position + 8 > body.size())
+      {
+      return false;
+      }
+    quint64 frameSize = qFromBigEndian<quint64>(data + position);
+    position += 8;
+    if (frameSize > static_cast<quint64>(body.size() - position))
+      {
+      return false;
+      }
+    frames << QByteArray::fromRawData(body.constData() + position, static_cast<int>(frameSize));
+    position += static_cast<qint64>(frameSize);
+    }
+  return true;
+}
+
+// --------------------------------------------------------------------------
+// voRemoteAnalysisProtocol::FrameReader methods
+
+// --------------------------------------------------------------------------
+voRemoteAnalysisProtocol::FrameReader::FrameReader()
+  : m_state(ReadingSignature), m_received(0), m_frameCount(0)
+{
+}
+
+// --------------------------------------------------------------------------
+bool voRemoteAnalysisProtocol::FrameReader::read(QIODevice* device)
+{
+  // Loop until a field or frame can't be completed with the available bytes
+  for (;;)
+    {
+    switch (m_state)
+      {
+      case ReadingSignature:
+        if (!this->readField(device, SignatureSize))
+          {
+          return true;
+          }
+        if (!isFramed(m_field))
+          {
+          return false;
+          }
+        m_field.clear();
+        m_state = ReadingHeaderSize;
+        break;
+      case ReadingHeaderSize:
+        if (!this->readField(device, 4))
+          {
+          return true;
+          }
+        m_header.resize(static_cast<int>(
+          qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(m_field.constData()))));
+        m_field.clear();
+        m_received = 0;
+        m_state = ReadingHeader;
+        break;
+      case ReadingHeader:
+        if (!this->readData(device, m_header))
+          {
+          return true;
+          }
+        m_state = ReadingFrameSize;
+        break;
+      case ReadingFrameSize:
+        {
+        if (!this->readField(device, 8))
+          {
+          return true;
+          }
+        quint64 frameSize =
+          qFromBigEndian<quint64>(reinterpret_cast<const uchar*>(m_field.constData()));
+        m_field.clear();
+        if (frameSize > static_cast<quint64>(std::numeric_limits<int>::max()))
+          {
+          return false;
+          }
+        m_frame.resize(static_cast<int>(frameSize));
+        m_received = 0;
+        m_state = ReadingFrame;
+        break;
+        }
+      case ReadingFrame:
+        if (!this->readData(device, m_frame))
+          {
+          return true;
+          }
+        m_frames << m_frame;
+        m_frame = QByteArray();
+        ++m_frameCount;
+        m_state = ReadingFrameSize;
+        break;
+      }
+    }
+}
+
+// --------------------------------------------------------------------------
+bool voRemoteAnalysisProtocol::FrameReader::readField(QIODevice* device, int size)
+{
+  m_field.append(device->read(size - m_field.size()));
+  return m_field.size() == size;
+}
+
+// --------------------------------------------------------------------------
+bool voRemoteAnalysisProtocol::FrameReader::readData(QIODevice* device, QByteArray& data)
+{
+  qint64 count = device->read(data.data() + m_received, data.size() - m_received);
+  if (count > 0)
+    {
+    m_received += count;
+    }
+  return m_received == data.size();
+}
+
+// --------------------------------------------------------------------------
+bool voRemoteAnalysisProtocol::FrameReader::hasHeader()const
+{
+  return m_state == ReadingFrameSize || m_state == ReadingFrame;
+}
+
+// --------------------------------------------------------------------------
+const QByteArray& voRemoteAnalysisProtocol::FrameReader::header()const
+{
+  return m_header;
+}
+
+// --------------------------------------------------------------------------
+bool voRemoteAnalysisProtocol::FrameReader::hasFrame()const
+{
+  return !m_frames.isEmpty();
+}
+
+// --------------------------------------------------------------------------
+QByteArray voRemoteAnalysisProtocol::FrameReader::takeFrame()
+{
+  return m_frames.isEmpty() ? QByteArray() : m_frames.takeFirst();
+}
+
+// --------------------------------------------------------------------------
+int voRemoteAnalysisProtocol::FrameReader::frameCount()const
+{
+  return m_frameCount;
+}
+
+// --------------------------------------------------------------------------
+int voRemoteAnalysisProtocol::FrameReader::nextFrameIndex()const
+{
+  return m_frameCount - m_frames.size();
+}
+
+// --------------------------------------------------------------------------
+bool voRemoteAnalysisProtocol::FrameReader::atFrameBoundary()const
+{
+  return m_state == ReadingFrameSize && m_field.isEmpty();
+}
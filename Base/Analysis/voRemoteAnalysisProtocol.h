@@ -0,0 +1,127 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+#ifndef __voRemoteAnalysisProtocol_h
+#define __voRemoteAnalysisProtocol_h
+
+// Qt includes
+#include <QByteArray>
+#include <QList>
+
+class QIODevice;
+
+/// Length-prefixed binary framing used to exchange data with the analysis server.
+///
+/// A framed message is laid out as:
+///
+///   "VOFR" | header length (uint32, big endian) | header (JSON)
+///   | frame length (uint64, big endian) | frame bytes | ...
+///
+/// The JSON header describes the frames (name, type, encoding) in order.
+/// Frames with the "zlib" encoding hold the output of qCompress(): a 4 byte
+/// big endian uncompressed length followed by a zlib stream.
+///
+/// The same layout is implemented in AnalysisServer/visomics/vtk/common.py.
+namespace voRemoteAnalysisProtocol
+{
+
+/// Content type used for framed request and response bodies.
+const char* contentType();
+
+/// Payloads smaller than this size (in bytes) are sent uncompressed.
+const int CompressionThreshold = 64 * 1024;
+
+/// Start a framed message in \a body with the given JSON \a header.
+void writeHeader(QByteArray& body, const QByteArray& header);
+
+/// Append one frame to \a body.
+void writeFrame(QByteArray& body, const char* data, qint64 size);
+
+/// Compress \a data if it is worth it. Return false and leave \a compressed
+/// empty if the payload should be sent as is.
+bool compressPayload(const char* data, qint64 size, QByteArray& compressed);
+
+/// Decode a frame according to its \a encoding ("raw" or "zlib").
+/// Return false if the encoding is unknown or the data is corrupted.
+bool decodePayload(const QByteArray& encoding, const QByteArray& payload, QByteArray& decoded);
+
+/// Return true if \a body starts with the framed message signature.
+bool isFramed(const QByteArray& body);
+
+/// Split a complete framed message into its \a header and \a frames.
+/// Frames reference \a body memory and are only valid as long as \a body is.
+bool readFrames(const QByteArray& body, QByteArray& header, QList<QByteArray>& frames);
+
+/// Incremental reader of a framed message.
+///
+/// Bytes are read from the device as they arrive and copied once, straight
+/// into a buffer sized after the frame length. Frames can be taken as soon
+/// as they are complete, so that a large message never needs to be held in
+/// memory at once.
+class FrameReader
+{
+public:
+  FrameReader();
+
+  /// Consume the bytes available on \a device.
+  /// Return false if the stream is not a valid framed message.
+  bool read(QIODevice* device);
+
+  bool hasHeader()const;
+  const QByteArray& header()const;
+
+  /// Return true if a complete frame is waiting to be taken.
+  bool hasFrame()const;
+  QByteArray takeFrame();
+
+  /// Number of frames completed so far (taken or not).
+  int frameCount()const;
+
+  /// Index of the frame returned by the next call to takeFrame().
+  int nextFrameIndex()const;
+
+  /// Return true if no field or frame is partially read.
+  bool atFrameBoundary()const;
+
+private:
+  enum State
+    {
+    ReadingSignature,
+    ReadingHeaderSize,
+    ReadingHeader,
+    ReadingFrameSize,
+    ReadingFrame
+    };
+
+  bool readField(QIODevice* device, int size);
+  bool readData(QIODevice* device, QByteArray& data);
+
+  State m_state;
+  QByteArray m_field;
+  qint64 m_received;
+  QByteArray m_header;
+  QByteArray m_frame;
+  QList<QByteArray> m_frames;
+  int m_frameCount;
+};
+
+}
+
+#endif
@@ -24,6 +24,10 @@
 #include <QtCore/QTimer>
 #include <QtGui/QMessageBox>
 #include <QtNetwork/QAuthenticator>
+#include <QCryptographicHash>
+#include <QSet>
+#include <QtEndian>
+#include <QtNetwork/QLocalSocket>
 
 
 // QtPropertyBrowser includes
@@ -39,9 +43,15 @@
 #include "voUtils.h"
 #include "vtkExtendedTable.h"
 #include "voCustomAnalysisInformation.h"
+#include "voRemoteAnalysisClient.h"
+#include "voRemoteAnalysisMetrics.h"
+#include "voRemoteAnalysisProtocol.h"
+#include "voSharedMemoryTransfer.h"
+#include "voTrace.h"
 
 // VTK includes
 #include <vtkArrayData.h>
+#include <vtkCharArray.h>
 #include <vtkCompositeDataIterator.h>
 #include <vtkDoubleArray.h>
 #include <vtkGraph.h>
@@ -61,32 +71,77 @@
 #include <vtkTableWriter.h>
 #include <vtkTreeReader.h>
 #include <vtkTableReader.h>
+#include <vtkDataWriter.h>
 
 // JsonCpp
 #include <jsoncpp.cpp>
 
 #include <string>
 
+namespace
+{
+
+// Bounds (in ms) of the status polling interval used when the server
+// doesn't support long polling.
+const int MinimumPollInterval = 50;
+const int MaximumPollInterval = 5000;
+
+} // end of anonymous namespace
 
 // --------------------------------------------------------------------------
 // voRemoteCustomAnalysis methods
 
 // --------------------------------------------------------------------------
 voRemoteCustomAnalysis::voRemoteCustomAnalysis(QObject* newParent):
-    Superclass(newParent), m_credentialsProvided(false),
-    m_networkManager(new QNetworkAccessManager(this))
+    Superclass(newParent), m_credentialsProvided(false), m_forceUpload(false),
+    m_pollInterval(MinimumPollInterval), m_client(0),
+    m_resultIsJson(false), m_resultHeaderParsed(false),
+    m_uploadStart(0.), m_uploadBytes(0), m_queueStart(0.), m_queueEnd(0.),
+    m_downloadStart(0.), m_downloadBytes(0),
+    m_deserializeStart(-1.), m_deserializeDuration(0.), m_localSocket(0)
 {
 
   m_status = "";
-  connect(m_networkManager,
-          SIGNAL(authenticationRequired(QNetworkReply *, QAuthenticator *)),
-          this,
-          SLOT(provideCredentials(QNetworkReply *, QAuthenticator *)));
+  // Analyses run by the driver share its client, see setClient()
+  this->setClient(new voRemoteAnalysisClient(this));
 }
 
 // --------------------------------------------------------------------------
 voRemoteCustomAnalysis::~voRemoteCustomAnalysis()
 {
+  if (m_client && m_client->parent() != this)
+    {
+    m_client->cancel(this);
+    }
+}
+
+// --------------------------------------------------------------------------
+voRemoteAnalysisClient* voRemoteCustomAnalysis::client()const
+{
+  return m_client;
+}
+
+// --------------------------------------------------------------------------
+void voRemoteCustomAnalysis::setClient(voRemoteAnalysisClient* client)
+{
+  if (!client || client == m_client)
+    {
+    return;
+    }
+  if (m_client)
+    {
+    m_client->cancel(this);
+    disconnect(m_client, 0, this, 0);
+    if (m_client->parent() == this)
+      {
+      delete m_client;
+      }
+    }
+  m_client = client;
+  connect(m_client,
+          SIGNAL(authenticationRequired(QObject*, QNetworkReply*, QAuthenticator*)),
+          this,
+          SLOT(provideCredentials(QObject*, QNetworkReply*, QAuthenticator*)));
 }
 // --------------------------------------------------------------------------
 int voRemoteCustomAnalysis::execute()
@@ -96,13 +151,27 @@ int voRemoteCustomAnalysis::execute()
     {
     emit error("No connection details provided for remote analysis");
     }
+  if (!m_localServerName.isEmpty())
+    {
+    return this->executeLocal();
+    }
 
   vtkSmartPointer<vtkExtendedTable> extendedTable;
-  vtkNew<vtkMultiBlockDataSet> inputs;
+  m_submittedBlobs.clear();
+  if (!m_forceUpload)
+    {
+    // Resubmissions are accounted to the same job
+    m_jobEvents.clear();
+    }
 
   Json::Value taskRequest;
   taskRequest["name"] = this->information()->name().toStdString();
   taskRequest["inputs"] = Json::Value(Json::arrayValue);
+  // Let the server know it may compress the outputs it sends back
+  taskRequest["accept_encoding"] = "zlib";
+
+  QList<QByteArray> framePayloads;
+  qint64 bodySize = 0;
 
   int index = 0;
   foreach(voCustomAnalysisData *input, this->information()->inputs())
@@ -110,140 +179,135 @@ int voRemoteCustomAnalysis::execute()
     Json::Value &inputValue = taskRequest["inputs"][Json::ArrayIndex(index)];
     inputValue["name"] = input->name().toStdString();
 
-
-    vtkDataObject *data;
-    vtkDataWriter *writer;
     std::string type;
-
-    if (input->type() == "Table")
-      {
-      type = "Table";
-      extendedTable = this->getInputTable(index);
-      if (input->includeMetadata())
-        {
-        data = extendedTable->GetInputData();
-        }
-      else
-        {
-        data = extendedTable->GetData();
-        }
-      writer = vtkTableWriter::New();
-      }
-    else if(input->type() == "Tree")
+    if (input->type() == "Table" || input->type() == "Tree")
       {
-      type = "Tree";
-      data =
-        vtkTree::SafeDownCast(this->input(index)->dataAsVTKDataObject());
-      if (!data)
-        {
-        emit error("Input Tree is Null");
-        return voAnalysis::FAILURE;
-        }
-      writer = vtkTreeWriter::New();
+      type = input->type().toStdString();
       }
     else
       {
-      emit error(tr("Unsupported input type: %s").arg(input->type()));
+      emit error(tr("Unsupported input type: %1").arg(input->type()));
       return voAnalysis::FAILURE;
       }
 
-    if (writer)
+    // Inputs are converted once per modification of their data, the
+    // conversion is shared with the other jobs using the same data.
+    vtkDataObject * inputData = this->input(index)->dataAsVTKDataObject();
+    QString preparedKey = QString("%1/%2/%3/%4")
+        .arg(this->input(index)->uuid())
+        .arg(inputData ? static_cast<qulonglong>(inputData->GetMTime()) : 0)
+        .arg(input->type())
+        .arg(input->includeMetadata());
+
+    // The payload of a blob the server holds is not read back from disk
+    voRemoteAnalysisClient::PreparedInput prepared;
+    bool isPrepared = m_client->preparedInput(preparedKey, prepared, false);
+    if (isPrepared && (m_forceUpload || !m_client->knownBlobs(m_baseUrl).contains(prepared.Digest)))
+      {
+      isPrepared = m_client->preparedInput(preparedKey, prepared);
+      }
+    if (!isPrepared)
       {
+      double conversionStart = voTrace::now();
+      vtkDataObject *data;
+      vtkSmartPointer<vtkDataWriter> writer;
+      if (input->type() == "Table")
+        {
+        extendedTable = this->getInputTable(index);
+        if (input->includeMetadata())
+          {
+          data = extendedTable->GetInputData();
+          }
+        else
+          {
+          data = extendedTable->GetData();
+          }
+        writer = vtkSmartPointer<vtkTableWriter>::New();
+        }
+      else
+        {
+        data = vtkTree::SafeDownCast(inputData);
+        if (!data)
+          {
+          emit error("Input Tree is Null");
+          return voAnalysis::FAILURE;
+          }
+        writer = vtkSmartPointer<vtkTreeWriter>::New();
+        }
+
       writer->SetWriteToOutputString(1);
       writer->SetInputData(data);
       writer->SetFileTypeToBinary();
       writer->Update();
 
-      QByteArray base64 = QByteArray(reinterpret_cast<char*>(writer->GetBinaryOutputString()),
-                                     writer->GetOutputStringLength()).toBase64();
+      const char * payload = reinterpret_cast<const char*>(writer->GetBinaryOutputString());
+      qint64 payloadSize = writer->GetOutputStringLength();
+
+      // Inputs are content addressed: the server keeps the blobs it received
+      // and only their hash needs to be sent again.
+      QCryptographicHash hash(QCryptographicHash::Sha1);
+      hash.addData(payload, static_cast<int>(payloadSize));
+      prepared.Digest = hash.result().toHex();
+
+      if (voRemoteAnalysisProtocol::compressPayload(payload, payloadSize, prepared.Payload))
+        {
+        prepared.Encoding = "zlib";
+        }
+      else
+        {
+        prepared.Encoding = "raw";
+        prepared.Payload = QByteArray(payload, static_cast<int>(payloadSize));
+        }
+      m_client->insertPreparedInput(preparedKey, prepared);
+      this->addJobTiming(voTrace::addEvent("serialize", input->name(), conversionStart, payloadSize));
+      }
+    m_submittedBlobs << prepared.Digest;
+
+    inputValue["type"] = type;
+    inputValue["format"] = "vtk";
+    inputValue["sha1"] = prepared.Digest.constData();
 
-      inputValue["data"] = base64.constData();
-      inputValue["type"] = type;
-      inputValue["format"] = "vtk";
-      writer->Delete();
+    if (!m_forceUpload && m_client->knownBlobs(m_baseUrl).contains(prepared.Digest))
+      {
+      ++index;
+      continue;
       }
+
+    inputValue["encoding"] = prepared.Encoding.constData();
+    inputValue["frame"] = framePayloads.size();
+    bodySize += prepared.Payload.size();
+
+    framePayloads << prepared.Payload;
     ++index;
     }
 
   vtkNew<vtkMultiBlockDataSet> outputs;
 
-  index = 0;
-  taskRequest["outputs"] = Json::Value(Json::arrayValue);
-  foreach(voCustomAnalysisData *output, this->information()->outputs())
+  if (!this->describeOutputs(taskRequest["outputs"]))
     {
-    Json::Value &outputValue = taskRequest["outputs"][Json::ArrayIndex(index)];
+    return voAnalysis::FAILURE;
+    }
 
-    if (output->type() != "Table" && output->type() != "Tree")
+  QString script;
+  if (!this->parameterizedScript(script))
     {
-    emit error(tr("Unsupported output type: %s").arg(output->type()));
     return voAnalysis::FAILURE;
     }
+  taskRequest["script"] = script.toStdString();
 
-    outputValue["name"] = output->name().toStdString();
-    outputValue["type"] = output->type().toStdString();
-    ++index;
-    }
+  Json::FastWriter headerWriter;
+  std::string header = headerWriter.write(taskRequest);
 
-  // replace each parameter in the script with its actual value
-  QString script = this->information()->script();
-  foreach(voCustomAnalysisParameter *parameter, this->information()->parameters())
+  QByteArray requestBody;
+  requestBody.reserve(static_cast<int>(bodySize + header.size() + 16 * (framePayloads.size() + 1)));
+  voRemoteAnalysisProtocol::writeHeader(
+        requestBody, QByteArray::fromRawData(header.data(), static_cast<int>(header.size())));
+  foreach(const QByteArray& framePayload, framePayloads)
     {
-    QString type = parameter->type();
-    QString name = parameter->name();
-    QString parameterValue;
-    if (type == "Integer")
-      {
-      parameterValue = QString::number(this->integerParameter(name));
-      }
-    else if (type == "Double")
-      {
-      parameterValue = QString::number(this->doubleParameter(name));
-      }
-    else if (type == "Enum")
-      {
-      parameterValue = this->enumParameter(name);
-      }
-    else if (type == "String")
-      {
-      parameterValue = QString("\"%1\"").arg(this->stringParameter(name));
-      }
-    else if (type == "Range")
-      {
-      QList<int> range;
-
-      if (!voUtils::parseRangeString(this->stringParameter(name), range, true))
-        {
-        if (!voUtils::parseRangeString(this->stringParameter(name), range, false))
-          {
-          qDebug() << "Range error";
-          }
-        }
-
-      QStringList list;
-      foreach(int i, range)
-        {
-        list << QString::number(i+1);
-        }
-      QString rangeString = list.join(",");
-
-      parameterValue = QString("c(%1)").arg(rangeString);
-      }
-    else if (type == "Column")
-      {
-      parameterValue = this->columnParameter(name);
-      }
-    else
-      {
-      emit error(tr("Unsupported parameter type in voCustomAnalysis: %s").arg(type));
-      return voAnalysis::FAILURE;
-      }
-    script.replace(name, parameterValue);
+    voRemoteAnalysisProtocol::writeFrame(requestBody, framePayload.constData(), framePayload.size());
     }
+  framePayloads.clear();
 
-  taskRequest["script"] = script.toStdString();
-
-  Json::StyledWriter writer;
-  QString requestBody = QString::fromStdString(writer.write(taskRequest));
   QString postUrl;
   QString scriptType = this->information()->scriptType();
   if (scriptType == "R")
@@ -261,42 +325,39 @@ int voRemoteCustomAnalysis::execute()
 
   QUrl url(postUrl);
   QNetworkRequest request(url);
-  request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+  request.setHeader(QNetworkRequest::ContentTypeHeader, voRemoteAnalysisProtocol::contentType());
 
-  connect(m_networkManager, SIGNAL(finished(QNetworkReply *)),
-          this, SLOT(handleReply(QNetworkReply *)));
-
-  QNetworkReply *reply = m_networkManager->post(request, requestBody.toLocal8Bit());
-
-  if (reply->error() != QNetworkReply::NoError)
-    {
-    emit error(tr("POST error: %1").arg(reply->errorString()));
-    return voAnalysis::FAILURE;
-    }
+  m_uploadStart = voTrace::now();
+  m_uploadBytes = requestBody.size();
+  m_client->post(request, requestBody, this, SLOT(handleReply(QNetworkReply*)));
 
   return voAnalysis::PENDING;
 }
 
 void voRemoteCustomAnalysis::handleReply(QNetworkReply *reply)
 {
+  reply->deleteLater();
   if (reply->error())
     {
     emit error(QObject::tr("Unable to submit remote task: %1\n").arg(reply->errorString()));
     return;
     }
 
-  QString content = reply->readAll();
+  QByteArray content = reply->readAll();
 
   Json::Value root;
   Json::Reader reader;
 
-  if (!reader.parse(content.toStdString(), root))
+  if (!reader.parse(content.constData(), content.constData() + content.size(), root))
     {
     emit error("Unable to parse JSON POST response");
     return;
     }
 
   m_taskId = QString::fromStdString(root["id"].asString());
+  m_pollInterval = MinimumPollInterval;
+  this->addJobTiming(voTrace::addEvent("upload", this->objectName(), m_uploadStart, m_uploadBytes));
+  m_queueStart = voTrace::now();
 
   emit analysisSubmitted();
 
@@ -309,30 +370,30 @@ void voRemoteCustomAnalysis::monitorStatus()
   QString statusUrl = tr("%1tasks/celery/%2/status").arg(m_baseUrl)
       .arg(m_taskId);
 
+  // Servers supporting long polling hold the request until the task is
+  // done (or "wait" seconds elapsed), others ignore the parameter.
   QUrl url(statusUrl);
+  url.addQueryItem("wait", QString::number(m_client->longPollTimeout()));
   QNetworkRequest request(url);
 
-  disconnect(m_networkManager, SIGNAL(finished(QNetworkReply *)), 0, 0);
-  connect(m_networkManager, SIGNAL(finished(QNetworkReply *)),
-          this, SLOT(handleStatusReply(QNetworkReply *)));
-
-  m_networkManager->get(request);
+  m_client->get(request, this, SLOT(handleStatusReply(QNetworkReply*)));
 }
 
 void voRemoteCustomAnalysis::handleStatusReply(QNetworkReply *reply)
 {
+  reply->deleteLater();
   if (reply->error())
     {
     emit error(QObject::tr("Unable to retrieve remote task status: \n") + reply->errorString());
     return;
     }
 
-  QString content = reply->readAll();
+  QByteArray content = reply->readAll();
 
   Json::Value root;
   Json::Reader reader;
 
-  if (!reader.parse(content.toStdString(), root))
+  if (!reader.parse(content.constData(), content.constData() + content.size(), root))
     {
     emit error("Unable to parse JSON status response");
     return;
@@ -342,37 +403,167 @@ void voRemoteCustomAnalysis::handleStatusReply(QNetworkReply *reply)
 
   if (m_status == "FAILURE" || m_status == "SUCCESS")
     {
+    // Split between queue and execution once the result tells how long
+    // the server worked on the job.
+    m_queueEnd = voTrace::now();
+    m_downloadStart = m_queueEnd;
+    m_downloadBytes = 0;
+    m_deserializeStart = -1.;
+    m_deserializeDuration = 0.;
     QString resultUrl = tr("%1tasks/celery/%2/result").arg(m_baseUrl)
         .arg(m_taskId);
     QUrl url(resultUrl);
     QNetworkRequest request(url);
+    // Servers able to stream the outputs answer with a framed body
+    request.setRawHeader("Accept", QByteArray(voRemoteAnalysisProtocol::contentType())
+                         + ", application/json");
+
+    m_resultReader.reset();
+    m_resultIsJson = false;
+    m_resultHeaderParsed = false;
+    m_resultOutputs.clear();
+    m_resultError.clear();
+    m_client->get(request, this, SLOT(handleResultReply(QNetworkReply*)),
+                  SLOT(readResultData(QNetworkReply*)));
+    }
+  else if (reply->hasRawHeader("X-Visomics-Long-Poll") &&
+           reply->request().url().queryItemValue("wait").toInt() > 0)
+    {
+    // The server already waited for the task, ask again right away
+    this->monitorStatus();
+    }
+  else
+    {
+    // No push support: poll with exponential backoff
+    QTimer::singleShot(m_pollInterval, this, SLOT(monitorStatus()));
+    m_pollInterval = qMin(2 * m_pollInterval, MaximumPollInterval);
+    }
+}
+
+// --------------------------------------------------------------------------
+void voRemoteCustomAnalysis::readResultData(QNetworkReply *reply)
+{
+  if (!m_resultError.isEmpty() || m_resultIsJson || m_status != "SUCCESS")
+    {
+    // Plain JSON results (and failure messages) are parsed once complete
+    return;
+    }
 
-    disconnect(m_networkManager, SIGNAL(finished(QNetworkReply *)), 0, 0);
-    connect(m_networkManager, SIGNAL(finished(QNetworkReply *)),
-            this, SLOT(handleResultReply(QNetworkReply *)));
+  if (!m_resultReader)
+    {
+    if (reply->bytesAvailable() < 4)
+      {
+      return;
+      }
+    if (!voRemoteAnalysisProtocol::isFramed(reply->peek(4)))
+      {
+      m_resultIsJson = true;
+      return;
+      }
+    m_resultReader.reset(new voRemoteAnalysisProtocol::FrameReader);
+    }
 
-    m_networkManager->get(request);
+  m_downloadBytes += reply->bytesAvailable();
+  if (!m_resultReader->read(reply))
+    {
+    m_resultError = tr("Unable to read framed response");
+    reply->abort();
+    return;
     }
-  else
+
+  if (m_resultReader->hasHeader() && !m_resultHeaderParsed)
+    {
+    m_resultHeaderParsed = true;
+    const QByteArray& header = m_resultReader->header();
+    Json::Value root;
+    Json::Reader reader;
+    if (!reader.parse(header.constData(), header.constData() + header.size(), root))
+      {
+      m_resultError = tr("Unable to parse JSON response");
+      reply->abort();
+      return;
+      }
+    const Json::Value& outputs = root["result"]["output"];
+    for (unsigned int index = 0; index < outputs.size(); index++)
+      {
+      const Json::Value& output = outputs[index];
+      if (!output.isMember("frame"))
+        {
+        continue;
+        }
+      ResultOutput resultOutput;
+      resultOutput.Name = QString::fromStdString(output["name"].asString());
+      resultOutput.Type = QString::fromStdString(output["type"].asString());
+      resultOutput.Encoding = output.get("encoding", "raw").asCString();
+      m_resultOutputs.insert(output["frame"].asInt(), resultOutput);
+      }
+    }
+
+  // Materialize each output as soon as its bytes are complete, and release
+  // them right away.
+  while (m_resultHeaderParsed && m_resultReader->hasFrame())
     {
-    QTimer::singleShot(500, this, SLOT(monitorStatus()));
+    int frame = m_resultReader->nextFrameIndex();
+    QByteArray payload = m_resultReader->takeFrame();
+    if (!m_resultOutputs.contains(frame))
+      {
+      continue;
+      }
+    ResultOutput resultOutput = m_resultOutputs.take(frame);
+    if (!this->createOutput(resultOutput.Name, resultOutput.Type, resultOutput.Encoding, payload))
+      {
+      reply->abort();
+      return;
+      }
     }
 }
 
+// --------------------------------------------------------------------------
 void voRemoteCustomAnalysis::handleResultReply(QNetworkReply *reply)
 {
+  reply->deleteLater();
+  if (!m_resultError.isEmpty())
+    {
+    emit error(m_resultError);
+    return;
+    }
   if (reply->error())
     {
     emit error("Call to remote server failed");
     return;
     }
 
-  QString content = reply->readAll();
+  // Consume whatever arrived since the last readyRead()
+  this->readResultData(reply);
+  if (!m_resultError.isEmpty())
+    {
+    emit error(m_resultError);
+    return;
+    }
+
+  QByteArray content;
+  if (m_resultReader)
+    {
+    if (!m_resultReader->atFrameBoundary() || !m_resultOutputs.isEmpty())
+      {
+      emit error("Incomplete remote analysis result");
+      return;
+      }
+    content = m_resultReader->header();
+    m_resultReader.reset();
+    }
+  else
+    {
+    content = reply->readAll();
+    m_downloadBytes += content.size();
+    }
 
+  // Without streaming support, the result is a JSON document where each
+  // output carries its (possibly compressed) data in base64.
   Json::Value root;
   Json::Reader reader;
 
-  if (!reader.parse(content.toStdString(), root))
+  if (!reader.parse(content.constData(), content.constData() + content.size(), root))
     {
     emit error("Unable to parse JSON response");
     return;
@@ -380,58 +571,424 @@ void voRemoteCustomAnalysis::handleResultReply(QNetworkReply *reply)
 
   if (m_status == "FAILURE")
     {
+    QString message = QString::fromStdString(root["result"].asString());
+    if (message.contains("MissingBlobs") && !m_forceUpload)
+      {
+      // The server evicted (or never received) some of the inputs we assumed
+      // it had: forget about them and submit again with all the data.
+      QSet<QByteArray>& blobs = m_client->knownBlobs(m_baseUrl);
+      foreach(const QByteArray& digest, m_submittedBlobs)
+        {
+        blobs.remove(digest);
+        }
+      m_forceUpload = true;
+      this->execute();
+      return;
+      }
+    m_forceUpload = false;
     emit error(
-        tr("Remote R job failed:\n%1")
-          .arg(QString::fromStdString(root["result"].asString())));
+        tr("Remote R job failed:\n%1").arg(message));
     return;
     }
   // otherwise we assume status is "SUCCESS", since this slot should
   // not be connected on "PENDING".
 
-  Json::Value outputs = root["result"]["output"];
+  // The server now holds every input blob of this job
+  m_client->knownBlobs(m_baseUrl).unite(m_submittedBlobs.toSet());
+  m_forceUpload = false;
+
+  // Servers may report the time (in s) spent in each stage of the task
+  double executeDuration = -1.;
+  const Json::Value& serverTimings = root["result"]["timings"];
+  if (serverTimings.isObject())
+    {
+    executeDuration = 0.;
+    Json::Value::Members stages = serverTimings.getMemberNames();
+    for (unsigned int index = 0; index < stages.size(); index++)
+      {
+      executeDuration += serverTimings[stages[index]].asDouble() * 1000.;
+      }
+    }
+
+  const Json::Value& outputs = root["result"]["output"];
   for (unsigned int index = 0; index < outputs.size(); index++)
     {
-    Json::Value output = outputs[index];
-    std::string type = output["type"].asString();
-    QString name = QString::fromStdString(output["name"].asString());
-    std::string inputString = output["data"].asString();
-    QByteArray raw = QByteArray::fromRawData(inputString.c_str(), inputString.size());
-    QByteArray binary = QByteArray::fromBase64(raw);
+    const Json::Value& output = outputs[index];
+    if (output.isMember("frame"))
+      {
+      // Already created while streaming
+      continue;
+      }
+    const char * base64 = output["data"].asCString();
+    if (!this->createOutput(QString::fromStdString(output["name"].asString()),
+                            QString::fromStdString(output["type"].asString()),
+                            output.get("encoding", "raw").asCString(),
+                            QByteArray::fromBase64(QByteArray::fromRawData(base64, qstrlen(base64)))))
+      {
+      emit error(m_resultError);
+      return;
+      }
+    }
 
-    if (type == "Table" || type == "vtkTable")
+  double end = voTrace::now();
+  double queueDuration = m_queueEnd - m_queueStart;
+  if (executeDuration >= 0.)
+    {
+    executeDuration = qMin(executeDuration, queueDuration);
+    queueDuration -= executeDuration;
+    }
+  this->addJobTiming(voTrace::addMeasuredEvent(
+                       "queue", this->objectName(), m_queueStart, queueDuration));
+  if (executeDuration >= 0.)
+    {
+    this->addJobTiming(voTrace::addMeasuredEvent(
+                         "execute", this->objectName(), m_queueStart + queueDuration, executeDuration));
+    }
+  // Streamed outputs are decoded while the rest of the result downloads
+  this->addJobTiming(voTrace::addMeasuredEvent(
+                       "download", this->objectName(), m_downloadStart,
+                       end - m_downloadStart - m_deserializeDuration, m_downloadBytes));
+  if (m_deserializeStart >= 0.)
+    {
+    this->addJobTiming(voTrace::addMeasuredEvent(
+                         "deserialize", this->objectName(), m_deserializeStart, m_deserializeDuration));
+    }
+  voRemoteAnalysisMetrics::addJob(this->information()->name(), m_jobEvents);
+  emit complete();
+}
+
+// --------------------------------------------------------------------------
+int voRemoteCustomAnalysis::executeLocal()
+{
+  m_jobEvents.clear();
+  m_localTransfer.reset(new voSharedMemoryTransfer);
+
+  Json::Value taskRequest;
+  taskRequest["name"] = this->information()->name().toStdString();
+  taskRequest["script_type"] = this->information()->scriptType().toStdString();
+  // Outputs are written next to the inputs
+  taskRequest["segment_directory"] = voSharedMemoryTransfer::segmentDirectory().toStdString();
+  taskRequest["inputs"] = Json::Value(Json::arrayValue);
+
+  int index = 0;
+  foreach(voCustomAnalysisData *input, this->information()->inputs())
+    {
+    vtkSmartPointer<vtkDataObject> data;
+    if (input->type() == "Table")
+      {
+      vtkSmartPointer<vtkExtendedTable> extendedTable = this->getInputTable(index);
+      if (extendedTable)
+        {
+        data = input->includeMetadata() ? extendedTable->GetInputData() : extendedTable->GetData();
+        }
+      }
+    else if (input->type() == "Tree")
+      {
+      data = vtkTree::SafeDownCast(this->input(index)->dataAsVTKDataObject());
+      }
+    if (!data)
+      {
+      emit error(tr("Unsupported input: %1").arg(input->name()));
+      return voAnalysis::FAILURE;
+      }
+
+    double start = voTrace::now();
+    qint64 previousSize = m_localTransfer->inputSize();
+    if (!m_localTransfer->addInput(input->name(), data,
+                                   taskRequest["inputs"][Json::ArrayIndex(index)]))
       {
+      emit error(tr("Unable to copy input %1 to shared memory").arg(input->name()));
+      return voAnalysis::FAILURE;
+      }
+    this->addJobTiming(voTrace::addEvent("serialize", input->name(), start,
+                                         m_localTransfer->inputSize() - previousSize));
+    ++index;
+    }
+
+  if (!this->describeOutputs(taskRequest["outputs"]))
+    {
+    return voAnalysis::FAILURE;
+    }
+
+  QString script;
+  if (!this->parameterizedScript(script))
+    {
+    return voAnalysis::FAILURE;
+    }
+  taskRequest["script"] = script.toStdString();
 
-      vtkNew<vtkTableReader> reader;
-      reader->SetBinaryInputString(binary.data(), binary.size());
-      reader->SetReadFromInputString(1);
-      reader->Update();
+  Json::FastWriter writer;
+  std::string request = writer.write(taskRequest);
+  m_localRequest.resize(4);
+  qToBigEndian<quint32>(static_cast<quint32>(request.size()),
+                        reinterpret_cast<uchar*>(m_localRequest.data()));
+  m_localRequest.append(request.data(), static_cast<int>(request.size()));
+  m_localReply.clear();
 
-      voTableDataObject *dataObject = new voTableDataObject(name,
-                                                            reader->GetOutput(),
-                                                            true);
+  if (!m_localSocket)
+    {
+    m_localSocket = new QLocalSocket(this);
+    connect(m_localSocket, SIGNAL(connected()), this, SLOT(sendLocalRequest()));
+    connect(m_localSocket, SIGNAL(readyRead()), this, SLOT(readLocalReply()));
+    connect(m_localSocket, SIGNAL(error(QLocalSocket::LocalSocketError)),
+            this, SLOT(handleLocalError()));
+    }
+  m_localSocket->abort();
+  m_localSocket->connectToServer(m_localServerName);
+
+  return voAnalysis::PENDING;
+}
+
+// --------------------------------------------------------------------------
+void voRemoteCustomAnalysis::sendLocalRequest()
+{
+  m_localSocket->write(m_localRequest);
+  m_localRequest.clear();
+  m_queueStart = voTrace::now();
+  emit analysisSubmitted();
+}
+
+// --------------------------------------------------------------------------
+void voRemoteCustomAnalysis::readLocalReply()
+{
+  // Replies are a JSON document prefixed with its size (uint32, big endian)
+  m_localReply.append(m_localSocket->readAll());
+  if (m_localReply.size() < 4)
+    {
+    return;
+    }
+  int replySize = static_cast<int>(
+    qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(m_localReply.constData())));
+  if (m_localReply.size() < 4 + replySize)
+    {
+    return;
+    }
+  m_queueEnd = voTrace::now();
+  m_localSocket->disconnectFromServer();
+  // The worker is done with the inputs
+  m_localTransfer.reset();
+
+  Json::Value root;
+  Json::Reader reader;
+  if (!reader.parse(m_localReply.constData() + 4, m_localReply.constData() + 4 + replySize, root))
+    {
+    emit error("Unable to parse local worker response");
+    return;
+    }
+  m_localReply.clear();
+  if (root.isMember("error"))
+    {
+    emit error(tr("Local job failed:\n%1").arg(QString::fromStdString(root["error"].asString())));
+    return;
+    }
+
+  double start = voTrace::now();
+  const Json::Value& outputs = root["output"];
+  for (unsigned int index = 0; index < outputs.size(); index++)
+    {
+    QString errorMessage;
+    QString name = QString::fromStdString(outputs[index]["name"].asString());
+    vtkSmartPointer<vtkDataObject> data =
+      voSharedMemoryTransfer::readOutput(outputs[index], errorMessage);
+    if (vtkTable::SafeDownCast(data))
+      {
+      voTableDataObject *dataObject = new voTableDataObject(name, data, true);
       this->transferParameters(dataObject);
       this->setOutput(name, dataObject);
       }
-    else if (type == "Tree" || type == "vtkTree")
+    else if (vtkTree::SafeDownCast(data))
       {
-      vtkNew<vtkTreeReader> reader;
-      reader->SetBinaryInputString(binary.data(), binary.size());
-      reader->SetReadFromInputString(1);
-      reader->Update();
-
-      voOutputDataObject *dataObject = new voOutputDataObject(name, reader->GetOutput());
+      voOutputDataObject *dataObject = new voOutputDataObject(name, data);
       this->transferParameters(dataObject);
       this->setOutput(name, dataObject);
       }
     else
       {
-      emit error("Unsupported output type");
+      emit error(errorMessage);
+      return;
       }
     }
+  double deserializeDuration = voTrace::now() - start;
 
+  double executeDuration = 0.;
+  const Json::Value& workerTimings = root["timings"];
+  Json::Value::Members stages = workerTimings.getMemberNames();
+  for (unsigned int index = 0; index < stages.size(); index++)
+    {
+    executeDuration += workerTimings[stages[index]].asDouble() * 1000.;
+    }
+  executeDuration = qMin(executeDuration, m_queueEnd - m_queueStart);
+  double queueDuration = m_queueEnd - m_queueStart - executeDuration;
+  this->addJobTiming(voTrace::addMeasuredEvent(
+                       "queue", this->objectName(), m_queueStart, queueDuration));
+  this->addJobTiming(voTrace::addMeasuredEvent(
+                       "execute", this->objectName(), m_queueStart + queueDuration, executeDuration));
+  this->addJobTiming(voTrace::addMeasuredEvent(
+                       "deserialize", this->objectName(), start, deserializeDuration));
+  voRemoteAnalysisMetrics::addJob(this->information()->name(), m_jobEvents);
   emit complete();
 }
 
+// --------------------------------------------------------------------------
+void voRemoteCustomAnalysis::handleLocalError()
+{
+  if (m_localSocket->error() == QLocalSocket::PeerClosedError && m_localReply.isEmpty()
+      && !m_localTransfer)
+    {
+    // Closed after the reply was read
+    return;
+    }
+  m_localTransfer.reset();
+  emit error(tr("Unable to reach local worker %1: %2")
+             .arg(m_localServerName).arg(m_localSocket->errorString()));
+}
+
+// --------------------------------------------------------------------------
+bool voRemoteCustomAnalysis::describeOutputs(Json::Value& outputs)
+{
+  int index = 0;
+  outputs = Json::Value(Json::arrayValue);
+  foreach(voCustomAnalysisData *output, this->information()->outputs())
+    {
+    Json::Value &outputValue = outputs[Json::ArrayIndex(index)];
+
+    if (output->type() != "Table" && output->type() != "Tree")
+    {
+    emit error(tr("Unsupported output type: %1").arg(output->type()));
+    return false;
+    }
+
+    outputValue["name"] = output->name().toStdString();
+    outputValue["type"] = output->type().toStdString();
+    ++index;
+    }
+  return true;
+}
+
+// --------------------------------------------------------------------------
+bool voRemoteCustomAnalysis::parameterizedScript(QString& script)
+{
+  // replace each parameter in the script with its actual value
+  script = this->information()->script();
+  foreach(voCustomAnalysisParameter *parameter, this->information()->parameters())
+    {
+    QString type = parameter->type();
+    QString name = parameter->name();
+    QString parameterValue;
+    if (type == "Integer")
+      {
+      parameterValue = QString::number(this->integerParameter(name));
+      }
+    else if (type == "Double")
+      {
+      parameterValue = QString::number(this->doubleParameter(name));
+      }
+    else if (type == "Enum")
+      {
+      parameterValue = this->enumParameter(name);
+      }
+    else if (type == "String")
+      {
+      parameterValue = QString("\"%1\"").arg(this->stringParameter(name));
+      }
+    else if (type == "Range")
+      {
+      QList<int> range;
+
+      if (!voUtils::parseRangeString(this->stringParameter(name), range, true))
+        {
+        if (!voUtils::parseRangeString(this->stringParameter(name), range, false))
+          {
+          qDebug() << "Range error";
+          }
+        }
+
+      QStringList list;
+      foreach(int i, range)
+        {
+        list << QString::number(i+1);
+        }
+      QString rangeString = list.join(",");
+
+      parameterValue = QString("c(%1)").arg(rangeString);
+      }
+    else if (type == "Column")
+      {
+      parameterValue = this->columnParameter(name);
+      }
+    else
+      {
+      emit error(tr("Unsupported parameter type in voCustomAnalysis: %1").arg(type));
+      return false;
+      }
+    script.replace(name, parameterValue);
+    }
+  return true;
+}
+
+// --------------------------------------------------------------------------
+void voRemoteCustomAnalysis::addJobTiming(const voTrace::Event& event)
+{
+  this->addTiming(event);
+  m_jobEvents << event;
+}
+
+// --------------------------------------------------------------------------
+bool voRemoteCustomAnalysis::createOutput(const QString& name, const QString& type,
+                                          const QByteArray& encoding, const QByteArray& payload)
+{
+  double start = voTrace::now();
+  if (m_deserializeStart < 0.)
+    {
+    m_deserializeStart = start;
+    }
+
+  QByteArray binary;
+  if (!voRemoteAnalysisProtocol::decodePayload(encoding, payload, binary))
+    {
+    m_resultError = tr("Unable to decode output %1").arg(name);
+    return false;
+    }
+
+  // Hand our buffer over to the reader instead of copying it into its
+  // input string. The array doesn't own (nor modify) the memory.
+  vtkNew<vtkCharArray> inputArray;
+  inputArray->SetArray(const_cast<char*>(binary.constData()), binary.size(), 1);
+
+  if (type == "Table" || type == "vtkTable")
+    {
+
+    vtkNew<vtkTableReader> reader;
+    reader->SetInputArray(inputArray.GetPointer());
+    reader->SetReadFromInputString(1);
+    reader->Update();
+
+    voTableDataObject *dataObject = new voTableDataObject(name,
+                                                          reader->GetOutput(),
+                                                          true);
+    this->transferParameters(dataObject);
+    this->setOutput(name, dataObject);
+    }
+  else if (type == "Tree" || type == "vtkTree")
+    {
+    vtkNew<vtkTreeReader> reader;
+    reader->SetInputArray(inputArray.GetPointer());
+    reader->SetReadFromInputString(1);
+    reader->Update();
+
+    voOutputDataObject *dataObject = new voOutputDataObject(name, reader->GetOutput());
+    this->transferParameters(dataObject);
+    this->setOutput(name, dataObject);
+    }
+  else
+    {
+    m_resultError = tr("Unsupported output type");
+    return false;
+    }
+  m_deserializeDuration += voTrace::now() - start;
+  return true;
+}
+
 bool voRemoteCustomAnalysis::requestConnectionDetails()
 {
   QUrl connectionDetails;
@@ -446,6 +1003,9 @@ bool voRemoteCustomAnalysis::requestConnectionDetails()
     connectionDetails.setPassword("");
 
     m_baseUrl = connectionDetails.toString();
+    // "local://<socket path>" designates a worker on this host
+    m_localServerName = connectionDetails.scheme() == "local" ?
+      connectionDetails.path() : QString();
 
     if (!m_baseUrl.endsWith('/'))
       m_baseUrl = m_baseUrl + "/";
@@ -458,9 +1018,14 @@ bool voRemoteCustomAnalysis::requestConnectionDetails()
     }
 }
 
-void voRemoteCustomAnalysis::provideCredentials(QNetworkReply *reply,
-    QAuthenticator *auth)
+void voRemoteCustomAnalysis::provideCredentials(QObject *receiver,
+    QNetworkReply *reply, QAuthenticator *auth)
 {
+  Q_UNUSED(reply);
+  if (receiver != this)
+    {
+    return;
+    }
   if (m_credentialsProvided)
     {
     // Inform driver that credentials where bad
@@ -22,15 +22,29 @@
 #define __voRemoteCustomAnalysis_h
 
 // Qt includes
+#include <QByteArray>
+#include <QHash>
+#include <QList>
 #include <QScopedPointer>
 
 // Visomics includes
 #include "voCustomAnalysis.h"
 
+class QLocalSocket;
 class QNetworkReply;
 class QUrl;
 class QAuthenticator;
-class QNetworkAccessManager;
+namespace Json
+{
+class Value;
+}
+
+class voRemoteAnalysisClient;
+class voSharedMemoryTransfer;
+namespace voRemoteAnalysisProtocol
+{
+class FrameReader;
+}
 
 class voRemoteCustomAnalysis : public voCustomAnalysis
 {
@@ -40,6 +54,11 @@ public:
   voRemoteCustomAnalysis(QObject* newParent = 0);
   virtual ~voRemoteCustomAnalysis();
 
+  /// Client used to talk to the analysis server. By default each analysis
+  /// has its own, the driver sets a client shared by all its analyses.
+  voRemoteAnalysisClient* client()const;
+  void setClient(voRemoteAnalysisClient* client);
+
 signals:
   void urlRequired(QUrl *url);
   void invalidCredentials();
@@ -55,19 +74,69 @@ private:
   QString m_password;
   QString m_status;
   bool m_credentialsProvided;
-  QNetworkAccessManager *m_networkManager;
+  /// Send every input, even those the server is assumed to hold already
+  bool m_forceUpload;
+  /// Hashes of the inputs of the current job
+  QList<QByteArray> m_submittedBlobs;
+  /// Delay (in ms) before the next status request when the server doesn't
+  /// support long polling.
+  int m_pollInterval;
+  voRemoteAnalysisClient *m_client;
+
+  /// Outputs of a streamed result, by frame index
+  struct ResultOutput
+  {
+    QString Name;
+    QString Type;
+    QByteArray Encoding;
+  };
+  QScopedPointer<voRemoteAnalysisProtocol::FrameReader> m_resultReader;
+  bool m_resultIsJson;
+  bool m_resultHeaderParsed;
+  QHash<int, ResultOutput> m_resultOutputs;
+  QString m_resultError;
+
+  /// Start (see voTrace::now()) and size of the stages of the current job
+  double m_uploadStart;
+  qint64 m_uploadBytes;
+  double m_queueStart;
+  double m_queueEnd;
+  double m_downloadStart;
+  qint64 m_downloadBytes;
+  double m_deserializeStart;
+  double m_deserializeDuration;
+  /// Timings of the current job, see voRemoteAnalysisMetrics
+  QList<voTrace::Event> m_jobEvents;
+
+  /// Worker on this host, see voSharedMemoryTransfer. Set by URLs of the
+  /// form "local://<socket path>".
+  QString m_localServerName;
+  QLocalSocket* m_localSocket;
+  QScopedPointer<voSharedMemoryTransfer> m_localTransfer;
+  QByteArray m_localRequest;
+  QByteArray m_localReply;
 
   Q_DISABLE_COPY(voRemoteCustomAnalysis);
 
   bool requestConnectionDetails();
+  int executeLocal();
+  bool describeOutputs(Json::Value& outputs);
+  bool parameterizedScript(QString& script);
+  void addJobTiming(const voTrace::Event& event);
   void transferParameters(voDataObject *dataObject);
+  bool createOutput(const QString& name, const QString& type,
+                    const QByteArray& encoding, const QByteArray& payload);
 
 private slots:
   void handleReply(QNetworkReply *);
   void handleStatusReply(QNetworkReply *);
   void handleResultReply(QNetworkReply *);
+  void readResultData(QNetworkReply *);
   void monitorStatus();
-  void provideCredentials(QNetworkReply *reply, QAuthenticator *auth);
+  void sendLocalRequest();
+  void readLocalReply();
+  void handleLocalError();
+  void provideCredentials(QObject *receiver, QNetworkReply *reply, QAuthenticator *auth);
 };
 
 #endif
@@ -0,0 +1,367 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+// Qt includes
+#include <QAtomicInt>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+// Visomics includes
+#include "voSharedMemoryTransfer.h"
+
+// VTK includes
+#include <vtkCharArray.h>
+#include <vtkDataArray.h>
+#include <vtkDataWriter.h>
+#include <vtkNew.h>
+#include <vtkTable.h>
+#include <vtkTableReader.h>
+#include <vtkTableWriter.h>
+#include <vtkTree.h>
+#include <vtkTreeReader.h>
+#include <vtkTreeWriter.h>
+
+// JsonCpp includes
+#include <json/json.h>
+
+// STD includes
+#include <cstring>
+
+namespace
+{
+const qint64 Alignment = 64;
+const char SegmentPrefix[] = "visomics-";
+
+// --------------------------------------------------------------------------
+qint64 align(qint64 offset)
+{
+  return (offset + Alignment - 1) / Alignment * Alignment;
+}
+
+// --------------------------------------------------------------------------
+// Name of the type of the values of a column, as understood by numpy
+const char* columnTypeName(int dataType)
+{
+  switch (dataType)
+    {
+    case VTK_DOUBLE: return "float64";
+    case VTK_FLOAT: return "float32";
+    case VTK_CHAR:
+    case VTK_SIGNED_CHAR: return "int8";
+    case VTK_UNSIGNED_CHAR: return "uint8";
+    case VTK_SHORT: return "int16";
+    case VTK_UNSIGNED_SHORT: return "uint16";
+    case VTK_INT: return "int32";
+    case VTK_UNSIGNED_INT: return "uint32";
+    case VTK_LONG: return sizeof(long) == 8 ? "int64" : "int32";
+    case VTK_UNSIGNED_LONG: return sizeof(unsigned long) == 8 ? "uint64" : "uint32";
+    case VTK_LONG_LONG: return "int64";
+    case VTK_UNSIGNED_LONG_LONG: return "uint64";
+    case VTK_ID_TYPE: return sizeof(vtkIdType) == 8 ? "int64" : "int32";
+    default: return 0;
+    }
+}
+
+// --------------------------------------------------------------------------
+int columnDataType(const std::string& typeName)
+{
+  if (typeName == "float64") { return VTK_DOUBLE; }
+  if (typeName == "float32") { return VTK_FLOAT; }
+  if (typeName == "int8") { return VTK_SIGNED_CHAR; }
+  if (typeName == "uint8") { return VTK_UNSIGNED_CHAR; }
+  if (typeName == "int16") { return VTK_SHORT; }
+  if (typeName == "uint16") { return VTK_UNSIGNED_SHORT; }
+  if (typeName == "int32") { return VTK_INT; }
+  if (typeName == "uint32") { return VTK_UNSIGNED_INT; }
+  if (typeName == "int64") { return VTK_LONG_LONG; }
+  if (typeName == "uint64") { return VTK_UNSIGNED_LONG_LONG; }
+  return -1;
+}
+
+// --------------------------------------------------------------------------
+// Return a new file of \a size bytes, mapped at \a data
+QFile* createSegment(qint64 size, uchar*& data)
+{
+  static QAtomicInt counter;
+  QString fileName = QString("%1%2-%3-%4").arg(SegmentPrefix)
+    .arg(QCoreApplication::applicationPid()).arg(counter.fetchAndAddOrdered(1)).arg(qrand());
+  QFile* segment = new QFile(QDir(voSharedMemoryTransfer::segmentDirectory()).filePath(fileName));
+  // Empty mappings are not allowed
+  size = qMax(size, qint64(1));
+  data = 0;
+  if (segment->open(QIODevice::ReadWrite | QIODevice::Truncate) && segment->resize(size))
+    {
+    data = segment->map(0, size);
+    }
+  if (!data)
+    {
+    qWarning() << "voSharedMemoryTransfer - Failed to create segment" << segment->fileName()
+               << ":" << segment->errorString();
+    segment->remove();
+    delete segment;
+    return 0;
+    }
+  return segment;
+}
+
+// --------------------------------------------------------------------------
+// Only segments of ours can be removed
+bool isSegment(const QString& fileName)
+{
+  QFileInfo fileInfo(fileName);
+  return fileInfo.fileName().startsWith(SegmentPrefix)
+    && fileInfo.absolutePath() == QFileInfo(voSharedMemoryTransfer::segmentDirectory()).absoluteFilePath();
+}
+
+} // end of anonymous namespace
+
+// --------------------------------------------------------------------------
+// voSharedMemoryTransfer methods
+
+// --------------------------------------------------------------------------
+voSharedMemoryTransfer::voSharedMemoryTransfer() : InputSize(0)
+{
+}
+
+// --------------------------------------------------------------------------
+voSharedMemoryTransfer::~voSharedMemoryTransfer()
+{
+  foreach(QFile* segment, this->Segments)
+    {
+    segment->close();
+    segment->remove();
+    delete segment;
+    }
+}
+
+// --------------------------------------------------------------------------
+QString voSharedMemoryTransfer::segmentDirectory()
+{
+  QDir sharedMemory("/dev/shm");
+  return sharedMemory.exists() ? sharedMemory.path() : QDir::tempPath();
+}
+
+// --------------------------------------------------------------------------
+qint64 voSharedMemoryTransfer::inputSize()const
+{
+  return this->InputSize;
+}
+
+// --------------------------------------------------------------------------
+bool voSharedMemoryTransfer::addInput(const QString& name, vtkDataObject* data,
+                                      Json::Value& descriptor)
+{
+  vtkTable* table = vtkTable::SafeDownCast(data);
+  vtkTree* tree = vtkTree::SafeDownCast(data);
+  if (!table && !tree)
+    {
+    qWarning() << "voSharedMemoryTransfer - Unsupported input" << name;
+    return false;
+    }
+  descriptor["name"] = name.toStdString();
+  descriptor["type"] = table ? "Table" : "Tree";
+
+  // Layout of the columns, if they all are numeric
+  bool columns = table != 0;
+  qint64 size = 0;
+  for (vtkIdType column = 0; columns && column < table->GetNumberOfColumns(); ++column)
+    {
+    vtkDataArray* array = vtkDataArray::SafeDownCast(table->GetColumn(column));
+    if (!array || !columnTypeName(array->GetDataType()))
+      {
+      columns = false;
+      break;
+      }
+    size = align(size) + static_cast<qint64>(array->GetDataSize()) * array->GetDataTypeSize();
+    }
+
+  vtkSmartPointer<vtkDataWriter> writer;
+  const char* serialized = 0;
+  if (!columns)
+    {
+    if (table)
+      {
+      writer = vtkSmartPointer<vtkTableWriter>::New();
+      }
+    else
+      {
+      writer = vtkSmartPointer<vtkTreeWriter>::New();
+      }
+    writer->SetWriteToOutputString(1);
+    writer->SetInputData(data);
+    writer->SetFileTypeToBinary();
+    writer->Update();
+    serialized = reinterpret_cast<const char*>(writer->GetBinaryOutputString());
+    size = writer->GetOutputStringLength();
+    }
+
+  uchar* segmentData = 0;
+  QFile* segment = createSegment(size, segmentData);
+  if (!segment)
+    {
+    return false;
+    }
+  this->Segments << segment;
+  this->InputSize += size;
+  descriptor["segment"] = segment->fileName().toStdString();
+  descriptor["size"] = static_cast<Json::Int64>(size);
+
+  if (!columns)
+    {
+    descriptor["format"] = "vtk";
+    memcpy(segmentData, serialized, static_cast<size_t>(size));
+    segment->unmap(segmentData);
+    return true;
+    }
+
+  descriptor["format"] = "columns";
+  descriptor["rows"] = static_cast<Json::Int64>(table->GetNumberOfRows());
+  descriptor["columns"] = Json::Value(Json::arrayValue);
+  qint64 offset = 0;
+  for (vtkIdType column = 0; column < table->GetNumberOfColumns(); ++column)
+    {
+    vtkDataArray* array = vtkDataArray::SafeDownCast(table->GetColumn(column));
+    qint64 bytes = static_cast<qint64>(array->GetDataSize()) * array->GetDataTypeSize();
+    offset = align(offset);
+    Json::Value& columnValue = descriptor["columns"][Json::ArrayIndex(column)];
+    columnValue["name"] = array->GetName() ? array->GetName() : "";
+    columnValue["type"] = columnTypeName(array->GetDataType());
+    columnValue["components"] = array->GetNumberOfComponents();
+    columnValue["offset"] = static_cast<Json::Int64>(offset);
+    if (bytes > 0)
+      {
+      memcpy(segmentData + offset, array->GetVoidPointer(0), static_cast<size_t>(bytes));
+      }
+    offset += bytes;
+    }
+  segment->unmap(segmentData);
+  return true;
+}
+
+// --------------------------------------------------------------------------
+vtkSmartPointer<vtkDataObject> voSharedMemoryTransfer::readOutput(const Json::Value& descriptor,
+                                                                  QString& errorMessage)
+{
+  QString name = QString::fromStdString(descriptor["name"].asString());
+  QString fileName = QString::fromStdString(descriptor["segment"].asString());
+  if (!isSegment(fileName))
+    {
+    errorMessage = QObject::tr("Invalid shared memory segment for output %1").arg(name);
+    return vtkSmartPointer<vtkDataObject>();
+    }
+  QFile segment(fileName);
+  qint64 size = descriptor["size"].asInt64();
+  uchar* segmentData = 0;
+  if (segment.open(QIODevice::ReadOnly) && size >= 0 && size <= segment.size())
+    {
+    segmentData = segment.map(0, qMax(size, qint64(1)));
+    }
+  if (!segmentData)
+    {
+    errorMessage = QObject::tr("Unable to map output %1: %2").arg(name).arg(segment.errorString());
+    segment.remove();
+    return vtkSmartPointer<vtkDataObject>();
+    }
+
+  vtkSmartPointer<vtkDataObject> data;
+  std::string type = descriptor["type"].asString();
+  if (descriptor["format"].asString() == "columns" && (type == "Table" || type == "vtkTable"))
+    {
+    vtkSmartPointer<vtkTable> table = vtkSmartPointer<vtkTable>::New();
+    vtkIdType rows = static_cast<vtkIdType>(descriptor["rows"].asInt64());
+    const Json::Value& columns = descriptor["columns"];
+    bool valid = true;
+    for (unsigned int index = 0; valid && index < columns.size(); ++index)
+      {
+      const Json::Value& column = columns[index];
+      int dataType = columnDataType(column["type"].asString());
+      int components = column["components"].asInt();
+      qint64 offset = column["offset"].asInt64();
+      vtkSmartPointer<vtkDataArray> array;
+      if (dataType >= 0 && components > 0)
+        {
+        array.TakeReference(vtkDataArray::CreateDataArray(dataType));
+        }
+      if (!array)
+        {
+        errorMessage = QObject::tr("Unsupported column type in output %1").arg(name);
+        valid = false;
+        continue;
+        }
+      array->SetName(column["name"].asCString());
+      array->SetNumberOfComponents(components);
+      array->SetNumberOfTuples(rows);
+      qint64 bytes = static_cast<qint64>(array->GetDataSize()) * array->GetDataTypeSize();
+      if (offset < 0 || offset + bytes > size)
+        {
+        errorMessage = QObject::tr("Truncated output %1").arg(name);
+        valid = false;
+        continue;
+        }
+      if (bytes > 0)
+        {
+        memcpy(array->GetVoidPointer(0), segmentData + offset, static_cast<size_t>(bytes));
+        }
+      table->AddColumn(array.GetPointer());
+      }
+    if (valid)
+      {
+      data = table;
+      }
+    }
+  else if (descriptor["format"].asString() == "vtk")
+    {
+    // The reader parses the mapped bytes directly
+    vtkNew<vtkCharArray> inputArray;
+    inputArray->SetArray(reinterpret_cast<char*>(segmentData), size, 1);
+    if (type == "Table" || type == "vtkTable")
+      {
+      vtkNew<vtkTableReader> reader;
+      reader->SetInputArray(inputArray.GetPointer());
+      reader->SetReadFromInputString(1);
+      reader->Update();
+      data = reader->GetOutput();
+      }
+    else if (type == "Tree" || type == "vtkTree")
+      {
+      vtkNew<vtkTreeReader> reader;
+      reader->SetInputArray(inputArray.GetPointer());
+      reader->SetReadFromInputString(1);
+      reader->Update();
+      data = reader->GetOutput();
+      }
+    else
+      {
+      errorMessage = QObject::tr("Unsupported output type");
+      }
+    }
+  else
+    {
+    errorMessage = QObject::tr("Unsupported format for output %1").arg(name);
+    }
+
+  segment.unmap(segmentData);
+  segment.close();
+  segment.remove();
+  return data;
+}
@@ -0,0 +1,83 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+#ifndef __voSharedMemoryTransfer_h
+#define __voSharedMemoryTransfer_h
+
+// Qt includes
+#include <QList>
+#include <QString>
+
+// VTK includes
+#include <vtkSmartPointer.h>
+
+class QFile;
+class vtkDataObject;
+namespace Json
+{
+class Value;
+}
+
+/// Data objects handed over to a local analysis worker through shared
+/// memory, see AnalysisServer/visomics/vtk/localworker.py.
+///
+/// Each data object is copied once into its own segment: a file mapped in
+/// memory, created in /dev/shm when available so that it never reaches the
+/// disk. Only a descriptor (JSON) is sent to the worker, which maps the
+/// segment instead of decoding a serialized copy.
+///
+/// Tables made of numeric columns use the "columns" format: the buffer of
+/// each column is stored as is, at a 64 bytes aligned offset, so that the
+/// worker can wrap it without copying. Other data objects use the "vtk"
+/// format, i.e. the output of the VTK binary writers.
+///
+/// Segments created by addInput() are removed with the transfer, segments
+/// created by the worker are removed by readOutput().
+class voSharedMemoryTransfer
+{
+public:
+  voSharedMemoryTransfer();
+  ~voSharedMemoryTransfer();
+
+  /// Copy \a data, a table or a tree, into a new segment and describe it in
+  /// \a descriptor. Return false if the segment can't be created.
+  bool addInput(const QString& name, vtkDataObject* data, Json::Value& descriptor);
+
+  /// Total size (in bytes) of the segments created by addInput().
+  qint64 inputSize()const;
+
+  /// Read the data object described by \a descriptor and remove its
+  /// segment. Return 0 and set \a errorMessage on failure.
+  static vtkSmartPointer<vtkDataObject> readOutput(const Json::Value& descriptor,
+                                                   QString& errorMessage);
+
+  /// Directory of the segments: /dev/shm if it exists, the temporary
+  /// directory otherwise.
+  static QString segmentDirectory();
+
+private:
+  voSharedMemoryTransfer(const voSharedMemoryTransfer&);
+  void operator=(const voSharedMemoryTransfer&);
+
+  QList<QFile*> Segments;
+  qint64 InputSize;
+};
+
+#endif
@@ -0,0 +1,426 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+// Qt includes
+#include <QDebug>
+#include <QHash>
+#include <QList>
+#include <QtConcurrentMap>
+
+// QtPropertyBrowser includes
+#include <QtVariantPropertyManager>
+
+// Visomics includes
+#include "voDataObject.h"
+#include "voOutputDataObject.h"
+#include "voTreeComparison.h"
+#include "voTreeNameIndex.h"
+
+// VTK includes
+#include <vtkDataSetAttributes.h>
+#include <vtkDoubleArray.h>
+#include <vtkIntArray.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkStringArray.h>
+#include <vtkTable.h>
+#include <vtkTree.h>
+
+// STD includes
+#include <cmath>
+
+namespace // helpers for voTreeComparison::compareTrees(vtkTree*, vtkTree*, const QString&, QVector<double>*)
+{
+
+//----------------------------------------------------------------------------
+// Pre-order traversal without recursion: deep (e.g. caterpillar) trees
+// would overflow the stack.
+QVector<vtkIdType> preOrder(vtkTree * tree)
+{
+  QVector<vtkIdType> vertices;
+  vertices.reserve(static_cast<int>(tree->GetNumberOfVertices()));
+  QVector<vtkIdType> stack;
+  stack << tree->GetRoot();
+  while (!stack.isEmpty())
+    {
+    vtkIdType vertex = stack.last();
+    stack.pop_back();
+    vertices << vertex;
+    for (vtkIdType child = 0; child < tree->GetNumberOfChildren(vertex); ++child)
+      {
+      stack << tree->GetChild(vertex, child);
+      }
+    }
+  return vertices;
+}
+
+//----------------------------------------------------------------------------
+// Random key of a leaf: the clade of a vertex is identified by the sum of
+// the keys of its leaves.
+quint64 leafKey(quint64 x)
+{
+  x += Q_UINT64_C(0x9E3779B97F4A7C15);
+  x = (x ^ (x >> 30)) * Q_UINT64_C(0xBF58476D1CE4E5B9);
+  x = (x ^ (x >> 27)) * Q_UINT64_C(0x94D049BB133111EB);
+  return x ^ (x >> 31);
+}
+
+//----------------------------------------------------------------------------
+// Collect the clades of \a tree with the length of their branch. Clades of
+// a single leaf are only added to \a branches.
+void collectClades(vtkTree * tree, const QVector<quint64>& keys, int numberOfSharedLeaves,
+                   QHash<quint64, double>& clades, QHash<quint64, double>& branches)
+{
+  vtkDataArray * weights = tree->GetEdgeData()->GetArray("weight");
+  vtkIdType root = tree->GetRoot();
+  QVector<quint64> hashes(keys);
+  QVector<int> counts(keys.size(), 0);
+  QVector<vtkIdType> vertices = preOrder(tree);
+  // Children come after their parent in pre-order: walk it backwards
+  for (int i = vertices.size() - 1; i >= 0; --i)
+    {
+    vtkIdType vertex = vertices.at(i);
+    if (keys.at(vertex) != 0)
+      {
+      counts[vertex] = 1;
+      }
+    for (vtkIdType child = 0; child < tree->GetNumberOfChildren(vertex); ++child)
+      {
+      vtkIdType childVertex = tree->GetChild(vertex, child);
+      hashes[vertex] += hashes.at(childVertex);
+      counts[vertex] += counts.at(childVertex);
+      }
+    int count = counts.at(vertex);
+    if (vertex == root || count == 0 || count == numberOfSharedLeaves)
+      {
+      continue;
+      }
+    double length = weights ? weights->GetTuple1(tree->GetInEdge(vertex, 0).Id) : 1.0;
+    branches[hashes.at(vertex)] += length;
+    if (count > 1)
+      {
+      clades[hashes.at(vertex)] += length;
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+struct ComparisonTask
+{
+  vtkTree * Reference;
+  vtkTree * Tree;
+  QString ComparisonArrayName;
+  voTreeComparison::Distances Distances;
+  QVector<double> Differences;
+};
+
+//----------------------------------------------------------------------------
+void runComparisonTask(ComparisonTask& task)
+{
+  task.Distances = voTreeComparison::compareTrees(
+    task.Reference, task.Tree, task.ComparisonArrayName, &task.Differences);
+}
+
+} // end of anonymous namespace
+
+// --------------------------------------------------------------------------
+class voTreeComparisonPrivate
+{
+};
+
+// --------------------------------------------------------------------------
+// voTreeComparison methods
+
+// --------------------------------------------------------------------------
+voTreeComparison::voTreeComparison():
+  Superclass(), d_ptr(new voTreeComparisonPrivate)
+{
+}
+
+// --------------------------------------------------------------------------
+voTreeComparison::~voTreeComparison()
+{
+}
+
+// --------------------------------------------------------------------------
+bool voTreeComparison::canRunInBackground()const
+{
+  return true;
+}
+
+// --------------------------------------------------------------------------
+void voTreeComparison::setOutputInformation()
+{
+  this->addOutputType("comparisonTree", "vtkTree",
+                      "", "",
+                      "voTreeHeatmapView", "comparison tree");
+  this->addOutputType("distances", "vtkTable",
+                      "", "",
+                      "voTableView", "Distances");
+}
+
+// --------------------------------------------------------------------------
+void voTreeComparison::setParameterInformation()
+{
+  QList<QtProperty*> comparison_parameters;
+
+  comparison_parameters << this->addStringParameter("comparison_array", tr("Comparison array"), "node weight");
+
+  this->addParameterGroup("Comparison parameters", comparison_parameters);
+}
+
+// --------------------------------------------------------------------------
+QString voTreeComparison::parameterDescription()const
+{
+  return QString("<dl>"
+    "<dt><b>Inputs</b>:</dt>"
+    "<dd>The first selected tree is the reference. It is compared to each of"
+    " the other selected trees, e.g. the trees of a forest.</dd>"
+    "<dt><b>Comparison array</b>:</dt>"
+    "<dd>Vertex array whose differences are shown on the reference tree,"
+    " averaged over the compared trees.</dd>"
+    "</dl>");
+}
+
+// --------------------------------------------------------------------------
+int voTreeComparison::execute()
+{
+  vtkTree * reference = this->input(0) ?
+    vtkTree::SafeDownCast(this->input(0)->dataAsVTKDataObject()) : 0;
+  if (!reference)
+    {
+    qCritical() << "Reference tree is Null";
+    return voAnalysis::FAILURE;
+    }
+
+  QString comparisonArrayName = this->stringParameter("comparison_array");
+  QList<ComparisonTask> tasks;
+  for (int i = 1; this->input(i); ++i)
+    {
+    vtkTree * tree = vtkTree::SafeDownCast(this->input(i)->dataAsVTKDataObject());
+    if (!tree)
+      {
+      qCritical() << "Input" << this->input(i)->name() << "is not a tree";
+      return voAnalysis::FAILURE;
+      }
+    ComparisonTask task;
+    task.Reference = reference;
+    task.Tree = tree;
+    task.ComparisonArrayName = comparisonArrayName;
+    tasks << task;
+    }
+  if (tasks.isEmpty())
+    {
+    qCritical() << QObject::tr("At least two trees are expected");
+    return voAnalysis::FAILURE;
+    }
+
+  // Trees are only read: they are compared concurrently
+  QtConcurrent::blockingMap(tasks, runComparisonTask);
+  if (this->abortExecution())
+    {
+    return voAnalysis::FAILURE;
+    }
+
+  // Differences averaged over the trees where the vertex is found
+  vtkIdType numberOfVertices = reference->GetNumberOfVertices();
+  vtkNew<vtkDoubleArray> differences;
+  differences->SetName("differences");
+  differences->SetNumberOfValues(numberOfVertices);
+  for (vtkIdType vertex = 0; vertex < numberOfVertices; ++vertex)
+    {
+    double sum = 0.;
+    int count = 0;
+    foreach(const ComparisonTask& task, tasks)
+      {
+      double difference = task.Differences.at(static_cast<int>(vertex));
+      if (!vtkMath::IsNan(difference))
+        {
+        sum += difference;
+        ++count;
+        }
+      }
+    differences->SetValue(vertex, count > 0 ? sum / count : vtkMath::Nan());
+    }
+
+  vtkSmartPointer<vtkTree> comparisonTree =
+    vtkTree::SafeDownCast(this->input(0)->sharedDataCopy());
+  comparisonTree->GetVertexData()->AddArray(differences.GetPointer());
+  this->setOutput("comparisonTree", new voOutputDataObject("comparisonTree", comparisonTree));
+
+  vtkNew<vtkStringArray> treeNames;
+  treeNames->SetName("tree");
+  vtkNew<vtkIntArray> robinsonFoulds;
+  robinsonFoulds->SetName("Robinson-Foulds");
+  vtkNew<vtkDoubleArray> normalizedRobinsonFoulds;
+  normalizedRobinsonFoulds->SetName("normalized Robinson-Foulds");
+  vtkNew<vtkDoubleArray> weightedRobinsonFoulds;
+  weightedRobinsonFoulds->SetName("weighted Robinson-Foulds");
+  vtkNew<vtkIntArray> sharedLeaves;
+  sharedLeaves->SetName("shared tips");
+  for (int i = 0; i < tasks.size(); ++i)
+    {
+    const Distances& distances = tasks.at(i).Distances;
+    treeNames->InsertNextValue(this->input(i + 1)->name().toStdString());
+    robinsonFoulds->InsertNextValue(distances.RobinsonFoulds);
+    normalizedRobinsonFoulds->InsertNextValue(distances.NormalizedRobinsonFoulds);
+    weightedRobinsonFoulds->InsertNextValue(distances.WeightedRobinsonFoulds);
+    sharedLeaves->InsertNextValue(distances.NumberOfSharedLeaves);
+    }
+  vtkNew<vtkTable> distancesTable;
+  distancesTable->AddColumn(treeNames.GetPointer());
+  distancesTable->AddColumn(robinsonFoulds.GetPointer());
+  distancesTable->AddColumn(normalizedRobinsonFoulds.GetPointer());
+  distancesTable->AddColumn(weightedRobinsonFoulds.GetPointer());
+  distancesTable->AddColumn(sharedLeaves.GetPointer());
+  this->setOutput("distances", new voOutputDataObject("distances", distancesTable.GetPointer()));
+
+  return voAnalysis::SUCCESS;
+}
+
+// --------------------------------------------------------------------------
+voTreeComparison::Distances voTreeComparison::compareTrees(
+  vtkTree * reference, vtkTree * tree, const QString& comparisonArrayName,
+  QVector<double> * differences)
+{
+  Distances distances = {0, 0., 0., 0};
+  if (differences)
+    {
+    differences->fill(vtkMath::Nan(), reference ? static_cast<int>(reference->GetNumberOfVertices()) : 0);
+    }
+  if (!reference || !tree
+      || reference->GetNumberOfVertices() == 0 || tree->GetNumberOfVertices() == 0)
+    {
+    return distances;
+    }
+  int numberOfVertices = static_cast<int>(reference->GetNumberOfVertices());
+  vtkStringArray * referenceNames = vtkStringArray::SafeDownCast(
+    reference->GetVertexData()->GetAbstractArray("node name"));
+  voTreeNameIndex treeNameIndex(tree);
+
+  // Match the named vertices, then the unnamed internal vertices through
+  // the parent of their matched children
+  QVector<vtkIdType> matches(numberOfVertices, -1);
+  for (int vertex = 0; referenceNames && vertex < numberOfVertices; ++vertex)
+    {
+    QString name(referenceNames->GetValue(vertex).c_str());
+    if (!name.isEmpty())
+      {
+      matches[vertex] = treeNameIndex.vertex(name);
+      }
+    }
+  QVector<vtkIdType> vertices = preOrder(reference);
+  for (int i = vertices.size() - 1; i >= 0; --i)
+    {
+    vtkIdType vertex = vertices.at(i);
+    if (matches.at(vertex) >= 0 || reference->IsLeaf(vertex))
+      {
+      continue;
+      }
+    // The parent of a child matched to the root of the tree is -1: it is
+    // only consistent with children matched to the root too.
+    vtkIdType parent = -1;
+    bool hasMatchedChild = false;
+    bool consistent = true;
+    for (vtkIdType child = 0; consistent && child < reference->GetNumberOfChildren(vertex); ++child)
+      {
+      vtkIdType childMatch = matches.at(reference->GetChild(vertex, child));
+      if (childMatch < 0)
+        {
+        continue;
+        }
+      vtkIdType childMatchParent = tree->GetParent(childMatch);
+      consistent = !hasMatchedChild || parent == childMatchParent;
+      parent = childMatchParent;
+      hasMatchedChild = true;
+      }
+    if (consistent)
+      {
+      matches[vertex] = parent;
+      }
+    }
+
+  QByteArray arrayName = comparisonArrayName.toLatin1();
+  vtkDataArray * referenceValues = reference->GetVertexData()->GetArray(arrayName.constData());
+  vtkDataArray * treeValues = tree->GetVertexData()->GetArray(arrayName.constData());
+  if (differences && referenceValues && treeValues)
+    {
+    for (int vertex = 0; vertex < numberOfVertices; ++vertex)
+      {
+      if (matches.at(vertex) >= 0)
+        {
+        (*differences)[vertex] =
+          referenceValues->GetTuple1(vertex) - treeValues->GetTuple1(matches.at(vertex));
+        }
+      }
+    }
+
+  // Clades are restricted to the leaves found in both trees
+  QVector<quint64> referenceKeys(numberOfVertices, 0);
+  QVector<quint64> treeKeys(static_cast<int>(tree->GetNumberOfVertices()), 0);
+  for (int vertex = 0; vertex < numberOfVertices; ++vertex)
+    {
+    vtkIdType match = matches.at(vertex);
+    if (match < 0 || !reference->IsLeaf(vertex) || !tree->IsLeaf(match)
+        || treeKeys.at(match) != 0)
+      {
+      continue;
+      }
+    referenceKeys[vertex] = leafKey(vertex);
+    treeKeys[match] = referenceKeys.at(vertex);
+    ++distances.NumberOfSharedLeaves;
+    }
+
+  QHash<quint64, double> referenceClades;
+  QHash<quint64, double> referenceBranches;
+  collectClades(reference, referenceKeys, distances.NumberOfSharedLeaves,
+                referenceClades, referenceBranches);
+  QHash<quint64, double> treeClades;
+  QHash<quint64, double> treeBranches;
+  collectClades(tree, treeKeys, distances.NumberOfSharedLeaves,
+                treeClades, treeBranches);
+
+  QHash<quint64, double>::const_iterator it;
+  for (it = referenceClades.constBegin(); it != referenceClades.constEnd(); ++it)
+    {
+    distances.RobinsonFoulds += treeClades.contains(it.key()) ? 0 : 1;
+    }
+  for (it = treeClades.constBegin(); it != treeClades.constEnd(); ++it)
+    {
+    distances.RobinsonFoulds += referenceClades.contains(it.key()) ? 0 : 1;
+    }
+  int numberOfClades = referenceClades.size() + treeClades.size();
+  distances.NormalizedRobinsonFoulds = numberOfClades > 0 ?
+    static_cast<double>(distances.RobinsonFoulds) / numberOfClades : 0.;
+
+  for (it = referenceBranches.constBegin(); it != referenceBranches.constEnd(); ++it)
+    {
+    distances.WeightedRobinsonFoulds += fabs(it.value() - treeBranches.value(it.key(), 0.));
+    }
+  for (it = treeBranches.constBegin(); it != treeBranches.constEnd(); ++it)
+    {
+    if (!referenceBranches.contains(it.key()))
+      {
+      distances.WeightedRobinsonFoulds += fabs(it.value());
+      }
+    }
+  return distances;
+}
@@ -0,0 +1,92 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+#ifndef __voTreeComparison_h
+#define __voTreeComparison_h
+
+// Qt includes
+#include <QScopedPointer>
+#include <QVector>
+
+// Visomics includes
+#include "voAnalysis.h"
+
+class voTreeComparisonPrivate;
+class vtkTree;
+
+/// Compare a reference tree to one or more trees.
+///
+/// Vertices are matched by name; unnamed internal vertices are matched
+/// through their matched children. The "differences" array of the output
+/// tree holds, for each vertex of the reference, the difference of the
+/// comparison array ("node weight" by default) with the matching vertices,
+/// averaged over the compared trees. The Robinson-Foulds distances of each
+/// tree to the reference are listed in the "distances" table. Trees are
+/// compared in parallel.
+class voTreeComparison : public voAnalysis
+{
+  Q_OBJECT
+public:
+  typedef voAnalysis Superclass;
+  voTreeComparison();
+  virtual ~voTreeComparison();
+
+  /// Only reads the inputs.
+  virtual bool canRunInBackground()const;
+
+  struct Distances
+  {
+    /// Number of clades of the trees that are not found in the other tree.
+    /// The trees are rooted: clades are the sets of leaves below each vertex,
+    /// restricted to the leaves present in both trees.
+    int RobinsonFoulds;
+    /// RobinsonFoulds divided by the number of non-trivial clades of both trees
+    double NormalizedRobinsonFoulds;
+    /// Sum over all branches, terminal ones included, of the difference of
+    /// their lengths. Branches missing from a tree have a null length.
+    double WeightedRobinsonFoulds;
+    int NumberOfSharedLeaves;
+  };
+
+  /// Compare \a tree to \a reference. If \a differences is not null, it is
+  /// resized to the number of vertices of \a reference and filled with the
+  /// differences of the vertex array \a comparisonArrayName, or NaN for the
+  /// vertices not found in \a tree. Runs in linear time and can be called
+  /// concurrently.
+  static Distances compareTrees(vtkTree * reference, vtkTree * tree,
+                                const QString& comparisonArrayName = "node weight",
+                                QVector<double> * differences = 0);
+
+protected:
+  virtual void setOutputInformation();
+  virtual void setParameterInformation();
+  virtual QString parameterDescription()const;
+
+  virtual int execute();
+
+protected:
+  QScopedPointer<voTreeComparisonPrivate> d_ptr;
+
+private:
+  Q_DECLARE_PRIVATE(voTreeComparison);
+  Q_DISABLE_COPY(voTreeComparison);
+};
+
+#endif
@@ -19,20 +19,24 @@
 =========================================================================*/
 
 // Qt includes
+#include <QBitArray>
 #include <QDebug>
+#include <QHash>
+#include <QSet>
 
 // QtPropertyBrowser includes
 #include <QtVariantPropertyManager>
 #include <QInputDialog>
 #include <QMainWindow>
-#include <QRegExp>
 
 // Visomics includes
 #include "voTreeDropTip.h"
 #include "voApplication.h"
+#include "voDataFilterExpression.h"
 #include "voTableDataObject.h"
 #include "voOutputDataObject.h"
 #include "voIOManager.h"
+#include "voTreeNameIndex.h"
 #include "voUtils.h"
 #include "voTreeHeatmapView.h"
 
@@ -52,7 +56,6 @@
 #include <vtkSelectionNode.h>
 #include <vtkDataSetAttributes.h>
 #include <vtkInformation.h>
-#include <vtkAdjacentVertexIterator.h>
 #include <vtkTreeHeatmapItem.h>
 // --------------------------------------------------------------------------
 // voTreeDropTipPrivate methods
@@ -77,6 +80,18 @@ voTreeDropTip::~voTreeDropTip()
 }
 
 
+// --------------------------------------------------------------------------
+bool voTreeDropTip::canRunInBackground()const
+{
+  return this->enumParameter("selection_method") != "Tree Collapsing";
+}
+
+// --------------------------------------------------------------------------
+bool voTreeDropTip::canCacheResults()const
+{
+  return this->enumParameter("selection_method") != "Tree Collapsing";
+}
+
 // --------------------------------------------------------------------------
 void voTreeDropTip::setOutputInformation()
 {
@@ -109,6 +124,9 @@ void voTreeDropTip::setParameterInformation()
   DropTip_parameters << this->addEnumParameter("invert_selection", tr("Invert selection"), (QStringList()<<"No"<<"Yes"), "No");
 
   this->addParameterGroup("DropTip parameters", DropTip_parameters);
+
+  // Tips satisfying the data filter don't depend on "invert_selection"
+  this->addStage("matching_tips", QStringList() << "selection_method" << "input_string");
 }
 
 // --------------------------------------------------------------------------
@@ -126,7 +144,9 @@ QString voTreeDropTip::parameterDescription()const
     "<dt><b> Line editor </b>:</dt>"
     "<dd> Input tip names: e.g. tipName1, tipName2;"
     " Input data filtering criteria: e.g."
-    " scalarAttribut>1.0,stringAttribute=\"abc\".</dd>"
+    " scalarAttribut>1.0,stringAttribute=\"abc\";"
+    " conditions are combined with \",\" or \"&amp;\" (and), \"|\" (or),"
+    " \"!\" (not) and parentheses.</dd>"
     "<dt><b>Invert selection </b>:</dt>"
     "<dd> Invert the tip selection. If \"Yes\", The selected tips are to be kept.</dd>"
     "</dl>");
@@ -145,8 +165,9 @@ int voTreeDropTip::execute()
     }
 
 
-  vtkNew<vtkTree> tree;
-  tree->DeepCopy(inputTree);
+  // Only read: the arrays of the input are shared
+  vtkSmartPointer<vtkTree> tree =
+    vtkTree::SafeDownCast(this->input(0)->sharedDataCopy());
 
   vtkExtendedTable* extendedTable = vtkExtendedTable::SafeDownCast(
     this->input(1)->dataAsVTKDataObject());
@@ -154,7 +175,9 @@ int voTreeDropTip::execute()
   vtkNew<vtkTable> table;
   if (extendedTable)
     {
-    table->DeepCopy(extendedTable->GetInputData());
+    // Rows are removed by replacing the columns: the input columns are
+    // shared, not modified
+    table->ShallowCopy(extendedTable->GetInputData());
     }
   else
     {
@@ -181,6 +204,11 @@ int voTreeDropTip::execute()
     SUCCESS = this->getSelectionByPrunedTree(tree.GetPointer(), table.GetPointer(),selectedTips.GetPointer());
     }
 
+  if (this->abortExecution())
+    {
+    return voAnalysis::FAILURE;
+    }
+
   if (SUCCESS)
     {
     vtkNew<vtkExtractSelectedTree> extractSelectedTreeFilter;
@@ -188,6 +216,10 @@ int voTreeDropTip::execute()
     extractSelectedTreeFilter->SetInputData(0, tree.GetPointer());
     extractSelectedTreeFilter->SetInputData(1, selectedTips.GetPointer());
     extractSelectedTreeFilter->Update();
+    if (this->abortExecution())
+      {
+      return voAnalysis::FAILURE;
+      }
 
     vtkTree * outTree = vtkTree::SafeDownCast(extractSelectedTreeFilter->GetOutput());
 
@@ -222,43 +254,6 @@ int voTreeDropTip::execute()
     }
 }
 
-// --------------------------------------------------------------------------
-bool voTreeDropTip::removeInternalBranch(vtkTree * tree, vtkIdTypeArray * selArray, vtkIdType currentId)
-{// remove the internal branch of the selected tips
- //  by adding internal verticies/nodes to the selection
-  if (tree->IsLeaf(currentId))
-    {//do nothing
-    return true;
-    }
-
-  vtkSmartPointer <vtkAdjacentVertexIterator> it  =
-            vtkSmartPointer<vtkAdjacentVertexIterator>::New();
-  tree->GetChildren(currentId,it);
-  int numberOfSelectedChildren = 0;
-  while (it->HasNext())
-   {
-   vtkIdType childId = it->Next();
-   this->removeInternalBranch(tree, selArray,childId);
-   //count the number of selected children
-   for ( vtkIdType i = 0; i < selArray->GetNumberOfTuples(); i++)
-     {
-     if (selArray->GetValue(i) == childId)
-       {
-       numberOfSelectedChildren++;
-       break;
-       }
-     }
-   }
-
-   if (numberOfSelectedChildren == tree->GetNumberOfChildren(currentId))
-     {// add the current internal node to the selection list as well
-     selArray->InsertNextValue(currentId);
-     }
-
-  return true;
-}
-
-
 // --------------------------------------------------------------------------
 bool voTreeDropTip::getTipSelection(vtkTree * tree, vtkTable * inputDataTable, vtkSelection * sel, QStringList tipNameList)
 {
@@ -271,12 +266,13 @@ bool voTreeDropTip::getTipSelection(vtkTree * tree, vtkTable * inputDataTable, v
     }
   else
     {// input list is the keep list
+    QSet<QString> keptTipNames = tipNameList.toSet();
     for ( vtkIdType i = 0; i< nodeNames->GetNumberOfValues() ; i++)
       {
       if (tree->IsLeaf(i))
         {
         QString curTip = QString(nodeNames->GetValue(i).c_str());
-        if  ( !curTip.isEmpty() && !tipNameList.contains(curTip))
+        if  ( !curTip.isEmpty() && !keptTipNames.contains(curTip))
           {
           removalTipNameList.append(curTip);
           }
@@ -292,31 +288,47 @@ if (removalTipNameList.size() == 0 )
 
   vtkSmartPointer<vtkSelectionNode> selNode = vtkSmartPointer <vtkSelectionNode>::New() ;
   vtkSmartPointer<vtkIdTypeArray> selArr = vtkSmartPointer<vtkIdTypeArray>::New();
+  // 'tree' is a copy of the input tree: vertex ids are the same
+  voTreeNameIndex nameIndex = this->input(0)->treeNameIndex();
   // extract subtree using vtkExtractSelectedTree class
   // remove rows from the table
   vtkStringArray *tableNames = vtkStringArray::SafeDownCast(inputDataTable->GetColumn(0));
+  // Every row of a tip is removed, names may be duplicated
+  QMultiHash<QString, vtkIdType> tableRows;
+  for (vtkIdType row = 0; tableNames && row < tableNames->GetNumberOfValues(); ++row)
+    {
+    tableRows.insert(QString(tableNames->GetValue(row).c_str()), row);
+    }
+  // Rows are removed all at once: removing them one by one shifts the
+  // columns each time.
+  QBitArray keepRows(static_cast<int>(inputDataTable->GetNumberOfRows()), true);
 
   for (int i =0; i < removalTipNameList.size(); i++)
     {
-    vtkIdType vertexId = nodeNames->LookupValue(removalTipNameList[i].toStdString().c_str());
+    if (this->abortExecution())
+      {
+      return false;
+      }
+    vtkIdType vertexId = nameIndex.vertex(removalTipNameList[i]);
     if (vertexId >= 0)
       {
       selArr->InsertNextValue(vertexId);
       }
 
-    vtkIdType rowId = tableNames->LookupValue(removalTipNameList[i].toStdString().c_str());
-    if (rowId >= 0)
+    QList<vtkIdType> rowIds = tableRows.values(removalTipNameList[i]);
+    foreach(vtkIdType rowId, rowIds)
       {
-      inputDataTable->RemoveRow(rowId);
+      keepRows.clearBit(static_cast<int>(rowId));
       }
-    else
+    if (rowIds.isEmpty())
       {
       qWarning()<< QObject::tr("Could not find the tip names in the tree:") << removalTipNameList[i];
       }
     }
+  voUtils::removeTableRows(inputDataTable, keepRows);
 
-  //remove vertices whoes children are in the selection list recursively
-  this->removeInternalBranch(tree,selArr,tree->GetRoot());
+  //remove vertices whoes children are all in the selection list
+  voUtils::selectEmptyBranches(tree, selArr.GetPointer());
 
   selNode->SetContentType(vtkSelectionNode::INDICES);
   selNode->SetFieldType(vtkSelectionNode::VERTEX);
@@ -355,137 +367,43 @@ bool voTreeDropTip::getSelectionByTipNames(vtkTree * tree, vtkTable * inputDataT
 bool voTreeDropTip::getSelectionByDataFiltering(vtkTree *tree, vtkTable * inputDataTable, vtkSelection * sel)
 {
   QStringList tipNameList;
-  QString scratchString = this->stringParameter("input_string");
-  QStringList conditionList;
-  if ( !scratchString.isEmpty())
+  QString expression = this->stringParameter("input_string");
+  if (expression.trimmed().isEmpty())
     {
-    conditionList = scratchString.split(",");
+    qCritical() << QObject::tr("Invalid paramater, could not parse input condition list");
+    return false;
     }
 
+  vtkStringArray * matchingTips = vtkStringArray::SafeDownCast(this->stageOutput("matching_tips"));
+  if (matchingTips)
+    {
+    for (vtkIdType i = 0; i < matchingTips->GetNumberOfValues(); ++i)
+      {
+      tipNameList.append(QString(matchingTips->GetValue(i).c_str()));
+      }
+    return (getTipSelection(tree,inputDataTable,sel,tipNameList));
+    }
 
-  if(conditionList.empty())
+  voDataFilterExpression filter;
+  if (!filter.compile(expression, inputDataTable))
+    {
+    qCritical() << QObject::tr("Error parsing the conditions:") << filter.errorString();
+    return false;
+    }
+  QBitArray matchingRows = filter.evaluate();
+  if (this->abortExecution())
     {
-    qCritical() << QObject::tr("Invalid paramater, could not parse input condition list");
     return false;
     }
 
   vtkStringArray *tableNames = vtkStringArray::SafeDownCast(inputDataTable->GetColumn(0));
-  double epsilon = 1e-5;
-
-  for (vtkIdType row = 0; row < inputDataTable->GetNumberOfRows(); row++)
-    {// for each tip
-    int numberOfConditionSatisfied = 0;
-    for (int i = 0; i < conditionList.size(); i++)
-      { //parse each condition
-      QString condition = conditionList[i];
-      bool conditionSatisfied = false;
-      QRegExp rx("\\b(<|>|=)");
-      int pos = rx.indexIn(condition, 0);
-      if (pos < 0)
-        {
-        qCritical()<<"Invalid condition syntax!";
-        return false;
-        }
-      std::string colName = condition.left(pos).toStdString();
-
-      bool STRING_CONDITION = false;
-      if (condition.count("\"") == 2)
-        {
-        STRING_CONDITION = true;
-        }
-
-      if (STRING_CONDITION)
-        {// string comparison
-        if (condition.at(pos) == QChar('='))
-          {
-          QString v = QString ((inputDataTable->GetValueByName(row,colName.c_str()).ToString()).c_str());
-          QString  refString = condition.section('=',1,1);
-          refString.chop(1);
-          refString = refString.right(refString.size()-1);
-          if ( v == refString )
-            {
-            conditionSatisfied = true;
-            }
-          }
-        else
-          {
-          qCritical()<<"String filtering can only use \"=\"";
-          return false;
-          }
-        }
-      else
-        {// number comparison
-        double v = inputDataTable->GetValueByName(row,colName.c_str()).ToDouble();
-        double threshold;
-        if (condition.at(pos) == QChar('<'))
-          {
-          if (condition.at(pos+1) == QChar('='))
-            { // <=
-            threshold = condition.right(condition.size()-pos).toDouble();
-            if (v <= threshold)
-              {
-              conditionSatisfied = true;
-              }
-            }
-          else
-            {// <
-            threshold = condition.right(condition.size()-pos-1).toDouble();
-            if (v < threshold)
-              {
-              conditionSatisfied = true;
-              }
-            }
-          }
-        else if (condition.at(pos) == QChar('>'))
-          {
-          if(condition.at(pos+1) == QChar('='))
-            {// >=
-            threshold = condition.right(condition.size()-pos-2).toDouble();
-            if (v >= threshold)
-              {
-              conditionSatisfied = true;
-              }
-            }
-          else
-            {//>
-            threshold = condition.right(condition.size()-pos-1).toDouble();
-            if (v > threshold)
-              {
-              conditionSatisfied = true;
-              }
-            }
-          }
-        else if (condition.at(pos) == QChar('='))
-          { //=
-          threshold = condition.right(condition.size()-pos-1).toDouble();
-          if ( fabs(v- threshold) < epsilon)
-            {
-            conditionSatisfied = true;
-            }
-          }
-        else
-          {
-          qCritical()<<"Error parsing the conditions; please check your syntax.";
-          return false;
-          }
-        }// end of numeric condition
-
-      if (!conditionSatisfied)
-        {
-        break;
-        }
-      else
-        {
-        numberOfConditionSatisfied ++;
-        }
-      } //end of "for each condition"
-
-    if (numberOfConditionSatisfied == conditionList.size())
-      { // this tip meets all conditions
-      // qDebug()<<"tip name:"<<QString(tableNames->GetValue(row).c_str());
+  for (int row = 0; tableNames && row < matchingRows.size(); ++row)
+    {
+    if (matchingRows.testBit(row))
+      {
       tipNameList.append(QString(tableNames->GetValue(row).c_str()));
       }
-    } // end of "for each tip"
+    }
   // qDebug()<<"tipNameList"<<tipNameList;
   if (tipNameList.isEmpty())
     {
@@ -494,6 +412,12 @@ bool voTreeDropTip::getSelectionByDataFiltering(vtkTree *tree, vtkTable * inputD
     }
   else
     {
+    vtkNew<vtkStringArray> tipNames;
+    foreach(const QString& tipName, tipNameList)
+      {
+      tipNames->InsertNextValue(tipName.toStdString());
+      }
+    this->setStageOutput("matching_tips", tipNames.GetPointer());
     return (getTipSelection(tree,inputDataTable,sel,tipNameList));
     }
 }
@@ -509,13 +433,13 @@ bool voTreeDropTip::getSelectionByPrunedTree(vtkTree *tree, vtkTable * inputData
     {
     treeViewItem = view->getTreeHeatmapItem();
     prunedTree = treeViewItem->GetDendrogram()->GetPrunedTree();
-    vtkStringArray * prunedNodeNames = vtkStringArray::SafeDownCast(prunedTree->GetVertexData()->GetAbstractArray("node name"));
+    voTreeNameIndex prunedNodeNames(prunedTree);
     vtkStringArray * originalNodeNames = vtkStringArray::SafeDownCast(tree->GetVertexData()->GetAbstractArray("node name"));
     for ( vtkIdType i = 0; i< originalNodeNames->GetNumberOfValues(); ++i)
       {
       if (tree->IsLeaf(i))
         {
-        if (prunedNodeNames->LookupValue(originalNodeNames->GetValue(i)) < 0 )
+        if (!prunedNodeNames.contains(QString(originalNodeNames->GetValue(i).c_str())))
           {
           tipNameList.append(QString(originalNodeNames->GetValue(i).c_str()));
           }
@@ -32,7 +32,6 @@ class vtkTree;
 class vtkTable;
 class vtkSelection;
 class vtkQStringList;
-class vtkIdTypeArray;
 
 class voTreeDropTip : public voAnalysis
 {
@@ -42,6 +41,14 @@ public:
   voTreeDropTip();
   virtual ~voTreeDropTip();
 
+  /// "Tree Collapsing" reads the collapsed tree from the view and has to run
+  /// on the GUI thread. Other selection methods only read the inputs.
+  virtual bool canRunInBackground()const;
+
+  /// The collapsed tree isn't part of the parameters: "Tree Collapsing"
+  /// results are never cached.
+  virtual bool canCacheResults()const;
+
 protected:
   virtual void setOutputInformation();
   virtual void setParameterInformation();
@@ -49,7 +56,6 @@ protected:
 
   virtual int execute();
 
-  bool removeInternalBranch(vtkTree * tree, vtkIdTypeArray * selArray, vtkIdType parentId);
   bool getTipSelection(vtkTree * tree, vtkTable * inputDataTable,vtkSelection * sel, QStringList tipNameList);
   bool getSelectionByTipNames(vtkTree * tree, vtkTable * inputDataTable, vtkSelection * sel);
   bool getSelectionByDataFiltering(vtkTree *tree, vtkTable * inputDataTable, vtkSelection * sel);
@@ -20,6 +20,7 @@
 
 // Qt includes
 #include <QDebug>
+#include <QSet>
 
 // QtPropertyBrowser includes
 #include <QtVariantPropertyManager>
@@ -32,6 +33,7 @@
 #include "voApplication.h"
 #include "voOutputDataObject.h"
 #include "voIOManager.h"
+#include "voTreeNameIndex.h"
 #include "voUtils.h"
 #include "voTreeHeatmapView.h"
 
@@ -50,7 +52,6 @@
 #include <vtkSelectionNode.h>
 #include <vtkDataSetAttributes.h>
 #include <vtkInformation.h>
-#include <vtkAdjacentVertexIterator.h>
 #include <vtkTreeHeatmapItem.h>
 // --------------------------------------------------------------------------
 // voTreeDropTipWithoutDataPrivate methods
@@ -75,6 +76,18 @@ voTreeDropTipWithoutData::~voTreeDropTipWithoutData()
 }
 
 
+// --------------------------------------------------------------------------
+bool voTreeDropTipWithoutData::canRunInBackground()const
+{
+  return this->enumParameter("selection_method") != "Tree Collapsing";
+}
+
+// --------------------------------------------------------------------------
+bool voTreeDropTipWithoutData::canCacheResults()const
+{
+  return this->enumParameter("selection_method") != "Tree Collapsing";
+}
+
 // --------------------------------------------------------------------------
 void voTreeDropTipWithoutData::setOutputInformation()
 {
@@ -125,8 +138,9 @@ int voTreeDropTipWithoutData::execute()
     }
 
 
-  vtkNew<vtkTree> tree;
-  tree->DeepCopy(inputTree);
+  // Only read: the arrays of the input are shared
+  vtkSmartPointer<vtkTree> tree =
+    vtkTree::SafeDownCast(this->input(0)->sharedDataCopy());
   // obtain selected tips into a vtkSelection object
   QString selection_method = this->enumParameter("selection_method");
 
@@ -141,6 +155,11 @@ int voTreeDropTipWithoutData::execute()
     SUCCESS = this->getSelectionByPrunedTree(tree.GetPointer(),selectedTips.GetPointer());
     }
 
+  if (this->abortExecution())
+    {
+    return voAnalysis::FAILURE;
+    }
+
   if (SUCCESS)
     {
  //   clock_t t;
@@ -150,6 +169,10 @@ int voTreeDropTipWithoutData::execute()
     extractSelectedTreeFilter->SetInputData(0, tree.GetPointer());
     extractSelectedTreeFilter->SetInputData(1, selectedTips.GetPointer());
     extractSelectedTreeFilter->Update();
+    if (this->abortExecution())
+      {
+      return voAnalysis::FAILURE;
+      }
 
     vtkTree * outTree = vtkTree::SafeDownCast(extractSelectedTreeFilter->GetOutput());
  //   t = clock()-t;
@@ -176,43 +199,6 @@ int voTreeDropTipWithoutData::execute()
     }
 }
 
-// --------------------------------------------------------------------------
-bool voTreeDropTipWithoutData::removeInternalBranch(vtkTree * tree, vtkIdTypeArray * selArray, vtkIdType currentId)
-{// remove the internal branch of the selected tips
- //  by adding internal verticies/nodes to the selection
-  if (tree->IsLeaf(currentId))
-    {//do nothing
-    return true;
-    }
-
-  vtkSmartPointer <vtkAdjacentVertexIterator> it  =
-            vtkSmartPointer<vtkAdjacentVertexIterator>::New();
-  tree->GetChildren(currentId,it);
-  int numberOfSelectedChildren = 0;
-  while (it->HasNext())
-   {
-   vtkIdType childId = it->Next();
-   this->removeInternalBranch(tree, selArray,childId);
-   //count the number of selected children
-   for ( vtkIdType i = 0; i < selArray->GetNumberOfTuples(); i++)
-     {
-     if (selArray->GetValue(i) == childId)
-       {
-       numberOfSelectedChildren++;
-       break;
-       }
-     }
-   }
-
-   if (numberOfSelectedChildren == tree->GetNumberOfChildren(currentId))
-     {// add the current internal node to the selection list as well
-     selArray->InsertNextValue(currentId);
-     }
-
-  return true;
-}
-
-
 // --------------------------------------------------------------------------
 bool voTreeDropTipWithoutData::getTipSelection(vtkTree * tree, vtkSelection * sel, QStringList tipNameList)
 {
@@ -225,12 +211,13 @@ bool voTreeDropTipWithoutData::getTipSelection(vtkTree * tree, vtkSelection * se
     }
   else
     {// input list is the keep list
+    QSet<QString> keptTipNames = tipNameList.toSet();
     for ( vtkIdType i = 0; i< nodeNames->GetNumberOfValues() ; i++)
       {
       if (tree->IsLeaf(i))
         {
         QString curTip = QString(nodeNames->GetValue(i).c_str());
-        if  ( !curTip.isEmpty() && !tipNameList.contains(curTip))
+        if  ( !curTip.isEmpty() && !keptTipNames.contains(curTip))
           {
           removalTipNameList.append(curTip);
           }
@@ -240,10 +227,16 @@ bool voTreeDropTipWithoutData::getTipSelection(vtkTree * tree, vtkSelection * se
 
   vtkSmartPointer<vtkSelectionNode> selNode = vtkSmartPointer <vtkSelectionNode>::New() ;
   vtkSmartPointer<vtkIdTypeArray> selArr = vtkSmartPointer<vtkIdTypeArray>::New();
+  // 'tree' is a copy of the input tree: vertex ids are the same
+  voTreeNameIndex nameIndex = this->input(0)->treeNameIndex();
   // extract subtree using vtkExtractSelectedTree class
   for (int i =0; i < removalTipNameList.size(); i++)
     {
-    vtkIdType vertexId = nodeNames->LookupValue(removalTipNameList[i].toStdString().c_str());
+    if (this->abortExecution())
+      {
+      return false;
+      }
+    vtkIdType vertexId = nameIndex.vertex(removalTipNameList[i]);
     if (vertexId >= 0)
       {
       selArr->InsertNextValue(vertexId);
@@ -254,8 +247,8 @@ bool voTreeDropTipWithoutData::getTipSelection(vtkTree * tree, vtkSelection * se
       }
     }
 
-  //remove vertices whoes children are in the selection list recursively
-  this->removeInternalBranch(tree,selArr,tree->GetRoot());
+  //remove vertices whoes children are all in the selection list
+  voUtils::selectEmptyBranches(tree, selArr.GetPointer());
 
   selNode->SetContentType(vtkSelectionNode::INDICES);
   selNode->SetFieldType(vtkSelectionNode::VERTEX);
@@ -300,13 +293,13 @@ bool voTreeDropTipWithoutData::getSelectionByPrunedTree(vtkTree *tree, vtkSelect
     {
     treeViewItem = view->getTreeHeatmapItem();
     prunedTree = treeViewItem->GetDendrogram()->GetPrunedTree();
-    vtkStringArray * prunedNodeNames = vtkStringArray::SafeDownCast(prunedTree->GetVertexData()->GetAbstractArray("node name"));
+    voTreeNameIndex prunedNodeNames(prunedTree);
     vtkStringArray * originalNodeNames = vtkStringArray::SafeDownCast(tree->GetVertexData()->GetAbstractArray("node name"));
     for ( vtkIdType i = 0; i< originalNodeNames->GetNumberOfValues(); ++i)
       {
       if (tree->IsLeaf(i))
         {
-        if (prunedNodeNames->LookupValue(originalNodeNames->GetValue(i)) < 0 )
+        if (!prunedNodeNames.contains(QString(originalNodeNames->GetValue(i).c_str())))
           {
           tipNameList.append(QString(originalNodeNames->GetValue(i).c_str()));
           }
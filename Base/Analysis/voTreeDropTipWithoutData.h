@@ -31,7 +31,6 @@ class voTreeDropTipWithoutDataPrivate;
 class vtkTree;
 class vtkSelection;
 class vtkQStringList;
-class vtkIdTypeArray;
 
 class voTreeDropTipWithoutData : public voAnalysis
 {
@@ -41,6 +40,14 @@ public:
   voTreeDropTipWithoutData();
   virtual ~voTreeDropTipWithoutData();
 
+  /// "Tree Collapsing" reads the collapsed tree from the view and has to run
+  /// on the GUI thread. Other selection methods only read the inputs.
+  virtual bool canRunInBackground()const;
+
+  /// The collapsed tree isn't part of the parameters: "Tree Collapsing"
+  /// results are never cached.
+  virtual bool canCacheResults()const;
+
 protected:
   virtual void setOutputInformation();
   virtual void setParameterInformation();
@@ -48,7 +55,6 @@ protected:
 
   virtual int execute();
 
-  bool removeInternalBranch(vtkTree * tree, vtkIdTypeArray * selArray, vtkIdType parentId);
   bool getTipSelection(vtkTree * tree, vtkSelection * sel, QStringList tipNameList);
   bool getSelectionByTipNames(vtkTree * tree, vtkSelection * sel);
   bool getSelectionByPrunedTree(vtkTree *tree, vtkSelection * sel);
@@ -0,0 +1,618 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+// Qt includes
+#include <QDebug>
+#include <QList>
+#include <QStringList>
+#include <QtConcurrentMap>
+
+// QtPropertyBrowser includes
+#include <QtVariantPropertyManager>
+
+// Visomics includes
+#include "voDataObject.h"
+#include "voOutputDataObject.h"
+#include "voTreeModelFitting.h"
+#include "voTreeNameIndex.h"
+
+// VTK includes
+#include <vtkDataSetAttributes.h>
+#include <vtkDoubleArray.h>
+#include <vtkExtendedTable.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkStringArray.h>
+#include <vtkTable.h>
+#include <vtkTree.h>
+
+// STD includes
+#include <cmath>
+
+namespace // helpers for voTreeModelFitting::fitModel(vtkTree*, const QVector<double>&, const QString&)
+{
+
+//----------------------------------------------------------------------------
+// Topology and branching times of a tree, shared by all the fits.
+struct PhylogeneticTree
+{
+  PhylogeneticTree(vtkTree * tree);
+
+  vtkIdType Root;
+  /// Descendants come before their ancestors
+  QVector<vtkIdType> PostOrder;
+  QVector<vtkIdType> Parents;
+  /// Distance to the root
+  QVector<double> Times;
+  QVector<bool> Leaves;
+  /// Maximum distance from the root to a leaf
+  double Height;
+};
+
+//----------------------------------------------------------------------------
+PhylogeneticTree::PhylogeneticTree(vtkTree * tree) : Root(-1), Height(0.)
+{
+  int numberOfVertices = tree ? static_cast<int>(tree->GetNumberOfVertices()) : 0;
+  if (numberOfVertices == 0)
+    {
+    return;
+    }
+  this->Root = tree->GetRoot();
+  this->Parents.fill(-1, numberOfVertices);
+  this->Times.fill(0., numberOfVertices);
+  this->Leaves.fill(false, numberOfVertices);
+  vtkDataArray * weights = tree->GetEdgeData()->GetArray("weight");
+
+  // Pre-order without recursion: deep trees would overflow the stack
+  QVector<vtkIdType> preOrder;
+  preOrder.reserve(numberOfVertices);
+  QVector<vtkIdType> stack;
+  stack << this->Root;
+  while (!stack.isEmpty())
+    {
+    vtkIdType vertex = stack.last();
+    stack.pop_back();
+    preOrder << vertex;
+    this->Leaves[vertex] = tree->IsLeaf(vertex);
+    if (vertex != this->Root)
+      {
+      vtkIdType parent = tree->GetParent(vertex);
+      this->Parents[vertex] = parent;
+      this->Times[vertex] = this->Times.at(parent) +
+        (weights ? weights->GetTuple1(tree->GetInEdge(vertex, 0).Id) : 1.);
+      }
+    if (this->Leaves.at(vertex))
+      {
+      this->Height = qMax(this->Height, this->Times.at(vertex));
+      }
+    for (vtkIdType child = 0; child < tree->GetNumberOfChildren(vertex); ++child)
+      {
+      stack << tree->GetChild(vertex, child);
+      }
+    }
+  this->PostOrder.reserve(numberOfVertices);
+  for (int i = preOrder.size() - 1; i >= 0; --i)
+    {
+    this->PostOrder << preOrder.at(i);
+    }
+}
+
+//----------------------------------------------------------------------------
+// Length of the branch above each vertex once the tree is rescaled for
+// \a model, as geiger's rescale() does.
+QVector<double> branchLengths(const PhylogeneticTree& tree, const QString& model, double parameter)
+{
+  QVector<double> lengths(tree.Times.size(), 0.);
+  for (int vertex = 0; vertex < lengths.size(); ++vertex)
+    {
+    vtkIdType parent = tree.Parents.at(vertex);
+    if (parent < 0)
+      {
+      continue;
+      }
+    double start = tree.Times.at(parent);
+    double end = tree.Times.at(vertex);
+    if (model == "OU" && parameter > 0.)
+      {
+      // Covariance of the OU process with the root at the optimum
+      double alpha = parameter;
+      double startVariance = 2. * alpha * start > 1e-12 ?
+        (1. - exp(-2. * alpha * start)) / (2. * alpha) : start;
+      double endVariance = 2. * alpha * end > 1e-12 ?
+        (1. - exp(-2. * alpha * end)) / (2. * alpha) : end;
+      lengths[vertex] = exp(-2. * alpha * (tree.Height - end)) * endVariance
+        - exp(-2. * alpha * (tree.Height - start)) * startVariance;
+      }
+    else if (model == "EB" && parameter != 0.)
+      {
+      // The rate decays exponentially with time
+      lengths[vertex] = (exp(parameter * end) - exp(parameter * start)) / parameter;
+      }
+    else
+      {
+      lengths[vertex] = end - start;
+      }
+    }
+  return lengths;
+}
+
+//----------------------------------------------------------------------------
+// Felsenstein's pruning: each subtree is reduced to the estimate of the
+// value of its root and its variance. The contrasts between sibling
+// estimates are independent.
+double pruneLikelihood(const PhylogeneticTree& tree, const QVector<double>& lengths,
+                       const QVector<double>& values, double * z0, double * sigsq,
+                       int * numberOfTips)
+{
+  int numberOfVertices = tree.Times.size();
+  QVector<double> means(numberOfVertices, 0.);
+  QVector<double> variances(numberOfVertices, 0.);
+  // Variance accumulated on the branches above the last contrast: the root
+  // of a tree without data on one side is the most recent common ancestor
+  QVector<double> stemVariances(numberOfVertices, 0.);
+  QVector<bool> hasData(numberOfVertices, false);
+
+  double squaredContrasts = 0.;
+  double logVariances = 0.;
+  int n = 0;
+  foreach(vtkIdType vertex, tree.PostOrder)
+    {
+    if (tree.Leaves.at(vertex) && vertex < values.size()
+        && !vtkMath::IsNan(values.at(vertex)))
+      {
+      means[vertex] = values.at(vertex);
+      hasData[vertex] = true;
+      ++n;
+      }
+    vtkIdType parent = tree.Parents.at(vertex);
+    if (parent < 0 || !hasData.at(vertex))
+      {
+      continue;
+      }
+    double mean = means.at(vertex);
+    double variance = variances.at(vertex) + lengths.at(vertex);
+    if (!hasData.at(parent))
+      {
+      means[parent] = mean;
+      variances[parent] = variance;
+      stemVariances[parent] = stemVariances.at(vertex) + lengths.at(vertex);
+      hasData[parent] = true;
+      continue;
+      }
+    double sum = variances.at(parent) + variance;
+    if (sum <= 0.)
+      {
+      return vtkMath::NegInf();
+      }
+    double contrast = means.at(parent) - mean;
+    squaredContrasts += contrast * contrast / sum;
+    logVariances += log(sum);
+    means[parent] = (means.at(parent) * variance + mean * variances.at(parent)) / sum;
+    variances[parent] = variances.at(parent) * variance / sum;
+    stemVariances[parent] = 0.;
+    }
+  if (numberOfTips)
+    {
+    *numberOfTips = n;
+    }
+  if (n < 2)
+    {
+    return vtkMath::NegInf();
+    }
+
+  // The root state is estimated: its contrast with the estimate is null
+  double rootVariance = variances.at(tree.Root) - stemVariances.at(tree.Root);
+  double rate = squaredContrasts / n;
+  if (rootVariance <= 0. || rate <= 0.)
+    {
+    return vtkMath::NegInf();
+    }
+  logVariances += log(rootVariance);
+  if (z0)
+    {
+    *z0 = means.at(tree.Root);
+    }
+  if (sigsq)
+    {
+    *sigsq = rate;
+    }
+  return -0.5 * (n * log(2. * vtkMath::Pi() * rate) + logVariances + n);
+}
+
+//----------------------------------------------------------------------------
+// Likelihood maximized over the root state and the rate, as a function of
+// the parameter of the model. The OU parameter is searched on a log scale.
+struct ProfileLikelihood
+{
+  const PhylogeneticTree * Tree;
+  const QVector<double> * Values;
+  QString Model;
+
+  double parameter(double x)const
+    {
+    return this->Model == "OU" ? exp(x) : x;
+    }
+  double operator()(double x)const
+    {
+    return pruneLikelihood(*this->Tree,
+                           branchLengths(*this->Tree, this->Model, this->parameter(x)),
+                           *this->Values, 0, 0, 0);
+    }
+};
+
+//----------------------------------------------------------------------------
+voTreeModelFitting::Fit fitTraitModel(const PhylogeneticTree& tree, const QVector<double>& values,
+                                      const QString& model)
+{
+  voTreeModelFitting::Fit result = {vtkMath::Nan(), vtkMath::Nan(), 0.,
+                                    vtkMath::Nan(), 0};
+  double parameter = 0.;
+  if ((model == "OU" || model == "EB") && tree.Height > 0.)
+    {
+    ProfileLikelihood likelihood;
+    likelihood.Tree = &tree;
+    likelihood.Values = &values;
+    likelihood.Model = model;
+
+    // Bounds of fitContinuous
+    double lower = model == "OU" ? log(1e-6 / tree.Height) : log(1e-5) / tree.Height;
+    double upper = model == "OU" ? 1. : -1e-6;
+    if (lower >= upper)
+      {
+      lower = upper - 1.;
+      }
+
+    // The likelihood may have several maxima: bracket the best one on a
+    // grid, then refine it by golden section search.
+    const int numberOfSteps = 20;
+    double step = (upper - lower) / numberOfSteps;
+    int best = 0;
+    double bestLikelihood = vtkMath::NegInf();
+    for (int i = 0; i <= numberOfSteps; ++i)
+      {
+      double value = likelihood(lower + i * step);
+      if (value > bestLikelihood)
+        {
+        bestLikelihood = value;
+        best = i;
+        }
+      }
+    double a = lower + qMax(best - 1, 0) * step;
+    double b = lower + qMin(best + 1, numberOfSteps) * step;
+    const double ratio = 0.5 * (sqrt(5.) - 1.);
+    double c = b - ratio * (b - a);
+    double d = a + ratio * (b - a);
+    double likelihoodC = likelihood(c);
+    double likelihoodD = likelihood(d);
+    for (int iteration = 0; iteration < 60 && b - a > 1e-10 * (fabs(a) + fabs(b)); ++iteration)
+      {
+      if (likelihoodC > likelihoodD)
+        {
+        b = d;
+        d = c;
+        likelihoodD = likelihoodC;
+        c = b - ratio * (b - a);
+        likelihoodC = likelihood(c);
+        }
+      else
+        {
+        a = c;
+        c = d;
+        likelihoodC = likelihoodD;
+        d = a + ratio * (b - a);
+        likelihoodD = likelihood(d);
+        }
+      }
+    double x = likelihoodC > likelihoodD ? c : d;
+    if (qMax(likelihoodC, likelihoodD) < bestLikelihood)
+      {
+      x = lower + best * step;
+      }
+    parameter = likelihood.parameter(x);
+    }
+
+  double z0 = 0.;
+  double sigsq = 0.;
+  double logLikelihood = pruneLikelihood(tree, branchLengths(tree, model, parameter),
+                                         values, &z0, &sigsq, &result.NumberOfTips);
+  if (vtkMath::IsInf(logLikelihood))
+    {
+    return result;
+    }
+  result.Z0 = z0;
+  result.Sigsq = sigsq;
+  result.Parameter = parameter;
+  result.LogLikelihood = logLikelihood;
+  return result;
+}
+
+//----------------------------------------------------------------------------
+struct FitTask
+{
+  const PhylogeneticTree * Tree;
+  QString Model;
+  QString TraitName;
+  QVector<double> Values;
+  voTreeModelFitting::Fit Fit;
+};
+
+//----------------------------------------------------------------------------
+void runFitTask(FitTask& task)
+{
+  task.Fit = fitTraitModel(*task.Tree, task.Values, task.Model);
+}
+
+} // end of anonymous namespace
+
+// --------------------------------------------------------------------------
+class voTreeModelFittingPrivate
+{
+};
+
+// --------------------------------------------------------------------------
+// voTreeModelFitting methods
+
+// --------------------------------------------------------------------------
+voTreeModelFitting::voTreeModelFitting():
+  Superclass(), d_ptr(new voTreeModelFittingPrivate)
+{
+}
+
+// --------------------------------------------------------------------------
+voTreeModelFitting::~voTreeModelFitting()
+{
+}
+
+// --------------------------------------------------------------------------
+bool voTreeModelFitting::canRunInBackground()const
+{
+  return true;
+}
+
+// --------------------------------------------------------------------------
+void voTreeModelFitting::setOutputInformation()
+{
+  this->addOutputType("resultTable", "vtkTable",
+                      "", "",
+                      "voTableView", "fitted modeling parameters");
+  this->addOutputType("resultTree", "vtkTree",
+                      "", "",
+                      "voTreeHeatmapView", "fitted tree");
+}
+
+// --------------------------------------------------------------------------
+void voTreeModelFitting::setParameterInformation()
+{
+  QList<QtProperty*> fitting_parameters;
+
+  fitting_parameters << this->addEnumParameter("model_type", tr("Model Type"),
+                                               (QStringList() << "OU" << "BM" << "EB"), "OU");
+  fitting_parameters << this->addStringParameter("trait_columns", tr("Data Columns"), "");
+
+  this->addParameterGroup("Model Fitting parameters", fitting_parameters);
+}
+
+// --------------------------------------------------------------------------
+QString voTreeModelFitting::parameterDescription()const
+{
+  return QString("<dl>"
+    "<dt><b>Model Type</b>:</dt>"
+    "<dd>OU (Ornstein-Uhlenbeck), BM (Brownian Motion) or EB (Early Burst).</dd>"
+    "<dt><b>Data Columns</b>:</dt>"
+    "<dd>Comma separated names of the table columns to fit, e.g. \"mass, length\"."
+    " All the numeric columns are fit if empty. The first column of the table"
+    " holds the tip names.</dd>"
+    "</dl>");
+}
+
+// --------------------------------------------------------------------------
+int voTreeModelFitting::execute()
+{
+  vtkTree * tree = this->input(0) ?
+    vtkTree::SafeDownCast(this->input(0)->dataAsVTKDataObject()) : 0;
+  if (!tree)
+    {
+    qCritical() << "Input tree is Null";
+    return voAnalysis::FAILURE;
+    }
+  vtkExtendedTable * extendedTable = this->input(1) ?
+    vtkExtendedTable::SafeDownCast(this->input(1)->dataAsVTKDataObject()) : 0;
+  vtkTable * table = extendedTable ? extendedTable->GetInputData() : 0;
+  if (!table || table->GetNumberOfColumns() < 2)
+    {
+    qCritical() << "Input Table is Null";
+    return voAnalysis::FAILURE;
+    }
+
+  QString model = this->enumParameter("model_type");
+  QList<vtkAbstractArray*> traitColumns;
+  QString traitColumnNames = this->stringParameter("trait_columns").trimmed();
+  if (traitColumnNames.isEmpty())
+    {
+    for (vtkIdType column = 1; column < table->GetNumberOfColumns(); ++column)
+      {
+      if (vtkDataArray::SafeDownCast(table->GetColumn(column)))
+        {
+        traitColumns << table->GetColumn(column);
+        }
+      }
+    }
+  else
+    {
+    foreach(const QString& name, traitColumnNames.split(","))
+      {
+      vtkAbstractArray * column = table->GetColumnByName(name.trimmed().toLatin1().constData());
+      if (!column)
+        {
+        qWarning() << QObject::tr("Could not find the column:") << name.trimmed();
+        continue;
+        }
+      traitColumns << column;
+      }
+    }
+  if (traitColumns.isEmpty())
+    {
+    qCritical() << QObject::tr("No column to fit");
+    return voAnalysis::FAILURE;
+    }
+
+  // Rows are matched to the leaves by name
+  voTreeNameIndex nameIndex = this->input(0)->treeNameIndex();
+  vtkAbstractArray * tipNames = table->GetColumn(0);
+  QVector<vtkIdType> rowVertices(static_cast<int>(table->GetNumberOfRows()), -1);
+  for (vtkIdType row = 0; row < table->GetNumberOfRows(); ++row)
+    {
+    vtkIdType vertex = nameIndex.vertex(
+      QString(tipNames->GetVariantValue(row).ToString().c_str()));
+    if (vertex >= 0 && tree->IsLeaf(vertex))
+      {
+      rowVertices[static_cast<int>(row)] = vertex;
+      }
+    }
+
+  PhylogeneticTree phylogeneticTree(tree);
+  int numberOfVertices = static_cast<int>(tree->GetNumberOfVertices());
+  QList<FitTask> tasks;
+  foreach(vtkAbstractArray * column, traitColumns)
+    {
+    FitTask task;
+    task.Tree = &phylogeneticTree;
+    task.Model = model;
+    task.TraitName = QString(column->GetName());
+    task.Values.fill(vtkMath::Nan(), numberOfVertices);
+    for (int row = 0; row < rowVertices.size(); ++row)
+      {
+      bool valid = false;
+      double value = column->GetVariantValue(row).ToDouble(&valid);
+      if (valid && rowVertices.at(row) >= 0)
+        {
+        task.Values[rowVertices.at(row)] = value;
+        }
+      }
+    tasks << task;
+    }
+
+  // Each column is fit independently
+  QtConcurrent::blockingMap(tasks, runFitTask);
+  if (this->abortExecution())
+    {
+    return voAnalysis::FAILURE;
+    }
+
+  vtkNew<vtkStringArray> traitNames;
+  traitNames->SetName("trait");
+  vtkNew<vtkDoubleArray> z0s;
+  z0s->SetName("z0");
+  vtkNew<vtkDoubleArray> sigsqs;
+  sigsqs->SetName("sigsq");
+  vtkNew<vtkDoubleArray> parameters;
+  parameters->SetName(model == "OU" ? "alpha" : "a");
+  vtkNew<vtkDoubleArray> logLikelihoods;
+  logLikelihoods->SetName("lnL");
+  vtkNew<vtkDoubleArray> aics;
+  aics->SetName("AIC");
+  vtkNew<vtkDoubleArray> aiccs;
+  aiccs->SetName("AICc");
+  int numberOfParameters = model == "BM" ? 2 : 3;
+  foreach(const FitTask& task, tasks)
+    {
+    const Fit& fit = task.Fit;
+    if (vtkMath::IsNan(fit.LogLikelihood))
+      {
+      qWarning() << QObject::tr("Could not fit the column:") << task.TraitName;
+      }
+    double aic = 2. * numberOfParameters - 2. * fit.LogLikelihood;
+    int freedom = fit.NumberOfTips - numberOfParameters - 1;
+    traitNames->InsertNextValue(task.TraitName.toStdString());
+    z0s->InsertNextValue(fit.Z0);
+    sigsqs->InsertNextValue(fit.Sigsq);
+    parameters->InsertNextValue(fit.Parameter);
+    logLikelihoods->InsertNextValue(fit.LogLikelihood);
+    aics->InsertNextValue(aic);
+    aiccs->InsertNextValue(freedom > 0 ?
+      aic + 2. * numberOfParameters * (numberOfParameters + 1) / freedom : vtkMath::Nan());
+    }
+  vtkNew<vtkTable> resultTable;
+  resultTable->AddColumn(traitNames.GetPointer());
+  resultTable->AddColumn(z0s.GetPointer());
+  resultTable->AddColumn(sigsqs.GetPointer());
+  if (model != "BM")
+    {
+    resultTable->AddColumn(parameters.GetPointer());
+    }
+  resultTable->AddColumn(logLikelihoods.GetPointer());
+  resultTable->AddColumn(aics.GetPointer());
+  resultTable->AddColumn(aiccs.GetPointer());
+  this->setOutput("resultTable", new voOutputDataObject("resultTable", resultTable.GetPointer()));
+
+  // The tree is rescaled with the parameter fit to the first column
+  vtkSmartPointer<vtkTree> resultTree =
+    vtkTree::SafeDownCast(this->input(0)->sharedDataCopy());
+  if (model != "BM" && !vtkMath::IsNan(tasks.first().Fit.LogLikelihood))
+    {
+    QVector<double> lengths =
+      branchLengths(phylogeneticTree, model, tasks.first().Fit.Parameter);
+    vtkNew<vtkDoubleArray> weights;
+    weights->SetName("weight");
+    weights->SetNumberOfValues(resultTree->GetNumberOfEdges());
+    vtkNew<vtkDoubleArray> nodeWeights;
+    nodeWeights->SetName("node weight");
+    nodeWeights->SetNumberOfValues(numberOfVertices);
+    nodeWeights->SetValue(phylogeneticTree.Root, 0.);
+    // Parents come before their descendants
+    for (int i = phylogeneticTree.PostOrder.size() - 1; i >= 0; --i)
+      {
+      vtkIdType vertex = phylogeneticTree.PostOrder.at(i);
+      vtkIdType parent = phylogeneticTree.Parents.at(vertex);
+      if (parent >= 0)
+        {
+        weights->SetValue(resultTree->GetInEdge(vertex, 0).Id, lengths.at(vertex));
+        nodeWeights->SetValue(vertex, nodeWeights->GetValue(parent) + lengths.at(vertex));
+        }
+      }
+    resultTree->GetEdgeData()->AddArray(weights.GetPointer());
+    resultTree->GetVertexData()->AddArray(nodeWeights.GetPointer());
+    }
+  this->setOutput("resultTree", new voOutputDataObject("resultTree", resultTree));
+
+  return voAnalysis::SUCCESS;
+}
+
+// --------------------------------------------------------------------------
+voTreeModelFitting::Fit voTreeModelFitting::fitModel(
+  vtkTree * tree, const QVector<double>& values, const QString& model)
+{
+  return fitTraitModel(PhylogeneticTree(tree), values, model);
+}
+
+// --------------------------------------------------------------------------
+double voTreeModelFitting::logLikelihood(vtkTree * tree, const QVector<double>& values,
+                                         const QString& model, double parameter,
+                                         double * z0, double * sigsq)
+{
+  PhylogeneticTree phylogeneticTree(tree);
+  if (phylogeneticTree.Root < 0)
+    {
+    return vtkMath::NegInf();
+    }
+  return pruneLikelihood(phylogeneticTree, branchLengths(phylogeneticTree, model, parameter),
+                         values, z0, sigsq, 0);
+}
@@ -0,0 +1,92 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+#ifndef __voTreeModelFitting_h
+#define __voTreeModelFitting_h
+
+// Qt includes
+#include <QScopedPointer>
+#include <QVector>
+
+// Visomics includes
+#include "voAnalysis.h"
+
+class voTreeModelFittingPrivate;
+class vtkTree;
+
+/// Fit models of continuous trait evolution to the columns of a table.
+///
+/// The first column of the table holds the tip names. Brownian motion
+/// ("BM"), Ornstein-Uhlenbeck ("OU") and early burst ("EB") models are fit
+/// by maximum likelihood, as fitContinuous does in the geiger R package.
+/// Likelihoods are computed with Felsenstein's pruning algorithm, in linear
+/// time; the root state and the rate are estimated analytically. The
+/// columns are fit concurrently.
+class voTreeModelFitting : public voAnalysis
+{
+  Q_OBJECT
+public:
+  typedef voAnalysis Superclass;
+  voTreeModelFitting();
+  virtual ~voTreeModelFitting();
+
+  /// Only reads the inputs.
+  virtual bool canRunInBackground()const;
+
+  struct Fit
+  {
+    /// Root state
+    double Z0;
+    /// Rate of the Brownian motion
+    double Sigsq;
+    /// "alpha" of the OU model, "a" of the EB model, 0 for BM
+    double Parameter;
+    double LogLikelihood;
+    /// Number of tips with a value
+    int NumberOfTips;
+  };
+
+  /// Fit \a model ("BM", "OU" or "EB") to \a values, indexed by the vertex
+  /// ids of \a tree. Leaves without value (NaN) are ignored. Values are NaN
+  /// if the model can't be fit.
+  static Fit fitModel(vtkTree * tree, const QVector<double>& values, const QString& model);
+
+  /// Log-likelihood of \a values for \a model with the parameter
+  /// \a parameter, and the maximum likelihood root state and rate.
+  static double logLikelihood(vtkTree * tree, const QVector<double>& values,
+                              const QString& model, double parameter,
+                              double * z0 = 0, double * sigsq = 0);
+
+protected:
+  virtual void setOutputInformation();
+  virtual void setParameterInformation();
+  virtual QString parameterDescription()const;
+
+  virtual int execute();
+
+protected:
+  QScopedPointer<voTreeModelFittingPrivate> d_ptr;
+
+private:
+  Q_DECLARE_PRIVATE(voTreeModelFitting);
+  Q_DISABLE_COPY(voTreeModelFitting);
+};
+
+#endif
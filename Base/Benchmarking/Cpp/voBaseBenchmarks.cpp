@@ -0,0 +1,765 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+// Qt includes
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QRegExp>
+#include <QStringList>
+#include <QThread>
+#include <QVariant>
+
+// Visomics includes
+#include "voDataObject.h"
+#include "voDelimitedTextImportSettings.h"
+#include "voIOManager.h"
+#include "voNormalization.h"
+#include "voPhyloTreeReader.h"
+#include "voTreeDropTip.h"
+#include "voUtils.h"
+#include "vtkExtendedTable.h"
+
+// VTK includes
+#include <vtkArray.h>
+#include <vtkDataSetAttributes.h>
+#include <vtkDoubleArray.h>
+#include <vtkMutableDirectedGraph.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkStringArray.h>
+#include <vtkTable.h>
+#include <vtkTimerLog.h>
+#include <vtkTree.h>
+
+// JsonCpp includes
+#include <json/json.h>
+
+// STD includes
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+/// Performance suite of the Base hot paths.
+///
+/// Every benchmark runs on synthetic datasets generated from a fixed seed, so
+/// that results are comparable across commits. Results are written as JSON
+/// in the format of Google Benchmark ("context" and "benchmarks" entries) and
+/// can be compared with its tools/compare.py script.
+namespace
+{
+
+// --------------------------------------------------------------------------
+struct BenchmarkSettings
+{
+  BenchmarkSettings()
+    : Rows(1000), Columns(100), Tips(1024), Repetitions(1),
+      MinimumTime(0.5), MaximumIterations(1000000), Seed(42)
+    {
+    }
+  int Rows;
+  int Columns;
+  int Tips;
+  int Repetitions;
+  double MinimumTime; // In seconds
+  int MaximumIterations;
+  unsigned int Seed;
+};
+
+// --------------------------------------------------------------------------
+/// Linear congruential generator: unlike rand(), the sequence doesn't depend
+/// on the platform.
+class RandomGenerator
+{
+public:
+  RandomGenerator(unsigned int seed) : State(seed) {}
+  double uniform()
+    {
+    this->State = this->State * 1664525u + 1013904223u;
+    return static_cast<double>(this->State) / 4294967296.0;
+    }
+private:
+  unsigned int State;
+};
+
+// --------------------------------------------------------------------------
+/// Time the body of the loop:
+///   while (state.keepRunning()) { ... }
+/// The loop runs at least until minimumTime seconds are spent in the timed
+/// sections, unless maximumIterations is reached first.
+class BenchmarkState
+{
+public:
+  BenchmarkState(double minimumTime, int maximumIterations)
+    : MinimumTime(minimumTime), MaximumIterations(maximumIterations),
+      Iterations(-1), RealTime(0), CpuTime(0), RealStart(0), CpuStart(0),
+      Running(false), Error(false)
+    {
+    }
+
+  bool keepRunning()
+    {
+    if (this->Iterations < 0)
+      {
+      this->Iterations = 0;
+      this->resumeTiming();
+      return true;
+      }
+    ++this->Iterations;
+    if (this->Error || this->RealTime + this->elapsedRealTime() >= this->MinimumTime
+        || this->Iterations >= this->MaximumIterations)
+      {
+      this->pauseTiming();
+      return false;
+      }
+    return true;
+    }
+
+  void pauseTiming()
+    {
+    if (!this->Running)
+      {
+      return;
+      }
+    this->RealTime += this->elapsedRealTime();
+    this->CpuTime += static_cast<double>(std::clock() - this->CpuStart) / CLOCKS_PER_SEC;
+    this->Running = false;
+    }
+
+  void resumeTiming()
+    {
+    this->Running = true;
+    this->RealStart = vtkTimerLog::GetUniversalTime();
+    this->CpuStart = std::clock();
+    }
+
+  /// Stop the benchmark, the results are reported as an error.
+  void skipWithError(const QString& message)
+    {
+    this->Error = true;
+    this->ErrorMessage = message;
+    }
+
+  int iterations()const { return qMax(this->Iterations, 0); }
+  double realTime()const { return this->RealTime; }
+  double cpuTime()const { return this->CpuTime; }
+  bool error()const { return this->Error; }
+  QString errorMessage()const { return this->ErrorMessage; }
+
+private:
+  double elapsedRealTime()const
+    {
+    return this->Running ? vtkTimerLog::GetUniversalTime() - this->RealStart : 0.;
+    }
+
+  double MinimumTime;
+  int MaximumIterations;
+  int Iterations;
+  double RealTime;
+  double CpuTime;
+  double RealStart;
+  std::clock_t CpuStart;
+  bool Running;
+  bool Error;
+  QString ErrorMessage;
+};
+
+// --------------------------------------------------------------------------
+/// Synthetic inputs shared by the benchmarks.
+struct Dataset
+{
+  /// Table with a first column of row names and Columns double columns.
+  vtkSmartPointer<vtkTable> Table;
+  /// Same table, as read from CSVFileName.
+  vtkSmartPointer<vtkTable> RawTable;
+  QString CSVFileName;
+  /// Balanced binary tree with Tips leaves, and the data of the tips.
+  vtkSmartPointer<vtkTree> Tree;
+  vtkSmartPointer<vtkExtendedTable> TipTable;
+  /// Forest of ForestSize trees shaped like Tree, in the Newick format.
+  QString NewickFileName;
+};
+
+const int ForestSize = 16;
+
+// --------------------------------------------------------------------------
+vtkIdType addSubtree(vtkMutableDirectedGraph* graph, vtkIdType parent,
+                     int firstTip, int tipCount,
+                     vtkStringArray* names)
+{
+  vtkIdType vertex = parent < 0 ? graph->AddVertex() : graph->AddChild(parent);
+  if (tipCount == 1)
+    {
+    names->InsertValue(vertex, QString("tip_%1").arg(firstTip).toStdString());
+    return vertex;
+    }
+  names->InsertValue(vertex, "");
+  int leftCount = tipCount / 2;
+  addSubtree(graph, vertex, firstTip, leftCount, names);
+  addSubtree(graph, vertex, firstTip + leftCount, tipCount - leftCount, names);
+  return vertex;
+}
+
+// --------------------------------------------------------------------------
+QByteArray newickSubtree(int firstTip, int tipCount)
+{
+  if (tipCount == 1)
+    {
+    return QString("tip_%1:1").arg(firstTip).toLatin1();
+    }
+  int leftCount = tipCount / 2;
+  return "(" + newickSubtree(firstTip, leftCount) + ","
+    + newickSubtree(firstTip + leftCount, tipCount - leftCount) + "):1";
+}
+
+// --------------------------------------------------------------------------
+bool createDataset(const BenchmarkSettings& settings, Dataset& dataset)
+{
+  RandomGenerator random(settings.Seed);
+
+  dataset.Table = vtkSmartPointer<vtkTable>::New();
+  vtkNew<vtkStringArray> rowNames;
+  rowNames->SetName("name");
+  rowNames->SetNumberOfValues(settings.Rows);
+  for (int row = 0; row < settings.Rows; ++row)
+    {
+    rowNames->SetValue(row, QString("row_%1").arg(row).toStdString());
+    }
+  dataset.Table->AddColumn(rowNames.GetPointer());
+  for (int column = 0; column < settings.Columns; ++column)
+    {
+    vtkNew<vtkDoubleArray> values;
+    values->SetName(QString("column_%1").arg(column).toLatin1().constData());
+    values->SetNumberOfValues(settings.Rows);
+    for (int row = 0; row < settings.Rows; ++row)
+      {
+      // Strictly positive values, for the log2 normalization
+      values->SetValue(row, 1. + 1000. * random.uniform());
+      }
+    dataset.Table->AddColumn(values.GetPointer());
+    }
+
+  dataset.CSVFileName = QDir::temp().filePath(
+    QString("voBaseBenchmarks-%1.csv").arg(QCoreApplication::applicationPid()));
+  if (!voIOManager::writeTableToCVSFile(dataset.Table.GetPointer(), dataset.CSVFileName))
+    {
+    std::cerr << "Failed to write " << qPrintable(dataset.CSVFileName) << std::endl;
+    return false;
+    }
+  dataset.RawTable = vtkSmartPointer<vtkTable>::New();
+  if (!voIOManager::readCSVFileIntoTable(dataset.CSVFileName, dataset.RawTable.GetPointer()))
+    {
+    std::cerr << "Failed to read " << qPrintable(dataset.CSVFileName) << std::endl;
+    return false;
+    }
+
+  vtkNew<vtkMutableDirectedGraph> graph;
+  vtkNew<vtkStringArray> nodeNames;
+  nodeNames->SetName("node name");
+  addSubtree(graph.GetPointer(), -1, 0, qMax(settings.Tips, 2), nodeNames.GetPointer());
+  graph->GetVertexData()->AddArray(nodeNames.GetPointer());
+  // voUtils::stringify() names the vertices after the "id" array
+  vtkNew<vtkStringArray> ids;
+  ids->DeepCopy(nodeNames.GetPointer());
+  ids->SetName("id");
+  graph->GetVertexData()->AddArray(ids.GetPointer());
+  dataset.Tree = vtkSmartPointer<vtkTree>::New();
+  if (!dataset.Tree->CheckedShallowCopy(graph.GetPointer()))
+    {
+    std::cerr << "Failed to create the tree" << std::endl;
+    return false;
+    }
+
+  dataset.NewickFileName = QDir::temp().filePath(
+    QString("voBaseBenchmarks-%1.tre").arg(QCoreApplication::applicationPid()));
+  QFile newickFile(dataset.NewickFileName);
+  if (!newickFile.open(QIODevice::WriteOnly))
+    {
+    std::cerr << "Failed to write " << qPrintable(dataset.NewickFileName) << std::endl;
+    return false;
+    }
+  QByteArray newickTree = newickSubtree(0, qMax(settings.Tips, 2));
+  for (int i = 0; i < ForestSize; ++i)
+    {
+    newickFile.write(newickTree);
+    newickFile.write(";\n");
+    }
+  newickFile.close();
+
+  vtkNew<vtkTable> tipTable;
+  vtkNew<vtkStringArray> tipNames;
+  tipNames->SetName("name");
+  vtkNew<vtkDoubleArray> tipValues;
+  tipValues->SetName("value");
+  for (vtkIdType vertex = 0; vertex < dataset.Tree->GetNumberOfVertices(); ++vertex)
+    {
+    if (dataset.Tree->IsLeaf(vertex))
+      {
+      tipNames->InsertNextValue(nodeNames->GetValue(vertex));
+      tipValues->InsertNextValue(random.uniform());
+      }
+    }
+  tipTable->AddColumn(tipNames.GetPointer());
+  tipTable->AddColumn(tipValues.GetPointer());
+  dataset.TipTable = vtkSmartPointer<vtkExtendedTable>::New();
+  voIOManager::convertTableToExtended(tipTable.GetPointer(), dataset.TipTable.GetPointer());
+  return true;
+}
+
+// --------------------------------------------------------------------------
+// Benchmarks
+
+// --------------------------------------------------------------------------
+void benchmarkTransposeTable(BenchmarkState& state, const Dataset& dataset)
+{
+  while (state.keepRunning())
+    {
+    vtkNew<vtkTable> transposed;
+    if (!voUtils::transposeTable(dataset.Table.GetPointer(), transposed.GetPointer(), voUtils::Headers))
+      {
+      state.skipWithError("transposeTable failed");
+      }
+    }
+}
+
+// --------------------------------------------------------------------------
+void benchmarkFlipTable(BenchmarkState& state, const Dataset& dataset)
+{
+  while (state.keepRunning())
+    {
+    vtkNew<vtkTable> flipped;
+    if (!voUtils::flipTable(dataset.Table.GetPointer(), flipped.GetPointer(),
+                            voUtils::FlipOption(voUtils::FlipHorizontalAxis | voUtils::FlipVerticalAxis),
+                            1, 0))
+      {
+      state.skipWithError("flipTable failed");
+      }
+    }
+}
+
+// --------------------------------------------------------------------------
+void benchmarkTableToArray(BenchmarkState& state, const Dataset& dataset)
+{
+  QList<int> columns = voUtils::range(1, dataset.Table->GetNumberOfColumns());
+  while (state.keepRunning())
+    {
+    vtkSmartPointer<vtkArray> array;
+    if (!voUtils::tableToArray(dataset.Table.GetPointer(), array, columns))
+      {
+      state.skipWithError("tableToArray failed");
+      }
+    }
+}
+
+// --------------------------------------------------------------------------
+void benchmarkReadCSVFileIntoExtendedTable(BenchmarkState& state, const Dataset& dataset)
+{
+  while (state.keepRunning())
+    {
+    vtkNew<vtkExtendedTable> table;
+    if (!voIOManager::readCSVFileIntoExtendedTable(dataset.CSVFileName, table.GetPointer()))
+      {
+      state.skipWithError("readCSVFileIntoExtendedTable failed");
+      }
+    }
+}
+
+// --------------------------------------------------------------------------
+void benchmarkFillExtendedTable(BenchmarkState& state, const Dataset& dataset)
+{
+  while (state.keepRunning())
+    {
+    vtkNew<vtkExtendedTable> table;
+    voIOManager::fillExtendedTable(dataset.RawTable.GetPointer(), table.GetPointer());
+    }
+}
+
+// --------------------------------------------------------------------------
+void benchmarkLog2Normalization(BenchmarkState& state, const Dataset& dataset)
+{
+  vtkNew<vtkTable> table;
+  while (state.keepRunning())
+    {
+    // The normalization is applied in place
+    state.pauseTiming();
+    table->DeepCopy(dataset.Table.GetPointer());
+    state.resumeTiming();
+    if (!Normalization::applyLog2(table.GetPointer(), QHash<int, QVariant>()))
+      {
+      state.skipWithError("applyLog2 failed");
+      }
+    }
+}
+
+// --------------------------------------------------------------------------
+void benchmarkStringifyTable(BenchmarkState& state, const Dataset& dataset)
+{
+  QList<vtkIdType> columnIdsToSkip;
+  columnIdsToSkip << 0;
+  while (state.keepRunning())
+    {
+    if (voUtils::stringify("table", dataset.Table.GetPointer(), columnIdsToSkip).isEmpty())
+      {
+      state.skipWithError("stringify failed");
+      }
+    }
+}
+
+// --------------------------------------------------------------------------
+void benchmarkStringifyTree(BenchmarkState& state, const Dataset& dataset)
+{
+  while (state.keepRunning())
+    {
+    if (voUtils::stringify("tree", dataset.Tree.GetPointer()).isEmpty())
+      {
+      state.skipWithError("stringify failed");
+      }
+    }
+}
+
+// --------------------------------------------------------------------------
+void benchmarkReadPhyloTreeForest(BenchmarkState& state, const Dataset& dataset)
+{
+  while (state.keepRunning())
+    {
+    voPhyloTreeReader reader;
+    if (!reader.read(dataset.NewickFileName) || reader.trees().size() != ForestSize)
+      {
+      state.skipWithError("voPhyloTreeReader failed");
+      }
+    }
+}
+
+// --------------------------------------------------------------------------
+void runTreeDropTip(BenchmarkState& state, const Dataset& dataset,
+                    const QString& selectionMethod, const QString& inputString)
+{
+  while (state.keepRunning())
+    {
+    // A new analysis for each iteration: the matching tips are cached
+    // between runs of the same analysis.
+    state.pauseTiming();
+    voTreeDropTip analysis;
+    analysis.addInput(new voDataObject("tree", dataset.Tree.GetPointer()));
+    analysis.addInput(new voDataObject("table", dataset.TipTable.GetPointer()));
+    analysis.initializeOutputInformation();
+    analysis.initializeParameterInformation();
+    QHash<QString, QVariant> parameters;
+    parameters.insert("selection_method", selectionMethod);
+    parameters.insert("input_string", inputString);
+    analysis.setParameterValues(parameters);
+    state.resumeTiming();
+
+    if (!analysis.run())
+      {
+      state.skipWithError("voTreeDropTip failed");
+      }
+    }
+}
+
+// --------------------------------------------------------------------------
+void benchmarkTreeDropTipByDataFilter(BenchmarkState& state, const Dataset& dataset)
+{
+  runTreeDropTip(state, dataset, "Data Filter", "value<0.5");
+}
+
+// --------------------------------------------------------------------------
+void benchmarkTreeDropTipByTipNames(BenchmarkState& state, const Dataset& dataset)
+{
+  QStringList tipNames;
+  for (vtkIdType row = 0; row < dataset.TipTable->GetInputData()->GetNumberOfRows(); row += 2)
+    {
+    tipNames << QString(dataset.TipTable->GetInputData()->GetValue(row, 0).ToString().c_str());
+    }
+  runTreeDropTip(state, dataset, "Tip Names", tipNames.join(","));
+}
+
+// --------------------------------------------------------------------------
+typedef void (*BenchmarkFunction)(BenchmarkState& state, const Dataset& dataset);
+
+struct Benchmark
+{
+  const char* Name;
+  BenchmarkFunction Function;
+  bool UsesTree; // Sized after the tips instead of the table
+};
+
+const Benchmark Benchmarks[] =
+{
+  {"transposeTable", benchmarkTransposeTable, false},
+  {"flipTable", benchmarkFlipTable, false},
+  {"tableToArray", benchmarkTableToArray, false},
+  {"readCSVFileIntoExtendedTable", benchmarkReadCSVFileIntoExtendedTable, false},
+  {"fillExtendedTable", benchmarkFillExtendedTable, false},
+  {"log2Normalization", benchmarkLog2Normalization, false},
+  {"stringifyTable", benchmarkStringifyTable, false},
+  {"stringifyTree", benchmarkStringifyTree, true},
+  {"readPhyloTreeForest", benchmarkReadPhyloTreeForest, true},
+  {"treeDropTipByDataFilter", benchmarkTreeDropTipByDataFilter, true},
+  {"treeDropTipByTipNames", benchmarkTreeDropTipByTipNames, true}
+};
+const int BenchmarkCount = sizeof(Benchmarks) / sizeof(Benchmarks[0]);
+
+// --------------------------------------------------------------------------
+Json::Value runResult(const QString& runName, const QString& name, int repetitions,
+                      int repetitionIndex, int iterations, double realTime, double cpuTime)
+{
+  Json::Value result;
+  result["name"] = name.toStdString();
+  result["run_name"] = runName.toStdString();
+  result["run_type"] = repetitionIndex < 0 ? "aggregate" : "iteration";
+  result["repetitions"] = repetitions;
+  if (repetitionIndex >= 0)
+    {
+    result["repetition_index"] = repetitionIndex;
+    }
+  result["threads"] = 1;
+  result["iterations"] = iterations;
+  result["real_time"] = realTime;
+  result["cpu_time"] = cpuTime;
+  result["time_unit"] = "us";
+  return result;
+}
+
+// --------------------------------------------------------------------------
+double median(std::vector<double> values)
+{
+  std::sort(values.begin(), values.end());
+  size_t middle = values.size() / 2;
+  return values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) / 2.;
+}
+
+// --------------------------------------------------------------------------
+void printUsage()
+{
+  std::cerr << "Usage: VisomicsBaseBenchmarks [options]\n"
+            << "  --rows <count>          Rows of the synthetic table (default 1000)\n"
+            << "  --columns <count>       Columns of the synthetic table (default 100)\n"
+            << "  --tips <count>          Tips of the synthetic tree (default 1024)\n"
+            << "  --seed <value>          Seed of the synthetic data (default 42)\n"
+            << "  --repetitions <count>   Runs of each benchmark (default 1)\n"
+            << "  --min-time <seconds>    Minimum time of each run (default 0.5)\n"
+            << "  --filter <regexp>       Only run the matching benchmarks\n"
+            << "  --output <file>         Write the JSON results to a file instead of stdout\n"
+            << "  --list                  List the benchmarks" << std::endl;
+}
+
+// --------------------------------------------------------------------------
+void messageHandler(QtMsgType type, const char* message)
+{
+  // Analyses are chatty: only keep warnings and errors
+  if (type != QtDebugMsg)
+    {
+    std::cerr << message << std::endl;
+    }
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  QCoreApplication app(argc, argv);
+  qInstallMsgHandler(messageHandler);
+
+  BenchmarkSettings settings;
+  QRegExp filter(".*");
+  QString outputFileName;
+  bool listOnly = false;
+
+  QStringList arguments = app.arguments();
+  QString executable = arguments.takeFirst();
+  bool ok = true;
+  while (!arguments.isEmpty() && ok)
+    {
+    QString argument = arguments.takeFirst();
+    if (argument == "--list")
+      {
+      listOnly = true;
+      }
+    else if (argument == "--help")
+      {
+      printUsage();
+      return EXIT_SUCCESS;
+      }
+    else if (arguments.isEmpty())
+      {
+      ok = false;
+      }
+    else if (argument == "--rows")
+      {
+      settings.Rows = arguments.takeFirst().toInt(&ok);
+      }
+    else if (argument == "--columns")
+      {
+      settings.Columns = arguments.takeFirst().toInt(&ok);
+      }
+    else if (argument == "--tips")
+      {
+      settings.Tips = arguments.takeFirst().toInt(&ok);
+      }
+    else if (argument == "--seed")
+      {
+      settings.Seed = arguments.takeFirst().toUInt(&ok);
+      }
+    else if (argument == "--repetitions")
+      {
+      settings.Repetitions = arguments.takeFirst().toInt(&ok);
+      }
+    else if (argument == "--min-time")
+      {
+      settings.MinimumTime = arguments.takeFirst().toDouble(&ok);
+      }
+    else if (argument == "--filter")
+      {
+      filter = QRegExp(arguments.takeFirst());
+      ok = filter.isValid();
+      }
+    else if (argument == "--output")
+      {
+      outputFileName = arguments.takeFirst();
+      }
+    else
+      {
+      ok = false;
+      }
+    }
+  if (!ok || settings.Rows < 1 || settings.Columns < 1 || settings.Tips < 2
+      || settings.Repetitions < 1 || settings.MinimumTime < 0)
+    {
+    printUsage();
+    return EXIT_FAILURE;
+    }
+
+  if (listOnly)
+    {
+    for (int i = 0; i < BenchmarkCount; ++i)
+      {
+      std::cout << Benchmarks[i].Name << std::endl;
+      }
+    return EXIT_SUCCESS;
+    }
+
+  Dataset dataset;
+  if (!createDataset(settings, dataset))
+    {
+    return EXIT_FAILURE;
+    }
+
+  Json::Value context;
+  context["date"] = QDateTime::currentDateTime().toString(Qt::ISODate).toStdString();
+  context["executable"] = executable.toStdString();
+  context["num_cpus"] = QThread::idealThreadCount();
+#ifdef NDEBUG
+  context["library_build_type"] = "release";
+#else
+  context["library_build_type"] = "debug";
+#endif
+  context["rows"] = settings.Rows;
+  context["columns"] = settings.Columns;
+  context["tips"] = settings.Tips;
+  context["seed"] = settings.Seed;
+
+  Json::Value results(Json::arrayValue);
+  bool success = true;
+  for (int i = 0; i < BenchmarkCount; ++i)
+    {
+    const Benchmark& benchmark = Benchmarks[i];
+    if (filter.indexIn(benchmark.Name) < 0)
+      {
+      continue;
+      }
+    QString runName = benchmark.UsesTree ?
+      QString("%1/%2").arg(benchmark.Name).arg(settings.Tips) :
+      QString("%1/%2x%3").arg(benchmark.Name).arg(settings.Rows).arg(settings.Columns);
+    std::cerr << qPrintable(runName) << std::flush;
+
+    std::vector<double> realTimes;
+    std::vector<double> cpuTimes;
+    for (int repetition = 0; repetition < settings.Repetitions; ++repetition)
+      {
+      BenchmarkState state(settings.MinimumTime, settings.MaximumIterations);
+      benchmark.Function(state, dataset);
+      if (state.error())
+        {
+        std::cerr << " - " << qPrintable(state.errorMessage());
+        Json::Value result = runResult(runName, runName, settings.Repetitions, repetition,
+                                       state.iterations(), 0., 0.);
+        result["error_occurred"] = true;
+        result["error_message"] = state.errorMessage().toStdString();
+        results.append(result);
+        success = false;
+        break;
+        }
+      int iterations = qMax(state.iterations(), 1);
+      realTimes.push_back(state.realTime() * 1e6 / iterations);
+      cpuTimes.push_back(state.cpuTime() * 1e6 / iterations);
+      results.append(runResult(runName, runName, settings.Repetitions, repetition,
+                               state.iterations(), realTimes.back(), cpuTimes.back()));
+      }
+    if (realTimes.size() > 1)
+      {
+      double realMean = 0.;
+      double cpuMean = 0.;
+      for (size_t r = 0; r < realTimes.size(); ++r)
+        {
+        realMean += realTimes[r] / realTimes.size();
+        cpuMean += cpuTimes[r] / cpuTimes.size();
+        }
+      results.append(runResult(runName, runName + "_mean", settings.Repetitions, -1,
+                               static_cast<int>(realTimes.size()), realMean, cpuMean));
+      results.append(runResult(runName, runName + "_median", settings.Repetitions, -1,
+                               static_cast<int>(realTimes.size()),
+                               median(realTimes), median(cpuTimes)));
+      }
+    if (!realTimes.empty())
+      {
+      std::cerr << " - " << median(realTimes) << " us";
+      }
+    std::cerr << std::endl;
+    }
+  QFile::remove(dataset.CSVFileName);
+  QFile::remove(dataset.NewickFileName);
+
+  Json::Value root;
+  root["context"] = context;
+  root["benchmarks"] = results;
+  std::string json = Json::StyledWriter().write(root);
+  if (outputFileName.isEmpty())
+    {
+    std::cout << json;
+    }
+  else
+    {
+    QFile outputFile(outputFileName);
+    if (!outputFile.open(QIODevice::WriteOnly | QIODevice::Text))
+      {
+      std::cerr << "Failed to write " << qPrintable(outputFileName) << std::endl;
+      return EXIT_FAILURE;
+      }
+    outputFile.write(json.c_str(), json.size());
+    }
+  return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
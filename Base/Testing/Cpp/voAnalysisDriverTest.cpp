@@ -0,0 +1,136 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+// Qt includes
+#include <QApplication>
+
+// QtPropertyBrowser includes
+#include <QtVariantPropertyManager>
+
+// Visomics includes
+#include "voAnalysis.h"
+#include "voAnalysisDriver.h"
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+class voSweptAnalysis : public voAnalysis
+{
+public:
+  voSweptAnalysis():voAnalysis(){}
+  virtual ~voSweptAnalysis(){}
+
+  virtual int execute()
+    {
+    return voAnalysis::SUCCESS;
+    }
+
+  virtual void setParameterInformation()
+    {
+    QList<QtProperty*> parameters;
+    parameters << this->addIntegerParameter("count", QObject::tr("Count"), 0, 100, 1);
+    parameters << this->addDoubleParameter("threshold", QObject::tr("Threshold"), 0., 1., 0.5);
+    parameters << this->addEnumParameter("method", QObject::tr("Method"),
+                                         (QStringList() << "Mean" << "Median" << "Max"), "Mean");
+    parameters << this->addStringParameter("filter", QObject::tr("Filter"),
+                                           "awesomeness<2,island=\"Cuba\"");
+    this->addParameterGroup("Swept parameters", parameters);
+    }
+};
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int voAnalysisDriverTest(int argc, char * argv [])
+{
+  QApplication app(argc, argv);
+
+  voSweptAnalysis analysis;
+  analysis.initializeParameterInformation();
+
+  QString errorString;
+  QHash<QString, QVariantList> parameterGrid = voAnalysisDriver::parseParameterGrid(
+    &analysis, "count=1,4..10:3; threshold=0.1..0.3:0.1; method=Median,Max", errorString);
+  if (!errorString.isEmpty() || parameterGrid.count() != 3)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with parseParameterGrid() - "
+              << qPrintable(errorString) << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  QVariantList expectedCounts;
+  expectedCounts << 1 << 4 << 7 << 10;
+  if (parameterGrid.value("count") != expectedCounts)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with parseParameterGrid()"
+              << " - integer values or range not expanded !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if (parameterGrid.value("threshold").size() != 3 ||
+      qAbs(parameterGrid.value("threshold").at(2).toDouble() - 0.3) > 1e-12)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with parseParameterGrid()"
+              << " - double range not expanded !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  QVariantList expectedMethods;
+  expectedMethods << 1 << 2;
+  if (parameterGrid.value("method") != expectedMethods)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with parseParameterGrid()"
+              << " - enumeration names should be mapped to indices !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Strings containing separators are quoted
+  QString filter = analysis.stringParameter("filter");
+  QString spec = QString("filter=%1, \"a;b\"; count=2").arg(
+    voAnalysisDriver::quoteParameterGridValue(filter));
+  parameterGrid = voAnalysisDriver::parseParameterGrid(&analysis, spec, errorString);
+  QVariantList expectedFilters;
+  expectedFilters << filter << "a;b";
+  if (!errorString.isEmpty() || parameterGrid.value("filter") != expectedFilters
+      || parameterGrid.value("count") != (QVariantList() << 2))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with parseParameterGrid()"
+              << " - quoted values should not be split ! " << qPrintable(errorString) << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const char* invalidSpecs[] = {"unknown=1", "count=a", "count=1..5:0", "count=1.5",
+                                "method=Average", "count=", "", "filter=\"a,b"};
+  for (unsigned int i = 0; i < sizeof(invalidSpecs) / sizeof(invalidSpecs[0]); ++i)
+    {
+    parameterGrid = voAnalysisDriver::parseParameterGrid(&analysis, invalidSpecs[i], errorString);
+    if (!parameterGrid.isEmpty() || errorString.isEmpty())
+      {
+      std::cerr << "Line " << __LINE__ << " - Problem with parseParameterGrid()"
+                << " - \"" << invalidSpecs[i] << "\" should be rejected !" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
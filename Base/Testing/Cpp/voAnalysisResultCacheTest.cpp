@@ -0,0 +1,233 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+// Qt includes
+#include <QApplication>
+#include <QDir>
+
+// QtPropertyBrowser includes
+#include <QtVariantPropertyManager>
+
+// Visomics includes
+#include "voAnalysis.h"
+#include "voAnalysisResultCache.h"
+#include "voDataObject.h"
+#include "voOutputDataObject.h"
+
+// VTK includes
+#include <vtkIntArray.h>
+#include <vtkNew.h>
+#include <vtkTable.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+class voSumAnalysis : public voAnalysis
+{
+public:
+  voSumAnalysis():voAnalysis(){}
+  virtual ~voSumAnalysis(){}
+
+  virtual int execute()
+    {
+    vtkTable* table =  vtkTable::SafeDownCast(this->input()->dataAsVTKDataObject());
+    vtkIntArray * inputArray = vtkIntArray::SafeDownCast(table->GetColumn(0));
+
+    vtkNew<vtkTable> outputTable;
+    vtkNew<vtkIntArray> outputArray;
+    outputArray->SetName("sum");
+    outputArray->SetNumberOfValues(1);
+    outputArray->SetValue(0, inputArray->GetValue(0) + inputArray->GetValue(1)
+                          + this->integerParameter("offset"));
+    outputTable->AddColumn(outputArray.GetPointer());
+    this->setOutput("output", new voOutputDataObject("output", outputTable.GetPointer()));
+
+    return voAnalysis::SUCCESS;
+    }
+
+  virtual void setOutputInformation()
+    {
+    this->addOutputType("output", "vtkTable", "", "", "voTableView", "Sum");
+    }
+
+  virtual void setParameterInformation()
+    {
+    QList<QtProperty*> parameters;
+    parameters << this->addIntegerParameter("offset", QObject::tr("Offset"), 0, 10, 0);
+    this->addParameterGroup("Sum parameters", parameters);
+    }
+};
+
+// --------------------------------------------------------------------------
+voDataObject * createInput()
+{
+  vtkNew<vtkTable> table;
+  vtkNew<vtkIntArray> column;
+  column->SetName("values");
+  column->SetNumberOfValues(2);
+  column->SetValue(0, 1);
+  column->SetValue(1, 2);
+  table->AddColumn(column.GetPointer());
+  return new voDataObject("input", table.GetPointer());
+}
+
+// --------------------------------------------------------------------------
+void setupAnalysis(voAnalysis& analysis, voDataObject * input, int offset)
+{
+  analysis.addInput(input);
+  analysis.initializeOutputInformation();
+  analysis.initializeParameterInformation();
+  QHash<QString, QVariant> parameters;
+  parameters.insert("offset", offset);
+  analysis.setParameterValues(parameters);
+}
+
+// --------------------------------------------------------------------------
+int outputValue(voAnalysis& analysis)
+{
+  voDataObject * output = analysis.output("output");
+  vtkTable * table = output ? vtkTable::SafeDownCast(output->dataAsVTKDataObject()) : 0;
+  vtkIntArray * array = table ? vtkIntArray::SafeDownCast(table->GetColumn(0)) : 0;
+  return array ? array->GetValue(0) : -1;
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int voAnalysisResultCacheTest(int argc, char * argv [])
+{
+  QApplication app(argc, argv);
+
+  QString cacheDirectory = QDir::temp().filePath("voAnalysisResultCacheTest");
+  voAnalysisResultCache cache;
+  cache.setDirectory(cacheDirectory);
+  cache.clear();
+
+  voSumAnalysis analysis;
+  setupAnalysis(analysis, createInput(), 0);
+  QString key = cache.cacheKey(&analysis);
+  if (key.isEmpty())
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with cacheKey() !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if (cache.restoreOutputs(key, &analysis))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with restoreOutputs()"
+              << " - cache should be empty !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if (!analysis.run() || outputValue(analysis) != 3)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with run() !" << std::endl;
+    return EXIT_FAILURE;
+    }
+  cache.storeOutputs(key, &analysis);
+
+  // Same content in another data object: same key
+  voSumAnalysis sameAnalysis;
+  setupAnalysis(sameAnalysis, createInput(), 0);
+  if (cache.cacheKey(&sameAnalysis) != key)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with cacheKey()"
+              << " - key should only depend on the content of the inputs !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if (!cache.restoreOutputs(key, &sameAnalysis) || outputValue(sameAnalysis) != 3
+      || sameAnalysis.output("output") == analysis.output("output"))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with restoreOutputs() !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Outputs modified after being cached or restored don't alter the cache
+  vtkTable * analysisTable = vtkTable::SafeDownCast(analysis.output("output")->dataAsVTKDataObject());
+  vtkTable * restoredTable = vtkTable::SafeDownCast(sameAnalysis.output("output")->dataAsVTKDataObject());
+  if (restoredTable == analysisTable)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with restoreOutputs()"
+              << " - cached data should not be shared !" << std::endl;
+    return EXIT_FAILURE;
+    }
+  analysisTable->RemoveColumn(0);
+  restoredTable->RemoveColumn(0);
+  voSumAnalysis copyAnalysis;
+  setupAnalysis(copyAnalysis, createInput(), 0);
+  if (!cache.restoreOutputs(key, &copyAnalysis) || outputValue(copyAnalysis) != 3)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with restoreOutputs()"
+              << " - cached data should be copied !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Different parameter: different key
+  voSumAnalysis otherAnalysis;
+  setupAnalysis(otherAnalysis, createInput(), 4);
+  if (cache.cacheKey(&otherAnalysis) == key)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with cacheKey()"
+              << " - key should depend on the parameters !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Different content: different key
+  voDataObject * otherInput = createInput();
+  vtkTable * otherTable = vtkTable::SafeDownCast(otherInput->dataAsVTKDataObject());
+  vtkIntArray::SafeDownCast(otherTable->GetColumn(0))->SetValue(1, 5);
+  otherTable->Modified();
+  voSumAnalysis otherInputAnalysis;
+  setupAnalysis(otherInputAnalysis, otherInput, 0);
+  if (cache.cacheKey(&otherInputAnalysis) == key)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with cacheKey()"
+              << " - key should depend on the content of the inputs !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Results are read back from disk by a new cache
+  voAnalysisResultCache diskCache;
+  diskCache.setDirectory(cacheDirectory);
+  voSumAnalysis diskAnalysis;
+  setupAnalysis(diskAnalysis, createInput(), 0);
+  if (!diskCache.restoreOutputs(key, &diskAnalysis) || outputValue(diskAnalysis) != 3)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with restoreOutputs()"
+              << " - results should be read from disk !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  cache.clear();
+  voSumAnalysis clearedAnalysis;
+  setupAnalysis(clearedAnalysis, createInput(), 0);
+  if (cache.restoreOutputs(key, &clearedAnalysis))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with clear() !" << std::endl;
+    return EXIT_FAILURE;
+    }
+  QDir().rmdir(cacheDirectory);
+
+  return EXIT_SUCCESS;
+}
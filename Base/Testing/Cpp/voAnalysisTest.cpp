@@ -20,7 +20,12 @@
 
 // Qt includes
 #include <QApplication>
+#include <QEventLoop>
+#include <QHash>
 #include <QStringList>
+#include <QThread>
+#include <QThreadPool>
+#include <QTimer>
 
 // QtPropertyBrowser includes
 #include <QtVariantPropertyManager>
@@ -96,6 +101,54 @@ public:
     }
 };
 
+// --------------------------------------------------------------------------
+class voStagedAnalysis : public voAnalysis
+{
+public:
+  voStagedAnalysis():voAnalysis(), StageRunCount(0){}
+  virtual ~voStagedAnalysis(){}
+
+  int StageRunCount;
+
+  virtual int execute()
+    {
+    if (!this->stageOutput("copy"))
+      {
+      ++this->StageRunCount;
+      vtkNew<vtkTable> copy;
+      copy->DeepCopy(vtkTable::SafeDownCast(this->input()->dataAsVTKDataObject()));
+      this->setStageOutput("copy", copy.GetPointer());
+      }
+    return voAnalysis::SUCCESS;
+    }
+
+  virtual void setParameterInformation()
+    {
+    QList<QtProperty*> parameters;
+    parameters << this->addIntegerParameter("columns", QObject::tr("Columns"), 0, 10, 1);
+    parameters << this->addIntegerParameter("rows", QObject::tr("Rows"), 0, 10, 1);
+    this->addParameterGroup("Staged parameters", parameters);
+    this->addStage("copy", QStringList() << "columns");
+    }
+};
+
+// --------------------------------------------------------------------------
+class voWaitingAnalysis : public voAnalysis
+{
+public:
+  voWaitingAnalysis():voAnalysis(){}
+  virtual ~voWaitingAnalysis(){}
+
+  virtual int execute()
+    {
+    // Keep the worker busy until the owner cancels the analysis.
+    while (!this->abortExecution())
+      {
+      }
+    return voAnalysis::FAILURE;
+    }
+};
+
 } // end of anonymous namespace
 
 //-----------------------------------------------------------------------------
@@ -520,5 +573,117 @@ int voAnalysisTest(int argc, char * argv [])
     return EXIT_FAILURE;
     }
 
+  //-----------------------------------------------------------------------------
+  // Execute in background
+  //-----------------------------------------------------------------------------
+
+  analysis.removeAllOutputs();
+  analysis.initializeOutputInformation();
+
+  QThreadPool threadPool;
+  QEventLoop eventLoop;
+  QObject::connect(&analysis, SIGNAL(complete()), &eventLoop, SLOT(quit()));
+  QTimer::singleShot(10000, &eventLoop, SLOT(quit()));
+
+  analysis.runInBackground(&threadPool);
+  if (!analysis.isRunningInBackground())
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with isRunningInBackground() !" << std::endl;
+    return EXIT_FAILURE;
+    }
+  eventLoop.exec();
+
+  if (analysis.isRunningInBackground())
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with runInBackground() !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  voDataObject * backgroundOutput = analysis.output("output");
+  if (!backgroundOutput || backgroundOutput->thread() != analysis.thread())
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with runInBackground()"
+              << " - output should belong to the thread of the analysis !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  vtkTable * outputTable3 = vtkTable::SafeDownCast(backgroundOutput->dataAsVTKDataObject());
+  vtkIntArray * outputArray3 =
+    outputTable3 ? vtkIntArray::SafeDownCast(outputTable3->GetColumn(0)) : 0;
+  if (!outputArray3 || outputArray3->GetValue(0) != 3)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with runInBackground() !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //-----------------------------------------------------------------------------
+  // Cancel and wait before deletion
+  //-----------------------------------------------------------------------------
+
+  voWaitingAnalysis * waitingAnalysis = new voWaitingAnalysis;
+  waitingAnalysis->runInBackground(&threadPool);
+  waitingAnalysis->cancelAndWait();
+  if (!waitingAnalysis->abortExecution())
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with cancelAndWait() !" << std::endl;
+    return EXIT_FAILURE;
+    }
+  // The worker is done, deleting the analysis must not race with execute()
+  delete waitingAnalysis;
+  QCoreApplication::processEvents();
+
+  //-----------------------------------------------------------------------------
+  // Stages
+  //-----------------------------------------------------------------------------
+
+  voStagedAnalysis stagedAnalysis;
+  stagedAnalysis.initializeParameterInformation();
+  stagedAnalysis.addInput(new voDataObject("input", table.GetPointer()));
+  if (stagedAnalysis.stageNames() != QStringList("copy")
+      || stagedAnalysis.hasStageOutput("copy"))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with stageNames() / hasStageOutput() !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  QHash<QString, QVariant> stagedParameters;
+  stagedParameters.insert("rows", 2);
+  stagedAnalysis.run();
+  stagedAnalysis.setParameterValues(stagedParameters);
+  stagedAnalysis.run();
+  if (stagedAnalysis.StageRunCount != 1 || !stagedAnalysis.hasStageOutput("copy"))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with stageOutput()"
+              << " - stage should be reused when an unrelated parameter changes !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  stagedParameters.insert("columns", 2);
+  stagedAnalysis.setParameterValues(stagedParameters);
+  stagedAnalysis.run();
+  if (stagedAnalysis.StageRunCount != 2)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with stageOutput()"
+              << " - stage should run again when its parameters change !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  table->Modified();
+  stagedAnalysis.run();
+  if (stagedAnalysis.StageRunCount != 3)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with stageOutput()"
+              << " - stage should run again when its input data is modified !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  stagedAnalysis.removeAllInputs();
+  if (stagedAnalysis.hasStageOutput("copy"))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with removeAllInputs()"
+              << " - stage outputs should be removed !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,160 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+// Qt includes
+#include <QDir>
+#include <QFile>
+
+// Visomics includes
+#include "voApplication.h"
+#include "voBatchRunner.h"
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+// --------------------------------------------------------------------------
+bool writeFile(const QString& fileName, const QByteArray& content)
+{
+  QFile file(fileName);
+  if (!file.open(QIODevice::WriteOnly))
+    {
+    return false;
+    }
+  return file.write(content) == content.size();
+}
+
+// --------------------------------------------------------------------------
+void removeDirectory(const QString& path)
+{
+  QDir directory(path);
+  foreach(const QString& entry, directory.entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+    removeDirectory(directory.filePath(entry));
+    }
+  foreach(const QString& entry, directory.entryList(QDir::Files))
+    {
+    directory.remove(entry);
+    }
+  QDir().rmdir(path);
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int voBatchRunnerTest(int argc, char * argv [])
+{
+  voApplication app(argc, argv, false);
+  bool exitWhenDone = false;
+  app.initialize(exitWhenDone);
+
+  QString jobDirectory = QDir::temp().filePath("voBatchRunnerTest");
+  removeDirectory(jobDirectory);
+  QDir().mkpath(jobDirectory);
+  QDir job(jobDirectory);
+  if (!writeFile(job.filePath("first.tre"), "((A:1,B:1):1,C:2);\n") ||
+      !writeFile(job.filePath("second.tre"), "((A:1,B:2):1,(C:1,D:1):1);\n"))
+    {
+    std::cerr << "Line " << __LINE__ << " - Failed to write the input trees !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  voBatchRunner runner;
+  if (runner.loadJob("{ \"datasets\": [", jobDirectory))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with loadJob()"
+              << " - invalid JSON should be rejected !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if (runner.loadJob("{ \"datasets\": [ { \"tree\": \"first.tre\" } ],"
+                     "  \"analyses\": [ { \"name\": \"Unknown Analysis\" } ] }", jobDirectory))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with loadJob()"
+              << " - unknown analyses should be rejected !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if (runner.loadJob("{ \"datasets\": [ { \"tree\": \"first.tre\" } ],"
+                     "  \"analyses\": [ { \"name\": \"Tree Drop Tip\","
+                     "    \"parameters\": { \"selection_method\": \"Unknown Method\" } } ] }",
+                     jobDirectory))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with loadJob()"
+              << " - invalid enumeration values should be rejected !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if (!runner.loadJob("{ \"output_directory\": \"results\","
+                      "  \"datasets\": [ { \"tree\": \"first.tre\" }, { \"tree\": \"second.tre\" } ],"
+                      "  \"analyses\": [ { \"name\": \"Tree Drop Tip\", \"inputs\": [\"tree\"],"
+                      "    \"parameters\": { \"selection_method\": \"Tip Names\", \"input_string\": \"A\" } } ] }",
+                      jobDirectory)
+      || runner.datasetCount() != 2 || runner.analysisCount() != 1)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with loadJob() !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  runner.setMaximumConcurrentDatasets(2);
+  int failureCount = runner.run();
+  if (failureCount != 0)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with run() - "
+              << failureCount << " analyses failed !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  QStringList datasetNames;
+  datasetNames << "first" << "second";
+  foreach(const QString& datasetName, datasetNames)
+    {
+    QDir outputs(job.filePath("results/" + datasetName + "/Tree Drop Tip"));
+    if (outputs.entryList(QStringList() << "*.vtk", QDir::Files).count() != 1)
+      {
+      std::cerr << "Line " << __LINE__ << " - Problem with run()"
+                << " - missing output for dataset " << qPrintable(datasetName) << " !" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Analyses that can't run in the background run on the main thread
+  if (!runner.loadJob("{ \"output_directory\": \"serial\","
+                      "  \"datasets\": [ { \"tree\": \"first.tre\" }, { \"tree\": \"second.tre\" } ],"
+                      "  \"analyses\": [ { \"name\": \"OneZoom Visualization\" } ] }",
+                      jobDirectory))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with loadJob() !" << std::endl;
+    return EXIT_FAILURE;
+    }
+  failureCount = runner.run();
+  if (failureCount != 0 || QDir(job.filePath("serial/second/OneZoom Visualization"))
+        .entryList(QStringList() << "*.vtk", QDir::Files).count() != 1)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with run() - analyses"
+              << " that can't run in the background should run on the main thread !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  removeDirectory(jobDirectory);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,179 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+// Qt includes
+#include <QBitArray>
+#include <QString>
+
+// Visomics includes
+#include "voDataFilterExpression.h"
+
+// VTK includes
+#include <vtkDoubleArray.h>
+#include <vtkIntArray.h>
+#include <vtkNew.h>
+#include <vtkStringArray.h>
+#include <vtkTable.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+
+// --------------------------------------------------------------------------
+// Return a string of '0' and '1', one per row
+QString rowString(const QBitArray& rows)
+{
+  QString string;
+  for (int i = 0; i < rows.size(); ++i)
+    {
+    string += rows.testBit(i) ? '1' : '0';
+    }
+  return string;
+}
+
+// --------------------------------------------------------------------------
+bool checkExpression(int line, vtkTable * table, const QString& expression,
+                     const QString& expectedRows)
+{
+  voDataFilterExpression filter;
+  if (!filter.compile(expression, table))
+    {
+    std::cerr << "Line " << line << " - Problem with compile()\n"
+              << "\texpression: " << qPrintable(expression) << "\n"
+              << "\terror: " << qPrintable(filter.errorString()) << std::endl;
+    return false;
+    }
+  QString rows = rowString(filter.evaluate());
+  if (rows != expectedRows)
+    {
+    std::cerr << "Line " << line << " - Problem with evaluate()\n"
+              << "\texpression: " << qPrintable(expression) << "\n"
+              << "\trows: " << qPrintable(rows) << "\n"
+              << "\texpected rows: " << qPrintable(expectedRows) << std::endl;
+    return false;
+    }
+  return true;
+}
+
+// --------------------------------------------------------------------------
+bool checkInvalidExpression(int line, vtkTable * table, const QString& expression)
+{
+  voDataFilterExpression filter;
+  if (filter.compile(expression, table) || filter.isValid()
+      || filter.errorString().isEmpty() || !filter.evaluate().isEmpty())
+    {
+    std::cerr << "Line " << line << " - Problem with compile()\n"
+              << "\texpression should be invalid: " << qPrintable(expression) << std::endl;
+    return false;
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int voDataFilterExpressionTest(int /*argc*/, char * /*argv*/ [])
+{
+  const char * names[] = {"a", "b", "c", "d", "e"};
+  const char * islands[] = {"Cuba", "Jamaica", "Cuba", "Hispaniola", "Puerto Rico"};
+  const double lengths[] = {0.5, 1.5, 2.0, 2.5, 0.05};
+  const int counts[] = {1, 2, 3, 4, 5};
+
+  vtkNew<vtkTable> table;
+  vtkNew<vtkStringArray> nameColumn;
+  nameColumn->SetName("name");
+  vtkNew<vtkStringArray> islandColumn;
+  islandColumn->SetName("island");
+  vtkNew<vtkDoubleArray> lengthColumn;
+  lengthColumn->SetName("length");
+  vtkNew<vtkIntArray> countColumn;
+  countColumn->SetName("tip count");
+  for (int i = 0; i < 5; ++i)
+    {
+    nameColumn->InsertNextValue(names[i]);
+    islandColumn->InsertNextValue(islands[i]);
+    lengthColumn->InsertNextValue(lengths[i]);
+    countColumn->InsertNextValue(counts[i]);
+    }
+  table->AddColumn(nameColumn.GetPointer());
+  table->AddColumn(islandColumn.GetPointer());
+  table->AddColumn(lengthColumn.GetPointer());
+  table->AddColumn(countColumn.GetPointer());
+
+  // Syntax of the former comma separated conditions
+  if (!checkExpression(__LINE__, table.GetPointer(), "length<2", "11001")
+      || !checkExpression(__LINE__, table.GetPointer(), "length<=2", "11101")
+      || !checkExpression(__LINE__, table.GetPointer(), "length>1.5", "00110")
+      || !checkExpression(__LINE__, table.GetPointer(), "length>=1.5", "01110")
+      || !checkExpression(__LINE__, table.GetPointer(), "length=2", "00100")
+      || !checkExpression(__LINE__, table.GetPointer(), "island=\"Cuba\"", "10100")
+      || !checkExpression(__LINE__, table.GetPointer(), "length<2,island=\"Cuba\"", "10000"))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Operators, boolean connectives and parentheses
+  if (!checkExpression(__LINE__, table.GetPointer(), "length != 2", "11011")
+      || !checkExpression(__LINE__, table.GetPointer(), "island!=\"Cuba\"", "01011")
+      || !checkExpression(__LINE__, table.GetPointer(), "length<0.1 | length>2.2", "00011")
+      || !checkExpression(__LINE__, table.GetPointer(), "length<0.1 || island=\"Cuba\" && length>1", "00101")
+      || !checkExpression(__LINE__, table.GetPointer(), "(length<0.1 | island=\"Cuba\") & length>1", "00100")
+      || !checkExpression(__LINE__, table.GetPointer(), "!(island=\"Cuba\")", "01011")
+      || !checkExpression(__LINE__, table.GetPointer(), "!!(length>-1)", "11111")
+      || !checkExpression(__LINE__, table.GetPointer(), "tip count>=3", "00111")
+      || !checkExpression(__LINE__, table.GetPointer(), "\"tip count\"<3", "11000"))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Numeric comparison of a string column
+  vtkNew<vtkStringArray> textColumn;
+  textColumn->SetName("text");
+  for (int i = 0; i < 5; ++i)
+    {
+    textColumn->InsertNextValue(QString::number(lengths[i]).toStdString());
+    }
+  table->AddColumn(textColumn.GetPointer());
+  if (!checkExpression(__LINE__, table.GetPointer(), "text>1", "01110"))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Errors
+  if (!checkInvalidExpression(__LINE__, table.GetPointer(), "")
+      || !checkInvalidExpression(__LINE__, table.GetPointer(), "height<2")
+      || !checkInvalidExpression(__LINE__, table.GetPointer(), "length")
+      || !checkInvalidExpression(__LINE__, table.GetPointer(), "length<")
+      || !checkInvalidExpression(__LINE__, table.GetPointer(), "length<abc")
+      || !checkInvalidExpression(__LINE__, table.GetPointer(), "island<\"Cuba\"")
+      || !checkInvalidExpression(__LINE__, table.GetPointer(), "island=\"Cuba")
+      || !checkInvalidExpression(__LINE__, table.GetPointer(), "(length<2")
+      || !checkInvalidExpression(__LINE__, table.GetPointer(), "length<2)")
+      || !checkInvalidExpression(__LINE__, table.GetPointer(), "length<2,")
+      || !checkInvalidExpression(0, 0, "length<2"))
+    {
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
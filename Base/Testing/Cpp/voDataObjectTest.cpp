@@ -25,11 +25,16 @@
 
 // Visomics includes
 #include "voDataObject.h"
+#include "voUtils.h"
 
 // VTK includes
 #include <vtkDataObject.h>
+#include <vtkDataSetAttributes.h>
+#include <vtkMutableDirectedGraph.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
+#include <vtkStringArray.h>
+#include <vtkTree.h>
 
 // STD includes
 #include <cstdlib>
@@ -245,5 +250,93 @@ int voDataObjectTest(int argc, char * argv [])
     return EXIT_FAILURE;
     }
 
+  //-----------------------------------------------------------------------------
+  // Tree name index
+  //-----------------------------------------------------------------------------
+  vtkNew<vtkMutableDirectedGraph> graph;
+  vtkNew<vtkStringArray> nodeNames;
+  nodeNames->SetName("node name");
+  vtkIdType root = graph->AddVertex();
+  nodeNames->InsertNextValue("");
+  vtkIdType tip1 = graph->AddChild(root);
+  nodeNames->InsertNextValue("tip1");
+  vtkIdType tip2 = graph->AddChild(root);
+  nodeNames->InsertNextValue("tip2");
+  graph->GetVertexData()->AddArray(nodeNames.GetPointer());
+  vtkNew<vtkTree> tree;
+  if (!tree->CheckedShallowCopy(graph.GetPointer()))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with CheckedShallowCopy()" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  voDataObject treeDataObject("tree", tree.GetPointer());
+  voTreeNameIndex nameIndex = treeDataObject.treeNameIndex();
+  if (nameIndex.count() != 2 || nameIndex.vertex("tip1") != tip1
+      || nameIndex.vertex("tip2") != tip2 || nameIndex.vertex("tip3") != -1
+      || nameIndex.contains(""))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with voDataObject::treeNameIndex()" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  vtkStringArray * treeNodeNames = vtkStringArray::SafeDownCast(
+    tree->GetVertexData()->GetAbstractArray("node name"));
+  treeNodeNames->SetValue(tip2, "tip3");
+  treeNodeNames->Modified();
+  nameIndex = treeDataObject.treeNameIndex();
+  if (nameIndex.vertex("tip3") != tip2 || nameIndex.contains("tip2"))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with voDataObject::treeNameIndex()"
+              << " - index should be rebuilt when names are modified" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  voDataObject tableDataObject("table", QVariant(QString("not a tree")));
+  if (!tableDataObject.treeNameIndex().isEmpty())
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with voDataObject::treeNameIndex()"
+              << " - index should be empty" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //-----------------------------------------------------------------------------
+  // Shared data copy
+  //-----------------------------------------------------------------------------
+  vtkSmartPointer<vtkTree> treeCopy = vtkTree::SafeDownCast(treeDataObject.sharedDataCopy());
+  if (!treeCopy || treeCopy.GetPointer() == tree.GetPointer()
+      || treeCopy->GetNumberOfVertices() != 3
+      || treeCopy->GetVertexData()->GetAbstractArray("node name") != treeNodeNames)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with voDataObject::sharedDataCopy()"
+              << " - arrays should be shared" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  vtkStringArray * copyNodeNames = vtkStringArray::SafeDownCast(
+    voUtils::detachArray(treeCopy->GetVertexData(), "node name"));
+  if (!copyNodeNames || copyNodeNames == treeNodeNames
+      || copyNodeNames->GetValue(tip2) != "tip3"
+      || treeCopy->GetVertexData()->GetAbstractArray("node name") != copyNodeNames)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with voUtils::detachArray()" << std::endl;
+    return EXIT_FAILURE;
+    }
+  copyNodeNames->SetValue(tip2, "tip4");
+  if (treeNodeNames->GetValue(tip2) != "tip3"
+      || voUtils::detachArray(treeCopy->GetVertexData(), "node name") != copyNodeNames)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with voUtils::detachArray()"
+              << " - detached arrays should not be copied again" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if (tableDataObject.sharedDataCopy())
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with voDataObject::sharedDataCopy()"
+              << " - copy should be null" << std::endl;
+    return EXIT_FAILURE;
+    }
+
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,284 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+// Qt includes
+#include <QCoreApplication>
+#include <QDir>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegExp>
+#include <QSemaphore>
+#include <QStringList>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+#include <QTime>
+#include <QTimer>
+
+// Visomics includes
+#include "voOpenTreeFetcher.h"
+
+// JsonCpp includes
+#include <json/json.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+
+// Stand-in for the Open Tree of Life database: answers the requests of the
+// next connections, with blocking sockets, on its own thread.
+class voOpenTreeTestServer : public QThread
+{
+public:
+  voOpenTreeTestServer(int connections):QThread(), Connections(connections), Port(0){}
+
+  quint16 listen()
+    {
+    this->start();
+    this->Ready.acquire();
+    return this->Port;
+    }
+
+  QStringList RequestedIDs;
+
+protected:
+  virtual void run()
+    {
+    QTcpServer server;
+    server.listen(QHostAddress::LocalHost);
+    this->Port = server.serverPort();
+    this->Ready.release();
+    for (int i = 0; i < this->Connections; ++i)
+      {
+      if (!server.waitForNewConnection(10000))
+        {
+        return;
+        }
+      QTcpSocket * socket = server.nextPendingConnection();
+      QByteArray request;
+      int contentLength = -1;
+      int headerEnd = -1;
+      while (socket->waitForReadyRead(10000))
+        {
+        request += socket->readAll();
+        headerEnd = request.indexOf("\r\n\r\n");
+        if (headerEnd >= 0 && contentLength < 0)
+          {
+          QRegExp lengthHeader("Content-Length:\\s*(\\d+)", Qt::CaseInsensitive);
+          contentLength = lengthHeader.indexIn(QString(request.left(headerEnd))) >= 0 ?
+            lengthHeader.cap(1).toInt() : 0;
+          }
+        if (headerEnd >= 0 && request.size() >= headerEnd + 4 + contentLength)
+          {
+          break;
+          }
+        }
+      QByteArray body = request.mid(headerEnd + 4);
+      Json::Value root;
+      Json::Reader reader;
+      QString ottolID;
+      if (reader.parse(body.constData(), body.constData() + body.size(), root, false)
+          && root.isObject() && root["ottolID"].isString())
+        {
+        ottolID = QString::fromStdString(root["ottolID"].asString());
+        }
+      this->RequestedIDs << ottolID;
+
+      QByteArray content = ottolID == "1" ?
+        "{\n\"tree\" : \"(Homo_sapiens_ott2:1,Pan_ott3:2)Hominini_ott1\"\n}" :
+        "{\n\"message\" : \"Unknown ottolID\"\n}";
+      socket->write("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nConnection: close\r\n");
+      socket->write(QString("Content-Length: %1\r\n\r\n").arg(content.size()).toLatin1());
+      socket->write(content);
+      socket->waitForBytesWritten(10000);
+      socket->disconnectFromHost();
+      if (socket->state() != QAbstractSocket::UnconnectedState)
+        {
+        socket->waitForDisconnected(10000);
+        }
+      delete socket;
+      }
+    }
+
+  int Connections;
+  quint16 Port;
+  QSemaphore Ready;
+};
+
+// --------------------------------------------------------------------------
+void waitForFetch(voOpenTreeFetcher * fetcher)
+{
+  QEventLoop eventLoop;
+  QObject::connect(fetcher, SIGNAL(treeFetched(int,QString,int,QString)), &eventLoop, SLOT(quit()));
+  QObject::connect(fetcher, SIGNAL(fetchFailed(int,QString,int,QString)), &eventLoop, SLOT(quit()));
+  QTime timer;
+  timer.start();
+  // Wait for every download, or for the tree read from the cache
+  do
+    {
+    QTimer::singleShot(10000, &eventLoop, SLOT(quit()));
+    eventLoop.exec();
+    }
+  while (fetcher->pendingFetchCount() > 0 && timer.elapsed() < 10000);
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int voOpenTreeFetcherTest(int argc, char * argv [])
+{
+  QCoreApplication app(argc, argv);
+
+  //-----------------------------------------------------------------------------
+  // Test newickFromReply(const QByteArray& reply, QString * errorMessage)
+  //-----------------------------------------------------------------------------
+  QString newick = voOpenTreeFetcher::newickFromReply("{\n\"tree\" : \"(A,B)C\"\n}");
+  if (newick != "(A,B)C")
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with newickFromReply()\n"
+              << "\tCurrent:" << qPrintable(newick) << "\n"
+              << "\tExpected:(A,B)C" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (voOpenTreeFetcher::newickFromReply("{\"newick\": \"(A,\\\"B\\\")C;\"}") != "(A,\"B\")C;")
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with newickFromReply()\n"
+              << "\tEscaped characters should be decoded" << std::endl;
+    return EXIT_FAILURE;
+    }
+  QString errorMessage;
+  if (!voOpenTreeFetcher::newickFromReply("{\"message\": \"Unknown\"}", &errorMessage).isEmpty()
+      || errorMessage != "Unknown"
+      || !voOpenTreeFetcher::newickFromReply("tree").isEmpty())
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with newickFromReply()\n"
+              << "\tReplies without tree should be rejected" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //-----------------------------------------------------------------------------
+  // Test ottolIDFromLabel(const QString& label)
+  //-----------------------------------------------------------------------------
+  if (voOpenTreeFetcher::ottolIDFromLabel("Homo_sapiens_ott770315") != "770315"
+      || !voOpenTreeFetcher::ottolIDFromLabel("Homo_sapiens").isEmpty()
+      || !voOpenTreeFetcher::ottolIDFromLabel("ott770315_Homo").isEmpty())
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with ottolIDFromLabel()" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //-----------------------------------------------------------------------------
+  // Test fetch(const QString& hostURL, const QString& ottolID, int maxDepth)
+  //-----------------------------------------------------------------------------
+  QString cacheDirectory = QDir::temp().filePath("voOpenTreeFetcherTest");
+
+  // Only the first and the last fetch reach the server
+  voOpenTreeTestServer server(2);
+  QString hostURL = QString("http://127.0.0.1:%1/getDraftTreeForOttolID").arg(server.listen());
+
+  voOpenTreeFetcher fetcher;
+  fetcher.setCacheDirectory(cacheDirectory);
+  QFile cacheFile(fetcher.cacheFileName(hostURL, "1", 2));
+  cacheFile.remove();
+  if (fetcher.isCached(hostURL, "1", 2))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with isCached()"
+              << " - cache should be empty !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  int firstRequestId = fetcher.fetch(hostURL, "1", 2);
+  int secondRequestId = fetcher.fetch(hostURL, "1", 2); // Already being downloaded
+  if (fetcher.pendingFetchCount() != 1 || firstRequestId == secondRequestId)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with fetch()\n"
+              << "\tA subtree should be downloaded once for distinct requests" << std::endl;
+    return EXIT_FAILURE;
+    }
+  // The same subtree of another database is downloaded too, and fails
+  fetcher.fetch("http://127.0.0.1:1/getDraftTreeForOttolID", "1", 2);
+  if (fetcher.pendingFetchCount() != 2)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with fetch()\n"
+              << "\tSubtrees of distinct databases should be downloaded" << std::endl;
+    return EXIT_FAILURE;
+    }
+  waitForFetch(&fetcher);
+
+  if (fetcher.pendingFetchCount() != 0 || !fetcher.isCached(hostURL, "1", 2)
+      || !cacheFile.open(QIODevice::ReadOnly)
+      || cacheFile.readAll() != "(Homo_sapiens_ott2:1,Pan_ott3:2)Hominini_ott1")
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with fetch()\n"
+              << "\tThe tree should be downloaded and cached" << std::endl;
+    return EXIT_FAILURE;
+    }
+  cacheFile.close();
+
+  // Trees are cached for each database and expire
+  if (fetcher.isCached("http://127.0.0.1:1/getDraftTreeForOttolID", "1", 2))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with isCached()"
+              << " - trees of another database should not be cached !" << std::endl;
+    return EXIT_FAILURE;
+    }
+  fetcher.setMaximumCacheAge(-1);
+  if (fetcher.isCached(hostURL, "1", 2))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with isCached()"
+              << " - expired trees should not be cached !" << std::endl;
+    return EXIT_FAILURE;
+    }
+  fetcher.setMaximumCacheAge(3600);
+
+  // Read back from the cache by another fetcher
+  voOpenTreeFetcher cachedFetcher;
+  cachedFetcher.setCacheDirectory(cacheDirectory);
+  cachedFetcher.fetch(hostURL, "1", 2);
+  waitForFetch(&cachedFetcher);
+
+  fetcher.fetch(hostURL, "42", 2);
+  waitForFetch(&fetcher);
+  if (fetcher.pendingFetchCount() != 0 || fetcher.isCached(hostURL, "42", 2))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with fetch()\n"
+              << "\tReplies without tree should not be cached" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  server.wait();
+  if (server.RequestedIDs != (QStringList() << "1" << "42"))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with fetch()\n"
+              << "\tCurrent:" << qPrintable(server.RequestedIDs.join(",")) << "\n"
+              << "\tExpected:1,42" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  cacheFile.remove();
+  QDir().rmdir(QFileInfo(cacheFile).absolutePath());
+  QDir().rmdir(cacheDirectory);
+
+  return EXIT_SUCCESS;
+}
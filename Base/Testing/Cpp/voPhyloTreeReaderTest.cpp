@@ -0,0 +1,196 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+// Qt includes
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QStringList>
+
+// Visomics includes
+#include "voPhyloTreeReader.h"
+
+// VTK includes
+#include <vtkDataSetAttributes.h>
+#include <vtkDoubleArray.h>
+#include <vtkStringArray.h>
+#include <vtkTree.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+
+// --------------------------------------------------------------------------
+QString nodeName(vtkTree * tree, vtkIdType vertex)
+{
+  vtkStringArray * names = vtkStringArray::SafeDownCast(
+    tree->GetVertexData()->GetAbstractArray("node name"));
+  return names ? QString(names->GetValue(vertex).c_str()) : QString();
+}
+
+// --------------------------------------------------------------------------
+double nodeWeight(vtkTree * tree, vtkIdType vertex)
+{
+  vtkDoubleArray * weights = vtkDoubleArray::SafeDownCast(
+    tree->GetVertexData()->GetAbstractArray("node weight"));
+  return weights ? weights->GetValue(vertex) : -1.;
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int voPhyloTreeReaderTest(int argc, char * argv [])
+{
+  QCoreApplication app(argc, argv);
+
+  //-----------------------------------------------------------------------------
+  // Newick tree with branch lengths, quoted labels and comments
+  //-----------------------------------------------------------------------------
+  voPhyloTreeReader reader;
+  if (!reader.readData("((A:1,'B c':2)C:0.5[comment],D:3)root;"))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with readData(): "
+              << qPrintable(reader.errorString()) << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (reader.trees().size() != 1)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with trees()" << std::endl;
+    return EXIT_FAILURE;
+    }
+  vtkTree * tree = reader.trees().at(0);
+  // Vertices are numbered in pre-order
+  if (tree->GetNumberOfVertices() != 5 || tree->GetRoot() != 0
+      || nodeName(tree, 0) != "root" || nodeName(tree, 1) != "C"
+      || nodeName(tree, 2) != "A" || nodeName(tree, 3) != "B c" || nodeName(tree, 4) != "D"
+      || tree->GetParent(2) != 1 || tree->GetParent(4) != 0)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with the structure of the tree" << std::endl;
+    return EXIT_FAILURE;
+    }
+  vtkDoubleArray * edgeWeights = vtkDoubleArray::SafeDownCast(
+    tree->GetEdgeData()->GetAbstractArray("weight"));
+  if (!edgeWeights || edgeWeights->GetValue(tree->GetEdgeId(1, 3)) != 2.
+      || std::fabs(nodeWeight(tree, 3) - 2.5) > 1e-12 || nodeWeight(tree, 4) != 3.)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with the branch lengths" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //-----------------------------------------------------------------------------
+  // Forest in a file, parsed in parallel
+  //-----------------------------------------------------------------------------
+  QString forestFileName = QDir::temp().filePath("voPhyloTreeReaderTest.tre");
+  QFile forestFile(forestFileName);
+  if (!forestFile.open(QIODevice::WriteOnly))
+    {
+    std::cerr << "Line " << __LINE__ << " - Failed to write " << qPrintable(forestFileName) << std::endl;
+    return EXIT_FAILURE;
+    }
+  const int forestSize = 50;
+  for (int i = 0; i < forestSize; ++i)
+    {
+    forestFile.write(QString("(a%1,(b,c));\n").arg(i).toLatin1());
+    }
+  forestFile.close();
+  bool forestRead = reader.read(forestFileName);
+  QFile::remove(forestFileName);
+  if (!forestRead || reader.trees().size() != forestSize)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with read(): "
+              << qPrintable(reader.errorString()) << std::endl;
+    return EXIT_FAILURE;
+    }
+  for (int i = 0; i < forestSize; ++i)
+    {
+    vtkTree * forestTree = reader.trees().at(i);
+    if (forestTree->GetNumberOfVertices() != 5
+        || nodeName(forestTree, 1) != QString("a%1").arg(i)
+        || forestTree->GetVertexData()->GetAbstractArray("node weight"))
+      {
+      std::cerr << "Line " << __LINE__ << " - Problem with tree " << i << " of the forest" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  //-----------------------------------------------------------------------------
+  // NEXUS trees block
+  //-----------------------------------------------------------------------------
+  QByteArray nexus =
+    "#NEXUS\n"
+    "BEGIN TAXA;\n"
+    "  DIMENSIONS NTAX=3;\n"
+    "  TAXLABELS Homo Pan Gorilla;\n"
+    "END;\n"
+    "BEGIN TREES;\n"
+    "  TRANSLATE\n"
+    "    1 Homo,\n"
+    "    2 'Pan troglodytes',\n"
+    "    3 Gorilla;\n"
+    "  TREE first = [&R] ((1:1,2:1)95:1,3:2);\n"
+    "  TREE * 'second tree' = (3,(1,2));\n"
+    "END;\n";
+  if (!reader.readData(nexus) || reader.trees().size() != 2)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with readData(): "
+              << qPrintable(reader.errorString()) << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (reader.treeNames() != (QStringList() << "first" << "second tree"))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with treeNames()" << std::endl;
+    return EXIT_FAILURE;
+    }
+  tree = reader.trees().at(0);
+  // Labels of internal nodes are not translated
+  if (nodeName(tree, 1) != "95" || nodeName(tree, 2) != "Homo"
+      || nodeName(tree, 3) != "Pan troglodytes" || nodeName(tree, 4) != "Gorilla")
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with the TRANSLATE command" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //-----------------------------------------------------------------------------
+  // Errors
+  //-----------------------------------------------------------------------------
+  const char * invalidTrees[] = {"((A,B);", "(A,B));", "(A:x,B);", "", "#NEXUS\nBEGIN DATA;\nEND;\n"};
+  for (unsigned int i = 0; i < sizeof(invalidTrees) / sizeof(invalidTrees[0]); ++i)
+    {
+    if (reader.readData(invalidTrees[i]) || reader.errorString().isEmpty() || !reader.trees().isEmpty())
+      {
+      std::cerr << "Line " << __LINE__ << " - Problem with readData()"
+                << " - tree should be invalid: " << invalidTrees[i] << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  if (reader.read(QDir::temp().filePath("voPhyloTreeReaderTest-missing.tre")))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with read()"
+              << " - file should be missing" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
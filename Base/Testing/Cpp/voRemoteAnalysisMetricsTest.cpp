@@ -0,0 +1,125 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+// Visomics includes
+#include "voRemoteAnalysisMetrics.h"
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+// --------------------------------------------------------------------------
+voTrace::Event createEvent(const QString& category, double duration, qint64 bytes = -1)
+{
+  voTrace::Event event;
+  event.Category = category;
+  event.Name = "job";
+  event.Duration = duration;
+  event.Bytes = bytes;
+  return event;
+}
+
+// --------------------------------------------------------------------------
+bool fuzzyCompare(double value, double expected)
+{
+  return std::fabs(value - expected) < 1e-9;
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int voRemoteAnalysisMetricsTest(int /*argc*/, char * /*argv*/ [])
+{
+  QList<double> values;
+  values << 1 << 2 << 3 << 4 << 5;
+  if (!fuzzyCompare(voRemoteAnalysisMetrics::percentile(values, 50), 3)
+      || !fuzzyCompare(voRemoteAnalysisMetrics::percentile(values, 90), 4.6)
+      || !fuzzyCompare(voRemoteAnalysisMetrics::percentile(values, 0), 1)
+      || !fuzzyCompare(voRemoteAnalysisMetrics::percentile(values, 100), 5)
+      || !fuzzyCompare(voRemoteAnalysisMetrics::percentile(QList<double>(), 50), 0))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with percentile() !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  voRemoteAnalysisMetrics::clear();
+  for (int job = 1; job <= 10; ++job)
+    {
+    QList<voTrace::Event> events;
+    // Two inputs: serialize durations are summed up
+    events << createEvent("serialize", job, 512) << createEvent("serialize", job, 512)
+           << createEvent("upload", 10. * job, 1024) << createEvent("execute", 100.);
+    voRemoteAnalysisMetrics::addJob("PCA", events);
+    }
+  voRemoteAnalysisMetrics::addJob("Ignored", QList<voTrace::Event>());
+
+  if (voRemoteAnalysisMetrics::analysisNames() != QStringList("PCA"))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with analysisNames() !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  voRemoteAnalysisMetrics::Summary serialize = voRemoteAnalysisMetrics::summary("PCA", "serialize");
+  if (serialize.Count != 10 || !fuzzyCompare(serialize.Median, 11)
+      || !fuzzyCompare(serialize.Maximum, 20) || serialize.MeanBytes != 1024)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with summary() !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  voRemoteAnalysisMetrics::Summary upload = voRemoteAnalysisMetrics::summary("PCA", "upload");
+  // 10 KB in 550 ms
+  if (!fuzzyCompare(upload.Mean, 55) || !fuzzyCompare(upload.Throughput, 10240 / 0.55))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with summary() throughput !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  voRemoteAnalysisMetrics::Summary execute = voRemoteAnalysisMetrics::summary("PCA", "execute");
+  voRemoteAnalysisMetrics::Summary total = voRemoteAnalysisMetrics::summary("PCA", "total");
+  if (execute.MeanBytes != -1 || execute.Throughput != -1
+      || !fuzzyCompare(total.Maximum, 2 * 10 + 100 + 100)
+      || voRemoteAnalysisMetrics::summary("PCA", "download").Count != 0)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with summary() !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  voRemoteAnalysisMetrics::setMaximumSampleCount(4);
+  if (voRemoteAnalysisMetrics::summary("PCA", "execute").Count != 4
+      || !fuzzyCompare(voRemoteAnalysisMetrics::summary("PCA", "upload").Median, 85))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with setMaximumSampleCount() !" << std::endl;
+    return EXIT_FAILURE;
+    }
+  voRemoteAnalysisMetrics::setMaximumSampleCount(1000);
+
+  voRemoteAnalysisMetrics::clear();
+  if (!voRemoteAnalysisMetrics::analysisNames().isEmpty())
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with clear() !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,141 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+// Qt includes
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+
+// QtPropertyBrowser includes
+#include <QtVariantProperty>
+#include <QtVariantPropertyManager>
+
+// Visomics includes
+#include "voDataObject.h"
+#include "voTrace.h"
+
+// VTK includes
+#include <vtkNew.h>
+#include <vtkTable.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+// --------------------------------------------------------------------------
+QString propertyValue(voDataObject* dataObject, const QString& name)
+{
+  foreach(QtProperty* property, dataObject->variantPropertyManager()->properties())
+    {
+    QtVariantProperty* variantProperty = dynamic_cast<QtVariantProperty*>(property);
+    if (variantProperty && variantProperty->propertyName() == name)
+      {
+      return variantProperty->value().toString();
+      }
+    }
+  return QString();
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int voTraceTest(int argc, char * argv [])
+{
+  QCoreApplication app(argc, argv);
+
+  voTrace::clear();
+  vtkNew<vtkTable> table;
+  voDataObject dataObject("table", table.GetPointer());
+
+  {
+  voTrace::Scope importScope("import", "table.csv");
+  importScope.addBytes(2048);
+  importScope.addDataObject(&dataObject);
+    {
+    voTrace::Scope conversionScope("conversion", "vtkExtendedTable");
+    }
+  }
+
+  QList<voTrace::Event> events = voTrace::events();
+  if (events.size() != 2 ||
+      events.at(0).Category != "conversion" ||
+      events.at(1).Category != "import" ||
+      events.at(1).Bytes != 2048 ||
+      events.at(1).Duration < events.at(0).Duration)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with voTrace::Scope !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Timings of the nested scopes are recorded on the data object too
+  if (propertyValue(&dataObject, "Import time").isEmpty() ||
+      !propertyValue(&dataObject, "Import time").contains("2.0 KB") ||
+      propertyValue(&dataObject, "Conversion time").isEmpty())
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with voTrace::recordTiming() !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  double start = voTrace::now();
+  voTrace::Event event = voTrace::addEvent("upload", "analysis", start, 10);
+  if (event.Start != start || event.Duration < 0 || voTrace::events().size() != 3)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with voTrace::addEvent() !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if (voTrace::formatTiming(1500., 3 * 1024 * 1024) != "1.50 s (3.0 MB)" ||
+      voTrace::formatTiming(12.34) != "12.3 ms")
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with voTrace::formatTiming() !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  voTrace::setMaximumEventCount(2);
+  if (voTrace::events().size() != 2 || voTrace::events().at(1).Category != "upload")
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with setMaximumEventCount() !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  QString traceFileName = QDir::temp().filePath("voTraceTest.json");
+  if (!voTrace::exportChromeTrace(traceFileName))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with exportChromeTrace() !" << std::endl;
+    return EXIT_FAILURE;
+    }
+  QFile traceFile(traceFileName);
+  traceFile.open(QIODevice::ReadOnly);
+  QByteArray trace = traceFile.readAll();
+  traceFile.close();
+  QFile::remove(traceFileName);
+  if (!trace.contains("\"traceEvents\"") || !trace.contains("\"ph\":\"X\"")
+      || !trace.contains("\"cat\":\"upload\""))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with exportChromeTrace()"
+              << " - unexpected content: " << trace.constData() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  voTrace::clear();
+  return EXIT_SUCCESS;
+}
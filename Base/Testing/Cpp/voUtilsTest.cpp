@@ -19,6 +19,7 @@
 =========================================================================*/
 
 // Qt includes
+#include <QBitArray>
 #include <QCoreApplication>
 #include <QList>
 #include <QString>
@@ -31,6 +32,8 @@
 #include <vtkArray.h>
 #include <vtkDataSetAttributes.h>
 #include <vtkDoubleArray.h>
+#include <vtkFieldData.h>
+#include <vtkIdTypeArray.h>
 #include <vtkIntArray.h>
 #include <vtkMath.h>
 #include <vtkMutableDirectedGraph.h>
@@ -1515,6 +1518,170 @@ int voUtilsTest(int argc, char * argv [])
     }
 
 
+  //-----------------------------------------------------------------------------
+  // Test selectEmptyBranches(vtkTree * tree, vtkIdTypeArray * selection);
+  //-----------------------------------------------------------------------------
+  // root has two children a and b, a has two leaves c and d, b has two
+  // leaves e and f.
+  vtkNew<vtkMutableDirectedGraph> branchesGraph;
+  vtkIdType root = branchesGraph->AddVertex();
+  vtkIdType a = branchesGraph->AddChild(root);
+  vtkIdType b = branchesGraph->AddChild(root);
+  vtkIdType c = branchesGraph->AddChild(a);
+  vtkIdType d = branchesGraph->AddChild(a);
+  vtkIdType e = branchesGraph->AddChild(b);
+  vtkIdType f = branchesGraph->AddChild(b);
+  vtkNew<vtkTree> branchesTree;
+  if (!branchesTree->CheckedShallowCopy(branchesGraph.GetPointer()))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with CheckedShallowCopy()" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  vtkNew<vtkIdTypeArray> selection;
+  selection->InsertNextValue(c);
+  selection->InsertNextValue(d);
+  selection->InsertNextValue(e);
+  voUtils::selectEmptyBranches(branchesTree.GetPointer(), selection.GetPointer());
+  if (selection->GetNumberOfTuples() != 4 || selection->GetValue(3) != a)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with selectEmptyBranches()\n"
+              << "\tOnly the branch of 'a' should be selected" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  selection->InsertNextValue(f);
+  voUtils::selectEmptyBranches(branchesTree.GetPointer(), selection.GetPointer());
+  QList<vtkIdType> selectedVertices;
+  for (vtkIdType i = 0; i < selection->GetNumberOfTuples(); ++i)
+    {
+    selectedVertices << selection->GetValue(i);
+    }
+  if (selectedVertices.size() != 7 || !selectedVertices.contains(b) || !selectedVertices.contains(root))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with selectEmptyBranches()\n"
+              << "\tEvery vertex should be selected exactly once" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //-----------------------------------------------------------------------------
+  // Test removeTableRows(vtkTable * table, const QBitArray& keepRows);
+  //-----------------------------------------------------------------------------
+  vtkNew<vtkTable> removeRowsTable;
+  vtkNew<vtkStringArray> removeRowsNames;
+  vtkNew<vtkDoubleArray> removeRowsValues;
+  removeRowsNames->SetName("Name");
+  removeRowsValues->SetName("Value");
+  for (int i = 0; i < 5; ++i)
+    {
+    removeRowsNames->InsertNextValue(QString("tip%1").arg(i).toStdString());
+    removeRowsValues->InsertNextValue(i * 1.5);
+    }
+  removeRowsTable->AddColumn(removeRowsNames.GetPointer());
+  removeRowsTable->AddColumn(removeRowsValues.GetPointer());
+  vtkNew<vtkStringArray> removeRowsMetaData;
+  removeRowsMetaData->SetName("MetaData");
+  removeRowsMetaData->InsertNextValue("kept");
+  removeRowsTable->GetFieldData()->AddArray(removeRowsMetaData.GetPointer());
+
+  QBitArray keepRows(4, true);
+  keepRows.clearBit(0);
+  keepRows.clearBit(2);
+  if (!voUtils::removeTableRows(removeRowsTable.GetPointer(), keepRows))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with removeTableRows()" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Row 4 is past the end of keepRows and is kept
+  vtkStringArray * keptNames = vtkStringArray::SafeDownCast(removeRowsTable->GetColumnByName("Name"));
+  vtkDoubleArray * keptValues = vtkDoubleArray::SafeDownCast(removeRowsTable->GetColumnByName("Value"));
+  if (removeRowsTable->GetNumberOfRows() != 3 || !keptNames || !keptValues
+      || keptNames->GetValue(0) != "tip1" || keptNames->GetValue(1) != "tip3"
+      || keptNames->GetValue(2) != "tip4"
+      || keptValues->GetValue(0) != 1.5 || keptValues->GetValue(1) != 4.5
+      || keptValues->GetValue(2) != 6.0)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with removeTableRows()\n"
+              << "\tRows 1, 3 and 4 should be kept, in order" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (removeRowsTable->GetFieldData()->GetAbstractArray("MetaData") != removeRowsMetaData.GetPointer())
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with removeTableRows()\n"
+              << "\tField data should be kept" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //-----------------------------------------------------------------------------
+  // Test graftTree(vtkTree * tree, vtkIdType tip, vtkTree * subtree, vtkTree * output);
+  //-----------------------------------------------------------------------------
+  // (a:1,b:4)r where a is replaced by (x:2,y:3)s
+  vtkNew<vtkMutableDirectedGraph> graftGraph;
+  vtkNew<vtkStringArray> graftNames;
+  graftNames->SetName("node name");
+  vtkNew<vtkDoubleArray> graftWeights;
+  graftWeights->SetName("weight");
+  vtkIdType graftRoot = graftGraph->AddVertex();
+  vtkIdType graftTip = graftGraph->AddChild(graftRoot);
+  graftGraph->AddChild(graftRoot);
+  graftNames->InsertNextValue("r");
+  graftNames->InsertNextValue("a");
+  graftNames->InsertNextValue("b");
+  graftWeights->InsertNextValue(1.);
+  graftWeights->InsertNextValue(4.);
+  graftGraph->GetVertexData()->AddArray(graftNames.GetPointer());
+  graftGraph->GetEdgeData()->AddArray(graftWeights.GetPointer());
+  vtkNew<vtkTree> graftTree;
+  graftTree->CheckedShallowCopy(graftGraph.GetPointer());
+
+  vtkNew<vtkMutableDirectedGraph> subtreeGraph;
+  vtkNew<vtkStringArray> subtreeNames;
+  subtreeNames->SetName("node name");
+  vtkNew<vtkDoubleArray> subtreeWeights;
+  subtreeWeights->SetName("weight");
+  vtkIdType subtreeRoot = subtreeGraph->AddVertex();
+  subtreeGraph->AddChild(subtreeRoot);
+  subtreeGraph->AddChild(subtreeRoot);
+  subtreeNames->InsertNextValue("s");
+  subtreeNames->InsertNextValue("x");
+  subtreeNames->InsertNextValue("y");
+  subtreeWeights->InsertNextValue(2.);
+  subtreeWeights->InsertNextValue(3.);
+  subtreeGraph->GetVertexData()->AddArray(subtreeNames.GetPointer());
+  subtreeGraph->GetEdgeData()->AddArray(subtreeWeights.GetPointer());
+  vtkNew<vtkTree> subtree;
+  subtree->CheckedShallowCopy(subtreeGraph.GetPointer());
+
+  vtkNew<vtkTree> graftedTree;
+  if (voUtils::graftTree(graftTree.GetPointer(), graftRoot, subtree.GetPointer(), graftedTree.GetPointer()))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with graftTree()\n"
+              << "\tOnly leaves can be replaced" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (!voUtils::graftTree(graftTree.GetPointer(), graftTip, subtree.GetPointer(), graftedTree.GetPointer()))
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with graftTree()" << std::endl;
+    return EXIT_FAILURE;
+    }
+  vtkStringArray * graftedNames = vtkStringArray::SafeDownCast(
+    graftedTree->GetVertexData()->GetAbstractArray("node name"));
+  vtkDataArray * graftedNodeWeights = graftedTree->GetVertexData()->GetArray("node weight");
+  QStringList graftedOrder;
+  for (vtkIdType vertex = 0; graftedNames && vertex < graftedTree->GetNumberOfVertices(); ++vertex)
+    {
+    graftedOrder << QString(graftedNames->GetValue(vertex));
+    }
+  if (graftedOrder.join(",") != "r,a,x,y,b" || !graftedNodeWeights
+      || graftedNodeWeights->GetTuple1(3) != 4. || graftedNodeWeights->GetTuple1(4) != 4.)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with graftTree()\n"
+              << "\tCurrent:" << qPrintable(graftedOrder.join(",")) << "\n"
+              << "\tExpected:r,a,x,y,b" << std::endl;
+    return EXIT_FAILURE;
+    }
+
   //-----------------------------------------------------------------------------
   // Test cleanString(const QString& text);
   //-----------------------------------------------------------------------------
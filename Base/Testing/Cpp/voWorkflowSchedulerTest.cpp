@@ -0,0 +1,96 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+// Qt includes
+#include <QEventLoop>
+#include <QPointer>
+#include <QTimer>
+
+// Visomics includes
+#include "voApplication.h"
+#include "voDataModel.h"
+#include "voInputFileDataObject.h"
+#include "voWorkflowScheduler.h"
+
+// VTK includes
+#include <vtkMutableDirectedGraph.h>
+#include <vtkNew.h>
+#include <vtkTree.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+
+//-----------------------------------------------------------------------------
+int voWorkflowSchedulerTest(int argc, char * argv [])
+{
+  voApplication app(argc, argv, false);
+  bool exitWhenDone = false;
+  app.initialize(exitWhenDone);
+
+  vtkNew<vtkMutableDirectedGraph> builder;
+  vtkIdType root = builder->AddVertex();
+  builder->AddChild(root);
+  builder->AddChild(root);
+  vtkNew<vtkTree> tree;
+  if (!tree->CheckedShallowCopy(builder.GetPointer()))
+    {
+    std::cerr << "Line " << __LINE__ << " - Failed to create the input tree !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  voDataModel * model = app.dataModel();
+  model->clear();
+  model->setColumnCount(1);
+  model->addDataObject(new voInputFileDataObject("tree", tree.GetPointer()));
+
+  // OneZoom can't run in the background: each analysis of the chain is done
+  // before voAnalysisDriver::runAnalysis() returns.
+  QPointer<voWorkflowScheduler> scheduler = new voWorkflowScheduler(app.analysisDriver());
+  QHash<QString, QVariant> parameters;
+  scheduler->addAnalysis("third", "OneZoom Visualization", parameters,
+                         "One Zoom Visualization", "second", "newickTree");
+  scheduler->addAnalysis("first", "OneZoom Visualization", parameters, "tree");
+  scheduler->addAnalysis("second", "OneZoom Visualization", parameters,
+                         "One Zoom Visualization", "first", "newickTree");
+
+  // The scheduler deletes itself once finished
+  QEventLoop eventLoop;
+  QObject::connect(scheduler, SIGNAL(destroyed()), &eventLoop, SLOT(quit()));
+  QTimer::singleShot(10000, &eventLoop, SLOT(quit()));
+  scheduler->start();
+  eventLoop.exec();
+
+  if (!scheduler.isNull())
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with start()"
+              << " - scheduler should be finished !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if (model->analyses().size() != 3)
+    {
+    std::cerr << "Line " << __LINE__ << " - Problem with start() - "
+              << model->analyses().size() << " analyses run instead of 3 !" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
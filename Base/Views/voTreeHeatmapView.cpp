@@ -35,6 +35,7 @@
 
 // VTK includes
 #include <QVTKWidget.h>
+#include <vtkCallbackCommand.h>
 #include <vtkContextMouseEvent.h>
 #include <vtkContextScene.h>
 #include <vtkContextTransform.h>
@@ -42,6 +43,7 @@
 #include <vtkDataSetAttributes.h>
 #include <vtkDendrogramItem.h>
 #include <vtkGL2PSExporter.h>
+#include <vtkMatrix3x3.h>
 #include <vtkRenderer.h>
 #include <vtkRenderWindow.h>
 #include <vtkSmartPointer.h>
@@ -49,26 +51,164 @@
 #include <vtkTree.h>
 #include <vtkTreeHeatmapItem.h>
 
+// STD includes
+#include <cmath>
+
 // --------------------------------------------------------------------------
 class voTreeHeatmapViewPrivate
 {
 public:
+  typedef voTreeHeatmapViewPrivate Self;
   voTreeHeatmapViewPrivate();
+
+  /// Leaves drawn closer than that (in pixels) are collapsed
+  static const double MinimumLeafSpacing;
+
+  static vtkIdType numberOfLeaves(vtkTree * tree);
+  void resetLevelOfDetail();
+  void updateLevelOfDetail();
+  static void transformModifiedCallback(vtkObject *caller, unsigned long eid,
+                                        void *clientData, void * callData);
+
   vtkSmartPointer<vtkContextView>      ContextView;
   vtkSmartPointer<vtkTreeHeatmapItem>  TreeItem;
   vtkSmartPointer<vtkContextTransform> TransformItem;
+  vtkSmartPointer<vtkCallbackCommand>  TransformModifiedCallbackCommand;
   QVTKWidget*                          Widget;
   bool                                 DataAlreadyCentered;
+
+  /// Draws the tree in place of TreeItem when zoomed out. TreeItem is never
+  /// collapsed by the level of detail: its pruned tree holds the subtrees
+  /// collapsed by the user only, see voTreeDropTip.
+  vtkSmartPointer<vtkTreeHeatmapItem>  LevelOfDetailItem;
+  bool                                 LevelOfDetailEnabled;
+  /// Leaves are collapsed to 1/2^LevelOfDetail of the leaves of the pruned tree
+  int                                  LevelOfDetail;
+  vtkIdType                            NumberOfLeaves;
+  unsigned long                        PrunedTreeTime;
 };
 
 // --------------------------------------------------------------------------
 // voTreeHeatmapViewPrivate methods
 
+// --------------------------------------------------------------------------
+const double voTreeHeatmapViewPrivate::MinimumLeafSpacing = 2.0;
+
 // --------------------------------------------------------------------------
 voTreeHeatmapViewPrivate::voTreeHeatmapViewPrivate()
 {
   this->Widget = 0;
   this->DataAlreadyCentered = false;
+  this->LevelOfDetailEnabled = false;
+  this->LevelOfDetail = 0;
+  this->NumberOfLeaves = 0;
+  this->PrunedTreeTime = 0;
+  this->TransformModifiedCallbackCommand = vtkSmartPointer<vtkCallbackCommand>::New();
+  this->TransformModifiedCallbackCommand->SetClientData(reinterpret_cast<void*>(this));
+  this->TransformModifiedCallbackCommand->SetCallback(Self::transformModifiedCallback);
+}
+
+// --------------------------------------------------------------------------
+vtkIdType voTreeHeatmapViewPrivate::numberOfLeaves(vtkTree * tree)
+{
+  vtkIdType leafCount = 0;
+  for (vtkIdType vertex = 0; tree && vertex < tree->GetNumberOfVertices(); ++vertex)
+    {
+    if (tree->IsLeaf(vertex))
+      {
+      ++leafCount;
+      }
+    }
+  return leafCount;
+}
+
+// --------------------------------------------------------------------------
+void voTreeHeatmapViewPrivate::resetLevelOfDetail()
+{
+  // The tree, the table or their colors may have changed
+  this->PrunedTreeTime = 0;
+  this->updateLevelOfDetail();
+}
+
+// --------------------------------------------------------------------------
+void voTreeHeatmapViewPrivate::updateLevelOfDetail()
+{
+  if (!this->TreeItem || !this->LevelOfDetailItem || !this->TransformItem)
+    {
+    return;
+    }
+
+  vtkTree * tree = this->TreeItem->GetTree();
+  vtkTree * prunedTree = (tree && tree->GetNumberOfVertices() > 0) ?
+    this->TreeItem->GetDendrogram()->GetPrunedTree() : 0;
+  bool prunedTreeChanged = !prunedTree || prunedTree->GetMTime() != this->PrunedTreeTime;
+  if (prunedTreeChanged)
+    {
+    // Collapsing or expanding a subtree rebuilds the pruned tree
+    this->PrunedTreeTime = prunedTree ? prunedTree->GetMTime() : 0;
+    this->NumberOfLeaves = Self::numberOfLeaves(prunedTree);
+    }
+
+  int levelOfDetail = 0;
+  if (this->LevelOfDetailEnabled && this->NumberOfLeaves >= 2)
+    {
+    // Scale of the (uniform) zoom of the transform
+    vtkMatrix3x3 * matrix = this->TransformItem->GetTransform()->GetMatrix();
+    double scale = sqrt(fabs(matrix->GetElement(0, 0) * matrix->GetElement(1, 1)
+                             - matrix->GetElement(0, 1) * matrix->GetElement(1, 0)));
+    double leafSpacing = this->TreeItem->GetDendrogram()->GetLeafSpacing() * scale;
+    // Halve the number of leaves until they are far enough apart. Levels only
+    // change when the zoom doubles, which avoids collapsing the tree again
+    // at every step of the interaction.
+    while (leafSpacing > 0 && leafSpacing < Self::MinimumLeafSpacing
+           && (this->NumberOfLeaves >> (levelOfDetail + 1)) > 0)
+      {
+      leafSpacing *= 2.0;
+      ++levelOfDetail;
+      }
+    }
+  if (levelOfDetail == this->LevelOfDetail && (levelOfDetail == 0 || !prunedTreeChanged))
+    {
+    return;
+    }
+  this->LevelOfDetail = levelOfDetail;
+
+  // Subtrees collapsed by the user stay collapsed in the level of detail:
+  // it collapses a copy of the pruned tree of TreeItem.
+  this->TreeItem->SetVisible(levelOfDetail == 0);
+  this->TreeItem->SetInteractive(levelOfDetail == 0);
+  this->LevelOfDetailItem->SetVisible(levelOfDetail > 0);
+  if (levelOfDetail == 0)
+    {
+    return;
+    }
+  vtkSmartPointer<vtkTree> levelOfDetailTree = vtkSmartPointer<vtkTree>::New();
+  levelOfDetailTree->ShallowCopy(prunedTree);
+  this->LevelOfDetailItem->SetTree(levelOfDetailTree);
+  this->LevelOfDetailItem->SetTable(this->TreeItem->GetTable());
+  if (levelOfDetailTree->GetVertexData()->GetArray("differences"))
+    {
+    this->LevelOfDetailItem->GetDendrogram()->SetColorArray("differences");
+    this->LevelOfDetailItem->GetDendrogram()->SetLineWidth(2.0);
+    }
+  this->LevelOfDetailItem->CollapseToNumberOfLeaves(
+    static_cast<unsigned int>(this->NumberOfLeaves >> levelOfDetail));
+}
+
+// --------------------------------------------------------------------------
+void voTreeHeatmapViewPrivate::transformModifiedCallback(vtkObject *caller,
+                                                         unsigned long eid,
+                                                         void *clientData,
+                                                         void * callData)
+{
+  Q_UNUSED(caller);
+  Q_UNUSED(eid);
+  Q_UNUSED(callData);
+  Q_ASSERT(eid == vtkCommand::ModifiedEvent);
+  Q_ASSERT(clientData);
+  voTreeHeatmapViewPrivate * d =
+        reinterpret_cast<voTreeHeatmapViewPrivate*>(clientData);
+  d->updateLevelOfDetail();
 }
 
 // --------------------------------------------------------------------------
@@ -83,6 +223,12 @@ voTreeHeatmapView::voTreeHeatmapView(QWidget * newParent):
 // --------------------------------------------------------------------------
 voTreeHeatmapView::~voTreeHeatmapView()
 {
+  Q_D(voTreeHeatmapView);
+  // The scene may outlive the view
+  if (d->TransformItem)
+    {
+    d->TransformItem->GetTransform()->RemoveObserver(d->TransformModifiedCallbackCommand);
+    }
 }
 
 // --------------------------------------------------------------------------
@@ -105,7 +251,13 @@ void voTreeHeatmapView::setupUi(QLayout *layout)
   d->TreeItem = vtkSmartPointer<vtkTreeHeatmapItem>::New();
   d->TransformItem = vtkSmartPointer<vtkContextTransform>::New();
   d->TransformItem->AddItem(d->TreeItem);
+  d->LevelOfDetailItem = vtkSmartPointer<vtkTreeHeatmapItem>::New();
+  d->LevelOfDetailItem->SetVisible(false);
+  d->LevelOfDetailItem->SetInteractive(false);
+  d->TransformItem->AddItem(d->LevelOfDetailItem);
   d->TransformItem->SetInteractive(true);
+  d->TransformItem->GetTransform()->AddObserver(
+    vtkCommand::ModifiedEvent, d->TransformModifiedCallbackCommand);
   d->ContextView->GetScene()->AddItem(d->TransformItem);
 
   layout->addWidget(d->Widget);
@@ -136,9 +288,10 @@ void voTreeHeatmapView::setDataObjectListInternal(const QList<voDataObject*> dat
     if (d->TreeItem->GetTree()->GetNumberOfVertices() != Tree->GetNumberOfVertices())
       {
       // making a copy of the Tree so that the TreeHeatmap & Dendrogram no longer
-      // share a single input data source
-      vtkSmartPointer<vtkTree> treeCopy = vtkSmartPointer<vtkTree>::New();
-      treeCopy->DeepCopy(Tree);
+      // share a single input data source. The arrays are shared: the item
+      // only adds arrays to the tree.
+      vtkSmartPointer<vtkTree> treeCopy =
+        vtkTree::SafeDownCast(dataObjects[0]->sharedDataCopy());
       d->TreeItem->SetTree(treeCopy);
       }
     if (d->TreeItem->GetTable() != Table->GetInputData())
@@ -185,6 +338,7 @@ void voTreeHeatmapView::setDataObjectListInternal(const QList<voDataObject*> dat
     }
 
   this->colorTreeForDifference();
+  d->resetLevelOfDetail();
   d->ContextView->GetRenderWindow()->SetMultiSamples(0);
 }
 
@@ -205,6 +359,7 @@ void voTreeHeatmapView::setDataObjectInternal(const voDataObject& dataObject)
     d->TreeItem->SetTree(tree);
     }
   this->colorTreeForDifference();
+  d->resetLevelOfDetail();
   d->ContextView->GetRenderWindow()->SetMultiSamples(0);
 }
 
@@ -340,9 +495,40 @@ QList<QAction*> voTreeHeatmapView::actions()
           this, SLOT(onSaveScreenshotActionTriggered()));
   actionList << saveScreenshotAction;
 
+  QAction * levelOfDetailAction = new QAction("Level of detail", this);
+  levelOfDetailAction->setCheckable(true);
+  levelOfDetailAction->setChecked(this->isLevelOfDetailEnabled());
+  levelOfDetailAction->setToolTip("Collapse the subtrees too small to be seen at the current zoom.");
+  connect(levelOfDetailAction, SIGNAL(toggled(bool)),
+          this, SLOT(setLevelOfDetailEnabled(bool)));
+  actionList << levelOfDetailAction;
+
   return actionList;
 }
 
+// --------------------------------------------------------------------------
+bool voTreeHeatmapView::isLevelOfDetailEnabled()const
+{
+  Q_D(const voTreeHeatmapView);
+  return d->LevelOfDetailEnabled;
+}
+
+// --------------------------------------------------------------------------
+void voTreeHeatmapView::setLevelOfDetailEnabled(bool enabled)
+{
+  Q_D(voTreeHeatmapView);
+  if (d->LevelOfDetailEnabled == enabled)
+    {
+    return;
+    }
+  d->LevelOfDetailEnabled = enabled;
+  d->updateLevelOfDetail();
+  if (d->ContextView)
+    {
+    d->ContextView->Render();
+    }
+}
+
 // --------------------------------------------------------------------------
 void voTreeHeatmapView::onSaveScreenshotActionTriggered()
 {
@@ -43,6 +43,18 @@ public:
   virtual QList<QAction*> actions();
   virtual void saveScreenshot(const QString& fileName);
 
+  /// When enabled, subtrees whose leaves would be drawn less than a couple of
+  /// pixels apart are collapsed, and their heatmap rows hidden. The level of
+  /// detail is updated as the view is zoomed, so that the number of leaves
+  /// drawn depends on the size of the view rather than on the size of the
+  /// tree. Subtrees collapsed by the user are kept, and the tree is only
+  /// collapsed for display: getTreeHeatmapItem() is left untouched.
+  /// Disabled by default.
+  bool isLevelOfDetailEnabled()const;
+
+public slots:
+  void setLevelOfDetailEnabled(bool enabled);
+
 protected:
   void setupUi(QLayout * layout);
 
@@ -19,13 +19,21 @@
 =========================================================================*/
 
 // Qt includes
+#include <QAtomicInt>
 #include <QCryptographicHash>
 #include <QDebug>
 #include <QDir>
 #include <QExplicitlySharedDataPointer>
 #include <QFile>
 #include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QPair>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
 #include <QUuid>
+#include <QWaitCondition>
 
 // QtPropertyBrowser includes
 #include <QtVariantPropertyManager>
@@ -39,11 +47,13 @@
 #include "voDataObject.h"
 #include "voInputFileDataObject.h"
 #include "voIOManager.h"
+#include "voTrace.h"
 #include "voView.h"
 
 // VTK includes
 #include <vtkDataObject.h>
 #include <vtkExtendedTable.h>
+#include <vtkObject.h>
 #include <vtkSmartPointer.h>
 #include <vtkStringArray.h>
 #include <vtkTable.h>
@@ -63,6 +73,9 @@ public:
 
   void init();
 
+  /// Called from a worker thread by voAnalysisRunnable.
+  void executeInBackground();
+
   QString Uuid;
   voView* AnalysisView;
 
@@ -78,16 +91,53 @@ public:
   QHash<QString, QStringList> DynamicParameters;  // <parameter id, {label, type, [additional data]}>
   QHash<QString, QString> DynamicParameterValues;
 
+  // Intermediate results reused by execute() across runs
+  struct Stage
+    {
+    QStringList ParameterIds;
+    QByteArray Key;
+    vtkSmartPointer<vtkObject> Output;
+    };
+  QHash<QString, Stage> Stages;
+
+  /// Identify the inputs and the values of the parameters \a stageName depends on.
+  QByteArray stageKey(const QString& stageName)const;
+
+  /// Value of the parameter \a id, taken from the snapshot while running in
+  /// the background. Invalid if there is no such parameter.
+  QVariant parameterValue(const QString& id)const;
+  /// Copy the parameter values: the GUI may edit the properties while
+  /// execute() runs on a worker thread.
+  void snapshotParameters();
+
   bool OutputInformationInitialized;
   bool ParameterInformationInitialized;
 
   bool AcceptDefaultParameterValues;
 
-  bool AbortExecution;
+  QAtomicInt AbortExecution;
+
+  // Background execution. Output signals are delayed while executing so that
+  // they are emitted from the thread of the analysis.
+  bool RunningInBackground;
+  // Number of worker threads holding the analysis, from the submission to
+  // the end of executeInBackground(). Guarded by WorkerMutex.
+  int ActiveWorkers;
+  QMutex WorkerMutex;
+  QWaitCondition WorkerDone;
+  QStringList PendingOutputs;
+  QList<QPair<QString, QList<voDataObject*> > > PendingEnsembleOutputs;
+  QHash<QString, QVariant> ParameterSnapshot;
+  QHash<QString, QStringList> EnumNamesSnapshot;
 
   QString OutputDirectory;
   bool WriteOutputsToFilesEnabled;
 
+  // Time spent in the stages of the last run
+  double SubmitTime;
+  mutable QMutex TimingsMutex;
+  QList<voTrace::Event> Timings;
+
   QtVariantPropertyManager*          VariantManager;
 };
 
@@ -107,9 +157,12 @@ void voAnalysisPrivate::init()
   this->OutputInformationInitialized = false;
   this->ParameterInformationInitialized = false;
   this->AcceptDefaultParameterValues = false;
-  this->AbortExecution = false;
+  this->AbortExecution = 0;
+  this->RunningInBackground = false;
+  this->ActiveWorkers = 0;
   this->OutputDirectory = QLatin1String(".");
   this->WriteOutputsToFilesEnabled = false;
+  this->SubmitTime = 0.;
   this->VariantManager = new QtVariantPropertyManager(q);
   this->AnalysisView = NULL;
 }
@@ -119,6 +172,135 @@ voAnalysisPrivate::~voAnalysisPrivate()
 {
 }
 
+// --------------------------------------------------------------------------
+QByteArray voAnalysisPrivate::stageKey(const QString& stageName)const
+{
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  foreach(const QExplicitlySharedDataPointer<voDataObject>& input, this->InputDataObjects)
+    {
+    if (!input)
+      {
+      hash.addData("null", 4);
+      continue;
+      }
+    hash.addData(input->uuid().toLatin1());
+    // The data of an input may be modified in place, keeping its uuid
+    vtkDataObject * data = input->dataAsVTKDataObject();
+    hash.addData(QByteArray::number(data ? static_cast<qulonglong>(data->GetMTime()) : 0));
+    }
+  foreach(const QString& id, this->Stages.value(stageName).ParameterIds)
+    {
+    hash.addData(id.toUtf8());
+    hash.addData("=", 1);
+    QVariant value = this->parameterValue(id);
+    hash.addData(value.isValid() ? value.toString().toUtf8()
+                                 : this->DynamicParameterValues.value(id).toUtf8());
+    hash.addData("\n", 1);
+    }
+  return hash.result();
+}
+
+// --------------------------------------------------------------------------
+QVariant voAnalysisPrivate::parameterValue(const QString& id)const
+{
+  Q_Q(const voAnalysis);
+  if (this->ParameterSnapshot.contains(id))
+    {
+    return this->ParameterSnapshot.value(id);
+    }
+  QtVariantProperty * prop = q->parameter(id);
+  return prop ? prop->value() : QVariant();
+}
+
+// --------------------------------------------------------------------------
+void voAnalysisPrivate::snapshotParameters()
+{
+  this->ParameterSnapshot.clear();
+  this->EnumNamesSnapshot.clear();
+  foreach(QtProperty* prop, this->VariantManager->properties())
+    {
+    QtVariantProperty * variantProp = dynamic_cast<QtVariantProperty*>(prop);
+    if (!variantProp || variantProp->propertyId().isEmpty() ||
+        variantProp->propertyType() == QtVariantPropertyManager::groupTypeId())
+      {
+      continue;
+      }
+    this->ParameterSnapshot.insert(variantProp->propertyId(), variantProp->value());
+    if (variantProp->propertyType() == QtVariantPropertyManager::enumTypeId())
+      {
+      this->EnumNamesSnapshot.insert(variantProp->propertyId(),
+        variantProp->attributeValue(QLatin1String("enumNames")).toStringList());
+      }
+    }
+}
+
+// --------------------------------------------------------------------------
+void voAnalysisPrivate::executeInBackground()
+{
+  Q_Q(voAnalysis);
+  q->addTiming(voTrace::addEvent("queue wait", q->objectName(), this->SubmitTime));
+  int result = voAnalysis::FAILURE;
+  // Aborted while queued
+  if (!q->abortExecution())
+    {
+    double start = voTrace::now();
+    result = q->execute();
+    if (result != voAnalysis::PENDING)
+      {
+      q->addTiming(voTrace::addEvent("compute", q->objectName(), start));
+      }
+    }
+
+  // Outputs created on this thread are handed over to the thread of the analysis
+  QList<voDataObject*> dataObjects;
+  foreach(const QExplicitlySharedDataPointer<voDataObject>& dataObject, this->OutputDataObjects)
+    {
+    dataObjects << dataObject.data();
+    }
+  foreach(const QExplicitlySharedDataPointer<voDataObject>& dataObject, this->EnsembleOutputDataObjects)
+    {
+    dataObjects << dataObject.data();
+    }
+  for (int i = 0; i < this->PendingEnsembleOutputs.size(); ++i)
+    {
+    dataObjects << this->PendingEnsembleOutputs.at(i).second;
+    }
+  foreach(voDataObject * dataObject, dataObjects)
+    {
+    if (dataObject && dataObject->thread() == QThread::currentThread())
+      {
+      dataObject->moveToThread(q->thread());
+      }
+    }
+
+  QMetaObject::invokeMethod(q, "onBackgroundExecutionFinished",
+                            Qt::QueuedConnection, Q_ARG(int, result));
+
+  // Last access to the analysis from this thread
+  QMutexLocker locker(&this->WorkerMutex);
+  --this->ActiveWorkers;
+  this->WorkerDone.wakeAll();
+}
+
+// --------------------------------------------------------------------------
+// voAnalysisRunnable
+
+// --------------------------------------------------------------------------
+namespace
+{
+class voAnalysisRunnable : public QRunnable
+{
+public:
+  voAnalysisRunnable(voAnalysisPrivate * analysisPrivate) : AnalysisPrivate(analysisPrivate){}
+  virtual void run()
+    {
+    this->AnalysisPrivate->executeInBackground();
+    }
+private:
+  voAnalysisPrivate * AnalysisPrivate;
+};
+}
+
 // --------------------------------------------------------------------------
 // voAnalysis methods
 
@@ -132,6 +314,31 @@ voAnalysis::voAnalysis():d_ptr(new voAnalysisPrivate(*this))
 // --------------------------------------------------------------------------
 voAnalysis::~voAnalysis()
 {
+  Q_D(voAnalysis);
+  QMutexLocker locker(&d->WorkerMutex);
+  if (d->ActiveWorkers > 0)
+    {
+    qCritical() << "voAnalysis::~voAnalysis - Analysis deleted while running in the background,"
+                   " cancelAndWait() should have been called !";
+    locker.unlock();
+    this->cancelAndWait();
+    }
+}
+
+// --------------------------------------------------------------------------
+void voAnalysis::cancelAndWait()
+{
+  Q_D(voAnalysis);
+  QMutexLocker locker(&d->WorkerMutex);
+  if (d->ActiveWorkers == 0)
+    {
+    return;
+    }
+  this->setAbortExecution(true);
+  while (d->ActiveWorkers > 0)
+    {
+    d->WorkerDone.wait(&d->WorkerMutex);
+    }
 }
 
 // --------------------------------------------------------------------------
@@ -215,6 +422,7 @@ void voAnalysis::removeAllInputs()
 {
   Q_D(voAnalysis);
   d->InputDataObjects.clear();
+  this->removeAllStageOutputs();
 }
 
 
@@ -425,6 +633,11 @@ void voAnalysis::setEnsembleOutput(const QString& ensembleName, QList<voDataObje
 
   d->EnsembleOutputDataObjects.insert(ensembleName, QExplicitlySharedDataPointer<voDataObject>(ensembleDataObject));
 
+  if (d->RunningInBackground)
+    {
+    d->PendingEnsembleOutputs << qMakePair(ensembleName, ensembleDataObjectList);
+    return;
+    }
   emit this->ensembleOutputSet(ensembleName, ensembleDataObjectList, this);
 }
 
@@ -445,6 +658,11 @@ void voAnalysis::setOutput(const QString& outputName, voDataObject * dataObject)
     }
   d->OutputDataObjects.insert(outputName, QExplicitlySharedDataPointer<voDataObject>(dataObject));
 
+  if (d->RunningInBackground)
+    {
+    d->PendingOutputs << outputName;
+    return;
+    }
   emit this->outputSet(outputName, dataObject, this);
 }
 
@@ -593,20 +811,22 @@ void voAnalysis::removeAllOutputs()
   d->OutputViewPrettyName.clear();
   d->OutputRawViewPrettyName.clear();
   d->OutputInformationInitialized = false;
+  d->PendingOutputs.clear();
+  d->PendingEnsembleOutputs.clear();
 }
 
 // --------------------------------------------------------------------------
 bool voAnalysis::abortExecution()const
 {
   Q_D(const voAnalysis);
-  return d->AbortExecution;
+  return d->AbortExecution != 0;
 }
 
 // --------------------------------------------------------------------------
 void voAnalysis::setAbortExecution(bool abortExecutionValue)
 {
   Q_D(voAnalysis);
-  d->AbortExecution = abortExecutionValue;
+  d->AbortExecution.fetchAndStoreOrdered(abortExecutionValue ? 1 : 0);
 }
 
 // --------------------------------------------------------------------------
@@ -641,7 +861,14 @@ void voAnalysis::setWriteOutputsToFilesEnabled(bool enabled)
 bool voAnalysis::run()
 {
   Q_D(voAnalysis);
+  this->clearTimings();
+  double start = voTrace::now();
   int results = this->execute();
+  if (results != voAnalysis::PENDING)
+    {
+    // Pending analyses record the stages they go through
+    this->addTiming(voTrace::addEvent("compute", this->objectName(), start));
+    }
   if (results == voAnalysis::SUCCESS)
     {
     emit complete();
@@ -657,6 +884,85 @@ bool voAnalysis::run()
   return true;
 }
 
+// --------------------------------------------------------------------------
+bool voAnalysis::canRunInBackground()const
+{
+  return false;
+}
+
+// --------------------------------------------------------------------------
+void voAnalysis::runInBackground(QThreadPool* threadPool)
+{
+  Q_D(voAnalysis);
+  Q_ASSERT(threadPool);
+  if (d->RunningInBackground)
+    {
+    qWarning() << tr("voAnalysis::runInBackground [%1] - Analysis is already running !")
+                  .arg(this->metaObject()->className());
+    return;
+    }
+  d->RunningInBackground = true;
+  d->snapshotParameters();
+  this->clearTimings();
+  d->SubmitTime = voTrace::now();
+  {
+  QMutexLocker locker(&d->WorkerMutex);
+  ++d->ActiveWorkers;
+  }
+  threadPool->start(new voAnalysisRunnable(d));
+}
+
+// --------------------------------------------------------------------------
+bool voAnalysis::isRunningInBackground()const
+{
+  Q_D(const voAnalysis);
+  return d->RunningInBackground;
+}
+
+// --------------------------------------------------------------------------
+void voAnalysis::onBackgroundExecutionFinished(int result)
+{
+  Q_D(voAnalysis);
+  d->RunningInBackground = false;
+  d->ParameterSnapshot.clear();
+  d->EnumNamesSnapshot.clear();
+
+  // Emit the signals delayed while executing
+  QStringList pendingOutputs = d->PendingOutputs;
+  QList<QPair<QString, QList<voDataObject*> > > pendingEnsembleOutputs = d->PendingEnsembleOutputs;
+  d->PendingOutputs.clear();
+  d->PendingEnsembleOutputs.clear();
+  foreach(const QString& outputName, pendingOutputs)
+    {
+    emit this->outputSet(outputName, this->output(outputName), this);
+    }
+  for (int i = 0; i < pendingEnsembleOutputs.size(); ++i)
+    {
+    emit this->ensembleOutputSet(
+      pendingEnsembleOutputs.at(i).first, pendingEnsembleOutputs.at(i).second, this);
+    }
+
+  if (result == voAnalysis::SUCCESS)
+    {
+    emit complete();
+    if (d->WriteOutputsToFilesEnabled)
+      {
+      this->writeOutputsToFiles(d->OutputDirectory);
+      }
+    }
+  else if (result == voAnalysis::FAILURE)
+    {
+    if (this->abortExecution())
+      {
+      // Cancelled by the user: no message
+      emit error(QString());
+      return;
+      }
+    qCritical() << "Analysis failed to run " << this->objectName();
+    emit error(tr("Analysis %1 failed to run.").arg(this->objectName()));
+    }
+}
+
 // --------------------------------------------------------------------------
 int voAnalysis::execute()
 {
@@ -799,6 +1105,46 @@ QString voAnalysis::parameterDescription()const
   return QString();
 }
 
+// --------------------------------------------------------------------------
+QByteArray voAnalysis::parametersHash()const
+{
+  Q_D(const voAnalysis);
+  // QMap keeps the values sorted by parameter id
+  QMap<QString, QString> values;
+  foreach(QtProperty* prop, d->VariantManager->properties())
+    {
+    QtVariantProperty * variantProp = dynamic_cast<QtVariantProperty*>(prop);
+    if (!variantProp ||
+        variantProp->propertyType() == QtVariantPropertyManager::groupTypeId())
+      {
+      continue;
+      }
+    values.insert(variantProp->propertyId(),
+                  QString::number(variantProp->propertyType()) + ":" + variantProp->value().toString());
+    }
+  foreach(const QString& label, d->DynamicParameterValues.keys())
+    {
+    values.insert("dynamic:" + label, d->DynamicParameterValues.value(label));
+    }
+
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  QMap<QString, QString>::const_iterator it;
+  for (it = values.constBegin(); it != values.constEnd(); ++it)
+    {
+    hash.addData(it.key().toUtf8());
+    hash.addData("=", 1);
+    hash.addData(it.value().toUtf8());
+    hash.addData("\n", 1);
+    }
+  return hash.result().toHex();
+}
+
+// --------------------------------------------------------------------------
+bool voAnalysis::canCacheResults()const
+{
+  return true;
+}
+
 // --------------------------------------------------------------------------
 void voAnalysis::addParameterGroup(const QString& label, const QList<QtProperty*> parameters)
 {
@@ -813,6 +1159,95 @@ void voAnalysis::addParameterGroup(const QString& label, const QList<QtProperty*
     }
 }
 
+// --------------------------------------------------------------------------
+QList<voTrace::Event> voAnalysis::timings()const
+{
+  Q_D(const voAnalysis);
+  QMutexLocker locker(&d->TimingsMutex);
+  return d->Timings;
+}
+
+// --------------------------------------------------------------------------
+void voAnalysis::addTiming(const voTrace::Event& event)
+{
+  Q_D(voAnalysis);
+  QMutexLocker locker(&d->TimingsMutex);
+  d->Timings << event;
+}
+
+// --------------------------------------------------------------------------
+void voAnalysis::clearTimings()
+{
+  Q_D(voAnalysis);
+  QMutexLocker locker(&d->TimingsMutex);
+  d->Timings.clear();
+}
+
+// --------------------------------------------------------------------------
+QStringList voAnalysis::stageNames()const
+{
+  Q_D(const voAnalysis);
+  return d->Stages.keys();
+}
+
+// --------------------------------------------------------------------------
+bool voAnalysis::hasStageOutput(const QString& stageName)const
+{
+  return this->stageOutput(stageName) != 0;
+}
+
+// --------------------------------------------------------------------------
+void voAnalysis::removeAllStageOutputs()
+{
+  Q_D(voAnalysis);
+  QHash<QString, voAnalysisPrivate::Stage>::iterator it;
+  for (it = d->Stages.begin(); it != d->Stages.end(); ++it)
+    {
+    it->Key.clear();
+    it->Output = 0;
+    }
+}
+
+// --------------------------------------------------------------------------
+void voAnalysis::addStage(const QString& stageName, const QStringList& parameterIds)
+{
+  Q_D(voAnalysis);
+  voAnalysisPrivate::Stage stage;
+  stage.ParameterIds = parameterIds;
+  d->Stages.insert(stageName, stage);
+}
+
+// --------------------------------------------------------------------------
+vtkObject* voAnalysis::stageOutput(const QString& stageName)const
+{
+  Q_D(const voAnalysis);
+  if (!d->Stages.contains(stageName))
+    {
+    return 0;
+    }
+  voAnalysisPrivate::Stage stage = d->Stages.value(stageName);
+  if (!stage.Output || stage.Key != d->stageKey(stageName))
+    {
+    return 0;
+    }
+  return stage.Output;
+}
+
+// --------------------------------------------------------------------------
+void voAnalysis::setStageOutput(const QString& stageName, vtkObject* output)
+{
+  Q_D(voAnalysis);
+  if (!d->Stages.contains(stageName))
+    {
+    qWarning() << tr("voAnalysis::setStageOutput [%1] - Unknown stage [%2] !")
+                  .arg(this->metaObject()->className()).arg(stageName);
+    return;
+    }
+  voAnalysisPrivate::Stage& stage = d->Stages[stageName];
+  stage.Key = d->stageKey(stageName);
+  stage.Output = output;
+}
+
 // --------------------------------------------------------------------------
 QtVariantProperty* voAnalysis::parameter(const QString& id)const
 {
@@ -830,13 +1265,21 @@ QString voAnalysis::dynamicParameter(const QString& label)const
 // --------------------------------------------------------------------------
 QString voAnalysis::enumParameter(const QString& id)const
 {
-  QtVariantProperty * prop = this->parameter(id);
-  Q_ASSERT(prop);
-
-  QStringList choices = prop->attributeValue(QLatin1String("enumNames")).toStringList();
+  Q_D(const voAnalysis);
+  QStringList choices;
+  if (d->EnumNamesSnapshot.contains(id))
+    {
+    choices = d->EnumNamesSnapshot.value(id);
+    }
+  else
+    {
+    QtVariantProperty * prop = this->parameter(id);
+    Q_ASSERT(prop);
+    choices = prop->attributeValue(QLatin1String("enumNames")).toStringList();
+    }
   Q_ASSERT(choices.count() > 0);
 
-  return choices.at(prop->value().toInt());
+  return choices.at(d->parameterValue(id).toInt());
 }
 
 // --------------------------------------------------------------------------
@@ -897,9 +1340,10 @@ QtVariantProperty* voAnalysis::updateEnumParameter(const QString& id,
 // --------------------------------------------------------------------------
 QString voAnalysis::stringParameter(const QString& id)const
 {
-  QtVariantProperty * prop = this->parameter(id);
-  Q_ASSERT(prop);
-  return prop->value().toString();
+  Q_D(const voAnalysis);
+  QVariant value = d->parameterValue(id);
+  Q_ASSERT(value.isValid());
+  return value.toString();
 }
 
 // --------------------------------------------------------------------------
@@ -968,9 +1412,10 @@ void voAnalysis::addColumnParameter(const QString &id, const QString& label,
 // --------------------------------------------------------------------------
 int voAnalysis::integerParameter(const QString& id)const
 {
-  QtVariantProperty * prop = this->parameter(id);
-  Q_ASSERT(prop);
-  return prop->value().toInt();
+  Q_D(const voAnalysis);
+  QVariant value = d->parameterValue(id);
+  Q_ASSERT(value.isValid());
+  return value.toInt();
 }
 
 // --------------------------------------------------------------------------
@@ -996,9 +1441,10 @@ QtVariantProperty*  voAnalysis::addIntegerParameter(const QString& id, const QSt
 // --------------------------------------------------------------------------
 double voAnalysis::doubleParameter(const QString& id)const
 {
-  QtVariantProperty * prop = this->parameter(id);
-  Q_ASSERT(prop);
-  return prop->value().toDouble();
+  Q_D(const voAnalysis);
+  QVariant value = d->parameterValue(id);
+  Q_ASSERT(value.isValid());
+  return value.toDouble();
 }
 
 // --------------------------------------------------------------------------
@@ -1026,9 +1472,10 @@ QtVariantProperty*  voAnalysis::addDoubleParameter(const QString& id, const QStr
 // --------------------------------------------------------------------------
 bool voAnalysis::booleanParameter(const QString& id)const
 {
-  QtVariantProperty * prop = this->parameter(id);
-  Q_ASSERT(prop);
-  return prop->value().toBool();
+  Q_D(const voAnalysis);
+  QVariant value = d->parameterValue(id);
+  Q_ASSERT(value.isValid());
+  return value.toBool();
 }
 
 // --------------------------------------------------------------------------
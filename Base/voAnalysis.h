@@ -28,9 +28,13 @@
 #include <QStringList>
 #include <QVariant>
 
+// Visomics includes
+#include "voTrace.h"
+
 // VTK includes
 #include <vtkSmartPointer.h>
 
+class QThreadPool;
 class QtProperty;
 class QtVariantPropertyManager;
 class QtVariantProperty;
@@ -38,6 +42,7 @@ class voAnalysisPrivate;
 class voDataObject;
 class vtkDataObject;
 class vtkExtendedTable;
+class vtkObject;
 class voView;
 class vtkTree;
 
@@ -120,6 +125,25 @@ public:
 
   bool run();
 
+  /// Return true if execute() can safely be called from a worker thread.
+  /// Analyses reading from views or other GUI objects should return false.
+  virtual bool canRunInBackground()const;
+
+  /// Call execute() on a thread of \a threadPool and return immediately.
+  /// complete() or error() is emitted from the thread of the analysis once
+  /// done. Outputs set while executing are moved to the thread of the analysis
+  /// and the corresponding signals are delayed until then.
+  void runInBackground(QThreadPool* threadPool);
+
+  /// Return true while execute() is running on a worker thread.
+  bool isRunningInBackground()const;
+
+  /// Abort the background execution and wait for the worker thread to be
+  /// done with the analysis. Owners must call it before deleting an analysis
+  /// that may run in the background: the worker calls the virtual execute(),
+  /// and the derived parts are gone by the time ~voAnalysis() runs.
+  void cancelAndWait();
+
   void initializeOutputInformation();
 
   void writeOutputsToFiles(const QString& directory = QLatin1String(".")) const;
@@ -145,6 +169,31 @@ public:
 
   virtual QString parameterDescription()const;
 
+  /// Hash of the parameter values. It doesn't depend on the order in which
+  /// the parameters were added. Analyses whose outputs depend on other
+  /// settings, like a script, add them to the hash.
+  virtual QByteArray parametersHash()const;
+
+  /// Return false if the outputs depend on more than the inputs and the
+  /// parameters (e.g. the state of a view) and shouldn't be cached.
+  virtual bool canCacheResults()const;
+
+  /// Time spent in the stages of the last run: queue wait and compute,
+  /// or upload, queue wait and download for remote analyses.
+  QList<voTrace::Event> timings()const;
+  void addTiming(const voTrace::Event& event);
+  void clearTimings();
+
+  /// Names of the intermediate stages declared with addStage().
+  QStringList stageNames()const;
+
+  /// Return true if the output of \a stageName is up to date with the
+  /// current inputs and parameter values.
+  bool hasStageOutput(const QString& stageName)const;
+
+  /// Forget the stage outputs. Stages are kept.
+  void removeAllStageOutputs();
+
   vtkSmartPointer<vtkExtendedTable> getInputTable() const;
   vtkSmartPointer<vtkExtendedTable> getInputTable(int i) const;
 
@@ -175,6 +224,16 @@ protected:
 
   void addParameterGroup(const QString& label, const QList<QtProperty*> parameters);
 
+  /// Declare an intermediate result of execute() that only depends on the
+  /// inputs and on the parameters \a parameterIds. Stage outputs are kept
+  /// across runs and reused as long as these parameters don't change.
+  void addStage(const QString& stageName, const QStringList& parameterIds = QStringList());
+
+  /// Return the output of \a stageName if it was computed with the current
+  /// inputs and parameter values, 0 otherwise. The output must not be modified.
+  vtkObject* stageOutput(const QString& stageName)const;
+  void setStageOutput(const QString& stageName, vtkObject* output);
+
   QtVariantProperty* parameter(const QString& id)const;
   QString dynamicParameter(const QString& label)const;
 
@@ -217,6 +276,9 @@ protected:
 private:
   Q_DECLARE_PRIVATE(voAnalysis);
   Q_DISABLE_COPY(voAnalysis);
+
+private slots:
+  void onBackgroundExecutionFinished(int result);
 };
 
 #endif
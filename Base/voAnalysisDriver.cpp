@@ -19,14 +19,22 @@
 =========================================================================*/
 
 // Qt includes
+#include <QCoreApplication>
+#include <QDir>
 #include <QFile>
 #include <QHash>
+#include <QSet>
 #include <QSharedPointer>
 #include <QDebug>
 #include <QMainWindow>
+#include <QPointer>
 #include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
 #include <QXmlStreamReader>
+#include <QtGui/QDesktopServices>
 #include <QtGui/QMessageBox>
+#include <QtCore/QSettings>
 #include <QtCore/QUrl>
 
 // QtPropertyBrowser includes
@@ -36,12 +44,79 @@
 #include "voAnalysis.h"
 #include "voAnalysisDriver.h"
 #include "voAnalysisFactory.h"
+#include "voAnalysisResultCache.h"
 #include "voApplication.h"
 #include "voCustomAnalysisInformation.h"
 #include "voDataModelItem.h"
 #include "voDataObject.h"
 #include "voViewManager.h"
+#include "voRemoteAnalysisClient.h"
 #include "voRemoteCustomAnalysis.h"
+#include "voTrace.h"
+
+namespace
+{
+// --------------------------------------------------------------------------
+// Split \a text on \a separator, except within double quotes. Parts are
+// trimmed and kept quoted. \a ok is false if a quote is not terminated.
+QStringList splitParameterGrid(const QString& text, QChar separator, bool& ok)
+{
+  QStringList parts;
+  QString part;
+  bool quoted = false;
+  for (int i = 0; i < text.size(); ++i)
+    {
+    QChar c = text.at(i);
+    if (quoted && c == '\\' && i + 1 < text.size())
+      {
+      part += c;
+      part += text.at(++i);
+      continue;
+      }
+    if (c == '"')
+      {
+      quoted = !quoted;
+      }
+    if (c == separator && !quoted)
+      {
+      if (!part.trimmed().isEmpty())
+        {
+        parts << part.trimmed();
+        }
+      part.clear();
+      continue;
+      }
+    part += c;
+    }
+  if (!part.trimmed().isEmpty())
+    {
+    parts << part.trimmed();
+    }
+  ok = !quoted;
+  return parts;
+}
+
+// --------------------------------------------------------------------------
+// Remove the quotes and escapes added by voAnalysisDriver::quoteParameterGridValue()
+QString unquoteParameterGridValue(const QString& value)
+{
+  if (value.size() < 2 || !value.startsWith('"') || !value.endsWith('"'))
+    {
+    return value;
+    }
+  QString unquoted;
+  for (int i = 1; i < value.size() - 1; ++i)
+    {
+    if (value.at(i) == '\\' && i + 2 < value.size())
+      {
+      ++i;
+      }
+    unquoted += value.at(i);
+    }
+  return unquoted;
+}
+
+} // end of anonymous namespace
 
 
 // --------------------------------------------------------------------------
@@ -52,6 +127,15 @@ public:
   virtual ~voAnalysisDriverPrivate();
 
   QUrl remoteAnalysisUrl;
+  voRemoteAnalysisClient* RemoteAnalysisClient;
+  QThreadPool* AnalysisThreadPool;
+  QScopedPointer<voAnalysisResultCache> ResultCache;
+  QHash<voAnalysis*, QString> ResultCacheKeys; // Keys of the running analyses
+  // Running analyses that set an override cursor, restored once they are done
+  QSet<voAnalysis*> OverrideCursorAnalyses;
+
+  void setOverrideCursor(voAnalysis * analysis, const QCursor& cursor);
+  void restoreOverrideCursor(voAnalysis * analysis);
 };
 
 // --------------------------------------------------------------------------
@@ -60,6 +144,29 @@ public:
 // --------------------------------------------------------------------------
 voAnalysisDriverPrivate::voAnalysisDriverPrivate()
 {
+  this->RemoteAnalysisClient = 0;
+  this->AnalysisThreadPool = 0;
+}
+
+// --------------------------------------------------------------------------
+void voAnalysisDriverPrivate::setOverrideCursor(voAnalysis * analysis, const QCursor& cursor)
+{
+  if (this->OverrideCursorAnalyses.contains(analysis))
+    {
+    return;
+    }
+  this->OverrideCursorAnalyses.insert(analysis);
+  QApplication::setOverrideCursor(cursor);
+}
+
+// --------------------------------------------------------------------------
+void voAnalysisDriverPrivate::restoreOverrideCursor(voAnalysis * analysis)
+{
+  // Analyses restored from the cache or run synchronously set no cursor
+  if (this->OverrideCursorAnalyses.remove(analysis))
+    {
+    QApplication::restoreOverrideCursor();
+    }
 }
 
 // --------------------------------------------------------------------------
@@ -74,12 +181,50 @@ voAnalysisDriverPrivate::~voAnalysisDriverPrivate()
 voAnalysisDriver::voAnalysisDriver(QObject* newParent):
     Superclass(newParent), d_ptr(new voAnalysisDriverPrivate)
 {
+  Q_D(voAnalysisDriver);
+
+  // All remote analyses share the same connections to the server
+  d->RemoteAnalysisClient = new voRemoteAnalysisClient(this);
+  QSettings settings("Kitware", "Visomics");
+  d->RemoteAnalysisClient->setMaximumConcurrentRequests(
+    settings.value("maximumConcurrentRemoteRequests", 16).toInt());
+  d->RemoteAnalysisClient->setMaximumPreparedInputCost(
+    settings.value("remoteInputCacheMaximumMemoryCost",
+                   d->RemoteAnalysisClient->maximumPreparedInputCost()).toInt());
+  // Payloads are not reused across sessions: each session has its own directory
+  QString preparedInputDirectory = settings.value("remoteInputCacheDirectory",
+    QDir::temp().filePath("VisomicsRemoteInputs")).toString();
+  d->RemoteAnalysisClient->setPreparedInputDirectory(QDir(preparedInputDirectory).filePath(
+    QString::number(QCoreApplication::applicationPid())));
+  d->RemoteAnalysisClient->setMaximumPreparedInputDiskSize(
+    settings.value("remoteInputCacheMaximumDiskSize",
+                   d->RemoteAnalysisClient->maximumPreparedInputDiskSize()).toLongLong());
+
+  // Native analyses run on worker threads to keep the interface responsive
+  d->AnalysisThreadPool = new QThreadPool(this);
+  d->AnalysisThreadPool->setMaxThreadCount(
+    settings.value("maximumConcurrentAnalyses", QThread::idealThreadCount()).toInt());
+
+  d->ResultCache.reset(new voAnalysisResultCache);
+  d->ResultCache->setDirectory(settings.value("analysisResultCacheDirectory",
+    QDesktopServices::storageLocation(QDesktopServices::CacheLocation) + "/AnalysisResults").toString());
+  d->ResultCache->setMaximumMemoryCost(
+    settings.value("analysisResultCacheMaximumMemoryCost", d->ResultCache->maximumMemoryCost()).toInt());
+  d->ResultCache->setMaximumDiskSize(
+    settings.value("analysisResultCacheMaximumDiskSize", d->ResultCache->maximumDiskSize()).toLongLong());
+
   analysisNameToInputTypes.insert(
     "OneZoom Visualization", QStringList() << "vtkTree");
   analysisNameToInputTypes.insert(
     "Tree Drop Tip", QStringList() << "vtkTree");
   analysisNameToInputTypes.insert(
     "Tree Drop Tip With Data", QStringList() << "vtkTree" << "vtkExtendedTable");
+  analysisNameToInputTypes.insert(
+    "Tree Comparison", QStringList() << "vtkTree" << "vtkTree");
+  analysisNameToInputTypes.insert(
+    "Tree Model Fitting", QStringList() << "vtkTree" << "vtkExtendedTable");
+  // A reference tree is compared to any number of trees
+  analysisNamesWithRepeatedLastInput.insert("Tree Comparison");
 }
 
 // --------------------------------------------------------------------------
@@ -87,6 +232,27 @@ voAnalysisDriver::~voAnalysisDriver()
 {
 }
 
+// --------------------------------------------------------------------------
+voRemoteAnalysisClient* voAnalysisDriver::remoteAnalysisClient()const
+{
+  Q_D(const voAnalysisDriver);
+  return d->RemoteAnalysisClient;
+}
+
+// --------------------------------------------------------------------------
+QThreadPool* voAnalysisDriver::analysisThreadPool()const
+{
+  Q_D(const voAnalysisDriver);
+  return d->AnalysisThreadPool;
+}
+
+// --------------------------------------------------------------------------
+voAnalysisResultCache* voAnalysisDriver::analysisResultCache()const
+{
+  Q_D(const voAnalysisDriver);
+  return d->ResultCache.data();
+}
+
 // --------------------------------------------------------------------------
 void voAnalysisDriver::runAnalysisForAllInputs(const QString& analysisName, bool acceptDefaultParameter)
 {
@@ -143,53 +309,272 @@ void voAnalysisDriver::runAnalysis(const QString& analysisName,
 }
 
 // --------------------------------------------------------------------------
-void voAnalysisDriver::runAnalysis(const QString& analysisName,
-                                   QList<voDataModelItem*> inputTargets,
-                                   const QHash<QString, QVariant>& parameters)
+voAnalysis* voAnalysisDriver::runAnalysis(const QString& analysisName,
+                                          QList<voDataModelItem*> inputTargets,
+                                          const QHash<QString, QVariant>& parameters)
 {
   if (inputTargets.empty())
     {
     qWarning() << "Failed to runAnalysis - InputTargets is empty";
-    return;
+    return 0;
     }
-  voAnalysis * analysis = this->createAnalysis(analysisName);
+  voAnalysis * analysis = this->createAnalysis(analysisName, parameters);
   if (!analysis)
     {
-    return;
+    return 0;
+    }
+  if (!this->runAnalysis(analysis, inputTargets))
+    {
+    analysis->deleteLater();
+    return 0;
     }
+  return analysis;
+}
 
+// --------------------------------------------------------------------------
+voAnalysis* voAnalysisDriver::createAnalysis(const QString& analysisName,
+                                             const QHash<QString, QVariant>& parameters)
+{
+  voAnalysis * analysis = this->createAnalysis(analysisName);
+  if (!analysis)
+    {
+    return 0;
+    }
   analysis->initializeParameterInformation();
   analysis->updateDynamicParameters();
   analysis->setParameterValues(parameters);
   analysis->setAcceptDefaultParameterValues(true);
-  this->runAnalysis(analysis, inputTargets);
+  return analysis;
+}
+
+// --------------------------------------------------------------------------
+void voAnalysisDriver::runAnalysisSweep(const QString& analysisName,
+                                        QList<voDataModelItem*> inputTargets,
+                                        const QHash<QString, QVariantList>& parameterGrid)
+{
+  if (inputTargets.empty())
+    {
+    qWarning() << "Failed to runAnalysisSweep - InputTargets is empty";
+    return;
+    }
+
+  // Cartesian product of the parameter values. Parameters are iterated in a
+  // fixed order so that the runs are always listed the same way.
+  QStringList parameterIds = parameterGrid.keys();
+  parameterIds.sort();
+  QList<QHash<QString, QVariant> > combinations;
+  combinations << QHash<QString, QVariant>();
+  foreach(const QString& id, parameterIds)
+    {
+    QList<QHash<QString, QVariant> > expandedCombinations;
+    foreach(const QHash<QString, QVariant>& combination, combinations)
+      {
+      foreach(const QVariant& value, parameterGrid.value(id))
+        {
+        QHash<QString, QVariant> expandedCombination = combination;
+        expandedCombination.insert(id, value);
+        expandedCombinations << expandedCombination;
+        }
+      }
+    combinations = expandedCombinations;
+    }
+  if (combinations.isEmpty() || parameterIds.isEmpty())
+    {
+    qWarning() << "Failed to runAnalysisSweep - Parameter grid is empty";
+    return;
+    }
+
+  // All the runs of the sweep are grouped under the same container
+  voDataModel * model = voApplication::application()->dataModel();
+  voDataModelItem * sweepContainer =
+    model->addContainer(model->getNextName(tr("Sweep %1").arg(analysisName)), inputTargets.at(0));
+
+  // Runs are all scheduled at once: native analyses are spread over the
+  // thread pool and remote ones are queued by the shared client, which also
+  // shares the serialized inputs between the jobs.
+  foreach(const QHash<QString, QVariant>& combination, combinations)
+    {
+    voAnalysis * analysis = this->createAnalysis(analysisName);
+    if (!analysis)
+      {
+      return;
+      }
+    analysis->initializeParameterInformation();
+    analysis->updateDynamicParameters();
+    analysis->setParameterValues(combination);
+    analysis->setAcceptDefaultParameterValues(true);
+
+    // Runs are named after the swept values
+    QStringList values;
+    foreach(const QString& id, parameterIds)
+      {
+      if (parameterGrid.value(id).size() < 2 && parameterIds.size() > 1)
+        {
+        continue;
+        }
+      QtProperty * property = analysis->propertyManager()->qtProperty(id);
+      values << QString("%1=%2").arg(id).arg(
+                  property ? property->valueText() : combination.value(id).toString());
+      }
+    this->runAnalysis(analysis, inputTargets, sweepContainer,
+                      QString("%1 (%2)").arg(analysisName).arg(values.join(", ")));
+    }
+}
+
+// --------------------------------------------------------------------------
+QString voAnalysisDriver::quoteParameterGridValue(const QString& value)
+{
+  QString escaped = value;
+  escaped.replace('\\', "\\\\");
+  escaped.replace('"', "\\\"");
+  return QString("\"%1\"").arg(escaped);
+}
+
+// --------------------------------------------------------------------------
+QHash<QString, QVariantList> voAnalysisDriver::parseParameterGrid(
+  voAnalysis * analysis, const QString& spec, QString& errorString)
+{
+  QHash<QString, QVariantList> parameterGrid;
+  errorString.clear();
+  if (!analysis)
+    {
+    errorString = tr("No analysis");
+    return parameterGrid;
+    }
+
+  bool quotesMatch = true;
+  QStringList entries = splitParameterGrid(spec, ';', quotesMatch);
+  if (!quotesMatch)
+    {
+    errorString = tr("Unterminated quote in \"%1\"").arg(spec.trimmed());
+    return parameterGrid;
+    }
+  foreach(const QString& entry, entries)
+    {
+    int separator = entry.indexOf('=');
+    QString id = entry.left(separator).trimmed();
+    QtVariantProperty * property = separator < 0 ? 0 :
+      dynamic_cast<QtVariantProperty*>(analysis->propertyManager()->qtProperty(id));
+    if (!property)
+      {
+      errorString = tr("Unknown parameter in \"%1\"").arg(entry.trimmed());
+      return QHash<QString, QVariantList>();
+      }
+
+    QVariantList values;
+    foreach(QString value, splitParameterGrid(entry.mid(separator + 1), ',', quotesMatch))
+      {
+      value = unquoteParameterGridValue(value);
+      bool ok = true;
+      if (property->propertyType() == QtVariantPropertyManager::enumTypeId())
+        {
+        // Enumeration values are stored as indices
+        QStringList enumNames = property->attributeValue("enumNames").toStringList();
+        int enumIndex = enumNames.indexOf(value);
+        ok = enumIndex >= 0;
+        values << enumIndex;
+        }
+      else if (property->propertyType() == QVariant::Int ||
+               property->propertyType() == QVariant::Double)
+        {
+        // "first..last[:step]" ranges are expanded
+        bool isInteger = property->propertyType() == QVariant::Int;
+        QString range = value;
+        double step = 1.;
+        int stepSeparator = range.indexOf(':');
+        if (stepSeparator >= 0)
+          {
+          step = range.mid(stepSeparator + 1).toDouble(&ok);
+          range = range.left(stepSeparator);
+          }
+        QStringList bounds = range.split("..");
+        double first = 0.;
+        double last = 0.;
+        if (ok && bounds.size() <= 2)
+          {
+          first = bounds.first().toDouble(&ok);
+          last = ok ? bounds.last().toDouble(&ok) : 0.;
+          }
+        else
+          {
+          ok = false;
+          }
+        ok = ok && step > 0. && first <= last && (!isInteger ||
+          (first == static_cast<int>(first) && step == static_cast<int>(step)));
+        for (int i = 0; ok && first + i * step <= last + 1e-9 * step; ++i)
+          {
+          double number = first + i * step;
+          values << (isInteger ? QVariant(static_cast<int>(number)) : QVariant(number));
+          }
+        }
+      else if (property->propertyType() == QVariant::Bool)
+        {
+        ok = value == "true" || value == "false";
+        values << (value == "true");
+        }
+      else if (property->propertyType() == QVariant::String)
+        {
+        values << value;
+        }
+      else
+        {
+        ok = false;
+        }
+      if (!ok)
+        {
+        errorString = tr("Invalid value \"%1\" for parameter %2").arg(value).arg(id);
+        return QHash<QString, QVariantList>();
+        }
+      }
+    if (values.isEmpty())
+      {
+      errorString = tr("No value for parameter %1").arg(id);
+      return QHash<QString, QVariantList>();
+      }
+    parameterGrid.insert(id, values);
+    }
+  if (parameterGrid.isEmpty())
+    {
+    errorString = tr("No parameter to sweep");
+    }
+  return parameterGrid;
 }
 
-voAnalysisTask::voAnalysisTask(voAnalysis *analysis, voDataModelItem* insertLocation)
-  : m_analysis(analysis), m_insertLocation(insertLocation)
+// --------------------------------------------------------------------------
+voAnalysisTask::voAnalysisTask(voAnalysis *analysis, voDataModelItem* insertLocation,
+                               const QString& label)
+  : m_analysis(analysis), m_insertLocation(insertLocation), m_label(label)
 {
   connect(m_analysis, SIGNAL(complete()), this, SIGNAL(complete()));
   connect(m_analysis, SIGNAL(error(const QString&)), this, SIGNAL(error(const QString&)));
 }
 
-bool voAnalysisTask::run()
+bool voAnalysisTask::run(QThreadPool* threadPool)
 {
+  if (threadPool && m_analysis->canRunInBackground())
+    {
+    m_analysis->runInBackground(threadPool);
+    return true;
+    }
   return m_analysis->run();
 }
 
 // --------------------------------------------------------------------------
-void voAnalysisDriver::runAnalysis(voAnalysis * analysis,
-                                   QList<voDataModelItem*> inputTargets)
+bool voAnalysisDriver::runAnalysis(voAnalysis * analysis,
+                                   QList<voDataModelItem*> inputTargets,
+                                   voDataModelItem* insertLocation,
+                                   const QString& label)
 {
+  Q_D(voAnalysisDriver);
   if (!analysis)
     {
     qWarning() << "Failed to runAnalysis - Analysis is NULL";
-    return;
+    return false;
     }
   if (inputTargets.empty())
     {
     qWarning() << "Failed to runAnalysis - InputTargets is empty";
-    return;
+    return false;
     }
 
   // Reset abort execution flag
@@ -213,7 +598,7 @@ void voAnalysisDriver::runAnalysis(voAnalysis * analysis,
     voDataModelItem *inputTarget = inputTargets.at(0);
     if (!this->doesInputMatchAnalysis(analysisName, inputTarget, true))
       {
-      return;
+      return false;
       }
     dataObject = inputTarget->dataObject();
     }
@@ -235,7 +620,7 @@ void voAnalysisDriver::runAnalysis(voAnalysis * analysis,
       }
     if (!inputMatches)
       {
-      return;
+      return false;
       }
     }
 
@@ -244,7 +629,7 @@ void voAnalysisDriver::runAnalysis(voAnalysis * analysis,
     // multiple inputs required & multiple items provided
     if (!this->doesInputMatchAnalysis(analysisName, inputTargets, true))
       {
-      return;
+      return false;
       }
     }
 
@@ -258,14 +643,14 @@ void voAnalysisDriver::runAnalysis(voAnalysis * analysis,
     Q_ASSERT(inputTarget);
     if (!this->doesInputMatchAnalysis(analysisName, inputTarget, true))
       {
-      return;
+      return false;
       }
     }
 
   else
     {
     qDebug() << "unhandled case in voAnalysisDriver::runAnalysis";
-    return;
+    return false;
     }
 
   // At this point we've verified that our input is good.  Now we need
@@ -291,7 +676,7 @@ void voAnalysisDriver::runAnalysis(voAnalysis * analysis,
       // single input selected by user, but its children match
       // what the analysis is looking for.
       voDataModelItem* inputTarget = inputTargets.at(0);
-      for (int i = 0; i < expectedInputTypes.size(); i++)
+      for (int i = 0; i < inputTarget->childItems().size(); i++)
         {
         voDataModelItem * childItem =
           dynamic_cast<voDataModelItem*>(inputTarget->child(i));
@@ -308,22 +693,40 @@ void voAnalysisDriver::runAnalysis(voAnalysis * analysis,
   emit this->aboutToRunAnalysis(analysis);
   if (analysis->abortExecution())
     {
-    return;
+    return false;
     }
 
-  voAnalysisTask *task  = new voAnalysisTask(analysis, inputTargets.at(0));
+  voAnalysisTask *task  = new voAnalysisTask(
+    analysis, insertLocation ? insertLocation : inputTargets.at(0), label);
 
   connect(task, SIGNAL(complete()),
       this, SLOT(analysisComplete()));
   connect(task, SIGNAL(error(const QString&)),
       this, SLOT(analysisError(const QString&)));
 
+  // Same analysis, inputs and parameters: reuse the outputs
+  double cacheStart = voTrace::now();
+  QString cacheKey = d->ResultCache->cacheKey(analysis);
+  if (d->ResultCache->restoreOutputs(cacheKey, analysis))
+    {
+    qDebug() << " => Analysis" << analysis->objectName() << " restored from cache";
+    analysis->addTiming(voTrace::addEvent("cache", analysis->objectName(), cacheStart));
+    QMetaObject::invokeMethod(task, "complete", Qt::QueuedConnection);
+    return true;
+    }
+  if (!cacheKey.isEmpty())
+    {
+    d->ResultCacheKeys.insert(analysis, cacheKey);
+    connect(analysis, SIGNAL(complete()), this, SLOT(cacheAnalysisResults()), Qt::UniqueConnection);
+    }
+
   // If we are dealing with remote analysis we need to connect up the extra
   // signals.
   voRemoteCustomAnalysis *remoteAnalysis
     = qobject_cast<voRemoteCustomAnalysis *>(analysis);
   if (remoteAnalysis)
     {
+    remoteAnalysis->setClient(d->RemoteAnalysisClient);
     connect(remoteAnalysis, SIGNAL(urlRequired(QUrl *)),
             this, SLOT(provideRemoteAnalysisUrl(QUrl *)));
     connect(remoteAnalysis, SIGNAL(invalidCredentials()),
@@ -331,17 +734,49 @@ void voAnalysisDriver::runAnalysis(voAnalysis * analysis,
     connect(remoteAnalysis, SIGNAL(analysisSubmitted()),
             this, SLOT(onAnalysisSubmitted()));
     }
+  else if (analysis->canRunInBackground())
+    {
+    // Restored once the task completes or fails
+    d->setOverrideCursor(analysis, QCursor(Qt::BusyCursor));
+    }
 
-  task->run();
+  QPointer<voAnalysisTask> runningTask(task);
+  if (!task->run(d->AnalysisThreadPool) && runningTask)
+    {
+    // The analysis failed without reporting an error: report it so that
+    // the task is cleaned up like any other failure.
+    QMetaObject::invokeMethod(task, "error", Qt::QueuedConnection,
+      Q_ARG(QString, tr("Analysis %1 failed to run.").arg(analysis->objectName())));
+    }
+  return true;
 }
 
 void voAnalysisDriver::analysisComplete()
 {
+  Q_D(voAnalysisDriver);
   voAnalysisTask *task = qobject_cast<voAnalysisTask*>(sender());
   voAnalysis *analysis = task->analysis();
 
+  // Show the time spent in each stage with the properties of the outputs
+  QList<voDataObject*> outputs;
+  foreach(const QString& outputName, analysis->outputNames())
+    {
+    outputs << analysis->output(outputName);
+    }
+  foreach(const QString& outputName, analysis->ensembleOutputNames())
+    {
+    outputs << analysis->ensembleOutput(outputName);
+    }
+  foreach(const voTrace::Event& timing, analysis->timings())
+    {
+    foreach(voDataObject* output, outputs)
+      {
+      voTrace::recordTiming(output, timing);
+      }
+    }
+
   voAnalysisDriver::addAnalysisToObjectModel(
-      analysis, task->insertLocation());
+      analysis, task->insertLocation(), task->label());
 
   connect(analysis, SIGNAL(outputSet(const QString&, voDataObject*, voAnalysis*)),
     SLOT(onAnalysisOutputSet(const QString&,voDataObject*,voAnalysis*)));
@@ -354,7 +789,7 @@ void voAnalysisDriver::analysisComplete()
 
   delete task;
 
-  QApplication::restoreOverrideCursor();
+  d->restoreOverrideCursor(analysis);
 }
 
 void voAnalysisDriver::analysisError(const QString &errorString) {
@@ -364,18 +799,23 @@ void voAnalysisDriver::analysisError(const QString &errorString) {
   d->remoteAnalysisUrl.clear();
 
   voAnalysisTask *task = qobject_cast<voAnalysisTask*>(sender());
+  d->ResultCacheKeys.remove(task->analysis());
+  emit this->analysisFailed(task->analysis());
 
   // If a message was provided display it, otherwise the user may have just
   // cancelled the analysis.
-  if (!errorString.isEmpty())
+  if (!errorString.isEmpty() && voApplication::application()->mainWindow())
     {
     QMessageBox::critical(voApplication::application()->mainWindow(),
         "Analysis Error", errorString,  QMessageBox::Ok);
     }
+  else if (!errorString.isEmpty())
+    {
+    qCritical() << "Analysis Error:" << errorString;
+    }
+  d->restoreOverrideCursor(task->analysis());
   task->analysis()->deleteLater();
   delete task;
-
-  QApplication::restoreOverrideCursor();
 }
 
 // --------------------------------------------------------------------------
@@ -398,25 +838,71 @@ void voAnalysisDriver::runAnalysisForCurrentInput(
   this->runAnalysis(newAnalysis, inputTargets);
 }
 
+// --------------------------------------------------------------------------
+void voAnalysisDriver::runAnalysisSweepForCurrentInput(
+  const QString& analysisName, const QHash<QString, QVariantList>& parameterGrid)
+{
+  voDataModel * model = voApplication::application()->dataModel();
+  voDataModelItem * inputTarget = model->inputTargetForAnalysis(model->activeAnalysis());
+  Q_ASSERT(inputTarget);
+
+  QList<voDataModelItem*> inputTargets;
+  inputTargets << inputTarget;
+  this->runAnalysisSweep(analysisName, inputTargets, parameterGrid);
+}
+
 // --------------------------------------------------------------------------
 void voAnalysisDriver::updateAnalysis(
   voAnalysis * analysis, const QHash<QString, QVariant>& parameters)
 {
+  Q_D(voAnalysisDriver);
   if (!analysis || parameters.count() == 0)
     {
     return;
     }
+  if (analysis->isRunningInBackground())
+    {
+    qWarning() << "Failed to updateAnalysis - Analysis" << analysis->objectName() << "is still running";
+    return;
+    }
 
   // Update analysis parameter
   analysis->setParameterValues(parameters);
   analysis->setAcceptDefaultParameterValues(true);
 
-  // Clear outputs
+  // Clear outputs. Stage outputs are kept: the stages that don't depend on
+  // the updated parameters are not computed again.
   analysis->removeAllOutputs();
   analysis->initializeOutputInformation();
+  foreach(const QString& stageName, analysis->stageNames())
+    {
+    if (analysis->hasStageOutput(stageName))
+      {
+      qDebug() << " => Analysis" << analysis->objectName() << "reuses stage" << stageName;
+      }
+    }
 
+  analysis->setAbortExecution(false);
   emit this->aboutToRunAnalysis(analysis);
 
+  QString cacheKey = d->ResultCache->cacheKey(analysis);
+  if (d->ResultCache->restoreOutputs(cacheKey, analysis))
+    {
+    return;
+    }
+  if (!cacheKey.isEmpty())
+    {
+    d->ResultCacheKeys.insert(analysis, cacheKey);
+    connect(analysis, SIGNAL(complete()), this, SLOT(cacheAnalysisResults()), Qt::UniqueConnection);
+    }
+
+  if (analysis->canRunInBackground())
+    {
+    // Outputs are updated through outputSet() once done
+    analysis->runInBackground(d->AnalysisThreadPool);
+    return;
+    }
+
   bool ret = analysis->run();
   if (!ret)
     {
@@ -535,7 +1021,7 @@ voDataModelItem *  voAnalysisDriver::addOutputToObjectModel(const QString& outpu
 }
 // --------------------------------------------------------------------------
 void voAnalysisDriver::addAnalysisToObjectModel(voAnalysis * analysis,
-  voDataModelItem* insertLocation)
+  voDataModelItem* insertLocation, const QString& label)
 {
   if (!analysis || !insertLocation)
     {
@@ -546,7 +1032,8 @@ void voAnalysisDriver::addAnalysisToObjectModel(voAnalysis * analysis,
 
   // Analysis container
   voDataModelItem * analysisContainer =
-    model->addContainer(model->getNextName(analysis->objectName()), insertLocation);
+    model->addContainer(label.isEmpty() ? model->getNextName(analysis->objectName()) : label,
+                        insertLocation);
   analysisContainer->setData(QVariant(analysis->uuid()), voDataModelItem::UuidRole);
   analysisContainer->setData(QVariant(true), voDataModelItem::IsAnalysisContainerRole);
   analysisContainer->setData(QVariant(QMetaType::VoidStar, &analysis), voDataModelItem::AnalysisVoidStarRole);
@@ -587,7 +1074,8 @@ bool voAnalysisDriver::doesInputMatchAnalysis(const QString& analysisName,
     return false;
     }
 
-  QStringList expectedInputTypes = analysisNameToInputTypes.value(analysisName);
+  QStringList expectedInputTypes =
+    this->inputTypesForAnalysis(analysisName, inputTarget->childItems().size());
   QString expectedInputType = expectedInputTypes.at(0);
   QString providedInputType = inputTarget->dataObject()->type();
 
@@ -654,7 +1142,8 @@ bool voAnalysisDriver::doesInputMatchAnalysis(const QString& analysisName,
     return false;
     }
 
-  QStringList expectedInputTypes = analysisNameToInputTypes.value(analysisName);
+  QStringList expectedInputTypes =
+    this->inputTypesForAnalysis(analysisName, inputTargets.size());
   expectedInputTypes.sort();
 
   QStringList providedInputTypes;
@@ -690,6 +1179,21 @@ int voAnalysisDriver::numberOfInputsForAnalysis(QString analysisName)
   return analysisNameToInputTypes.value(analysisName).size();
 }
 
+// --------------------------------------------------------------------------
+QStringList voAnalysisDriver::inputTypesForAnalysis(const QString& analysisName,
+                                                    int numberOfInputs)const
+{
+  QStringList inputTypes = analysisNameToInputTypes.value(analysisName);
+  if (analysisNamesWithRepeatedLastInput.contains(analysisName))
+    {
+    while (!inputTypes.isEmpty() && inputTypes.size() < numberOfInputs)
+      {
+      inputTypes << inputTypes.last();
+      }
+    }
+  return inputTypes;
+}
+
 // --------------------------------------------------------------------------
 void voAnalysisDriver::loadAnalysisFromScript(const QString& xmlFileName,
   const QString& rScriptFileName, const QString &scriptType)
@@ -943,5 +1447,22 @@ void voAnalysisDriver::onInvalidCredentials()
 // --------------------------------------------------------------------------
 void voAnalysisDriver::onAnalysisSubmitted()
 {
-  QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
+  Q_D(voAnalysisDriver);
+  voAnalysis * analysis = qobject_cast<voAnalysis*>(this->sender());
+  if (analysis)
+    {
+    d->setOverrideCursor(analysis, QCursor(Qt::WaitCursor));
+    }
+}
+
+// --------------------------------------------------------------------------
+void voAnalysisDriver::cacheAnalysisResults()
+{
+  Q_D(voAnalysisDriver);
+  voAnalysis * analysis = qobject_cast<voAnalysis*>(this->sender());
+  if (!analysis || !d->ResultCacheKeys.contains(analysis))
+    {
+    return;
+    }
+  d->ResultCache->storeOutputs(d->ResultCacheKeys.take(analysis), analysis);
 }
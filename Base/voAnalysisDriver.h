@@ -25,22 +25,32 @@
 #include <QObject>
 #include <QMap>
 #include <QHash>
+#include <QSet>
+#include <QVariant>
 
+class QThreadPool;
 class QUrl;
 
 class voAnalysis;
+class voAnalysisResultCache;
 class voDataModelItem;
 class voDataObject;
+class voRemoteAnalysisClient;
 class voAnalysisDriverPrivate;
 
 class voAnalysisTask : public QObject
 {
   Q_OBJECT
 public:
-  voAnalysisTask(voAnalysis *analysis, voDataModelItem* insertLocation);
+  voAnalysisTask(voAnalysis *analysis, voDataModelItem* insertLocation,
+                 const QString& label = QString());
   voAnalysis *analysis() { return m_analysis; };
   voDataModelItem* insertLocation() { return m_insertLocation; };
-  bool run();
+  /// Name of the container of the outputs, the analysis name if empty.
+  QString label() { return m_label; };
+  /// Run the analysis on \a threadPool if it supports it, otherwise on the
+  /// calling thread.
+  bool run(QThreadPool* threadPool = 0);
 
 signals:
   void complete();
@@ -50,6 +60,7 @@ signals:
 private:
   voAnalysis *m_analysis;
   voDataModelItem* m_insertLocation;
+  QString m_label;
 };
 
 class voAnalysisDriver : public QObject
@@ -64,9 +75,44 @@ public:
                    QList<voDataModelItem*> inputTargets,
                    bool acceptDefaultParameter = false);
 
-  void runAnalysis(const QString& analysisName,
-                   QList<voDataModelItem*> inputTargets,
-                   const QHash<QString, QVariant>& parameters);
+  /// Return the analysis being run, or 0 if it could not be started.
+  /// Analyses that don't run in the background may be done by then.
+  voAnalysis* runAnalysis(const QString& analysisName,
+                          QList<voDataModelItem*> inputTargets,
+                          const QHash<QString, QVariant>& parameters);
+
+  /// Create an analysis of type \a analysisName with the given \a parameters,
+  /// to be run with runAnalysis(). Return 0 if the type is unknown.
+  voAnalysis* createAnalysis(const QString& analysisName,
+                             const QHash<QString, QVariant>& parameters);
+
+  /// Return false if the analysis was not started (e.g. invalid inputs).
+  /// analysisAddedToObjectModel() or analysisFailed() may be emitted before
+  /// returning.
+  bool runAnalysis(voAnalysis * analysis,
+                   QList<voDataModelItem*> inputTarget,
+                   voDataModelItem* insertLocation = 0,
+                   const QString& label = QString());
+
+  /// Run \a analysisName once for every combination of the values in
+  /// \a parameterGrid. The runs are scheduled at once and their results are
+  /// grouped under a single container. Parameters missing from the grid
+  /// keep their default value.
+  void runAnalysisSweep(const QString& analysisName,
+                        QList<voDataModelItem*> inputTargets,
+                        const QHash<QString, QVariantList>& parameterGrid);
+
+  /// Parse a parameter grid of the form "id=v1,v2,v3; id2=first..last[:step]"
+  /// for the parameters of \a analysis. Enumeration values are given by name.
+  /// Values containing separators are enclosed in double quotes, see
+  /// quoteParameterGridValue().
+  /// Return an empty grid and set \a errorString if \a spec is invalid.
+  static QHash<QString, QVariantList> parseParameterGrid(
+    voAnalysis * analysis, const QString& spec, QString& errorString);
+
+  /// Enclose \a value in double quotes, escaping quotes and backslashes, so
+  /// that parseParameterGrid() reads it as a single value.
+  static QString quoteParameterGridValue(const QString& value);
 
   bool doesInputMatchAnalysis(const QString& analysisName,
                               voDataModelItem* inputTarget, bool warnOnFail);
@@ -74,13 +120,29 @@ public:
                               QList<voDataModelItem*> inputTargets,
                               bool warnOnFail);
   int numberOfInputsForAnalysis(QString analysisName);
+  /// Input types expected by \a analysisName when \a numberOfInputs inputs
+  /// are provided. The last input type of the analyses listed in
+  /// analysisNamesWithRepeatedLastInput is repeated as needed.
+  QStringList inputTypesForAnalysis(const QString& analysisName, int numberOfInputs)const;
   void loadAnalysisFromScript(const QString& xmlFileName,
                               const QString& rScriptFileName,
                               const QString& scriptType);
 
+  /// Client shared by the remote analyses run by the driver.
+  voRemoteAnalysisClient* remoteAnalysisClient()const;
+
+  /// Pool of worker threads running the native analyses.
+  QThreadPool* analysisThreadPool()const;
+
+  /// Outputs of the analyses run so far, returned instead of running an
+  /// analysis again with the same inputs and parameters.
+  voAnalysisResultCache* analysisResultCache()const;
+
 signals:
   void aboutToRunAnalysis(voAnalysis*);
   void analysisAddedToObjectModel(voAnalysis*);
+  /// Emitted when \a analysis fails or is cancelled, before it is deleted.
+  void analysisFailed(voAnalysis* analysis);
   void addedCustomAnalysis(const QString&);
   void urlRequired(QUrl *);
 
@@ -90,6 +152,9 @@ public slots:
   void runAnalysisForCurrentInput(
     const QString& analysisName, const QHash<QString, QVariant>& parameters);
 
+  void runAnalysisSweepForCurrentInput(
+    const QString& analysisName, const QHash<QString, QVariantList>& parameterGrid);
+
   void updateAnalysis(
     voAnalysis * analysis, const QHash<QString, QVariant>& parameters);
 
@@ -102,17 +167,17 @@ protected slots:
 
 
 protected:
-  void runAnalysis(voAnalysis * analysis,
-                   QList<voDataModelItem*> inputTarget);
   voAnalysis * createAnalysis(const QString& analysisName);
 
   static voDataModelItem * addEnsembleOutputToObjectModel(const QString& outputName, voAnalysis * analysis, voDataModelItem* parent);
   static voDataModelItem * addOutputToObjectModel(const QString& outputName, voAnalysis * analysis, voDataModelItem* parent);
-  static void addAnalysisToObjectModel(voAnalysis * analysis, voDataModelItem* insertLocation);
+  static void addAnalysisToObjectModel(voAnalysis * analysis, voDataModelItem* insertLocation,
+                                       const QString& label = QString());
 
 protected:
   QScopedPointer<voAnalysisDriverPrivate> d_ptr;
   QMap< QString, QStringList > analysisNameToInputTypes;
+  QSet<QString> analysisNamesWithRepeatedLastInput;
 
 private:
   Q_DECLARE_PRIVATE(voAnalysisDriver);
@@ -124,6 +189,7 @@ private slots:
   void provideRemoteAnalysisUrl(QUrl *url);
   void onInvalidCredentials();
   void onAnalysisSubmitted();
+  void cacheAnalysisResults();
 };
 
 #endif
@@ -27,8 +27,10 @@
 #include "voQObjectFactory.h"
 
 #include "voOneZoom.h"
+#include "voTreeComparison.h"
 #include "voTreeDropTip.h"
 #include "voTreeDropTipWithoutData.h"
+#include "voTreeModelFitting.h"
 
 #include "voCustomAnalysis.h"
 #include "voRemoteCustomAnalysis.h"
@@ -56,6 +58,8 @@ voAnalysisFactory::voAnalysisFactory():d_ptr(new voAnalysisFactoryPrivate)
   this->registerAnalysis<voOneZoom>("OneZoom Visualization");
   this->registerAnalysis<voTreeDropTip>("Tree Drop Tip With Data");
   this->registerAnalysis<voTreeDropTipWithoutData>("Tree Drop Tip");
+  this->registerAnalysis<voTreeComparison>("Tree Comparison");
+  this->registerAnalysis<voTreeModelFitting>("Tree Model Fitting");
 }
 
 //-----------------------------------------------------------------------------
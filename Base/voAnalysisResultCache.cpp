@@ -0,0 +1,641 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+// Qt includes
+#include <QCache>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QExplicitlySharedDataPointer>
+#include <QFileInfo>
+#include <QHash>
+#include <QMap>
+#include <QSettings>
+#include <QVector>
+
+// Visomics includes
+#include "voAnalysis.h"
+#include "voAnalysisResultCache.h"
+#include "voDataObject.h"
+#include "voInputFileDataObject.h"
+#include "voIOManager.h"
+#include "voOutputDataObject.h"
+#include "voTableDataObject.h"
+#include "vtkExtendedTable.h"
+
+// VTK includes
+#include <vtkAbstractArray.h>
+#include <vtkDataArray.h>
+#include <vtkDataObject.h>
+#include <vtkDataSetAttributes.h>
+#include <vtkErrorCode.h>
+#include <vtkFieldData.h>
+#include <vtkGenericDataObjectReader.h>
+#include <vtkGenericDataObjectWriter.h>
+#include <vtkGraph.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkStringArray.h>
+#include <vtkTable.h>
+#include <vtkVariant.h>
+
+// STD includes
+#include <cstring>
+
+namespace
+{
+typedef QList<QPair<QString, QExplicitlySharedDataPointer<voDataObject> > > OutputList;
+
+// --------------------------------------------------------------------------
+// Extended tables can't be written as is: their input table is used instead.
+vtkDataObject * serializableData(vtkDataObject * data)
+{
+  vtkExtendedTable * extendedTable = vtkExtendedTable::SafeDownCast(data);
+  if (extendedTable && extendedTable->GetInputData())
+    {
+    return extendedTable->GetInputData();
+    }
+  return data;
+}
+
+// --------------------------------------------------------------------------
+void addData(QCryptographicHash& hash, const char * data, qint64 size)
+{
+  // QCryptographicHash::addData() takes an int
+  const qint64 maximumChunkSize = 1 << 30;
+  for (qint64 offset = 0; offset < size; offset += maximumChunkSize)
+    {
+    hash.addData(data + offset, static_cast<int>(qMin(maximumChunkSize, size - offset)));
+    }
+}
+
+// --------------------------------------------------------------------------
+// Hash the names and values of the arrays of \a fieldData. Arrays of numbers
+// are hashed from their buffer, without serializing them.
+void addFieldData(QCryptographicHash& hash, vtkFieldData * fieldData)
+{
+  for (int i = 0; fieldData && i < fieldData->GetNumberOfArrays(); ++i)
+    {
+    vtkAbstractArray * array = fieldData->GetAbstractArray(i);
+    const char * name = array->GetName() ? array->GetName() : "";
+    hash.addData(name, static_cast<int>(strlen(name)) + 1);
+    hash.addData(array->GetClassName());
+    hash.addData(QByteArray::number(array->GetNumberOfComponents()) + ":"
+                 + QByteArray::number(static_cast<qlonglong>(array->GetNumberOfTuples())) + ":");
+    vtkIdType numberOfValues = array->GetNumberOfTuples() * array->GetNumberOfComponents();
+    vtkDataArray * dataArray = vtkDataArray::SafeDownCast(array);
+    vtkStringArray * stringArray = vtkStringArray::SafeDownCast(array);
+    if (dataArray && numberOfValues > 0)
+      {
+      addData(hash, static_cast<const char*>(dataArray->GetVoidPointer(0)),
+              static_cast<qint64>(numberOfValues) * dataArray->GetDataTypeSize());
+      }
+    else if (stringArray)
+      {
+      for (vtkIdType value = 0; value < numberOfValues; ++value)
+        {
+        // The terminating null character separates the values
+        const vtkStdString& string = stringArray->GetValue(value);
+        hash.addData(string.c_str(), static_cast<int>(string.size()) + 1);
+        }
+      }
+    else
+      {
+      for (vtkIdType value = 0; value < numberOfValues; ++value)
+        {
+        vtkStdString string = array->GetVariantValue(value).ToString();
+        hash.addData(string.c_str(), static_cast<int>(string.size()) + 1);
+        }
+      }
+    }
+}
+
+// --------------------------------------------------------------------------
+// Hash the content of tables and graphs directly. Return false for other
+// data, which has to be serialized.
+bool addDataObject(QCryptographicHash& hash, vtkDataObject * data)
+{
+  vtkTable * table = vtkTable::SafeDownCast(data);
+  vtkGraph * graph = vtkGraph::SafeDownCast(data);
+  if (table)
+    {
+    addFieldData(hash, table->GetRowData());
+    }
+  else if (graph)
+    {
+    addFieldData(hash, graph->GetVertexData());
+    addFieldData(hash, graph->GetEdgeData());
+    QVector<vtkIdType> edges;
+    edges.reserve(2 * graph->GetNumberOfEdges());
+    for (vtkIdType edge = 0; edge < graph->GetNumberOfEdges(); ++edge)
+      {
+      edges << graph->GetSourceVertex(edge) << graph->GetTargetVertex(edge);
+      }
+    hash.addData(QByteArray::number(static_cast<qlonglong>(graph->GetNumberOfVertices())) + ":");
+    addData(hash, reinterpret_cast<const char*>(edges.constData()),
+            static_cast<qint64>(edges.size()) * sizeof(vtkIdType));
+    }
+  else
+    {
+    return false;
+    }
+  addFieldData(hash, data->GetFieldData());
+  return true;
+}
+
+// --------------------------------------------------------------------------
+// Memory used by the outputs, in kilobytes
+int memoryCost(const OutputList& outputs)
+{
+  int cost = 0;
+  foreach(const OutputList::value_type& output, outputs)
+    {
+    cost += static_cast<int>(output.second->dataAsVTKDataObject()->GetActualMemorySize());
+    }
+  return qMax(cost, 1);
+}
+
+// --------------------------------------------------------------------------
+// Create a data object of the same class as \a source, holding a shallow copy
+// of its data: adding or removing arrays, rows or vertices in the copy leaves
+// the cached data untouched.
+voDataObject * shallowCopy(voDataObject * source)
+{
+  vtkSmartPointer<vtkDataObject> dataCopy = source->sharedDataCopy();
+  vtkDataObject * data = dataCopy.GetPointer();
+  if (voTableDataObject * tableDataObject = qobject_cast<voTableDataObject*>(source))
+    {
+    return new voTableDataObject(source->name(), data, tableDataObject->sortable());
+    }
+  if (voInputFileDataObject * inputFileDataObject = qobject_cast<voInputFileDataObject*>(source))
+    {
+    voInputFileDataObject * copy = new voInputFileDataObject(source->name(), data);
+    copy->setFileName(inputFileDataObject->fileName());
+    return copy;
+    }
+  if (qobject_cast<voOutputDataObject*>(source))
+    {
+    return new voOutputDataObject(source->name(), data);
+    }
+  return new voDataObject(source->name(), data);
+}
+
+// --------------------------------------------------------------------------
+// QDir::removeRecursively() isn't available with Qt 4. Cache entries don't
+// have sub-directories.
+void removeEntryDirectory(const QString& path)
+{
+  QDir dir(path);
+  foreach(const QString& fileName, dir.entryList(QDir::Files | QDir::Hidden))
+    {
+    dir.remove(fileName);
+    }
+  dir.rmdir(path);
+}
+
+} // end of anonymous namespace
+
+// --------------------------------------------------------------------------
+class voAnalysisResultCachePrivate
+{
+public:
+  voAnalysisResultCachePrivate();
+
+  struct ContentHash
+    {
+    unsigned long MTime;
+    QByteArray Hash;
+    };
+
+  bool readEntry(const QString& key, OutputList& outputs);
+  void writeEntry(const QString& key, const OutputList& outputs);
+  void trimDirectory();
+
+  QCache<QString, OutputList> MemoryCache;
+  QHash<QString, ContentHash> ContentHashes; // Indexed by data object uuid
+  QString Directory;
+  qint64 MaximumDiskSize;
+};
+
+// --------------------------------------------------------------------------
+// voAnalysisResultCachePrivate methods
+
+// --------------------------------------------------------------------------
+voAnalysisResultCachePrivate::voAnalysisResultCachePrivate()
+{
+  this->MemoryCache.setMaxCost(256 * 1024);
+  this->MaximumDiskSize = Q_INT64_C(1024) * 1024 * 1024;
+}
+
+// --------------------------------------------------------------------------
+bool voAnalysisResultCachePrivate::readEntry(const QString& key, OutputList& outputs)
+{
+  if (this->Directory.isEmpty())
+    {
+    return false;
+    }
+  QDir entryDir(QDir(this->Directory).filePath(key));
+  if (!entryDir.exists("manifest.ini"))
+    {
+    return false;
+    }
+
+  QSettings manifest(entryDir.filePath("manifest.ini"), QSettings::IniFormat);
+  int count = manifest.beginReadArray("outputs");
+  for (int i = 0; i < count; ++i)
+    {
+    manifest.setArrayIndex(i);
+    QString name = manifest.value("name").toString();
+    QString className = manifest.value("class").toString();
+
+    vtkNew<vtkGenericDataObjectReader> reader;
+    reader->SetFileName(entryDir.filePath(QString("%1.vtk").arg(i)).toLatin1());
+    reader->Update();
+    vtkSmartPointer<vtkDataObject> data = reader->GetOutput();
+    if (!data || reader->GetErrorCode() != vtkErrorCode::NoError)
+      {
+      qWarning() << "voAnalysisResultCache - Failed to read cached output" << name << "of" << key;
+      outputs.clear();
+      break;
+      }
+    if (manifest.value("extended").toBool())
+      {
+      vtkTable * table = vtkTable::SafeDownCast(data);
+      if (!table)
+        {
+        outputs.clear();
+        break;
+        }
+      vtkSmartPointer<vtkExtendedTable> extendedTable = vtkSmartPointer<vtkExtendedTable>::New();
+      voIOManager::convertTableToExtended(table, extendedTable.GetPointer());
+      data = extendedTable.GetPointer();
+      }
+
+    voDataObject * dataObject = 0;
+    if (className == "voTableDataObject")
+      {
+      dataObject = new voTableDataObject(name, data.GetPointer(), manifest.value("sortable").toBool());
+      }
+    else if (className == "voInputFileDataObject")
+      {
+      voInputFileDataObject * inputFileDataObject = new voInputFileDataObject(name, data.GetPointer());
+      inputFileDataObject->setFileName(manifest.value("fileName").toString());
+      dataObject = inputFileDataObject;
+      }
+    else if (className == "voOutputDataObject")
+      {
+      dataObject = new voOutputDataObject(name, data.GetPointer());
+      }
+    else
+      {
+      dataObject = new voDataObject(name, data.GetPointer());
+      }
+    outputs << qMakePair(name, QExplicitlySharedDataPointer<voDataObject>(dataObject));
+    }
+  manifest.endArray();
+
+  if (outputs.isEmpty())
+    {
+    return false;
+    }
+  // Used for least recently used eviction
+  manifest.setValue("lastUsed", QDateTime::currentDateTime());
+  return true;
+}
+
+// --------------------------------------------------------------------------
+void voAnalysisResultCachePrivate::writeEntry(const QString& key, const OutputList& outputs)
+{
+  if (this->Directory.isEmpty())
+    {
+    return;
+    }
+  QString entryPath = QDir(this->Directory).filePath(key);
+  if (!QDir().mkpath(entryPath))
+    {
+    qWarning() << "voAnalysisResultCache - Failed to create directory" << entryPath;
+    return;
+    }
+  QDir entryDir(entryPath);
+
+  for (int i = 0; i < outputs.size(); ++i)
+    {
+    vtkNew<vtkGenericDataObjectWriter> writer;
+    writer->SetFileName(entryDir.filePath(QString("%1.vtk").arg(i)).toLatin1());
+    writer->SetFileTypeToBinary();
+    writer->SetInputData(serializableData(outputs.at(i).second->dataAsVTKDataObject()));
+    if (!writer->Write())
+      {
+      // Not every data type can be written: keep the entry in memory only
+      removeEntryDirectory(entryPath);
+      return;
+      }
+    }
+
+  QSettings manifest(entryDir.filePath("manifest.ini"), QSettings::IniFormat);
+  manifest.beginWriteArray("outputs", outputs.size());
+  for (int i = 0; i < outputs.size(); ++i)
+    {
+    voDataObject * dataObject = outputs.at(i).second.data();
+    manifest.setArrayIndex(i);
+    manifest.setValue("name", outputs.at(i).first);
+    manifest.setValue("class", dataObject->metaObject()->className());
+    manifest.setValue("extended",
+                      vtkExtendedTable::SafeDownCast(dataObject->dataAsVTKDataObject()) != 0);
+    if (voTableDataObject * tableDataObject = qobject_cast<voTableDataObject*>(dataObject))
+      {
+      manifest.setValue("sortable", tableDataObject->sortable());
+      }
+    if (voInputFileDataObject * inputFileDataObject = qobject_cast<voInputFileDataObject*>(dataObject))
+      {
+      manifest.setValue("fileName", inputFileDataObject->fileName());
+      }
+    }
+  manifest.endArray();
+  manifest.setValue("lastUsed", QDateTime::currentDateTime());
+  manifest.sync();
+
+  this->trimDirectory();
+}
+
+// --------------------------------------------------------------------------
+void voAnalysisResultCachePrivate::trimDirectory()
+{
+  QDir cacheDir(this->Directory);
+  QMap<QDateTime, QString> entries; // Sorted from the least recently used
+  QHash<QString, qint64> entrySizes;
+  qint64 totalSize = 0;
+  foreach(const QFileInfo& entryInfo, cacheDir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+    QDir entryDir(entryInfo.absoluteFilePath());
+    qint64 entrySize = 0;
+    foreach(const QFileInfo& fileInfo, entryDir.entryInfoList(QDir::Files))
+      {
+      entrySize += fileInfo.size();
+      }
+    QSettings manifest(entryDir.filePath("manifest.ini"), QSettings::IniFormat);
+    QDateTime lastUsed = manifest.value("lastUsed").toDateTime();
+    while (entries.contains(lastUsed))
+      {
+      lastUsed = lastUsed.addMSecs(1);
+      }
+    entries.insert(lastUsed, entryInfo.absoluteFilePath());
+    entrySizes.insert(entryInfo.absoluteFilePath(), entrySize);
+    totalSize += entrySize;
+    }
+
+  QMap<QDateTime, QString>::const_iterator it = entries.constBegin();
+  for (; it != entries.constEnd() && totalSize > this->MaximumDiskSize; ++it)
+    {
+    removeEntryDirectory(it.value());
+    totalSize -= entrySizes.value(it.value());
+    }
+}
+
+// --------------------------------------------------------------------------
+// voAnalysisResultCache methods
+
+// --------------------------------------------------------------------------
+voAnalysisResultCache::voAnalysisResultCache():d_ptr(new voAnalysisResultCachePrivate)
+{
+}
+
+// --------------------------------------------------------------------------
+voAnalysisResultCache::~voAnalysisResultCache()
+{
+}
+
+// --------------------------------------------------------------------------
+QString voAnalysisResultCache::cacheKey(voAnalysis * analysis)
+{
+  if (!analysis || !analysis->canCacheResults())
+    {
+    return QString();
+    }
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(analysis->metaObject()->className());
+  hash.addData(analysis->objectName().toUtf8());
+  hash.addData(analysis->parametersHash());
+  for (int i = 0; analysis->input(i); ++i)
+    {
+    hash.addData(this->contentHash(analysis->input(i)));
+    }
+  return hash.result().toHex();
+}
+
+// --------------------------------------------------------------------------
+QByteArray voAnalysisResultCache::contentHash(voDataObject * dataObject)
+{
+  Q_D(voAnalysisResultCache);
+  if (!dataObject)
+    {
+    return QByteArray();
+    }
+  vtkDataObject * data = dataObject->isVTKDataObject() ? dataObject->dataAsVTKDataObject() : 0;
+  if (!data)
+    {
+    // Only VTK data can be serialized: other data is identified by its object
+    return QCryptographicHash::hash(dataObject->uuid().toLatin1(), QCryptographicHash::Sha1).toHex();
+    }
+
+  unsigned long mtime = data->GetMTime();
+  QHash<QString, voAnalysisResultCachePrivate::ContentHash>::const_iterator cached =
+    d->ContentHashes.constFind(dataObject->uuid());
+  if (cached != d->ContentHashes.constEnd() && cached->MTime == mtime)
+    {
+    return cached->Hash;
+    }
+
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(data->GetClassName());
+  if (!addDataObject(hash, serializableData(data)))
+    {
+    vtkNew<vtkGenericDataObjectWriter> writer;
+    writer->SetWriteToOutputString(1);
+    writer->SetFileTypeToBinary();
+    writer->SetInputData(serializableData(data));
+    writer->Write();
+    addData(hash, reinterpret_cast<const char*>(writer->GetBinaryOutputString()),
+            writer->GetOutputStringLength());
+    }
+
+  voAnalysisResultCachePrivate::ContentHash contentHash;
+  contentHash.MTime = mtime;
+  contentHash.Hash = hash.result().toHex();
+  d->ContentHashes.insert(dataObject->uuid(), contentHash);
+  return contentHash.Hash;
+}
+
+// --------------------------------------------------------------------------
+bool voAnalysisResultCache::restoreOutputs(const QString& key, voAnalysis * analysis)
+{
+  Q_D(voAnalysisResultCache);
+  if (key.isEmpty() || !analysis)
+    {
+    return false;
+    }
+
+  OutputList outputs;
+  if (d->MemoryCache.contains(key))
+    {
+    outputs = *d->MemoryCache.object(key);
+    }
+  else
+    {
+    if (!d->readEntry(key, outputs))
+      {
+      return false;
+      }
+    d->MemoryCache.insert(key, new OutputList(outputs), memoryCost(outputs));
+    }
+
+  // Cached data objects are never handed out: views and the data model
+  // identify data objects by uuid.
+  foreach(const OutputList::value_type& output, outputs)
+    {
+    analysis->setOutput(output.first, shallowCopy(output.second.data()));
+    }
+
+  // Ensembles group outputs already restored
+  foreach(const QString& ensembleName, analysis->ensembleOutputNames())
+    {
+    QList<voDataObject*> ensembleDataObjects;
+    foreach(const QString& childName, analysis->childNameListOfEnsembleOutput(ensembleName))
+      {
+      if (analysis->output(childName))
+        {
+        ensembleDataObjects << analysis->output(childName);
+        }
+      }
+    analysis->setEnsembleOutput(ensembleName, ensembleDataObjects);
+    }
+  return true;
+}
+
+// --------------------------------------------------------------------------
+void voAnalysisResultCache::storeOutputs(const QString& key, voAnalysis * analysis)
+{
+  Q_D(voAnalysisResultCache);
+  if (key.isEmpty() || !analysis)
+    {
+    return;
+    }
+
+  OutputList outputs;
+  foreach(const QString& outputName, analysis->outputNames())
+    {
+    voDataObject * dataObject = analysis->output(outputName);
+    if (!dataObject)
+      {
+      continue;
+      }
+    vtkDataObject * data = dataObject->isVTKDataObject() ? dataObject->dataAsVTKDataObject() : 0;
+    if (!data)
+      {
+      // Non VTK outputs can't be restored safely
+      return;
+      }
+    // The outputs of the analysis may be modified once cached
+    outputs << qMakePair(outputName, QExplicitlySharedDataPointer<voDataObject>(shallowCopy(dataObject)));
+    }
+  if (outputs.isEmpty())
+    {
+    return;
+    }
+
+  d->MemoryCache.insert(key, new OutputList(outputs), memoryCost(outputs));
+  d->writeEntry(key, outputs);
+}
+
+// --------------------------------------------------------------------------
+bool voAnalysisResultCache::contains(const QString& key)const
+{
+  Q_D(const voAnalysisResultCache);
+  if (key.isEmpty())
+    {
+    return false;
+    }
+  if (d->MemoryCache.contains(key))
+    {
+    return true;
+    }
+  return !d->Directory.isEmpty() &&
+    QFileInfo(QDir(QDir(d->Directory).filePath(key)).filePath("manifest.ini")).exists();
+}
+
+// --------------------------------------------------------------------------
+void voAnalysisResultCache::clear()
+{
+  Q_D(voAnalysisResultCache);
+  d->MemoryCache.clear();
+  d->ContentHashes.clear();
+  if (d->Directory.isEmpty())
+    {
+    return;
+    }
+  QDir cacheDir(d->Directory);
+  foreach(const QFileInfo& entryInfo, cacheDir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+    removeEntryDirectory(entryInfo.absoluteFilePath());
+    }
+}
+
+// --------------------------------------------------------------------------
+int voAnalysisResultCache::maximumMemoryCost()const
+{
+  Q_D(const voAnalysisResultCache);
+  return d->MemoryCache.maxCost();
+}
+
+// --------------------------------------------------------------------------
+void voAnalysisResultCache::setMaximumMemoryCost(int kilobytes)
+{
+  Q_D(voAnalysisResultCache);
+  d->MemoryCache.setMaxCost(kilobytes);
+}
+
+// --------------------------------------------------------------------------
+QString voAnalysisResultCache::directory()const
+{
+  Q_D(const voAnalysisResultCache);
+  return d->Directory;
+}
+
+// --------------------------------------------------------------------------
+void voAnalysisResultCache::setDirectory(const QString& path)
+{
+  Q_D(voAnalysisResultCache);
+  d->Directory = path;
+}
+
+// --------------------------------------------------------------------------
+qint64 voAnalysisResultCache::maximumDiskSize()const
+{
+  Q_D(const voAnalysisResultCache);
+  return d->MaximumDiskSize;
+}
+
+// --------------------------------------------------------------------------
+void voAnalysisResultCache::setMaximumDiskSize(qint64 bytes)
+{
+  Q_D(voAnalysisResultCache);
+  d->MaximumDiskSize = bytes;
+}
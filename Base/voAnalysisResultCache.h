@@ -0,0 +1,86 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+#ifndef __voAnalysisResultCache_h
+#define __voAnalysisResultCache_h
+
+// Qt includes
+#include <QByteArray>
+#include <QScopedPointer>
+#include <QString>
+
+class voAnalysis;
+class voAnalysisResultCachePrivate;
+class voDataObject;
+
+/// Cache of analysis outputs.
+///
+/// Results are keyed on the analysis name, the content hash of every input
+/// and the hash of the parameter values. Recent results are kept in memory,
+/// up to maximumMemoryCost() kilobytes. When a directory is set, results are
+/// also written to disk, up to maximumDiskSize() bytes, and are available
+/// across sessions.
+class voAnalysisResultCache
+{
+public:
+  voAnalysisResultCache();
+  virtual ~voAnalysisResultCache();
+
+  /// Return the key of the results of \a analysis with its current inputs and
+  /// parameters, or an empty string if the results can't be cached.
+  QString cacheKey(voAnalysis * analysis);
+
+  /// SHA-1 of the data of \a dataObject. The arrays of tables and trees are
+  /// hashed directly, other data is serialized. Hashes are computed once per
+  /// modification of the data.
+  QByteArray contentHash(voDataObject * dataObject);
+
+  /// Set the outputs of \a analysis from the cache. Return false if no
+  /// result is cached for \a key.
+  bool restoreOutputs(const QString& key, voAnalysis * analysis);
+
+  /// Cache the outputs of \a analysis under \a key.
+  void storeOutputs(const QString& key, voAnalysis * analysis);
+
+  /// Return true if results are cached under \a key, in memory or on disk.
+  bool contains(const QString& key)const;
+
+  /// Remove all the cached results, in memory and on disk.
+  void clear();
+
+  int maximumMemoryCost()const;
+  void setMaximumMemoryCost(int kilobytes);
+
+  /// Results are only kept in memory if the directory is empty.
+  QString directory()const;
+  void setDirectory(const QString& path);
+
+  qint64 maximumDiskSize()const;
+  void setMaximumDiskSize(qint64 bytes);
+
+protected:
+  QScopedPointer<voAnalysisResultCachePrivate> d_ptr;
+
+private:
+  Q_DECLARE_PRIVATE(voAnalysisResultCache);
+  Q_DISABLE_COPY(voAnalysisResultCache);
+};
+
+#endif
@@ -130,8 +130,8 @@ QString voApplicationPrivate::discoverHomeDirectory()
 // voApplication methods
 
 // --------------------------------------------------------------------------
-voApplication::voApplication(int & argc, char ** argv):
-    Superclass(argc, argv), d_ptr(new voApplicationPrivate)
+voApplication::voApplication(int & argc, char ** argv, bool guiEnabled):
+    Superclass(argc, argv, guiEnabled), d_ptr(new voApplicationPrivate)
 {
   Q_D(voApplication);
   d->init();
@@ -165,7 +165,10 @@ void voApplication::initialize(bool& exitWhenDone)
   this->normalizerRegistry()->registerMethod("Log2", Normalization::applyLog2);
 //  this->normalizerRegistry()->registerMethod("Quantile", Normalization::applyQuantile);
 
-  QWebSettings::globalSettings()->setAttribute(QWebSettings::DeveloperExtrasEnabled, true);
+  if (QApplication::type() != QApplication::Tty)
+    {
+    QWebSettings::globalSettings()->setAttribute(QWebSettings::DeveloperExtrasEnabled, true);
+    }
 
   // TODO Parse command line arguments
   //d->parseArguments();
@@ -41,7 +41,9 @@ class voApplication : public QApplication
   Q_OBJECT
 public:
   typedef QApplication Superclass;
-  voApplication(int & argc, char ** argv);
+  /// Without \a guiEnabled, no window can be created and no display is
+  /// needed (see voBatchRunner).
+  voApplication(int & argc, char ** argv, bool guiEnabled = true);
   virtual ~voApplication();
 
   /// Return a reference to the application singleton
@@ -0,0 +1,552 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+// Qt includes
+#include <QDebug>
+#include <QDir>
+#include <QExplicitlySharedDataPointer>
+#include <QFile>
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QStringList>
+#include <QThread>
+#include <QThreadPool>
+
+// QtPropertyBrowser includes
+#include <QtVariantPropertyManager>
+
+// Visomics includes
+#include "voAnalysis.h"
+#include "voAnalysisFactory.h"
+#include "voApplication.h"
+#include "voBatchRunner.h"
+#include "voInputFileDataObject.h"
+#include "voIOManager.h"
+#include "voPhyloTreeReader.h"
+#include "vtkExtendedTable.h"
+
+// VTK includes
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkTree.h>
+
+// JsonCpp includes
+#include <json/json.h>
+
+// --------------------------------------------------------------------------
+class voBatchRunnerPrivate
+{
+  Q_DECLARE_PUBLIC(voBatchRunner);
+
+protected:
+  voBatchRunner* const q_ptr;
+
+public:
+  struct Dataset
+  {
+    QString Name;
+    QHash<QString, QString> FileNames; // "tree" and/or "table"
+  };
+
+  struct Analysis
+  {
+    QString Name;
+    QStringList Inputs;
+    QHash<QString, QVariant> Parameters;
+  };
+
+  // Dataset being processed: its analyses run one after another
+  struct DatasetRun
+  {
+    Dataset Description;
+    QHash<QString, QExplicitlySharedDataPointer<voDataObject> > Inputs;
+    int NextAnalysis;
+  };
+
+  voBatchRunnerPrivate(voBatchRunner& object);
+
+  static QVariant jsonToVariant(const Json::Value& value);
+  voAnalysis * createAnalysis(const Analysis& analysis)const;
+  bool convertParameters(const QString& analysisName, const Json::Value& parameters,
+                         QHash<QString, QVariant>& convertedParameters)const;
+  bool loadInputs(const Dataset& dataset,
+                  QHash<QString, QExplicitlySharedDataPointer<voDataObject> >& inputs)const;
+
+  /// Start datasets until MaximumConcurrentDatasets are processed.
+  void startDatasets();
+  /// Start the next analysis of \a datasetRun, or finish the dataset.
+  void startNextAnalysis(DatasetRun* datasetRun);
+  void finishAnalysis(voAnalysis* analysis, bool success);
+
+  QList<Dataset> Datasets;
+  QList<Analysis> Analyses;
+  QString OutputDirectory;
+  int MaximumConcurrentDatasets;
+  int FailureCount;
+
+  // State of run()
+  QList<Dataset> PendingDatasets;
+  int RunningDatasetCount;
+  QHash<voAnalysis*, DatasetRun*> RunningAnalyses;
+  QThreadPool* ThreadPool;
+  QEventLoop* EventLoop;
+};
+
+// --------------------------------------------------------------------------
+// voBatchRunnerPrivate methods
+
+// --------------------------------------------------------------------------
+voBatchRunnerPrivate::voBatchRunnerPrivate(voBatchRunner& object) : q_ptr(&object)
+{
+  this->OutputDirectory = ".";
+  this->MaximumConcurrentDatasets = QThread::idealThreadCount();
+  this->FailureCount = 0;
+  this->RunningDatasetCount = 0;
+  this->ThreadPool = 0;
+  this->EventLoop = 0;
+}
+
+// --------------------------------------------------------------------------
+QVariant voBatchRunnerPrivate::jsonToVariant(const Json::Value& value)
+{
+  if (value.isBool())
+    {
+    return value.asBool();
+    }
+  if (value.isInt())
+    {
+    return value.asInt();
+    }
+  if (value.isDouble())
+    {
+    return value.asDouble();
+    }
+  if (value.isString())
+    {
+    return QString::fromUtf8(value.asCString());
+    }
+  return QVariant();
+}
+
+// --------------------------------------------------------------------------
+voAnalysis * voBatchRunnerPrivate::createAnalysis(const Analysis& analysis)const
+{
+  voAnalysisFactory * analysisFactory = voApplication::application()->analysisFactory();
+  QString className = analysisFactory->analysisNameFromPrettyName(analysis.Name);
+  if (className.isEmpty())
+    {
+    qCritical() << "voBatchRunner - Unknown analysis:" << analysis.Name;
+    return 0;
+    }
+  return analysisFactory->createAnalysis(className);
+}
+
+// --------------------------------------------------------------------------
+bool voBatchRunnerPrivate::convertParameters(const QString& analysisName, const Json::Value& parameters,
+                                             QHash<QString, QVariant>& convertedParameters)const
+{
+  Analysis description;
+  description.Name = analysisName;
+  QScopedPointer<voAnalysis> analysis(this->createAnalysis(description));
+  if (!analysis)
+    {
+    return false;
+    }
+  analysis->initializeParameterInformation();
+
+  Json::Value::Members ids = parameters.getMemberNames();
+  for (Json::Value::Members::const_iterator it = ids.begin(); it != ids.end(); ++it)
+    {
+    QString id = QString::fromUtf8(it->c_str());
+    QtVariantProperty * property =
+      dynamic_cast<QtVariantProperty*>(analysis->propertyManager()->qtProperty(id));
+    QVariant value = jsonToVariant(parameters[*it]);
+    if (!property || !value.isValid())
+      {
+      qCritical() << "voBatchRunner - Invalid parameter" << id << "for analysis" << analysisName;
+      return false;
+      }
+    if (property->propertyType() == QtVariantPropertyManager::enumTypeId() &&
+        value.type() == QVariant::String)
+      {
+      // Enumeration values are stored as indices
+      int enumIndex = property->attributeValue("enumNames").toStringList().indexOf(value.toString());
+      if (enumIndex < 0)
+        {
+        qCritical() << "voBatchRunner - Invalid value" << value.toString()
+                    << "for parameter" << id << "of analysis" << analysisName;
+        return false;
+        }
+      value = enumIndex;
+      }
+    convertedParameters.insert(id, value);
+    }
+  return true;
+}
+
+// --------------------------------------------------------------------------
+bool voBatchRunnerPrivate::loadInputs(const Dataset& dataset,
+  QHash<QString, QExplicitlySharedDataPointer<voDataObject> >& inputs)const
+{
+  QString treeFileName = dataset.FileNames.value("tree");
+  if (!treeFileName.isEmpty())
+    {
+    voPhyloTreeReader reader;
+    if (!reader.read(treeFileName))
+      {
+      qCritical() << "voBatchRunner - Failed to read tree" << treeFileName
+                  << "-" << reader.errorString();
+      return false;
+      }
+    QList<vtkSmartPointer<vtkTree> > forest = reader.trees();
+    vtkTree * tree = forest.at(0);
+    if (forest.size() > 1)
+      {
+      qWarning() << "voBatchRunner -" << treeFileName << "holds"
+                 << forest.size() << "trees, only the first one is used";
+      }
+    inputs.insert("tree", QExplicitlySharedDataPointer<voDataObject>(
+                    new voInputFileDataObject(treeFileName, tree)));
+    }
+
+  QString tableFileName = dataset.FileNames.value("table");
+  if (!tableFileName.isEmpty())
+    {
+    vtkNew<vtkExtendedTable> extendedTable;
+    if (!voIOManager::readCSVFileIntoExtendedTable(tableFileName, extendedTable.GetPointer()))
+      {
+      qCritical() << "voBatchRunner - Failed to read table" << tableFileName;
+      return false;
+      }
+    inputs.insert("table", QExplicitlySharedDataPointer<voDataObject>(
+                    new voInputFileDataObject(tableFileName, extendedTable.GetPointer())));
+    }
+  return true;
+}
+
+// --------------------------------------------------------------------------
+void voBatchRunnerPrivate::startDatasets()
+{
+  while (this->RunningDatasetCount < this->MaximumConcurrentDatasets &&
+         !this->PendingDatasets.isEmpty())
+    {
+    DatasetRun * datasetRun = new DatasetRun;
+    datasetRun->Description = this->PendingDatasets.takeFirst();
+    datasetRun->NextAnalysis = 0;
+    if (!this->loadInputs(datasetRun->Description, datasetRun->Inputs))
+      {
+      this->FailureCount += this->Analyses.count();
+      delete datasetRun;
+      continue;
+      }
+    ++this->RunningDatasetCount;
+    this->startNextAnalysis(datasetRun);
+    }
+  if (this->RunningDatasetCount == 0 && this->PendingDatasets.isEmpty())
+    {
+    this->EventLoop->quit();
+    }
+}
+
+// --------------------------------------------------------------------------
+void voBatchRunnerPrivate::startNextAnalysis(DatasetRun* datasetRun)
+{
+  Q_Q(voBatchRunner);
+  while (datasetRun->NextAnalysis < this->Analyses.count())
+    {
+    const Analysis& description = this->Analyses.at(datasetRun->NextAnalysis++);
+    voAnalysis * analysis = this->createAnalysis(description);
+    if (!analysis)
+      {
+      ++this->FailureCount;
+      continue;
+      }
+
+    bool inputsFound = true;
+    foreach(const QString& inputName, description.Inputs)
+      {
+      inputsFound = inputsFound && datasetRun->Inputs.contains(inputName);
+      analysis->addInput(datasetRun->Inputs.value(inputName).data());
+      }
+    if (!inputsFound)
+      {
+      qCritical() << "voBatchRunner - Dataset" << datasetRun->Description.Name << "lacks the inputs"
+                  << description.Inputs.join(", ") << "of analysis" << description.Name;
+      ++this->FailureCount;
+      delete analysis;
+      continue;
+      }
+
+    analysis->initializeOutputInformation();
+    analysis->initializeParameterInformation(description.Parameters);
+    analysis->setAcceptDefaultParameterValues(true);
+    analysis->setOutputDirectory(
+      QDir(this->OutputDirectory).filePath(datasetRun->Description.Name + "/" + description.Name));
+    analysis->setWriteOutputsToFilesEnabled(true);
+
+    // Queued so that an analysis completing within run() doesn't start the
+    // next one recursively
+    this->RunningAnalyses.insert(analysis, datasetRun);
+    QObject::connect(analysis, SIGNAL(complete()),
+                     q, SLOT(onAnalysisComplete()), Qt::QueuedConnection);
+    QObject::connect(analysis, SIGNAL(error(const QString)),
+                     q, SLOT(onAnalysisError()), Qt::QueuedConnection);
+
+    if (analysis->canRunInBackground())
+      {
+      analysis->runInBackground(this->ThreadPool);
+      }
+    // Analyses depending on the state of the interface (e.g. the current view)
+    // run on this thread, one at a time
+    else if (!analysis->run())
+      {
+      this->finishAnalysis(analysis, false);
+      }
+    return;
+    }
+
+  // Every analysis of the dataset is done
+  delete datasetRun;
+  --this->RunningDatasetCount;
+  this->startDatasets();
+}
+
+// --------------------------------------------------------------------------
+void voBatchRunnerPrivate::finishAnalysis(voAnalysis* analysis, bool success)
+{
+  DatasetRun * datasetRun = this->RunningAnalyses.take(analysis);
+  if (!datasetRun)
+    {
+    return;
+    }
+  if (success)
+    {
+    qDebug() << " => Analysis" << analysis->objectName()
+             << "on dataset" << datasetRun->Description.Name << "DONE";
+    }
+  else
+    {
+    qCritical() << "voBatchRunner - Analysis" << analysis->objectName()
+                << "failed on dataset" << datasetRun->Description.Name;
+    ++this->FailureCount;
+    }
+  analysis->cancelAndWait();
+  analysis->deleteLater();
+  this->startNextAnalysis(datasetRun);
+}
+
+// --------------------------------------------------------------------------
+// voBatchRunner methods
+
+// --------------------------------------------------------------------------
+voBatchRunner::voBatchRunner(QObject* newParent):
+  Superclass(newParent), d_ptr(new voBatchRunnerPrivate(*this))
+{
+}
+
+// --------------------------------------------------------------------------
+voBatchRunner::~voBatchRunner()
+{
+}
+
+// --------------------------------------------------------------------------
+bool voBatchRunner::loadJobFile(const QString& fileName)
+{
+  QFile file(fileName);
+  if (!file.open(QIODevice::ReadOnly))
+    {
+    qCritical() << "voBatchRunner - Could not open" << fileName << "for reading!";
+    return false;
+    }
+  return this->loadJob(file.readAll(), QFileInfo(fileName).absolutePath());
+}
+
+// --------------------------------------------------------------------------
+bool voBatchRunner::loadJob(const QByteArray& json, const QString& baseDirectory)
+{
+  Q_D(voBatchRunner);
+  d->Datasets.clear();
+  d->Analyses.clear();
+
+  Json::Value job;
+  Json::Reader reader;
+  if (!reader.parse(json.constData(), json.constData() + json.size(), job) || !job.isObject())
+    {
+    qCritical() << "voBatchRunner - Invalid job file:"
+                << QString::fromStdString(reader.getFormattedErrorMessages());
+    return false;
+    }
+
+  QDir base(baseDirectory);
+  if (job.isMember("output_directory"))
+    {
+    d->OutputDirectory = base.absoluteFilePath(
+      QString::fromUtf8(job["output_directory"].asCString()));
+    }
+  if (job.isMember("maximum_concurrent_datasets"))
+    {
+    d->MaximumConcurrentDatasets = qMax(1, job["maximum_concurrent_datasets"].asInt());
+    }
+
+  const Json::Value& datasets = job["datasets"];
+  QStringList datasetNames;
+  for (Json::ArrayIndex i = 0; i < datasets.size(); ++i)
+    {
+    voBatchRunnerPrivate::Dataset dataset;
+    const char* inputNames[] = {"tree", "table"};
+    for (int input = 0; input < 2; ++input)
+      {
+      if (datasets[i].isMember(inputNames[input]))
+        {
+        dataset.FileNames.insert(inputNames[input], base.absoluteFilePath(
+          QString::fromUtf8(datasets[i][inputNames[input]].asCString())));
+        }
+      }
+    dataset.Name = QString::fromUtf8(datasets[i].get("name", "").asCString());
+    if (dataset.Name.isEmpty())
+      {
+      dataset.Name = QFileInfo(dataset.FileNames.value("tree", dataset.FileNames.value("table"))).baseName();
+      }
+    // Outputs of each dataset go in their own directory
+    if (dataset.FileNames.isEmpty() || datasetNames.contains(dataset.Name))
+      {
+      qCritical() << "voBatchRunner - Dataset" << i << "has no input or a duplicated name";
+      return false;
+      }
+    datasetNames << dataset.Name;
+    d->Datasets << dataset;
+    }
+
+  const Json::Value& analyses = job["analyses"];
+  for (Json::ArrayIndex i = 0; i < analyses.size(); ++i)
+    {
+    voBatchRunnerPrivate::Analysis analysis;
+    analysis.Name = QString::fromUtf8(analyses[i].get("name", "").asCString());
+    const Json::Value& inputs = analyses[i]["inputs"];
+    for (Json::ArrayIndex input = 0; input < inputs.size(); ++input)
+      {
+      analysis.Inputs << QString::fromUtf8(inputs[input].asCString());
+      }
+    if (analysis.Inputs.isEmpty())
+      {
+      analysis.Inputs << "tree";
+      }
+    if (!d->convertParameters(analysis.Name, analyses[i]["parameters"], analysis.Parameters))
+      {
+      return false;
+      }
+    d->Analyses << analysis;
+    }
+
+  if (d->Datasets.isEmpty() || d->Analyses.isEmpty())
+    {
+    qCritical() << "voBatchRunner - Job has no dataset or no analysis";
+    return false;
+    }
+  return true;
+}
+
+// --------------------------------------------------------------------------
+int voBatchRunner::datasetCount()const
+{
+  Q_D(const voBatchRunner);
+  return d->Datasets.count();
+}
+
+// --------------------------------------------------------------------------
+int voBatchRunner::analysisCount()const
+{
+  Q_D(const voBatchRunner);
+  return d->Analyses.count();
+}
+
+// --------------------------------------------------------------------------
+QString voBatchRunner::outputDirectory()const
+{
+  Q_D(const voBatchRunner);
+  return d->OutputDirectory;
+}
+
+// --------------------------------------------------------------------------
+void voBatchRunner::setOutputDirectory(const QString& directory)
+{
+  Q_D(voBatchRunner);
+  d->OutputDirectory = directory;
+}
+
+// --------------------------------------------------------------------------
+int voBatchRunner::maximumConcurrentDatasets()const
+{
+  Q_D(const voBatchRunner);
+  return d->MaximumConcurrentDatasets;
+}
+
+// --------------------------------------------------------------------------
+void voBatchRunner::setMaximumConcurrentDatasets(int maximum)
+{
+  Q_D(voBatchRunner);
+  d->MaximumConcurrentDatasets = qMax(1, maximum);
+}
+
+// --------------------------------------------------------------------------
+int voBatchRunner::run()
+{
+  Q_D(voBatchRunner);
+  d->FailureCount = 0;
+
+  // Analyses are created and their results handled on this thread, only
+  // voAnalysis::execute() runs on the thread pool.
+  QThreadPool threadPool;
+  threadPool.setMaxThreadCount(d->MaximumConcurrentDatasets);
+  QEventLoop eventLoop;
+  d->ThreadPool = &threadPool;
+  d->EventLoop = &eventLoop;
+  d->PendingDatasets = d->Datasets;
+  d->RunningDatasetCount = 0;
+
+  // Started from the event loop, which must be running to be quit
+  QMetaObject::invokeMethod(this, "startDatasets", Qt::QueuedConnection);
+  eventLoop.exec();
+
+  d->ThreadPool = 0;
+  d->EventLoop = 0;
+  return d->FailureCount;
+}
+
+// --------------------------------------------------------------------------
+void voBatchRunner::startDatasets()
+{
+  Q_D(voBatchRunner);
+  d->startDatasets();
+}
+
+// --------------------------------------------------------------------------
+void voBatchRunner::onAnalysisComplete()
+{
+  Q_D(voBatchRunner);
+  d->finishAnalysis(qobject_cast<voAnalysis*>(this->sender()), true);
+}
+
+// --------------------------------------------------------------------------
+void voBatchRunner::onAnalysisError()
+{
+  Q_D(voBatchRunner);
+  d->finishAnalysis(qobject_cast<voAnalysis*>(this->sender()), false);
+}
@@ -0,0 +1,99 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+#ifndef __voBatchRunner_h
+#define __voBatchRunner_h
+
+// Qt includes
+#include <QObject>
+#include <QScopedPointer>
+#include <QString>
+
+class voBatchRunnerPrivate;
+
+/// Run analyses on a list of datasets without the graphical interface.
+///
+/// The job is described by a JSON file:
+///
+/// \code
+/// {
+///   "output_directory": "results",
+///   "maximum_concurrent_datasets": 8,
+///   "datasets": [
+///     { "name": "anolis", "tree": "anolis.phy", "table": "anolisDataAppended.csv" }
+///   ],
+///   "analyses": [
+///     { "name": "Tree Drop Tip With Data", "inputs": ["tree", "table"],
+///       "parameters": { "selection_method": "Data Filter", "input_string": "awesomeness<2" } }
+///   ]
+/// }
+/// \endcode
+///
+/// Relative paths are resolved against the directory of the job file.
+/// Every analysis is run on every dataset, and the outputs are written with
+/// voAnalysis::writeOutputsToFiles() into
+/// <output_directory>/<dataset name>/<analysis name>. Datasets are processed
+/// in parallel, the analyses of a dataset one after another. Analyses are
+/// created on the thread of the runner and executed on a thread pool, except
+/// those that can't run in the background, which run one at a time on the
+/// thread of the runner.
+///
+/// Analyses defined by scripts run on the remote analysis server and are not
+/// available in batch mode.
+class voBatchRunner : public QObject
+{
+  Q_OBJECT
+public:
+  typedef QObject Superclass;
+  voBatchRunner(QObject* newParent = 0);
+  virtual ~voBatchRunner();
+
+  /// Read the job description. Return false if it is invalid.
+  bool loadJobFile(const QString& fileName);
+  bool loadJob(const QByteArray& json, const QString& baseDirectory);
+
+  int datasetCount()const;
+  int analysisCount()const;
+
+  QString outputDirectory()const;
+  void setOutputDirectory(const QString& directory);
+
+  /// Defaults to the number of cores.
+  int maximumConcurrentDatasets()const;
+  void setMaximumConcurrentDatasets(int maximum);
+
+  /// Run every analysis on every dataset and wait for them to be done.
+  /// Return the number of analyses that failed.
+  int run();
+
+protected slots:
+  void startDatasets();
+  void onAnalysisComplete();
+  void onAnalysisError();
+
+protected:
+  QScopedPointer<voBatchRunnerPrivate> d_ptr;
+
+private:
+  Q_DECLARE_PRIVATE(voBatchRunner);
+  Q_DISABLE_COPY(voBatchRunner);
+};
+
+#endif
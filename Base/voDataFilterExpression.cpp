@@ -0,0 +1,571 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+// Qt includes
+#include <QList>
+#include <QObject>
+
+// Visomics includes
+#include "voDataFilterExpression.h"
+
+// VTK includes
+#include <vtkAbstractArray.h>
+#include <vtkDataArray.h>
+#include <vtkSmartPointer.h>
+#include <vtkStringArray.h>
+#include <vtkTable.h>
+#include <vtkVariant.h>
+
+// STD includes
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+enum OperatorType
+{
+  LessThan,
+  LessOrEqual,
+  GreaterThan,
+  GreaterOrEqual,
+  Equal,
+  NotEqual
+};
+
+// Numbers closer than this are considered equal
+const double Epsilon = 1e-5;
+
+// --------------------------------------------------------------------------
+struct Token
+{
+  enum TokenType
+    {
+    Word,
+    String,
+    Operator,
+    And,
+    Or,
+    Not,
+    LeftParenthesis,
+    RightParenthesis,
+    End
+    };
+  Token(TokenType type = End, const QString& text = QString(), int position = 0):
+    Type(type), Text(text), Comparison(Equal), Position(position){}
+  TokenType Type;
+  QString Text;
+  int Comparison; // Operator tokens only
+  int Position;
+};
+
+// --------------------------------------------------------------------------
+struct Predicate
+{
+  vtkAbstractArray * Column;
+  int Operator;
+  bool IsString;
+  double Number;
+  std::string String;
+};
+
+// --------------------------------------------------------------------------
+// Instructions of the compiled program, in postfix order
+struct Instruction
+{
+  enum InstructionType
+    {
+    Compare,
+    And,
+    Or,
+    Not
+    };
+  Instruction(InstructionType type, int predicate = -1):Type(type), PredicateIndex(predicate){}
+  InstructionType Type;
+  int PredicateIndex;
+};
+
+// --------------------------------------------------------------------------
+bool compareNumber(double value, int op, double threshold)
+{
+  switch (op)
+    {
+    case LessThan: return value < threshold;
+    case LessOrEqual: return value <= threshold;
+    case GreaterThan: return value > threshold;
+    case GreaterOrEqual: return value >= threshold;
+    case Equal: return std::fabs(value - threshold) < Epsilon;
+    case NotEqual: return !(std::fabs(value - threshold) < Epsilon);
+    }
+  return false;
+}
+
+// --------------------------------------------------------------------------
+// Compare a whole column at once. The results are written to a byte mask
+// rather than to the bit array: the loops are kept free of any branch or
+// dispatch so that the compiler can vectorize the comparisons.
+template <class T>
+void compareNumbers(const T * values, vtkIdType count, int op, double threshold,
+                    unsigned char * mask)
+{
+  switch (op)
+    {
+    case LessThan:
+      for (vtkIdType i = 0; i < count; ++i)
+        {
+        mask[i] = static_cast<double>(values[i]) < threshold;
+        }
+      break;
+    case LessOrEqual:
+      for (vtkIdType i = 0; i < count; ++i)
+        {
+        mask[i] = static_cast<double>(values[i]) <= threshold;
+        }
+      break;
+    case GreaterThan:
+      for (vtkIdType i = 0; i < count; ++i)
+        {
+        mask[i] = static_cast<double>(values[i]) > threshold;
+        }
+      break;
+    case GreaterOrEqual:
+      for (vtkIdType i = 0; i < count; ++i)
+        {
+        mask[i] = static_cast<double>(values[i]) >= threshold;
+        }
+      break;
+    case Equal:
+      for (vtkIdType i = 0; i < count; ++i)
+        {
+        mask[i] = std::fabs(static_cast<double>(values[i]) - threshold) < Epsilon;
+        }
+      break;
+    case NotEqual:
+      for (vtkIdType i = 0; i < count; ++i)
+        {
+        mask[i] = !(std::fabs(static_cast<double>(values[i]) - threshold) < Epsilon);
+        }
+      break;
+    }
+}
+
+} // end of anonymous namespace
+
+// --------------------------------------------------------------------------
+class voDataFilterExpressionPrivate
+{
+public:
+  voDataFilterExpressionPrivate();
+
+  bool tokenize(const QString& expression);
+  bool parseOr();
+  bool parseAnd();
+  bool parseUnary();
+  bool parseComparison();
+  bool setError(const QString& message);
+
+  const Token& current()const { return this->Tokens.at(this->Current); }
+
+  void evaluatePredicate(const Predicate& predicate, QBitArray& rows)const;
+
+  vtkSmartPointer<vtkTable> Table;
+  QList<Token> Tokens;
+  int Current;
+  QList<Predicate> Predicates;
+  QList<Instruction> Program;
+  bool Valid;
+  QString ErrorString;
+};
+
+// --------------------------------------------------------------------------
+// voDataFilterExpressionPrivate methods
+
+// --------------------------------------------------------------------------
+voDataFilterExpressionPrivate::voDataFilterExpressionPrivate()
+{
+  this->Current = 0;
+  this->Valid = false;
+}
+
+// --------------------------------------------------------------------------
+bool voDataFilterExpressionPrivate::setError(const QString& message)
+{
+  int position = this->Tokens.isEmpty() ? 0 : this->current().Position;
+  this->ErrorString = QObject::tr("%1 (at character %2)").arg(message).arg(position + 1);
+  return false;
+}
+
+// --------------------------------------------------------------------------
+bool voDataFilterExpressionPrivate::tokenize(const QString& expression)
+{
+  const QString specialCharacters("<>=!,&|()\"");
+  this->Tokens.clear();
+  int i = 0;
+  while (i < expression.size())
+    {
+    QChar c = expression.at(i);
+    QChar next = i + 1 < expression.size() ? expression.at(i + 1) : QChar();
+    if (c == '(' || c == ')')
+      {
+      this->Tokens << Token(c == '(' ? Token::LeftParenthesis : Token::RightParenthesis, c, i);
+      ++i;
+      }
+    else if (c == ',' || c == '&' || c == '|')
+      {
+      this->Tokens << Token(c == '|' ? Token::Or : Token::And, c, i);
+      // "&&" and "||" are accepted too
+      i += (c != ',' && next == c) ? 2 : 1;
+      }
+    else if (c == '!' && next != '=')
+      {
+      this->Tokens << Token(Token::Not, c, i);
+      ++i;
+      }
+    else if (c == '<' || c == '>' || c == '=' || c == '!')
+      {
+      Token token(Token::Operator, c, i);
+      bool orEqual = (next == '=');
+      if (c == '<')
+        {
+        token.Comparison = orEqual ? LessOrEqual : LessThan;
+        }
+      else if (c == '>')
+        {
+        token.Comparison = orEqual ? GreaterOrEqual : GreaterThan;
+        }
+      else
+        {
+        token.Comparison = (c == '!') ? NotEqual : Equal;
+        }
+      this->Tokens << token;
+      i += orEqual ? 2 : 1;
+      }
+    else if (c == '"')
+      {
+      int end = expression.indexOf('"', i + 1);
+      if (end < 0)
+        {
+        this->ErrorString = QObject::tr("Missing closing quote (at character %1)").arg(i + 1);
+        return false;
+        }
+      this->Tokens << Token(Token::String, expression.mid(i + 1, end - i - 1), i);
+      i = end + 1;
+      }
+    else
+      {
+      int start = i;
+      while (i < expression.size() && !specialCharacters.contains(expression.at(i)))
+        {
+        ++i;
+        }
+      QString word = expression.mid(start, i - start).trimmed();
+      if (!word.isEmpty())
+        {
+        this->Tokens << Token(Token::Word, word, start);
+        }
+      }
+    }
+  this->Tokens << Token(Token::End, QString(), expression.size());
+  return true;
+}
+
+// --------------------------------------------------------------------------
+bool voDataFilterExpressionPrivate::parseOr()
+{
+  if (!this->parseAnd())
+    {
+    return false;
+    }
+  while (this->current().Type == Token::Or)
+    {
+    ++this->Current;
+    if (!this->parseAnd())
+      {
+      return false;
+      }
+    this->Program << Instruction(Instruction::Or);
+    }
+  return true;
+}
+
+// --------------------------------------------------------------------------
+bool voDataFilterExpressionPrivate::parseAnd()
+{
+  if (!this->parseUnary())
+    {
+    return false;
+    }
+  while (this->current().Type == Token::And)
+    {
+    ++this->Current;
+    if (!this->parseUnary())
+      {
+      return false;
+      }
+    this->Program << Instruction(Instruction::And);
+    }
+  return true;
+}
+
+// --------------------------------------------------------------------------
+bool voDataFilterExpressionPrivate::parseUnary()
+{
+  if (this->current().Type == Token::Not)
+    {
+    ++this->Current;
+    if (!this->parseUnary())
+      {
+      return false;
+      }
+    this->Program << Instruction(Instruction::Not);
+    return true;
+    }
+  if (this->current().Type == Token::LeftParenthesis)
+    {
+    ++this->Current;
+    if (!this->parseOr())
+      {
+      return false;
+      }
+    if (this->current().Type != Token::RightParenthesis)
+      {
+      return this->setError(QObject::tr("Expected \")\""));
+      }
+    ++this->Current;
+    return true;
+    }
+  return this->parseComparison();
+}
+
+// --------------------------------------------------------------------------
+bool voDataFilterExpressionPrivate::parseComparison()
+{
+  if (this->current().Type != Token::Word && this->current().Type != Token::String)
+    {
+    return this->setError(QObject::tr("Expected a column name"));
+    }
+  QString columnName = this->current().Text;
+  vtkAbstractArray * column = this->Table->GetColumnByName(columnName.toStdString().c_str());
+  if (!column)
+    {
+    return this->setError(QObject::tr("Unknown column \"%1\"").arg(columnName));
+    }
+  ++this->Current;
+
+  if (this->current().Type != Token::Operator)
+    {
+    return this->setError(QObject::tr("Expected <, <=, >, >=, = or != after \"%1\"").arg(columnName));
+    }
+  Predicate predicate;
+  predicate.Column = column;
+  predicate.Operator = this->current().Comparison;
+  predicate.Number = 0.;
+  ++this->Current;
+
+  const Token& value = this->current();
+  if (value.Type == Token::String)
+    {
+    if (predicate.Operator != Equal && predicate.Operator != NotEqual)
+      {
+      return this->setError(QObject::tr("Strings can only be compared with = or !="));
+      }
+    predicate.IsString = true;
+    predicate.String = value.Text.toStdString();
+    }
+  else if (value.Type == Token::Word)
+    {
+    bool ok = false;
+    predicate.IsString = false;
+    predicate.Number = value.Text.toDouble(&ok);
+    if (!ok)
+      {
+      return this->setError(QObject::tr("Expected a number or a quoted string instead of \"%1\"").arg(value.Text));
+      }
+    }
+  else
+    {
+    return this->setError(QObject::tr("Expected a number or a quoted string"));
+    }
+  ++this->Current;
+
+  this->Program << Instruction(Instruction::Compare, this->Predicates.size());
+  this->Predicates << predicate;
+  return true;
+}
+
+// --------------------------------------------------------------------------
+void voDataFilterExpressionPrivate::evaluatePredicate(const Predicate& predicate, QBitArray& rows)const
+{
+  vtkAbstractArray * column = predicate.Column;
+  vtkIdType count = qMin(static_cast<vtkIdType>(rows.size()), column->GetNumberOfTuples());
+
+  if (predicate.IsString)
+    {
+    vtkStringArray * strings = vtkStringArray::SafeDownCast(column);
+    bool equal = (predicate.Operator == Equal);
+    for (vtkIdType i = 0; i < count; ++i)
+      {
+      bool same = strings ? strings->GetValue(i) == predicate.String
+        : column->GetVariantValue(i).ToString() == predicate.String;
+      if (same == equal)
+        {
+        rows.setBit(i);
+        }
+      }
+    return;
+    }
+
+  vtkDataArray * dataArray = vtkDataArray::SafeDownCast(column);
+  bool compared = false;
+  if (dataArray && dataArray->GetNumberOfComponents() == 1 && count > 0)
+    {
+    std::vector<unsigned char> mask(count);
+    switch (dataArray->GetDataType())
+      {
+      // Bit arrays are not handled by vtkTemplateMacro
+      vtkTemplateMacro(compareNumbers(static_cast<VTK_TT*>(dataArray->GetVoidPointer(0)),
+                                      count, predicate.Operator, predicate.Number, &mask[0]);
+                       compared = true);
+      }
+    for (vtkIdType i = 0; compared && i < count; ++i)
+      {
+      rows.setBit(i, mask[i]);
+      }
+    }
+  if (!compared)
+    {
+    // String, variant or bit columns
+    for (vtkIdType i = 0; i < count; ++i)
+      {
+      if (compareNumber(column->GetVariantValue(i).ToDouble(), predicate.Operator, predicate.Number))
+        {
+        rows.setBit(i);
+        }
+      }
+    }
+}
+
+// --------------------------------------------------------------------------
+// voDataFilterExpression methods
+
+// --------------------------------------------------------------------------
+voDataFilterExpression::voDataFilterExpression():d_ptr(new voDataFilterExpressionPrivate)
+{
+}
+
+// --------------------------------------------------------------------------
+voDataFilterExpression::~voDataFilterExpression()
+{
+}
+
+// --------------------------------------------------------------------------
+bool voDataFilterExpression::compile(const QString& expression, vtkTable * table)
+{
+  Q_D(voDataFilterExpression);
+  d->Table = table;
+  d->Tokens.clear();
+  d->Current = 0;
+  d->Predicates.clear();
+  d->Program.clear();
+  d->ErrorString.clear();
+  d->Valid = false;
+
+  if (!table)
+    {
+    d->ErrorString = QObject::tr("No table to filter");
+    return false;
+    }
+  if (!d->tokenize(expression))
+    {
+    return false;
+    }
+  if (d->current().Type == Token::End)
+    {
+    return d->setError(QObject::tr("Empty expression"));
+    }
+  if (!d->parseOr())
+    {
+    return false;
+    }
+  if (d->current().Type != Token::End)
+    {
+    return d->setError(QObject::tr("Unexpected \"%1\"").arg(d->current().Text));
+    }
+  d->Tokens.clear();
+  d->Valid = true;
+  return true;
+}
+
+// --------------------------------------------------------------------------
+bool voDataFilterExpression::isValid()const
+{
+  Q_D(const voDataFilterExpression);
+  return d->Valid;
+}
+
+// --------------------------------------------------------------------------
+QString voDataFilterExpression::errorString()const
+{
+  Q_D(const voDataFilterExpression);
+  return d->ErrorString;
+}
+
+// --------------------------------------------------------------------------
+QBitArray voDataFilterExpression::evaluate()const
+{
+  Q_D(const voDataFilterExpression);
+  if (!d->Valid)
+    {
+    return QBitArray();
+    }
+  int numberOfRows = static_cast<int>(d->Table->GetNumberOfRows());
+  QList<QBitArray> stack;
+  foreach(const Instruction& instruction, d->Program)
+    {
+    switch (instruction.Type)
+      {
+      case Instruction::Compare:
+        {
+        QBitArray rows(numberOfRows);
+        d->evaluatePredicate(d->Predicates.at(instruction.PredicateIndex), rows);
+        stack << rows;
+        break;
+        }
+      case Instruction::And:
+        {
+        QBitArray rows = stack.takeLast();
+        stack.last() &= rows;
+        break;
+        }
+      case Instruction::Or:
+        {
+        QBitArray rows = stack.takeLast();
+        stack.last() |= rows;
+        break;
+        }
+      case Instruction::Not:
+        stack.last() = ~stack.last();
+        break;
+      }
+    }
+  Q_ASSERT(stack.size() == 1);
+  return stack.last();
+}
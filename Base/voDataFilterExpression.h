@@ -0,0 +1,74 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+#ifndef __voDataFilterExpression_h
+#define __voDataFilterExpression_h
+
+// Qt includes
+#include <QBitArray>
+#include <QScopedPointer>
+#include <QString>
+
+class voDataFilterExpressionPrivate;
+class vtkTable;
+
+/// Condition on the columns of a table, e.g. to select the tips of a tree
+/// from their traits:
+/// \code
+/// awesomeness<2,island="Cuba"
+/// (length>=1.5 | length<0.1) & !(island="Cuba")
+/// \endcode
+///
+/// A condition compares a column with a number (<, <=, >, >=, = or !=) or
+/// with a quoted string (= or !=). Conditions are combined with "," or "&"
+/// (and), "|" (or), "!" (not) and parentheses. Column names containing
+/// operators may be quoted.
+///
+/// The expression is compiled once against a table: column names are
+/// resolved and numbers are parsed. evaluate() then applies each condition
+/// to a whole column at a time and combines the resulting row masks.
+class voDataFilterExpression
+{
+public:
+  voDataFilterExpression();
+  virtual ~voDataFilterExpression();
+
+  /// Parse \a expression and resolve its columns in \a table. Return false
+  /// and set errorString() if the expression is invalid.
+  /// The expression must be compiled again if the columns of \a table change.
+  bool compile(const QString& expression, vtkTable * table);
+
+  bool isValid()const;
+
+  QString errorString()const;
+
+  /// Return a mask with the bits of the rows satisfying the expression set,
+  /// or an empty mask if the expression is not valid.
+  QBitArray evaluate()const;
+
+protected:
+  QScopedPointer<voDataFilterExpressionPrivate> d_ptr;
+
+private:
+  Q_DECLARE_PRIVATE(voDataFilterExpression);
+  Q_DISABLE_COPY(voDataFilterExpression);
+};
+
+#endif
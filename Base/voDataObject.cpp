@@ -20,6 +20,7 @@
 
 // Qt includes
 #include <QDebug>
+#include <QMutex>
 #include <QUuid>
 #include <QVariant>
 #include <QtVariantProperty>
@@ -31,6 +32,7 @@
 
 // VTK includes
 #include <vtkDataObject.h>
+#include <vtkTree.h>
 
 class voDataObjectPrivate
 {
@@ -41,6 +43,8 @@ public:
   QString                        Name;
   QString                        Uuid;
   QVariant                       Data;
+  mutable QMutex                 TreeNameIndexMutex;
+  mutable voTreeNameIndex        TreeNameIndex;
 };
 
 // --------------------------------------------------------------------------
@@ -218,6 +222,10 @@ void voDataObject::setData(const QVariant& newData)
        variantProp->setValue(dataType);
       }
     }
+
+  // Trees are indexed as soon as they enter the data model, so that the
+  // analyses and views using them share the same index.
+  this->treeNameIndex();
 }
 
 // --------------------------------------------------------------------------
@@ -284,3 +292,53 @@ bool voDataObject::isVTKDataObject()const
 {
   return voDataObject::isVTKDataObject(const_cast<voDataObject*>(this));
 }
+
+// --------------------------------------------------------------------------
+vtkSmartPointer<vtkDataObject> voDataObject::sharedDataCopy()const
+{
+  vtkDataObject * dataObject = this->isVTKDataObject() ? this->dataAsVTKDataObject() : 0;
+  if (!dataObject)
+    {
+    return 0;
+    }
+  // Graphs share their edge lists until the copy is modified
+  vtkSmartPointer<vtkDataObject> copy;
+  copy.TakeReference(dataObject->NewInstance());
+  copy->ShallowCopy(dataObject);
+  return copy;
+}
+
+// --------------------------------------------------------------------------
+voTreeNameIndex voDataObject::treeNameIndex()const
+{
+  Q_D(const voDataObject);
+  vtkTree * tree = this->isVTKDataObject() ? vtkTree::SafeDownCast(this->dataAsVTKDataObject()) : 0;
+  QMutexLocker locker(&d->TreeNameIndexMutex);
+  if (!tree)
+    {
+    d->TreeNameIndex = voTreeNameIndex();
+    }
+  else if (!d->TreeNameIndex.isUpToDate(tree))
+    {
+    d->TreeNameIndex = voTreeNameIndex(tree);
+    }
+  return d->TreeNameIndex;
+}
+
+// --------------------------------------------------------------------------
+void voDataObject::setTimingProperty(const QString& name, const QString& value)
+{
+  Q_D(voDataObject);
+  foreach(QtProperty * prop, d->VariantPropertyManager->properties())
+    {
+    QtVariantProperty * variantProp = dynamic_cast<QtVariantProperty*> (prop);
+    if (variantProp && variantProp->propertyName() == name)
+      {
+      variantProp->setValue(value);
+      return;
+      }
+    }
+  QtVariantProperty * timingProperty = d->VariantPropertyManager->addProperty(QVariant::String, name);
+  timingProperty->setValue(value);
+  emit this->timingsChanged();
+}
@@ -28,7 +28,11 @@
 #include <QObject>
 #include <QString>
 
+// Visomics includes
+#include "voTreeNameIndex.h"
+
 // VTK includes
+#include <vtkSmartPointer.h>
 #include <vtkVariant.h>
 
 class QVariant;
@@ -71,6 +75,26 @@ public:
 
   bool isVTKDataObject()const;
 
+  /// Return a copy of the VTK data that shares its arrays, and for trees its
+  /// structure, with this data object. Adding, removing or replacing arrays,
+  /// rows or vertices in the copy leaves this data object untouched; arrays
+  /// modified in place must first be detached with voUtils::detachArray().
+  /// Return a null pointer if the data is not a VTK data object.
+  vtkSmartPointer<vtkDataObject> sharedDataCopy()const;
+
+  /// Return the index of the vertex names of the tree held by the data
+  /// object, or an empty index if the data is not a tree. The index is built
+  /// when the tree is set and rebuilt only if its names are modified.
+  /// This method is thread-safe.
+  voTreeNameIndex treeNameIndex()const;
+
+  /// Set the read-only property \a name, e.g. "Import time", to \a value.
+  /// See voTrace.
+  Q_INVOKABLE void setTimingProperty(const QString& name, const QString& value);
+
+signals:
+  void timingsChanged();
+
 protected:
   QScopedPointer<voDataObjectPrivate> d_ptr;
 
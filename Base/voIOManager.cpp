@@ -27,17 +27,13 @@
 #include <QMessageBox>
 #include <QStandardItem>
 #include <QXmlStreamWriter>
-#include <QErrorMessage>
+#include <QDesktopServices>
+#include <QSettings>
 
 // QtPropertyBrowser includes
 #include <QtVariantPropertyManager>
 #include <QtVariantProperty>
 
-#include <QNetworkAccessManager>
-#include <QUrl>
-#include <QNetworkReply>
-#include <QNetworkRequest>
-
 // Visomics includes
 #include "voAnalysis.h"
 #include "voAnalysisDriver.h"
@@ -46,8 +42,12 @@
 #include "voDataModelItem.h"
 #include "voInputFileDataObject.h"
 #include "voIOManager.h"
+#include "voOpenTreeFetcher.h"
+#include "voPhyloTreeReader.h"
 #include "voRegistry.h"
+#include "voTrace.h"
 #include "voUtils.h"
+#include "voWorkflowScheduler.h"
 #include "vtkExtendedTable.h"
 
 // VTK includes
@@ -59,20 +59,35 @@
 #include <vtkSmartPointer.h>
 #include <vtkStringArray.h>
 #include <vtkTable.h>
-#include <vtkMultiNewickTreeReader.h>
-#include <vtkNewickTreeReader.h>
-#include <vtkMultiPieceDataSet.h>
 #include <vtkGraphLayoutView.h>
 #include <vtkTree.h>
 
 // --------------------------------------------------------------------------
 voIOManager::voIOManager()
 {
+  this->OpenTreeFetcher = 0;
 }
 
 // --------------------------------------------------------------------------
 voIOManager::~voIOManager()
 {
+  delete this->OpenTreeFetcher;
+}
+
+// --------------------------------------------------------------------------
+voOpenTreeFetcher * voIOManager::openTreeFetcher()
+{
+  // Created on first use: the application may not be created yet
+  if (!this->OpenTreeFetcher)
+    {
+    this->OpenTreeFetcher = new voOpenTreeFetcher;
+    QSettings settings("Kitware", "Visomics");
+    this->OpenTreeFetcher->setCacheDirectory(settings.value("openTreeCacheDirectory",
+      QDesktopServices::storageLocation(QDesktopServices::CacheLocation) + "/OpenTreeOfLife").toString());
+    this->OpenTreeFetcher->setMaximumCacheAge(settings.value("openTreeCacheMaximumAge",
+      this->OpenTreeFetcher->maximumCacheAge()).toInt());
+    }
+  return this->OpenTreeFetcher;
 }
 
 // --------------------------------------------------------------------------
@@ -83,6 +98,9 @@ bool voIOManager::readCSVFileIntoTable(const QString& fileName, vtkTable * outpu
     return false;
     }
 
+  voTrace::Scope traceScope("import", fileName);
+  traceScope.addBytes(QFileInfo(fileName).size());
+
   vtkNew<vtkDelimitedTextReader> reader;
   reader->SetFileName(fileName.toLatin1());
 
@@ -165,6 +183,8 @@ bool voIOManager::writeTableToCVSFile(vtkTable* table, const QString& fileName)
 void voIOManager::fillExtendedTable(vtkTable* sourceTable, vtkExtendedTable* destTable,
                                     const voDelimitedTextImportSettings& settings)
 {
+  voTrace::Scope traceScope("conversion", "vtkExtendedTable");
+
   // vtkExtendedTable settings
   bool transpose = settings.value(voDelimitedTextImportSettings::Transpose).toBool();
   if (transpose)
@@ -340,10 +360,15 @@ void voIOManager::fillExtendedTable(vtkTable* sourceTable, vtkExtendedTable* des
 void voIOManager::openCSVFile(const QString& fileName, const voDelimitedTextImportSettings& settings)
 {
   vtkNew<vtkExtendedTable> extendedTable;
-  Self::readCSVFileIntoExtendedTable(fileName, extendedTable.GetPointer(),
-                                     settings);
-  voInputFileDataObject * dataObject =
-      new voInputFileDataObject(fileName, extendedTable.GetPointer());
+  voInputFileDataObject * dataObject = 0;
+    {
+    voTrace::Scope traceScope("import", fileName);
+    traceScope.addBytes(QFileInfo(fileName).size());
+    Self::readCSVFileIntoExtendedTable(fileName, extendedTable.GetPointer(),
+                                       settings);
+    dataObject = new voInputFileDataObject(fileName, extendedTable.GetPointer());
+    traceScope.addDataObject(dataObject);
+    }
 
   tableSettings.insert(dataObject, const_cast<voDelimitedTextImportSettings&>(settings));
 
@@ -359,21 +384,26 @@ void voIOManager::openCSVFile(const QString& fileName, const voDelimitedTextImpo
 void voIOManager::loadPhyloTreeDataSet(const QString& fileName)
 {
   // load the phylo tree data set file
-  vtkSmartPointer<vtkMultiNewickTreeReader> reader =
-        vtkSmartPointer<vtkMultiNewickTreeReader>::New();
-
-  reader->SetFileName(fileName.toStdString().c_str());
-  vtkMultiPieceDataSet * forest = reader->GetOutput();
-  reader->Update();
+  voPhyloTreeReader reader;
+  double importStart = voTrace::now();
+  if (!reader.read(fileName))
+    {
+    qCritical() << "Failed to read" << fileName << "-" << reader.errorString();
+    return;
+    }
+  QList<vtkSmartPointer<vtkTree> > forest = reader.trees();
+  voTrace::Event importEvent = voTrace::addEvent(
+    "import", fileName, importStart, QFileInfo(fileName).size());
 
 
   voDataModel * model = voApplication::application()->dataModel();
 
-  if (forest->GetNumberOfPieces() == 1)
+  if (forest.size() == 1)
      { //single tree
-     vtkTree * tree =  vtkTree::SafeDownCast( forest->GetPieceAsDataObject(0));
+     vtkTree * tree =  forest.at(0);
      voInputFileDataObject * dataObject =
        new voInputFileDataObject(fileName, tree);
+     voTrace::recordTiming(dataObject, importEvent);
      voDataModelItem * newItem = model->addDataObject(dataObject);
      newItem->setRawViewType("voTreeHeatmapView");
 
@@ -383,11 +413,14 @@ void voIOManager::loadPhyloTreeDataSet(const QString& fileName)
      {//multiple trees --forest
      voDataObject * emptyDataObject = new voDataObject(QFileInfo(fileName).baseName(),NULL);
      voDataModelItem * newForestItem = model->addDataObject(emptyDataObject);
-     for (unsigned int i = 0; i < forest->GetNumberOfPieces(); i++)
+     QStringList treeNames = reader.treeNames();
+     for (int i = 0; i < forest.size(); i++)
        {
-       vtkTree * tree =  vtkTree::SafeDownCast( forest->GetPieceAsDataObject(i));
-       QString displayName = QString("tree-%1").arg(QString::number(i));
+       vtkTree * tree =  forest.at(i);
+       QString displayName = treeNames.at(i).isEmpty() ?
+         QString("tree-%1").arg(QString::number(i)) : treeNames.at(i);
        voInputFileDataObject * dataObject = new voInputFileDataObject(displayName, tree);
+       voTrace::recordTiming(dataObject, importEvent);
        voDataModelItem * treeItem = model->addDataObjectAsChild(dataObject, newForestItem);
        treeItem->setRawViewType("voTreeHeatmapView");
 
@@ -402,29 +435,40 @@ void voIOManager::loadPhyloTreeDataSet(const QString& fileName,
   const QString & tableFileName, const voDelimitedTextImportSettings& settings )
 {
   // load the phylo tree
-  vtkSmartPointer<vtkMultiNewickTreeReader> reader =
-        vtkSmartPointer<vtkMultiNewickTreeReader>::New();
-  reader->SetFileName(fileName.toStdString().c_str());
-  vtkMultiPieceDataSet * forest = reader->GetOutput();
-  reader->Update();
+  voPhyloTreeReader reader;
+  double importStart = voTrace::now();
+  if (!reader.read(fileName))
+    {
+    qCritical() << "Failed to read" << fileName << "-" << reader.errorString();
+    return;
+    }
+  QList<vtkSmartPointer<vtkTree> > forest = reader.trees();
+  voTrace::Event importEvent = voTrace::addEvent(
+    "import", fileName, importStart, QFileInfo(fileName).size());
 
   // load the associated table data
   vtkNew<vtkExtendedTable> extendedTable;
-  Self::readCSVFileIntoExtendedTable(tableFileName, extendedTable.GetPointer(),
-                                     settings);
-  voInputFileDataObject * tableObject = new voInputFileDataObject(
-    tableFileName, extendedTable.GetPointer());
+  voInputFileDataObject * tableObject = 0;
+    {
+    voTrace::Scope traceScope("import", tableFileName);
+    traceScope.addBytes(QFileInfo(tableFileName).size());
+    Self::readCSVFileIntoExtendedTable(tableFileName, extendedTable.GetPointer(),
+                                       settings);
+    tableObject = new voInputFileDataObject(tableFileName, extendedTable.GetPointer());
+    traceScope.addDataObject(tableObject);
+    }
 
   tableSettings.insert(tableObject,
                        const_cast<voDelimitedTextImportSettings&>(settings));
 
   //single tree
-  if (forest->GetNumberOfPieces() == 1)
+  if (forest.size() == 1)
     {
-    vtkTree * tree =  vtkTree::SafeDownCast( forest->GetPieceAsDataObject(0));
+    vtkTree * tree =  forest.at(0);
 
     voInputFileDataObject * treeObject =
       new voInputFileDataObject(fileName, tree);
+    voTrace::recordTiming(treeObject, importEvent);
 
     this->createTreeHeatmapItem(
       "TreeHeatmap",
@@ -436,11 +480,14 @@ void voIOManager::loadPhyloTreeDataSet(const QString& fileName,
   else
     {
     QList<voDataObject *> treeObjects;
-    for (unsigned int i = 0; i < forest->GetNumberOfPieces(); i++)
+    QStringList treeNames = reader.treeNames();
+    for (int i = 0; i < forest.size(); i++)
       {
-      vtkTree * tree =  vtkTree::SafeDownCast( forest->GetPieceAsDataObject(i));
-      QString displayName = QString("tree-%1").arg(QString::number(i));
+      vtkTree * tree =  forest.at(i);
+      QString displayName = treeNames.at(i).isEmpty() ?
+        QString("tree-%1").arg(QString::number(i)) : treeNames.at(i);
       voDataObject * treeObject = new voDataObject(displayName, tree);
+      voTrace::recordTiming(treeObject, importEvent);
       treeObjects << treeObject;
       }
 
@@ -652,10 +699,21 @@ void voIOManager::writeAnalysisToXML(voDataModelItem *item,
         item->data(voDataModelItem::AnalysisVoidStarRole).value<void*>());
   QString analysisName = analysis->objectName();
   stream->writeAttribute("type", analysisName);
+  stream->writeAttribute("uuid", analysis->uuid());
 
+  // Record the analysis producing the input so that the workflow can be
+  // run in dependency order when it is loaded.
+  voDataModel * dataModel = voApplication::application()->dataModel();
   voDataModelItem *parentItem =
     dynamic_cast<voDataModelItem*>(item->parent());
   stream->writeStartElement("parent");
+  voAnalysis * parentAnalysis = dataModel->analysisAboveItem(parentItem);
+  if (parentAnalysis)
+    {
+    stream->writeAttribute("analysis", parentAnalysis->uuid());
+    stream->writeAttribute("output",
+      parentItem->data(voDataModelItem::OutputNameRole).toString());
+    }
   stream->writeCharacters(parentItem->text());
   stream->writeEndElement(); // parent
 
@@ -840,57 +898,72 @@ void voIOManager::loadWorkflowFromFile(const QString& fileName)
 void voIOManager::loadTreeFromOpenTreeDB(const QString& hostURL,
                                          const QString& ottolID,
                                          const QString& maxDepth)
-{// download tree from opentreeoflife neo4j database
-  QUrl url(hostURL);
-
-  QNetworkRequest request;
-  request.setUrl(url);
-  request.setHeader(QNetworkRequest::ContentTypeHeader,"Application/json"); //Required!
-
-  QNetworkAccessManager *manager = new QNetworkAccessManager();
-
-  QNetworkReply *reply = manager->post(request,QString("{\"ottolID\":\"%1\", \"maxDepth\": %2}").arg(ottolID,maxDepth).toLatin1());
-
-  QEventLoop loop;
-  QObject::connect(reply, SIGNAL(finished()), &loop, SLOT(quit()));
-  loop.exec();
-
+{
+  this->openTreeFetcher()->fetch(hostURL, ottolID, maxDepth.toInt());
+}
 
-  // a newick tree is returned as the response
-  /* here is an example:
-  "{
-  "tree" : "(Homo_sapiens_ssp_Denisova:1.0E-22,Homo_sapiens_neanderthalensis:1.0E-22)Homo_sapiens"
-   }"
-  */
-  QByteArray replyBytes =  reply->readAll();
-  if (replyBytes.contains("tree") )
+// --------------------------------------------------------------------------
+void voIOManager::expandOpenTreeTip(voDataObject * treeObject, const QString& tipName,
+                                    const QString& hostURL, int maxDepth)
+{
+  QString ottolID = voOpenTreeFetcher::ottolIDFromLabel(tipName);
+  if (!treeObject || ottolID.isEmpty())
     {
-    //trim the response to be a newicktree string
-    replyBytes.remove(0,14);//remove the header charactors  "{\n\"tree\" : \""
-    replyBytes.replace(QString("\"\n}"),QByteArray(";"));//tail
+    qWarning() << "voIOManager::expandOpenTreeTip - No OTT id in" << tipName;
+    return;
+    }
+  int requestId = this->openTreeFetcher()->fetch(hostURL, ottolID, maxDepth);
+  this->PendingOpenTreeTips.insert(requestId,
+                                   qMakePair(QPointer<voDataObject>(treeObject), tipName));
+}
 
-    char * singleTreeBuffer = replyBytes.data();
+// --------------------------------------------------------------------------
+void voIOManager::addOpenTree(int requestId, const QString& ottolID, int maxDepth,
+                              const QString& newick)
+{
+  Q_UNUSED(maxDepth);
+  voPhyloTreeReader reader;
+  if (!reader.readData(newick.toUtf8()) || reader.trees().isEmpty())
+    {
+    qCritical() << "voIOManager::addOpenTree - Failed to parse the tree of" << ottolID
+                << ":" << reader.errorString();
+    this->PendingOpenTreeTips.remove(requestId);
+    return;
+    }
+  vtkSmartPointer<vtkTree> tree = reader.trees().first();
+  QString name = "OpenTreeOfLife";
 
-    vtkNew<vtkNewickTreeReader> treeReader;
-    vtkSmartPointer<vtkTree> tree = vtkSmartPointer<vtkTree>::New();
-    treeReader->ReadNewickTree(singleTreeBuffer, *tree);
+  if (this->PendingOpenTreeTips.contains(requestId))
+    {
+    QPair<QPointer<voDataObject>, QString> tip = this->PendingOpenTreeTips.take(requestId);
+    vtkTree * expandedTree = tip.first ? vtkTree::SafeDownCast(tip.first->dataAsVTKDataObject()) : 0;
+    vtkIdType tipVertex = tip.first ? tip.first->treeNameIndex().vertex(tip.second) : -1;
+    if (!expandedTree || tipVertex < 0)
+      {
+      qWarning() << "voIOManager::addOpenTree - Tip" << tip.second << "no longer exists";
+      return;
+      }
+    vtkSmartPointer<vtkTree> graftedTree = vtkSmartPointer<vtkTree>::New();
+    if (!voUtils::graftTree(expandedTree, tipVertex, tree, graftedTree))
+      {
+      qWarning() << "voIOManager::addOpenTree - Failed to expand" << tip.second;
+      return;
+      }
+    tree = graftedTree;
+    name = tip.first->name() + " (expanded)";
+    }
 
-    //load the tree to the GUI
-    voDataModel * model = voApplication::application()->dataModel();
-    voInputFileDataObject * dataObject =
-      new voInputFileDataObject("OpenTreeOfLife", tree);
-    voDataModelItem * newItem = model->addDataObject(dataObject);
-    newItem->setRawViewType("voTreeHeatmapView");
+  voDataModel * model = voApplication::application()->dataModel();
+  voInputFileDataObject * dataObject = new voInputFileDataObject(name, tree);
+  voDataModelItem * newItem = model->addDataObject(dataObject);
+  newItem->setRawViewType("voTreeHeatmapView");
+  model->setSelected(newItem);
+}
 
-    model->setSelected(newItem);
-    }
-  else
-    {//error
-    qDebug()<< replyBytes;
-    QErrorMessage errorMessage;
-    errorMessage.showMessage("Failed to load the tree from OpenTreeOfLife database!");
-    errorMessage.exec();
-    }
+// --------------------------------------------------------------------------
+void voIOManager::openTreeFetchFailed(int requestId)
+{
+  this->PendingOpenTreeTips.remove(requestId);
 }
 
 // --------------------------------------------------------------------------
@@ -900,6 +973,9 @@ void voIOManager::loadWorkflow(QXmlStreamReader *stream)
   model->clear();
   model->setColumnCount(1);
 
+  voWorkflowScheduler * scheduler =
+    new voWorkflowScheduler(voApplication::application()->analysisDriver());
+
   while (!stream->atEnd())
     {
     QString attribute = "";
@@ -929,10 +1005,11 @@ void voIOManager::loadWorkflow(QXmlStreamReader *stream)
         }
       else if(name == "analysis")
         {
-        this->loadAnalysisFromXML(stream);
+        this->loadAnalysisFromXML(stream, scheduler);
         }
       }
     }
+  scheduler->start();
   if (stream->hasError())
     {
     // do error handling
@@ -1146,10 +1223,12 @@ voDelimitedTextImportSettings voIOManager::readTableFromXML(
 }
 
 // --------------------------------------------------------------------------
-void voIOManager::loadAnalysisFromXML(QXmlStreamReader *stream)
+void voIOManager::loadAnalysisFromXML(QXmlStreamReader *stream,
+                                      voWorkflowScheduler *scheduler)
 {
   QString type = stream->attributes().value("type").toString();
   type.remove(QChar('"'));
+  QString uuid = stream->attributes().value("uuid").toString();
 
   stream->readNextStartElement();
   QString name = stream->name().toString();
@@ -1158,6 +1237,8 @@ void voIOManager::loadAnalysisFromXML(QXmlStreamReader *stream)
     qCritical() << "expected parent, found " << name;
     return;
     }
+  QString parentUuid = stream->attributes().value("analysis").toString();
+  QString parentOutputName = stream->attributes().value("output").toString();
   QString parent = stream->readElementText();
 
   stream->readNextStartElement();
@@ -1186,13 +1267,8 @@ void voIOManager::loadAnalysisFromXML(QXmlStreamReader *stream)
     name = stream->name().toString();
     }
 
-  voDataModel * model = voApplication::application()->dataModel();
-  voDataModelItem *inputTarget = model->findItemWithText(parent);
-  QList<voDataModelItem*> inputTargets;
-  inputTargets << inputTarget;
-
-  voAnalysisDriver *driver = voApplication::application()->analysisDriver();
-  driver->runAnalysis(type, inputTargets, parameters);
+  scheduler->addAnalysis(uuid, type, parameters, parent,
+                         parentUuid, parentOutputName);
 }
 
 // --------------------------------------------------------------------------
@@ -23,6 +23,9 @@
 #define __voIOManager_h
 
 // Qt includes
+#include <QHash>
+#include <QPair>
+#include <QPointer>
 #include <QString>
 
 // Visomics includes
@@ -31,9 +34,11 @@
 class QStandardItem;
 class QXmlStreamReader;
 class QXmlStreamWriter;
-class QNetworkReply;
 class voDataModelItem;
+class voDataObject;
 class voInputFileDataObject;
+class voOpenTreeFetcher;
+class voWorkflowScheduler;
 class vtkDataObject;
 class vtkExtendedTable;
 class vtkTable;
@@ -77,9 +82,29 @@ public:
   void saveWorkflowToFile(const QString& fileName);
   void loadWorkflowFromFile(const QString& fileName);
 
+  /// Fetch a subtree of the Open Tree of Life. The tree is added to the
+  /// data model by addOpenTree() once downloaded, see openTreeFetcher().
   void loadTreeFromOpenTreeDB(const QString& hostURL,
                              const QString& ottolID,
                              const QString& maxDepth);
+
+  /// Fetch the subtree of the tip \a tipName of \a treeObject, a tree of
+  /// the Open Tree of Life. Once downloaded, addOpenTree() adds a copy of the
+  /// tree where the tip is expanded.
+  void expandOpenTreeTip(voDataObject * treeObject, const QString& tipName,
+                         const QString& hostURL, int maxDepth);
+
+  /// Add a tree fetched from the Open Tree of Life by the request
+  /// \a requestId of openTreeFetcher() to the data model.
+  void addOpenTree(int requestId, const QString& ottolID, int maxDepth,
+                   const QString& newick);
+
+  /// Forget the tip expansion waiting for the request \a requestId that
+  /// failed to download its subtree.
+  void openTreeFetchFailed(int requestId);
+
+  voOpenTreeFetcher * openTreeFetcher();
+
 protected:
   bool treeAndTableMatch(vtkTree *tree, vtkTable *table);
   void loadWorkflow(QXmlStreamReader *stream);
@@ -93,13 +118,17 @@ protected:
   void loadTreeHeatmapFromXML(QXmlStreamReader *stream);
   void loadTreeFromXML(QXmlStreamReader *stream);
   void loadTableFromXML(QXmlStreamReader *stream);
-  void loadAnalysisFromXML(QXmlStreamReader *stream);
+  void loadAnalysisFromXML(QXmlStreamReader *stream, voWorkflowScheduler *scheduler);
   QString readTreeFileNameFromXML(QXmlStreamReader *stream);
   voDelimitedTextImportSettings readTableFromXML(QXmlStreamReader *stream,
                                                  QString *fileName);
 
   QMap<voInputFileDataObject *, voDelimitedTextImportSettings>
     tableSettings;
+
+  voOpenTreeFetcher * OpenTreeFetcher;
+  /// Tips waiting for their subtree, keyed by the id of the fetch request
+  QHash<int, QPair<QPointer<voDataObject>, QString> > PendingOpenTreeTips;
 };
 
 #endif
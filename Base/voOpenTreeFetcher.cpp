@@ -0,0 +1,314 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+// Qt includes
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QList>
+#include <QMetaObject>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QRegExp>
+#include <QUrl>
+
+// Visomics includes
+#include "voOpenTreeFetcher.h"
+
+// JsonCpp includes
+#include <json/json.h>
+
+class voOpenTreeFetcherPrivate
+{
+public:
+  struct PendingFetch
+  {
+    QString SubtreeKey;
+    QString OttolID;
+    int MaxDepth;
+    QString CacheFileName;
+    QList<int> RequestIds;
+  };
+
+  voOpenTreeFetcherPrivate();
+
+  /// Identify the subtree \a ottolID of \a maxDepth levels of the database
+  /// at \a hostURL.
+  static QString subtreeKey(const QString& hostURL, const QString& ottolID, int maxDepth);
+
+  /// Return true if \a fileName exists and is recent enough.
+  bool isCacheFileValid(const QString& fileName)const;
+  void writeCache(const QString& fileName, const QString& newick)const;
+
+  QString CacheDirectory;
+  int MaximumCacheAge;
+  QNetworkAccessManager * NetworkManager;
+  int NextRequestId;
+  QHash<QNetworkReply*, PendingFetch> PendingReplies;
+  QHash<QString, QNetworkReply*> PendingSubtrees;
+};
+
+// --------------------------------------------------------------------------
+// voOpenTreeFetcherPrivate methods
+
+// --------------------------------------------------------------------------
+voOpenTreeFetcherPrivate::voOpenTreeFetcherPrivate()
+{
+  this->NetworkManager = 0;
+  this->MaximumCacheAge = 30 * 24 * 3600;
+  this->NextRequestId = 1;
+}
+
+// --------------------------------------------------------------------------
+QString voOpenTreeFetcherPrivate::subtreeKey(const QString& hostURL,
+                                             const QString& ottolID, int maxDepth)
+{
+  return QString("%1\n%2\n%3").arg(hostURL).arg(ottolID).arg(maxDepth);
+}
+
+// --------------------------------------------------------------------------
+bool voOpenTreeFetcherPrivate::isCacheFileValid(const QString& fileName)const
+{
+  QFileInfo fileInfo(fileName);
+  return !fileName.isEmpty() && fileInfo.exists() &&
+    fileInfo.lastModified().secsTo(QDateTime::currentDateTime()) <= this->MaximumCacheAge;
+}
+
+// --------------------------------------------------------------------------
+void voOpenTreeFetcherPrivate::writeCache(const QString& fileName, const QString& newick)const
+{
+  if (fileName.isEmpty() || !QDir().mkpath(QFileInfo(fileName).absolutePath()))
+    {
+    return;
+    }
+  // Written aside first: a partial file is never read back
+  QFile file(fileName + ".part");
+  if (!file.open(QIODevice::WriteOnly))
+    {
+    qWarning() << "voOpenTreeFetcher - Failed to write" << file.fileName();
+    return;
+    }
+  file.write(newick.toUtf8());
+  file.close();
+  QFile::remove(fileName);
+  file.rename(fileName);
+}
+
+// --------------------------------------------------------------------------
+// voOpenTreeFetcher methods
+
+// --------------------------------------------------------------------------
+voOpenTreeFetcher::voOpenTreeFetcher(QObject* newParent):
+  Superclass(newParent), d_ptr(new voOpenTreeFetcherPrivate)
+{
+}
+
+// --------------------------------------------------------------------------
+voOpenTreeFetcher::~voOpenTreeFetcher()
+{
+}
+
+// --------------------------------------------------------------------------
+QString voOpenTreeFetcher::cacheDirectory()const
+{
+  Q_D(const voOpenTreeFetcher);
+  return d->CacheDirectory;
+}
+
+// --------------------------------------------------------------------------
+void voOpenTreeFetcher::setCacheDirectory(const QString& path)
+{
+  Q_D(voOpenTreeFetcher);
+  d->CacheDirectory = path;
+}
+
+// --------------------------------------------------------------------------
+int voOpenTreeFetcher::maximumCacheAge()const
+{
+  Q_D(const voOpenTreeFetcher);
+  return d->MaximumCacheAge;
+}
+
+// --------------------------------------------------------------------------
+void voOpenTreeFetcher::setMaximumCacheAge(int seconds)
+{
+  Q_D(voOpenTreeFetcher);
+  d->MaximumCacheAge = seconds;
+}
+
+// --------------------------------------------------------------------------
+QString voOpenTreeFetcher::cacheFileName(const QString& hostURL, const QString& ottolID,
+                                         int maxDepth)const
+{
+  Q_D(const voOpenTreeFetcher);
+  if (d->CacheDirectory.isEmpty())
+    {
+    return QString();
+    }
+  // Databases may hold different versions of the tree
+  QString hostKey = QCryptographicHash::hash(
+    hostURL.toUtf8(), QCryptographicHash::Sha1).toHex().left(16);
+  QString safeID = ottolID;
+  safeID.replace(QRegExp("[^A-Za-z0-9_-]"), "_");
+  return QDir(d->CacheDirectory).filePath(
+    QString("%1/ott%2-depth%3.tre").arg(hostKey).arg(safeID).arg(maxDepth));
+}
+
+// --------------------------------------------------------------------------
+bool voOpenTreeFetcher::isCached(const QString& hostURL, const QString& ottolID, int maxDepth)const
+{
+  Q_D(const voOpenTreeFetcher);
+  return d->isCacheFileValid(this->cacheFileName(hostURL, ottolID, maxDepth));
+}
+
+// --------------------------------------------------------------------------
+int voOpenTreeFetcher::pendingFetchCount()const
+{
+  Q_D(const voOpenTreeFetcher);
+  return d->PendingSubtrees.count();
+}
+
+// --------------------------------------------------------------------------
+int voOpenTreeFetcher::fetch(const QString& hostURL, const QString& ottolID, int maxDepth)
+{
+  Q_D(voOpenTreeFetcher);
+  int requestId = d->NextRequestId++;
+  QString subtreeKey = voOpenTreeFetcherPrivate::subtreeKey(hostURL, ottolID, maxDepth);
+  if (d->PendingSubtrees.contains(subtreeKey))
+    {
+    d->PendingReplies[d->PendingSubtrees.value(subtreeKey)].RequestIds << requestId;
+    return requestId;
+    }
+
+  QFile cacheFile(this->cacheFileName(hostURL, ottolID, maxDepth));
+  if (d->isCacheFileValid(cacheFile.fileName()) && cacheFile.open(QIODevice::ReadOnly))
+    {
+    QString newick = QString::fromUtf8(cacheFile.readAll());
+    // Emitted from the event loop, like downloaded trees
+    QMetaObject::invokeMethod(this, "treeFetched", Qt::QueuedConnection,
+                              Q_ARG(int, requestId), Q_ARG(QString, ottolID),
+                              Q_ARG(int, maxDepth), Q_ARG(QString, newick));
+    return requestId;
+    }
+
+  if (!d->NetworkManager)
+    {
+    d->NetworkManager = new QNetworkAccessManager(this);
+    }
+  QNetworkRequest request;
+  request.setUrl(QUrl(hostURL));
+  request.setHeader(QNetworkRequest::ContentTypeHeader, "Application/json"); //Required!
+
+  Json::Value body(Json::objectValue);
+  body["ottolID"] = ottolID.toStdString();
+  body["maxDepth"] = maxDepth;
+  Json::FastWriter writer;
+  QNetworkReply * reply = d->NetworkManager->post(
+    request, QByteArray(writer.write(body).c_str()));
+
+  voOpenTreeFetcherPrivate::PendingFetch pendingFetch;
+  pendingFetch.SubtreeKey = subtreeKey;
+  pendingFetch.OttolID = ottolID;
+  pendingFetch.MaxDepth = maxDepth;
+  pendingFetch.CacheFileName = cacheFile.fileName();
+  pendingFetch.RequestIds << requestId;
+  d->PendingReplies.insert(reply, pendingFetch);
+  d->PendingSubtrees.insert(subtreeKey, reply);
+  connect(reply, SIGNAL(finished()), this, SLOT(onReplyFinished()));
+  return requestId;
+}
+
+// --------------------------------------------------------------------------
+void voOpenTreeFetcher::onReplyFinished()
+{
+  Q_D(voOpenTreeFetcher);
+  QNetworkReply * reply = qobject_cast<QNetworkReply*>(this->sender());
+  if (!reply || !d->PendingReplies.contains(reply))
+    {
+    return;
+    }
+  reply->deleteLater();
+  voOpenTreeFetcherPrivate::PendingFetch pendingFetch = d->PendingReplies.take(reply);
+  d->PendingSubtrees.remove(pendingFetch.SubtreeKey);
+
+  QString errorMessage;
+  QString newick;
+  if (reply->error() != QNetworkReply::NoError)
+    {
+    errorMessage = reply->errorString();
+    }
+  else
+    {
+    newick = voOpenTreeFetcher::newickFromReply(reply->readAll(), &errorMessage);
+    }
+  if (newick.isEmpty())
+    {
+    foreach(int requestId, pendingFetch.RequestIds)
+      {
+      emit this->fetchFailed(requestId, pendingFetch.OttolID, pendingFetch.MaxDepth, errorMessage);
+      }
+    return;
+    }
+  d->writeCache(pendingFetch.CacheFileName, newick);
+  foreach(int requestId, pendingFetch.RequestIds)
+    {
+    emit this->treeFetched(requestId, pendingFetch.OttolID, pendingFetch.MaxDepth, newick);
+    }
+}
+
+// --------------------------------------------------------------------------
+QString voOpenTreeFetcher::newickFromReply(const QByteArray& reply, QString * errorMessage)
+{
+  Json::Value root;
+  Json::Reader reader;
+  if (!reader.parse(reply.constData(), reply.constData() + reply.size(), root, false)
+      || !root.isObject())
+    {
+    if (errorMessage)
+      {
+      *errorMessage = QObject::tr("Invalid reply: %1").arg(QString(reply.left(200)));
+      }
+    return QString();
+    }
+  // Older versions of the API name the tree "tree", newer ones "newick"
+  const Json::Value& tree = root.isMember("newick") ? root["newick"] : root["tree"];
+  if (!tree.isString() || tree.asString().empty())
+    {
+    if (errorMessage)
+      {
+      *errorMessage = root.isMember("message") && root["message"].isString() ?
+        QString::fromUtf8(root["message"].asCString()) : QObject::tr("The reply holds no tree");
+      }
+    return QString();
+    }
+  return QString::fromUtf8(tree.asCString());
+}
+
+// --------------------------------------------------------------------------
+QString voOpenTreeFetcher::ottolIDFromLabel(const QString& label)
+{
+  QRegExp ottSuffix("_ott(\\d+)$");
+  return ottSuffix.indexIn(label) >= 0 ? ottSuffix.cap(1) : QString();
+}
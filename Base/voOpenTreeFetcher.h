@@ -0,0 +1,96 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+#ifndef __voOpenTreeFetcher_h
+#define __voOpenTreeFetcher_h
+
+// Qt includes
+#include <QObject>
+#include <QScopedPointer>
+#include <QString>
+
+class QByteArray;
+class voOpenTreeFetcherPrivate;
+
+/// Asynchronous download of subtrees of the Open Tree of Life.
+///
+/// A subtree is identified by the OTT id of its root and the number of
+/// levels it spans. fetch() returns immediately: treeFetched() or
+/// fetchFailed() is emitted later, from the event loop. Fetched trees are
+/// cached on disk for each database, so that a subtree is downloaded only
+/// once across sessions until it is older than maximumCacheAge(). Deeper
+/// levels can be fetched incrementally by fetching the subtrees of the tips,
+/// see ottolIDFromLabel().
+class voOpenTreeFetcher : public QObject
+{
+  Q_OBJECT
+public:
+  typedef QObject Superclass;
+  voOpenTreeFetcher(QObject* newParent = 0);
+  virtual ~voOpenTreeFetcher();
+
+  /// Trees are not cached if the directory is empty.
+  QString cacheDirectory()const;
+  void setCacheDirectory(const QString& path);
+
+  /// Cached trees older than \a seconds are downloaded again, as the
+  /// database is updated. Defaults to 30 days.
+  int maximumCacheAge()const;
+  void setMaximumCacheAge(int seconds);
+
+  /// Fetch the subtree rooted at \a ottolID limited to \a maxDepth levels,
+  /// from the cache or from the database at \a hostURL. Fetching a subtree
+  /// that is already being downloaded doesn't send a new request.
+  /// Return the id passed to treeFetched() or fetchFailed() for this request.
+  int fetch(const QString& hostURL, const QString& ottolID, int maxDepth);
+
+  bool isCached(const QString& hostURL, const QString& ottolID, int maxDepth)const;
+
+  /// File caching the subtree of the database at \a hostURL, or an empty
+  /// string if trees are not cached.
+  QString cacheFileName(const QString& hostURL, const QString& ottolID, int maxDepth)const;
+
+  /// Number of subtrees being downloaded.
+  int pendingFetchCount()const;
+
+  /// Return the Newick tree of a reply of the database, e.g.
+  /// {"tree": "(A,B)C"}, or an empty string if the reply holds no tree.
+  static QString newickFromReply(const QByteArray& reply, QString * errorMessage = 0);
+
+  /// Return the OTT id of a node labelled like "Homo_sapiens_ott770315", or
+  /// an empty string.
+  static QString ottolIDFromLabel(const QString& label);
+
+signals:
+  void treeFetched(int requestId, const QString& ottolID, int maxDepth, const QString& newick);
+  void fetchFailed(int requestId, const QString& ottolID, int maxDepth, const QString& errorMessage);
+
+protected slots:
+  void onReplyFinished();
+
+protected:
+  QScopedPointer<voOpenTreeFetcherPrivate> d_ptr;
+
+private:
+  Q_DECLARE_PRIVATE(voOpenTreeFetcher);
+  Q_DISABLE_COPY(voOpenTreeFetcher);
+};
+
+#endif
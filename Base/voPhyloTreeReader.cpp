@@ -0,0 +1,645 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+// Qt includes
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QObject>
+#include <QStack>
+#include <QVector>
+#include <QtConcurrentMap>
+
+// Visomics includes
+#include "voPhyloTreeReader.h"
+
+// VTK includes
+#include <vtkDataSetAttributes.h>
+#include <vtkDoubleArray.h>
+#include <vtkMutableDirectedGraph.h>
+#include <vtkNew.h>
+#include <vtkStringArray.h>
+#include <vtkTree.h>
+
+// STD includes
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace
+{
+
+typedef QHash<QByteArray, QByteArray> TranslationTable;
+
+// --------------------------------------------------------------------------
+struct TreeSpan
+{
+  TreeSpan():Begin(0), End(0){}
+  const char * Begin;
+  const char * End; // Excluding the ';'
+  QString Name;
+  vtkSmartPointer<vtkTree> Tree;
+  QString Error;
+};
+
+// --------------------------------------------------------------------------
+// Return the position after the comment starting at \a p. Comments may be
+// nested.
+const char * skipComment(const char * p, const char * end)
+{
+  int depth = 0;
+  for (; p < end; ++p)
+    {
+    if (*p == '[')
+      {
+      ++depth;
+      }
+    else if (*p == ']' && --depth == 0)
+      {
+      return p + 1;
+      }
+    }
+  return end;
+}
+
+// --------------------------------------------------------------------------
+// Return the position after the label quoted at \a p. Quotes are escaped
+// by doubling them.
+const char * skipQuoted(const char * p, const char * end)
+{
+  const char quote = *p;
+  for (++p; p < end; ++p)
+    {
+    if (*p == quote)
+      {
+      if (p + 1 < end && p[1] == quote)
+        {
+        ++p;
+        }
+      else
+        {
+        return p + 1;
+        }
+      }
+    }
+  return end;
+}
+
+// --------------------------------------------------------------------------
+const char * skipBlanks(const char * p, const char * end)
+{
+  while (p < end)
+    {
+    if (*p == '[')
+      {
+      p = skipComment(p, end);
+      }
+    else if (std::isspace(static_cast<unsigned char>(*p)))
+      {
+      ++p;
+      }
+    else
+      {
+      break;
+      }
+    }
+  return p;
+}
+
+// --------------------------------------------------------------------------
+// Return the position of the first occurrence of \a c that is neither
+// quoted nor in a comment, or \a end.
+const char * findUnquoted(const char * p, const char * end, char c)
+{
+  while (p < end && *p != c)
+    {
+    if (*p == '\'' || *p == '"')
+      {
+      p = skipQuoted(p, end);
+      }
+    else if (*p == '[')
+      {
+      p = skipComment(p, end);
+      }
+    else
+      {
+      ++p;
+      }
+    }
+  return p;
+}
+
+// --------------------------------------------------------------------------
+QByteArray trimmed(const char * begin, const char * end)
+{
+  return QByteArray(begin, static_cast<int>(end - begin)).trimmed();
+}
+
+// --------------------------------------------------------------------------
+QByteArray unquoted(const QByteArray& label)
+{
+  if (label.size() < 2 || (label.at(0) != '\'' && label.at(0) != '"')
+      || label.at(label.size() - 1) != label.at(0))
+    {
+    return label;
+    }
+  QByteArray quote(1, label.at(0));
+  return label.mid(1, label.size() - 2).replace(quote + quote, quote);
+}
+
+// --------------------------------------------------------------------------
+/// Parse one Newick tree with an explicit stack: deep trees (e.g.
+/// caterpillars) can't overflow the call stack.
+class NewickParser
+{
+public:
+  NewickParser(const char * begin, const char * end, const TranslationTable& translation):
+    Begin(begin), End(end), P(begin), Translation(translation), NumberOfNodes(0){}
+
+  bool parse(vtkSmartPointer<vtkTree>& tree, QString& error);
+
+private:
+  vtkIdType countNodes()const;
+  bool addChild(vtkIdType parent, vtkIdType& child);
+  bool parseLabel(vtkIdType node, bool isLeaf);
+  bool parseLength(vtkIdType node);
+  bool setError(const QString& message);
+
+  const char * Begin;
+  const char * End;
+  const char * P;
+  const TranslationTable& Translation;
+  QString Error;
+
+  vtkIdType NumberOfNodes;
+  QVector<vtkIdType> Parents;
+  QVector<double> Lengths;
+  vtkSmartPointer<vtkStringArray> Names;
+};
+
+// --------------------------------------------------------------------------
+// Each '(' and ',' starts a node, in addition to the root.
+vtkIdType NewickParser::countNodes()const
+{
+  vtkIdType count = 1;
+  for (const char * p = this->Begin; p < this->End;)
+    {
+    switch (*p)
+      {
+      case '(':
+      case ',':
+        ++count;
+        ++p;
+        break;
+      case '\'':
+      case '"':
+        p = skipQuoted(p, this->End);
+        break;
+      case '[':
+        p = skipComment(p, this->End);
+        break;
+      default:
+        ++p;
+      }
+    }
+  return count;
+}
+
+// --------------------------------------------------------------------------
+bool NewickParser::setError(const QString& message)
+{
+  this->Error = QObject::tr("%1 at character %2").arg(message)
+    .arg(static_cast<qint64>(this->P - this->Begin) + 1);
+  return false;
+}
+
+// --------------------------------------------------------------------------
+bool NewickParser::addChild(vtkIdType parent, vtkIdType& child)
+{
+  if (this->NumberOfNodes >= this->Parents.size())
+    {
+    return this->setError(QObject::tr("Unexpected node"));
+    }
+  child = this->NumberOfNodes++;
+  this->Parents[child] = parent;
+  return true;
+}
+
+// --------------------------------------------------------------------------
+bool NewickParser::parseLabel(vtkIdType node, bool isLeaf)
+{
+  this->P = skipBlanks(this->P, this->End);
+  const char * start = this->P;
+  QByteArray label;
+  if (this->P < this->End && (*this->P == '\'' || *this->P == '"'))
+    {
+    this->P = skipQuoted(this->P, this->End);
+    label = unquoted(QByteArray(start, static_cast<int>(this->P - start)));
+    }
+  else
+    {
+    while (this->P < this->End && !strchr("(),:;[", *this->P))
+      {
+      ++this->P;
+      }
+    label = trimmed(start, this->P);
+    }
+  if (label.isEmpty())
+    {
+    return true;
+    }
+  // Labels of internal nodes, e.g. support values, aren't translated
+  if (isLeaf && !this->Translation.isEmpty())
+    {
+    label = this->Translation.value(label, label);
+    }
+  this->Names->SetValue(node, std::string(label.constData(), label.size()));
+  return true;
+}
+
+// --------------------------------------------------------------------------
+bool NewickParser::parseLength(vtkIdType node)
+{
+  this->P = skipBlanks(this->P, this->End);
+  if (this->P >= this->End || *this->P != ':')
+    {
+    return true;
+    }
+  this->P = skipBlanks(this->P + 1, this->End);
+  char number[64];
+  int size = 0;
+  while (this->P < this->End && size < 63 && strchr("0123456789+-.eE", *this->P))
+    {
+    number[size++] = *this->P++;
+    }
+  number[size] = '\0';
+  char * numberEnd = 0;
+  double length = std::strtod(number, &numberEnd);
+  if (size == 0 || numberEnd != number + size)
+    {
+    return this->setError(QObject::tr("Invalid branch length"));
+    }
+  this->Lengths[node] = length;
+  return true;
+}
+
+// --------------------------------------------------------------------------
+bool NewickParser::parse(vtkSmartPointer<vtkTree>& tree, QString& error)
+{
+  vtkIdType capacity = this->countNodes();
+  this->Parents.fill(-1, static_cast<int>(capacity));
+  this->Lengths.fill(0., static_cast<int>(capacity));
+  this->Names = vtkSmartPointer<vtkStringArray>::New();
+  this->Names->SetName("node name");
+  this->Names->SetNumberOfValues(capacity);
+
+  // The root
+  this->NumberOfNodes = 1;
+  vtkIdType node = 0;
+  QStack<vtkIdType> parents;
+  bool expectNode = true;
+  bool ok = true;
+  while (ok)
+    {
+    this->P = skipBlanks(this->P, this->End);
+    if (expectNode)
+      {
+      if (this->P < this->End && *this->P == '(')
+        {
+        ++this->P;
+        parents.push(node);
+        ok = this->addChild(node, node);
+        }
+      else
+        {
+        ok = this->parseLabel(node, true) && this->parseLength(node);
+        expectNode = false;
+        }
+      continue;
+      }
+    if (this->P >= this->End)
+      {
+      break;
+      }
+    if (*this->P == ',' && !parents.isEmpty())
+      {
+      ++this->P;
+      ok = this->addChild(parents.top(), node);
+      expectNode = true;
+      }
+    else if (*this->P == ')' && !parents.isEmpty())
+      {
+      ++this->P;
+      node = parents.pop();
+      ok = this->parseLabel(node, false) && this->parseLength(node);
+      }
+    else
+      {
+      ok = this->setError(QObject::tr("Unexpected '%1'").arg(QLatin1Char(*this->P)));
+      }
+    }
+  if (ok && !parents.isEmpty())
+    {
+    ok = this->setError(QObject::tr("Missing ')'"));
+    }
+  if (!ok)
+    {
+    error = this->Error;
+    return false;
+    }
+
+  vtkIdType numberOfNodes = this->NumberOfNodes;
+  this->Names->SetNumberOfValues(numberOfNodes);
+  vtkNew<vtkDoubleArray> weights;
+  weights->SetName("weight");
+  weights->SetNumberOfValues(numberOfNodes - 1);
+
+  // Vertices are numbered in pre-order: the edge to vertex i is edge i-1.
+  vtkNew<vtkMutableDirectedGraph> builder;
+  builder->AddVertex();
+  bool hasLengths = false;
+  for (vtkIdType vertex = 1; vertex < numberOfNodes; ++vertex)
+    {
+    builder->AddChild(this->Parents.at(vertex));
+    weights->SetValue(vertex - 1, this->Lengths.at(vertex));
+    hasLengths = hasLengths || this->Lengths.at(vertex) != 0.;
+    }
+  builder->GetEdgeData()->AddArray(weights.GetPointer());
+  builder->GetVertexData()->AddArray(this->Names.GetPointer());
+
+  tree = vtkSmartPointer<vtkTree>::New();
+  if (!tree->CheckedShallowCopy(builder.GetPointer()))
+    {
+    error = QObject::tr("Edges do not create a valid tree");
+    return false;
+    }
+
+  if (hasLengths)
+    {
+    // Parents come before their children in pre-order
+    vtkNew<vtkDoubleArray> nodeWeights;
+    nodeWeights->SetName("node weight");
+    nodeWeights->SetNumberOfValues(numberOfNodes);
+    nodeWeights->SetValue(0, 0.);
+    for (vtkIdType vertex = 1; vertex < numberOfNodes; ++vertex)
+      {
+      nodeWeights->SetValue(vertex, nodeWeights->GetValue(this->Parents.at(vertex))
+                            + this->Lengths.at(vertex));
+      }
+    tree->GetVertexData()->AddArray(nodeWeights.GetPointer());
+    }
+  return true;
+}
+
+// --------------------------------------------------------------------------
+struct ParseTree
+{
+  typedef void result_type;
+  ParseTree(const TranslationTable& translation):Translation(translation){}
+  void operator()(TreeSpan& span)const
+    {
+    NewickParser parser(span.Begin, span.End, this->Translation);
+    parser.parse(span.Tree, span.Error);
+    }
+  const TranslationTable& Translation;
+};
+
+// --------------------------------------------------------------------------
+bool startsWithWord(const QByteArray& statement, const char * word)
+{
+  int length = static_cast<int>(strlen(word));
+  return statement.size() >= length
+    && qstrnicmp(statement.constData(), word, length) == 0
+    && (statement.size() == length || !std::isalnum(static_cast<unsigned char>(statement.at(length))));
+}
+
+} // end of anonymous namespace
+
+// --------------------------------------------------------------------------
+class voPhyloTreeReaderPrivate
+{
+public:
+  bool findNewickTrees(const char * begin, const char * end);
+  bool findNexusTrees(const char * begin, const char * end);
+  bool parse(const char * begin, const char * end);
+
+  QList<TreeSpan> Spans;
+  TranslationTable Translation;
+  QString ErrorString;
+};
+
+// --------------------------------------------------------------------------
+// voPhyloTreeReaderPrivate methods
+
+// --------------------------------------------------------------------------
+bool voPhyloTreeReaderPrivate::findNewickTrees(const char * begin, const char * end)
+{
+  for (const char * p = skipBlanks(begin, end); p < end; p = skipBlanks(p, end))
+    {
+    TreeSpan span;
+    span.Begin = p;
+    span.End = findUnquoted(p, end, ';');
+    this->Spans << span;
+    p = span.End < end ? span.End + 1 : end;
+    }
+  return true;
+}
+
+// --------------------------------------------------------------------------
+bool voPhyloTreeReaderPrivate::findNexusTrees(const char * begin, const char * end)
+{
+  bool inTreesBlock = false;
+  for (const char * p = skipBlanks(begin, end); p < end; p = skipBlanks(p, end))
+    {
+    const char * statementEnd = findUnquoted(p, end, ';');
+    QByteArray statement = trimmed(p, statementEnd);
+    if (startsWithWord(statement, "begin"))
+      {
+      inTreesBlock = statement.mid(5).trimmed().toLower() == "trees";
+      }
+    else if (startsWithWord(statement, "end") || startsWithWord(statement, "endblock"))
+      {
+      inTreesBlock = false;
+      }
+    else if (inTreesBlock && startsWithWord(statement, "translate"))
+      {
+      const char * entry = p + strlen("translate");
+      while (entry < statementEnd)
+        {
+        const char * entryEnd = findUnquoted(entry, statementEnd, ',');
+        QByteArray pair = trimmed(entry, entryEnd);
+        int separator = 0;
+        while (separator < pair.size() && !std::isspace(static_cast<unsigned char>(pair.at(separator))))
+          {
+          ++separator;
+          }
+        if (separator < pair.size())
+          {
+          this->Translation.insert(pair.left(separator), unquoted(pair.mid(separator).trimmed()));
+          }
+        entry = entryEnd + 1;
+        }
+      }
+    else if (inTreesBlock && (startsWithWord(statement, "tree") || startsWithWord(statement, "utree")))
+      {
+      const char * equal = findUnquoted(p, statementEnd, '=');
+      if (equal >= statementEnd)
+        {
+        this->ErrorString = QObject::tr("Missing '=' in the TREE command \"%1\"").arg(QString(statement.left(40)));
+        return false;
+        }
+      QByteArray name = trimmed(p + (startsWithWord(statement, "utree") ? 5 : 4), equal);
+      if (name.startsWith('*'))
+        {
+        name = name.mid(1).trimmed();
+        }
+      TreeSpan span;
+      span.Begin = equal + 1;
+      span.End = statementEnd;
+      span.Name = QString(unquoted(name));
+      this->Spans << span;
+      }
+    p = statementEnd < end ? statementEnd + 1 : end;
+    }
+  if (this->Spans.isEmpty())
+    {
+    this->ErrorString = QObject::tr("No TREES block found in the NEXUS file");
+    return false;
+    }
+  return true;
+}
+
+// --------------------------------------------------------------------------
+bool voPhyloTreeReaderPrivate::parse(const char * begin, const char * end)
+{
+  this->Spans.clear();
+  this->Translation.clear();
+  this->ErrorString.clear();
+
+  const char * start = skipBlanks(begin, end);
+  const int headerSize = 6;
+  bool found = startsWithWord(trimmed(start, qMin(start + headerSize + 1, end)), "#nexus") ?
+    this->findNexusTrees(start + headerSize, end) : this->findNewickTrees(start, end);
+  if (!found)
+    {
+    return false;
+    }
+  if (this->Spans.isEmpty())
+    {
+    this->ErrorString = QObject::tr("No tree found");
+    return false;
+    }
+
+  // The first tree is parsed on this thread: it makes sure VTK is
+  // initialized (e.g. object factories) before the other threads use it.
+  ParseTree parseTree(this->Translation);
+  parseTree(this->Spans.first());
+  if (this->Spans.size() > 1)
+    {
+    QList<TreeSpan>::iterator second = this->Spans.begin() + 1;
+    QtConcurrent::blockingMap(second, this->Spans.end(), parseTree);
+    }
+
+  for (int i = 0; i < this->Spans.size(); ++i)
+    {
+    if (!this->Spans.at(i).Tree)
+      {
+      this->ErrorString = QObject::tr("Invalid tree %1: %2").arg(i + 1).arg(this->Spans.at(i).Error);
+      this->Spans.clear();
+      return false;
+      }
+    }
+  return true;
+}
+
+// --------------------------------------------------------------------------
+// voPhyloTreeReader methods
+
+// --------------------------------------------------------------------------
+voPhyloTreeReader::voPhyloTreeReader():d_ptr(new voPhyloTreeReaderPrivate)
+{
+}
+
+// --------------------------------------------------------------------------
+voPhyloTreeReader::~voPhyloTreeReader()
+{
+}
+
+// --------------------------------------------------------------------------
+bool voPhyloTreeReader::read(const QString& fileName)
+{
+  Q_D(voPhyloTreeReader);
+  QFile file(fileName);
+  if (!file.open(QIODevice::ReadOnly))
+    {
+    d->Spans.clear();
+    d->ErrorString = QObject::tr("Failed to open %1: %2").arg(fileName).arg(file.errorString());
+    return false;
+    }
+  // Trees are parsed directly from the pages of the file
+  uchar * data = file.size() > 0 ? file.map(0, file.size()) : 0;
+  if (!data)
+    {
+    return this->readData(file.readAll());
+    }
+  const char * begin = reinterpret_cast<const char *>(data);
+  bool success = d->parse(begin, begin + file.size());
+  file.unmap(data);
+  return success;
+}
+
+// --------------------------------------------------------------------------
+bool voPhyloTreeReader::readData(const QByteArray& data)
+{
+  Q_D(voPhyloTreeReader);
+  return d->parse(data.constData(), data.constData() + data.size());
+}
+
+// --------------------------------------------------------------------------
+QList<vtkSmartPointer<vtkTree> > voPhyloTreeReader::trees()const
+{
+  Q_D(const voPhyloTreeReader);
+  QList<vtkSmartPointer<vtkTree> > trees;
+  foreach(const TreeSpan& span, d->Spans)
+    {
+    trees << span.Tree;
+    }
+  return trees;
+}
+
+// --------------------------------------------------------------------------
+QStringList voPhyloTreeReader::treeNames()const
+{
+  Q_D(const voPhyloTreeReader);
+  QStringList names;
+  foreach(const TreeSpan& span, d->Spans)
+    {
+    names << span.Name;
+    }
+  return names;
+}
+
+// --------------------------------------------------------------------------
+QString voPhyloTreeReader::errorString()const
+{
+  Q_D(const voPhyloTreeReader);
+  return d->ErrorString;
+}
@@ -0,0 +1,78 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+#ifndef __voPhyloTreeReader_h
+#define __voPhyloTreeReader_h
+
+// Qt includes
+#include <QList>
+#include <QScopedPointer>
+#include <QStringList>
+
+// VTK includes
+#include <vtkSmartPointer.h>
+
+class QByteArray;
+class voPhyloTreeReaderPrivate;
+class vtkTree;
+
+/// Reader of phylogenetic trees in the Newick and NEXUS formats.
+///
+/// The file is mapped in memory and scanned once to find where each tree
+/// starts and ends. Trees are then parsed in parallel, one tree per thread
+/// of the global thread pool. Each tree is parsed without recursion into
+/// arrays sized from a count of its nodes, and the vtkTree is built from
+/// them in one pass.
+///
+/// Trees have the arrays of vtkNewickTreeReader: "node name" and
+/// "node weight" (distance from the root, only set if the tree has branch
+/// lengths) on vertices, "weight" (branch length) on edges. Vertices are
+/// numbered in pre-order. Labels of NEXUS trees are translated with the
+/// TRANSLATE command of the TREES block.
+class voPhyloTreeReader
+{
+public:
+  voPhyloTreeReader();
+  virtual ~voPhyloTreeReader();
+
+  /// Read the trees of \a fileName. Return false and set errorString() if
+  /// the file can't be read or if one of its trees is invalid.
+  bool read(const QString& fileName);
+
+  /// Read the trees held by \a data.
+  bool readData(const QByteArray& data);
+
+  /// Trees that were read, in the order of the file.
+  QList<vtkSmartPointer<vtkTree> > trees()const;
+
+  /// Names given to the trees by a NEXUS file, empty strings otherwise.
+  QStringList treeNames()const;
+
+  QString errorString()const;
+
+protected:
+  QScopedPointer<voPhyloTreeReaderPrivate> d_ptr;
+
+private:
+  Q_DECLARE_PRIVATE(voPhyloTreeReader);
+  Q_DISABLE_COPY(voPhyloTreeReader);
+};
+
+#endif
@@ -0,0 +1,329 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+// Qt includes
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QHash>
+#include <QMetaObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QThreadStorage>
+
+// Visomics includes
+#include "voDataObject.h"
+#include "voTrace.h"
+
+// VTK includes
+#include <vtkTimerLog.h>
+
+// JsonCpp includes
+#include <json/json.h>
+
+namespace
+{
+// --------------------------------------------------------------------------
+struct voTraceState
+{
+  voTraceState() : Origin(-1.), MaximumEventCount(100000) {}
+  QMutex Mutex;
+  double Origin; // In seconds
+  int MaximumEventCount;
+  QList<voTrace::Event> Events;
+  QHash<Qt::HANDLE, int> Threads;
+};
+
+// --------------------------------------------------------------------------
+struct voTraceThreadState
+{
+  voTraceThreadState() : CurrentScope(0) {}
+  voTrace::Scope* CurrentScope;
+};
+
+Q_GLOBAL_STATIC(voTraceState, traceState);
+Q_GLOBAL_STATIC(QThreadStorage<voTraceThreadState*>, traceThreadState);
+
+// --------------------------------------------------------------------------
+voTraceThreadState* currentThreadState()
+{
+  QThreadStorage<voTraceThreadState*>* storage = traceThreadState();
+  if (!storage->hasLocalData())
+    {
+    storage->setLocalData(new voTraceThreadState);
+    }
+  return storage->localData();
+}
+
+// --------------------------------------------------------------------------
+int currentThreadIndex()
+{
+  voTraceState* state = traceState();
+  QMutexLocker locker(&state->Mutex);
+  Qt::HANDLE thread = QThread::currentThreadId();
+  if (!state->Threads.contains(thread))
+    {
+    state->Threads.insert(thread, state->Threads.size());
+    }
+  return state->Threads.value(thread);
+}
+
+// --------------------------------------------------------------------------
+void appendEvent(const voTrace::Event& event)
+{
+  qDebug() << qPrintable(QString("[%1] %2: %3").arg(event.Category).arg(event.Name)
+                         .arg(voTrace::formatTiming(event.Duration, event.Bytes)));
+
+  voTraceState* state = traceState();
+  QMutexLocker locker(&state->Mutex);
+  state->Events << event;
+  while (state->Events.size() > state->MaximumEventCount)
+    {
+    state->Events.removeFirst();
+    }
+}
+
+} // end of anonymous namespace
+
+// --------------------------------------------------------------------------
+// voTrace::Scope methods
+
+// --------------------------------------------------------------------------
+voTrace::Scope::Scope(const QString& category, const QString& name)
+{
+  this->ScopeEvent.Category = category;
+  this->ScopeEvent.Name = name;
+  this->ScopeEvent.Thread = currentThreadIndex();
+  voTraceThreadState* threadState = currentThreadState();
+  this->Parent = threadState->CurrentScope;
+  threadState->CurrentScope = this;
+  this->ScopeEvent.Start = voTrace::now();
+}
+
+// --------------------------------------------------------------------------
+voTrace::Scope::~Scope()
+{
+  this->ScopeEvent.Duration = voTrace::now() - this->ScopeEvent.Start;
+  currentThreadState()->CurrentScope = this->Parent;
+  appendEvent(this->ScopeEvent);
+
+  // The timing of the scope comes last: it wins over the nested scopes of
+  // the same category.
+  this->NestedEvents << this->ScopeEvent;
+  foreach(voDataObject* dataObject, this->DataObjects)
+    {
+    foreach(const Event& event, this->NestedEvents)
+      {
+      voTrace::recordTiming(dataObject, event);
+      }
+    }
+  if (this->Parent)
+    {
+    this->Parent->NestedEvents << this->NestedEvents;
+    }
+}
+
+// --------------------------------------------------------------------------
+void voTrace::Scope::addBytes(qint64 bytes)
+{
+  this->ScopeEvent.Bytes = qMax(this->ScopeEvent.Bytes, qint64(0)) + bytes;
+}
+
+// --------------------------------------------------------------------------
+void voTrace::Scope::addDataObject(voDataObject* dataObject)
+{
+  if (dataObject)
+    {
+    this->DataObjects << dataObject;
+    }
+}
+
+// --------------------------------------------------------------------------
+// voTrace methods
+
+// --------------------------------------------------------------------------
+double voTrace::now()
+{
+  double time = vtkTimerLog::GetUniversalTime();
+  voTraceState* state = traceState();
+  QMutexLocker locker(&state->Mutex);
+  if (state->Origin < 0)
+    {
+    state->Origin = time;
+    }
+  return (time - state->Origin) * 1000.;
+}
+
+// --------------------------------------------------------------------------
+voTrace::Event voTrace::addEvent(const QString& category, const QString& name,
+                                 double start, qint64 bytes)
+{
+  Event event;
+  event.Category = category;
+  event.Name = name;
+  event.Start = start;
+  event.Duration = voTrace::now() - start;
+  event.Bytes = bytes;
+  event.Thread = currentThreadIndex();
+  appendEvent(event);
+  return event;
+}
+
+// --------------------------------------------------------------------------
+voTrace::Event voTrace::addMeasuredEvent(const QString& category, const QString& name,
+                                         double start, double duration, qint64 bytes)
+{
+  Event event;
+  event.Category = category;
+  event.Name = name;
+  event.Start = start;
+  event.Duration = qMax(duration, 0.);
+  event.Bytes = bytes;
+  event.Thread = currentThreadIndex();
+  appendEvent(event);
+  return event;
+}
+
+// --------------------------------------------------------------------------
+void voTrace::recordTiming(voDataObject* dataObject, const Event& event)
+{
+  if (!dataObject)
+    {
+    return;
+    }
+  QString propertyName = event.Category;
+  if (!propertyName.isEmpty())
+    {
+    propertyName[0] = propertyName.at(0).toUpper();
+    }
+  propertyName += " time";
+
+  // Properties are shown by the GUI: they are only modified from the thread
+  // of the object. Objects still owned by a worker thread are modified there.
+  QCoreApplication* application = QCoreApplication::instance();
+  if (application && dataObject->thread() == application->thread()
+      && QThread::currentThread() != dataObject->thread())
+    {
+    QMetaObject::invokeMethod(dataObject, "setTimingProperty", Qt::QueuedConnection,
+                              Q_ARG(QString, propertyName),
+                              Q_ARG(QString, voTrace::formatTiming(event.Duration, event.Bytes)));
+    return;
+    }
+  dataObject->setTimingProperty(propertyName, voTrace::formatTiming(event.Duration, event.Bytes));
+}
+
+// --------------------------------------------------------------------------
+QString voTrace::formatTiming(double milliseconds, qint64 bytes)
+{
+  QString timing = milliseconds < 1000. ?
+    QString("%1 ms").arg(milliseconds, 0, 'f', 1) :
+    QString("%1 s").arg(milliseconds / 1000., 0, 'f', 2);
+  if (bytes < 0)
+    {
+    return timing;
+    }
+  QString size;
+  if (bytes < 1024)
+    {
+    size = QString("%1 B").arg(bytes);
+    }
+  else if (bytes < 1024 * 1024)
+    {
+    size = QString("%1 KB").arg(bytes / 1024., 0, 'f', 1);
+    }
+  else
+    {
+    size = QString("%1 MB").arg(bytes / (1024. * 1024.), 0, 'f', 1);
+    }
+  return QString("%1 (%2)").arg(timing).arg(size);
+}
+
+// --------------------------------------------------------------------------
+QList<voTrace::Event> voTrace::events()
+{
+  voTraceState* state = traceState();
+  QMutexLocker locker(&state->Mutex);
+  return state->Events;
+}
+
+// --------------------------------------------------------------------------
+void voTrace::clear()
+{
+  voTraceState* state = traceState();
+  QMutexLocker locker(&state->Mutex);
+  state->Events.clear();
+}
+
+// --------------------------------------------------------------------------
+int voTrace::maximumEventCount()
+{
+  voTraceState* state = traceState();
+  QMutexLocker locker(&state->Mutex);
+  return state->MaximumEventCount;
+}
+
+// --------------------------------------------------------------------------
+void voTrace::setMaximumEventCount(int count)
+{
+  voTraceState* state = traceState();
+  QMutexLocker locker(&state->Mutex);
+  state->MaximumEventCount = qMax(count, 0);
+  while (state->Events.size() > state->MaximumEventCount)
+    {
+    state->Events.removeFirst();
+    }
+}
+
+// --------------------------------------------------------------------------
+bool voTrace::exportChromeTrace(const QString& fileName)
+{
+  QFile file(fileName);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+    qCritical() << "voTrace::exportChromeTrace - Failed to open" << fileName;
+    return false;
+    }
+
+  Json::Value traceEvents(Json::arrayValue);
+  foreach(const Event& event, voTrace::events())
+    {
+    Json::Value traceEvent;
+    traceEvent["name"] = event.Name.toStdString();
+    traceEvent["cat"] = event.Category.toStdString();
+    traceEvent["ph"] = "X"; // Complete event
+    // Timestamps are in microseconds
+    traceEvent["ts"] = event.Start * 1000.;
+    traceEvent["dur"] = event.Duration * 1000.;
+    traceEvent["pid"] = static_cast<int>(QCoreApplication::applicationPid());
+    traceEvent["tid"] = event.Thread;
+    if (event.Bytes >= 0)
+      {
+      traceEvent["args"]["bytes"] = static_cast<double>(event.Bytes);
+      }
+    traceEvents.append(traceEvent);
+    }
+  Json::Value root;
+  root["traceEvents"] = traceEvents;
+  root["displayTimeUnit"] = "ms";
+
+  std::string json = Json::FastWriter().write(root);
+  return file.write(json.c_str(), json.size()) == static_cast<qint64>(json.size());
+}
@@ -0,0 +1,113 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+#ifndef __voTrace_h
+#define __voTrace_h
+
+// Qt includes
+#include <QList>
+#include <QString>
+
+class voDataObject;
+
+/// Lightweight tracing of the time spent in the stages of a workflow:
+/// import, conversion, upload, queue wait, compute (or remote execution),
+/// download and rendering.
+///
+/// Events are kept in memory, up to maximumEventCount(), and can be exported
+/// as a Chrome trace (chrome://tracing or Perfetto). Each event is also
+/// logged at debug level so that it shows in the error log, and can be
+/// recorded as a property of the data objects it concerns.
+///
+/// All the methods are thread-safe.
+class voTrace
+{
+public:
+  struct Event
+    {
+    Event() : Start(0), Duration(0), Bytes(-1), Thread(0) {}
+    QString Category; // Stage, e.g. "import" or "compute"
+    QString Name;     // What was processed, e.g. a file or an analysis
+    double Start;     // In milliseconds since the first event
+    double Duration;  // In milliseconds
+    qint64 Bytes;     // Amount of data processed, -1 if unknown
+    int Thread;
+    };
+
+  /// Record an event spanning its lifetime:
+  /// \code
+  /// voTrace::Scope scope("import", fileName);
+  /// scope.addBytes(fileSize);
+  /// scope.addDataObject(dataObject);
+  /// \endcode
+  /// Events of the scopes nested in a scope of the same thread are also
+  /// recorded on the data objects of the enclosing scope.
+  class Scope
+  {
+  public:
+    Scope(const QString& category, const QString& name);
+    ~Scope();
+
+    void addBytes(qint64 bytes);
+
+    /// Record the timing on \a dataObject when the scope ends.
+    void addDataObject(voDataObject* dataObject);
+
+  private:
+    Scope(const Scope&);
+    void operator=(const Scope&);
+
+    Event ScopeEvent;
+    QList<Event> NestedEvents;
+    QList<voDataObject*> DataObjects;
+    Scope* Parent;
+  };
+
+  /// Milliseconds since the first event.
+  static double now();
+
+  /// Record an event that started at \a start (see now()).
+  static Event addEvent(const QString& category, const QString& name,
+                        double start, qint64 bytes = -1);
+
+  /// Record an event of \a duration milliseconds measured elsewhere, e.g.
+  /// reported by the analysis server.
+  static Event addMeasuredEvent(const QString& category, const QString& name,
+                                double start, double duration, qint64 bytes = -1);
+
+  /// Show \a event with the properties of \a dataObject. Can be called from
+  /// any thread.
+  static void recordTiming(voDataObject* dataObject, const Event& event);
+
+  /// Human readable timing, e.g. "12.5 ms (3.2 MB)".
+  static QString formatTiming(double milliseconds, qint64 bytes = -1);
+
+  static QList<Event> events();
+  static void clear();
+
+  /// Oldest events are dropped once the limit is reached.
+  static int maximumEventCount();
+  static void setMaximumEventCount(int count);
+
+  /// Write the events in the Chrome trace event format.
+  static bool exportChromeTrace(const QString& fileName);
+};
+
+#endif
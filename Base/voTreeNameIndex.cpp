@@ -0,0 +1,95 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+// Visomics includes
+#include "voTreeNameIndex.h"
+
+// VTK includes
+#include <vtkDataSetAttributes.h>
+#include <vtkStringArray.h>
+#include <vtkTree.h>
+
+// --------------------------------------------------------------------------
+voTreeNameIndex::voTreeNameIndex():Names(0), NamesMTime(0)
+{
+}
+
+// --------------------------------------------------------------------------
+voTreeNameIndex::voTreeNameIndex(vtkTree * tree):Names(0), NamesMTime(0)
+{
+  vtkStringArray * names = vtkStringArray::SafeDownCast(voTreeNameIndex::nodeNames(tree));
+  if (!names)
+    {
+    return;
+    }
+  this->Names = names;
+  this->NamesMTime = names->GetMTime();
+  this->Vertices.reserve(static_cast<int>(names->GetNumberOfValues()));
+  // Walk backward so that the lowest id wins for repeated names
+  for (vtkIdType vertex = names->GetNumberOfValues() - 1; vertex >= 0; --vertex)
+    {
+    const vtkStdString& name = names->GetValue(vertex);
+    if (!name.empty())
+      {
+      this->Vertices.insert(QString(name.c_str()), vertex);
+      }
+    }
+}
+
+// --------------------------------------------------------------------------
+vtkAbstractArray * voTreeNameIndex::nodeNames(vtkTree * tree)
+{
+  return tree ? tree->GetVertexData()->GetAbstractArray("node name") : 0;
+}
+
+// --------------------------------------------------------------------------
+vtkIdType voTreeNameIndex::vertex(const QString& name)const
+{
+  return this->Vertices.value(name, -1);
+}
+
+// --------------------------------------------------------------------------
+bool voTreeNameIndex::contains(const QString& name)const
+{
+  return this->Vertices.contains(name);
+}
+
+// --------------------------------------------------------------------------
+int voTreeNameIndex::count()const
+{
+  return this->Vertices.count();
+}
+
+// --------------------------------------------------------------------------
+bool voTreeNameIndex::isEmpty()const
+{
+  return this->Vertices.isEmpty();
+}
+
+// --------------------------------------------------------------------------
+bool voTreeNameIndex::isUpToDate(vtkTree * tree)const
+{
+  vtkAbstractArray * names = voTreeNameIndex::nodeNames(tree);
+  if (!names)
+    {
+    return this->Names == 0;
+    }
+  return names == this->Names && names->GetMTime() == this->NamesMTime;
+}
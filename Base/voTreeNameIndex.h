@@ -0,0 +1,69 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+#ifndef __voTreeNameIndex_h
+#define __voTreeNameIndex_h
+
+// Qt includes
+#include <QHash>
+#include <QString>
+
+// VTK includes
+#include <vtkType.h>
+
+class vtkAbstractArray;
+class vtkTree;
+
+/// Index of the vertices of a tree by their "node name".
+///
+/// Looking up a name is a hash lookup, where vtkStringArray::LookupValue
+/// sorts the names again each time the array is copied or modified.
+/// The index of the tree held by a data object is built once and shared,
+/// see voDataObject::treeNameIndex(). Copies of an index are cheap.
+class voTreeNameIndex
+{
+public:
+  voTreeNameIndex();
+  explicit voTreeNameIndex(vtkTree * tree);
+
+  /// Return the vertex named \a name, or -1 if there is none. If several
+  /// vertices have the same name, the one with the lowest id is returned.
+  vtkIdType vertex(const QString& name)const;
+
+  bool contains(const QString& name)const;
+
+  /// Number of distinct names.
+  int count()const;
+
+  bool isEmpty()const;
+
+  /// Return true if the index was built from the current names of \a tree.
+  /// Names set without calling Modified() on the array are not detected.
+  bool isUpToDate(vtkTree * tree)const;
+
+private:
+  static vtkAbstractArray * nodeNames(vtkTree * tree);
+
+  QHash<QString, vtkIdType> Vertices;
+  vtkAbstractArray * Names;
+  unsigned long NamesMTime;
+};
+
+#endif
@@ -24,6 +24,7 @@
 #include <QScriptValue>
 #include <QStringList>
 #include <QtGlobal>
+#include <QBitArray>
 #include <QRegExp>
 #include <QSet>
 
@@ -36,7 +37,10 @@
 #include <vtkArrayToTable.h>
 #include <vtkDataSetAttributes.h>
 #include <vtkDoubleArray.h>
+#include <vtkFieldData.h>
+#include <vtkIdTypeArray.h>
 #include <vtkIntArray.h>
+#include <vtkMutableDirectedGraph.h>
 #include <vtkMath.h>
 #include <vtkNew.h>
 #include <vtkSmartPointer.h>
@@ -343,6 +347,67 @@ bool voUtils::insertColumnIntoTable(vtkTable * table, int position, vtkAbstractA
   return true;
 }
 
+// --------------------------------------------------------------------------
+vtkAbstractArray * voUtils::detachArray(vtkFieldData * fieldData, const char * name)
+{
+  vtkAbstractArray * array = fieldData ? fieldData->GetAbstractArray(name) : 0;
+  if (!array || array->GetReferenceCount() == 1)
+    {
+    return array;
+    }
+  vtkSmartPointer<vtkAbstractArray> detachedArray;
+  detachedArray.TakeReference(array->NewInstance());
+  detachedArray->DeepCopy(array);
+  detachedArray->SetName(array->GetName());
+  // Arrays of the same name are replaced at the same index: attributes
+  // (e.g. active scalars) still point to it.
+  fieldData->AddArray(detachedArray);
+  return detachedArray;
+}
+
+// --------------------------------------------------------------------------
+bool voUtils::removeTableRows(vtkTable * table, const QBitArray& keepRows)
+{
+  if (!table)
+    {
+    return false;
+    }
+  vtkIdType numberOfRows = table->GetNumberOfRows();
+  QList<vtkIdType> keptRows;
+  for (vtkIdType row = 0; row < numberOfRows; ++row)
+    {
+    if (row >= keepRows.size() || keepRows.testBit(static_cast<int>(row)))
+      {
+      keptRows << row;
+      }
+    }
+  if (keptRows.size() == numberOfRows)
+    {
+    return true;
+    }
+
+  vtkNew<vtkTable> updatedTable;
+  for (int cid = 0; cid < table->GetNumberOfColumns(); ++cid)
+    {
+    vtkAbstractArray * column = table->GetColumn(cid);
+    Q_ASSERT(column);
+    vtkSmartPointer<vtkAbstractArray> updatedColumn;
+    updatedColumn.TakeReference(column->NewInstance());
+    updatedColumn->SetName(column->GetName());
+    updatedColumn->SetNumberOfComponents(column->GetNumberOfComponents());
+    updatedColumn->SetNumberOfTuples(keptRows.size());
+    for (int i = 0; i < keptRows.size(); ++i)
+      {
+      updatedColumn->SetTuple(i, keptRows.at(i), column);
+      }
+    updatedTable->AddColumn(updatedColumn.GetPointer());
+    }
+  // Field data (e.g. table meta data) doesn't depend on the rows
+  updatedTable->GetFieldData()->ShallowCopy(table->GetFieldData());
+  table->ShallowCopy(updatedTable.GetPointer());
+  return true;
+}
+
 //----------------------------------------------------------------------------
 vtkStringArray* voUtils::tableColumnNames(vtkTable * table, int offset)
 {
@@ -772,6 +837,149 @@ QString voUtils::stringify(const QString& name, vtkTree* tree)
   return voUtils::stringify(&scriptEngine, rootScriptValue);
 }
 
+// --------------------------------------------------------------------------
+void voUtils::selectEmptyBranches(vtkTree* tree, vtkIdTypeArray* selection)
+{
+  if (!tree || !selection || tree->GetNumberOfVertices() == 0)
+    {
+    return;
+    }
+  vtkIdType numberOfVertices = tree->GetNumberOfVertices();
+  QBitArray selected(static_cast<int>(numberOfVertices));
+  for (vtkIdType i = 0; i < selection->GetNumberOfTuples(); ++i)
+    {
+    vtkIdType vertex = selection->GetValue(i);
+    if (vertex >= 0 && vertex < numberOfVertices)
+      {
+      selected.setBit(static_cast<int>(vertex));
+      }
+    }
+
+  // Pre-order traversal without recursion: deep (e.g. caterpillar) trees
+  // would overflow the stack.
+  QList<vtkIdType> preOrder;
+  QList<vtkIdType> stack;
+  stack << tree->GetRoot();
+  while (!stack.isEmpty())
+    {
+    vtkIdType vertex = stack.takeLast();
+    preOrder << vertex;
+    for (vtkIdType child = 0; child < tree->GetNumberOfChildren(vertex); ++child)
+      {
+      stack << tree->GetChild(vertex, child);
+      }
+    }
+
+  // Children come after their parent in pre-order: walk it backwards
+  for (int i = preOrder.size() - 1; i >= 0; --i)
+    {
+    vtkIdType vertex = preOrder.at(i);
+    vtkIdType numberOfChildren = tree->GetNumberOfChildren(vertex);
+    if (numberOfChildren == 0 || selected.testBit(static_cast<int>(vertex)))
+      {
+      continue;
+      }
+    bool allChildrenSelected = true;
+    for (vtkIdType child = 0; allChildrenSelected && child < numberOfChildren; ++child)
+      {
+      allChildrenSelected = selected.testBit(static_cast<int>(tree->GetChild(vertex, child)));
+      }
+    if (allChildrenSelected)
+      {
+      selected.setBit(static_cast<int>(vertex));
+      selection->InsertNextValue(vertex);
+      }
+    }
+}
+
+// --------------------------------------------------------------------------
+namespace // helpers for bool voUtils::graftTree(vtkTree*, vtkIdType, vtkTree*, vtkTree*)
+{
+struct GraftedVertex
+{
+  vtkTree * Tree;
+  vtkIdType Vertex;
+  vtkIdType Parent;
+  double Weight;
+};
+}
+
+// --------------------------------------------------------------------------
+bool voUtils::graftTree(vtkTree* tree, vtkIdType tip, vtkTree* subtree, vtkTree* output)
+{
+  if (!tree || !subtree || !output || subtree->GetNumberOfVertices() == 0
+      || tip < 0 || tip >= tree->GetNumberOfVertices() || !tree->IsLeaf(tip))
+    {
+    return false;
+    }
+  vtkStringArray * treeNames = vtkStringArray::SafeDownCast(
+    tree->GetVertexData()->GetAbstractArray("node name"));
+  vtkStringArray * subtreeNames = vtkStringArray::SafeDownCast(
+    subtree->GetVertexData()->GetAbstractArray("node name"));
+  vtkDataArray * treeWeights = tree->GetEdgeData()->GetArray("weight");
+  vtkDataArray * subtreeWeights = subtree->GetEdgeData()->GetArray("weight");
+  bool hasWeights = treeWeights || subtreeWeights;
+
+  vtkIdType numberOfVertices = tree->GetNumberOfVertices() + subtree->GetNumberOfVertices() - 1;
+  vtkNew<vtkMutableDirectedGraph> builder;
+  vtkNew<vtkStringArray> names;
+  names->SetName("node name");
+  names->Allocate(numberOfVertices);
+  vtkNew<vtkDoubleArray> weights;
+  weights->SetName("weight");
+  vtkNew<vtkDoubleArray> nodeWeights;
+  nodeWeights->SetName("node weight");
+
+  // Pre-order traversal without recursion, vertices are added as visited
+  QList<GraftedVertex> stack;
+  GraftedVertex root = {tree, tree->GetRoot(), -1, 0.};
+  stack << root;
+  while (!stack.isEmpty())
+    {
+    GraftedVertex current = stack.takeLast();
+    vtkIdType vertex;
+    double nodeWeight = 0.;
+    if (current.Parent < 0)
+      {
+      vertex = builder->AddVertex();
+      }
+    else
+      {
+      vertex = builder->AddChild(current.Parent);
+      weights->InsertNextValue(current.Weight);
+      nodeWeight = nodeWeights->GetValue(current.Parent) + current.Weight;
+      }
+    nodeWeights->InsertNextValue(nodeWeight);
+    vtkStringArray * sourceNames = current.Tree == tree ? treeNames : subtreeNames;
+    names->InsertNextValue(sourceNames ? sourceNames->GetValue(current.Vertex) : vtkStdString());
+
+    vtkTree * source = current.Tree;
+    vtkIdType sourceVertex = current.Vertex;
+    if (source == tree && sourceVertex == tip)
+      {
+      source = subtree;
+      sourceVertex = subtree->GetRoot();
+      }
+    vtkDataArray * sourceWeights = source == tree ? treeWeights : subtreeWeights;
+    // Pushed backwards so that children are visited in order
+    for (vtkIdType child = source->GetNumberOfChildren(sourceVertex) - 1; child >= 0; --child)
+      {
+      vtkOutEdgeType edge = source->GetOutEdge(sourceVertex, child);
+      GraftedVertex childVertex = {source, edge.Target, vertex,
+                                   sourceWeights ? sourceWeights->GetTuple1(edge.Id) : 0.};
+      stack << childVertex;
+      }
+    }
+
+  builder->GetVertexData()->AddArray(names.GetPointer());
+  if (hasWeights)
+    {
+    builder->GetEdgeData()->AddArray(weights.GetPointer());
+    builder->GetVertexData()->AddArray(nodeWeights.GetPointer());
+    }
+  return output->CheckedShallowCopy(builder.GetPointer());
+}
+
 // --------------------------------------------------------------------------
 QString voUtils::cleanString(const QString& text)
 {
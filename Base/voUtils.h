@@ -24,10 +24,13 @@
 #include <vtkType.h>
 
 class vtkAbstractArray;
+class vtkIdTypeArray;
 class vtkStringArray;
 class vtkTable;
 class vtkTree;
 class vtkDataSetAttributes;
+class vtkFieldData;
+class QBitArray;
 template <class T> class QList;
 class QScriptEngine;
 class QScriptValue;
@@ -62,6 +65,15 @@ bool flipTable(vtkTable* table, const FlipOption& flipOption, int horizontalOffs
 
 bool insertColumnIntoTable(vtkTable * table, int position, vtkAbstractArray * column);
 
+/// Make the array \a name of \a fieldData safe to modify in place: if it is
+/// shared with another data object, e.g. by voDataObject::sharedDataCopy(),
+/// it is replaced by a copy. Return the array, or 0 if there is none.
+vtkAbstractArray * detachArray(vtkFieldData * fieldData, const char * name);
+
+/// Remove the rows of \a table whose bit is cleared in \a keepRows, in a
+/// single pass over each column. Rows past the end of \a keepRows are kept.
+bool removeTableRows(vtkTable * table, const QBitArray& keepRows);
+
 vtkStringArray* tableColumnNames(vtkTable * table, int offset = 0);
 
 void setTableColumnNames(vtkTable * table, vtkStringArray * columnNames);
@@ -90,6 +102,17 @@ QString stringify(const QString& name, vtkTable * table, const QList<vtkIdType>&
 
 QString stringify(const QString& name, vtkTree * tree);
 
+/// Add to \a selection the internal vertices of \a tree whose children are
+/// all selected, from the leaves up, so that removing the selected vertices
+/// doesn't leave empty branches behind. Runs in linear time.
+void selectEmptyBranches(vtkTree * tree, vtkIdTypeArray * selection);
+
+/// Copy into \a output the \a tree where the leaf \a tip is replaced by the
+/// root of \a subtree, e.g. to expand a tip with its descendants. The tip
+/// keeps its name and branch length. Only the "node name", "weight" and
+/// "node weight" arrays are copied.
+bool graftTree(vtkTree * tree, vtkIdType tip, vtkTree * subtree, vtkTree * output);
+
 /// Convert characters different from letters, number or hyphen into an underscore
 /// The function will also make sure there are no more that one underscore in a row.
 QString cleanString(const QString& text);
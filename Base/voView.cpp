@@ -28,6 +28,7 @@
 #include <QSharedDataPointer>
 
 // Visomics includes
+#include "voTrace.h"
 #include "voUtils.h"
 #include "voView.h"
 
@@ -102,6 +103,8 @@ void voView::setDataObject(voDataObject* dataObject)
     return;
     }
   d->DataObject = dataObject;
+  voTrace::Scope traceScope("render", this->metaObject()->className());
+  traceScope.addDataObject(dataObject);
   this->setDataObjectInternal(*dataObject);
 }
 
@@ -115,6 +118,11 @@ void voView::setDataObjectList(QList<voDataObject*> dataObjectList)
                 << "- Failed to setDataObjects - dataObject list is NULL";
     return;
     }
+  voTrace::Scope traceScope("render", this->metaObject()->className());
+  foreach(voDataObject* dataObject, dataObjectList)
+    {
+    traceScope.addDataObject(dataObject);
+    }
   if (dataObjectList.size() == 1)
     {
     d->DataObject = dataObjectList[0];
@@ -0,0 +1,280 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+// Qt includes
+#include <QDebug>
+#include <QSet>
+#include <QSettings>
+#include <QThread>
+
+// Visomics includes
+#include "voAnalysis.h"
+#include "voAnalysisDriver.h"
+#include "voApplication.h"
+#include "voDataModel.h"
+#include "voDataModelItem.h"
+#include "voWorkflowScheduler.h"
+
+// --------------------------------------------------------------------------
+class voWorkflowSchedulerPrivate
+{
+  Q_DECLARE_PUBLIC(voWorkflowScheduler);
+protected:
+  voWorkflowScheduler* const q_ptr;
+
+public:
+  struct Node
+  {
+    QString Uuid;
+    QString AnalysisName;
+    QHash<QString, QVariant> Parameters;
+    QString Parent;
+    QString ParentUuid;
+    QString ParentOutputName;
+    // Workflows saved without uuids don't record which analysis computed
+    // the input: their analyses run one after the other, in file order.
+    QString PreviousUuid;
+  };
+
+  voWorkflowSchedulerPrivate(voWorkflowScheduler& object);
+
+  voDataModelItem* inputTarget(const Node& node)const;
+  void schedule();
+
+  voAnalysisDriver* Driver;
+  int MaximumConcurrentAnalyses;
+  QList<Node> PendingNodes;
+  QSet<QString> Uuids;
+  QHash<voAnalysis*, Node> RunningNodes;
+  QHash<QString, voAnalysis*> CompletedAnalyses; // Keyed on the saved uuid
+  QSet<QString> FailedUuids;
+  QString LastUuid;
+
+  // Analyses that don't run in the background complete within
+  // voAnalysisDriver::runAnalysis(), which calls schedule() again.
+  bool Scheduling;
+  bool ScheduleRequested;
+};
+
+// --------------------------------------------------------------------------
+// voWorkflowSchedulerPrivate methods
+
+// --------------------------------------------------------------------------
+voWorkflowSchedulerPrivate::voWorkflowSchedulerPrivate(voWorkflowScheduler& object)
+  : q_ptr(&object)
+{
+  this->Driver = 0;
+  this->MaximumConcurrentAnalyses = QThread::idealThreadCount();
+  this->Scheduling = false;
+  this->ScheduleRequested = false;
+}
+
+// --------------------------------------------------------------------------
+voDataModelItem* voWorkflowSchedulerPrivate::inputTarget(const Node& node)const
+{
+  voDataModel * model = voApplication::application()->dataModel();
+  if (node.ParentUuid.isEmpty() || !this->Uuids.contains(node.ParentUuid))
+    {
+    return model->findItemWithText(node.Parent);
+    }
+  voDataModelItem * analysisContainer =
+    model->itemForAnalysis(this->CompletedAnalyses.value(node.ParentUuid));
+  if (!analysisContainer)
+    {
+    return 0;
+    }
+  QList<voDataModelItem*> items = model->findItemsWithRole(
+    voDataModelItem::OutputNameRole, node.ParentOutputName, analysisContainer);
+  return items.isEmpty() ? 0 : items.first();
+}
+
+// --------------------------------------------------------------------------
+void voWorkflowSchedulerPrivate::schedule()
+{
+  Q_Q(voWorkflowScheduler);
+  if (this->Scheduling)
+    {
+    this->ScheduleRequested = true;
+    return;
+    }
+  this->Scheduling = true;
+  for (int i = 0; i < this->PendingNodes.size() &&
+       this->RunningNodes.size() < this->MaximumConcurrentAnalyses; )
+    {
+    Node node = this->PendingNodes.at(i);
+    bool dependsOnScheduledAnalysis =
+      !node.ParentUuid.isEmpty() && this->Uuids.contains(node.ParentUuid);
+    if (dependsOnScheduledAnalysis && this->FailedUuids.contains(node.ParentUuid))
+      {
+      qWarning() << "Skipping analysis" << node.AnalysisName << "- its input could not be computed";
+      this->FailedUuids << node.Uuid;
+      this->PendingNodes.removeAt(i);
+      // Nodes depending on this one may be earlier in the list
+      i = 0;
+      continue;
+      }
+    if (dependsOnScheduledAnalysis && !this->CompletedAnalyses.contains(node.ParentUuid))
+      {
+      ++i;
+      continue;
+      }
+    if (!node.PreviousUuid.isEmpty() && !this->CompletedAnalyses.contains(node.PreviousUuid)
+        && !this->FailedUuids.contains(node.PreviousUuid))
+      {
+      ++i;
+      continue;
+      }
+    this->PendingNodes.removeAt(i);
+
+    voDataModelItem * inputTarget = this->inputTarget(node);
+    voAnalysis * analysis = 0;
+    if (inputTarget)
+      {
+      analysis = this->Driver->createAnalysis(node.AnalysisName, node.Parameters);
+      }
+    else
+      {
+      qCritical() << "Failed to find the input" << node.Parent << "of analysis" << node.AnalysisName;
+      }
+    if (analysis)
+      {
+      // Recorded first: the analysis may be done when runAnalysis() returns
+      this->RunningNodes.insert(analysis, node);
+      if (!this->Driver->runAnalysis(analysis, QList<voDataModelItem*>() << inputTarget))
+        {
+        this->RunningNodes.remove(analysis);
+        analysis->deleteLater();
+        analysis = 0;
+        }
+      }
+    if (!analysis)
+      {
+      this->FailedUuids << node.Uuid;
+      }
+    if (!analysis || this->ScheduleRequested)
+      {
+      // Analyses that completed or failed may have released pending nodes
+      this->ScheduleRequested = false;
+      i = 0;
+      }
+    }
+  this->Scheduling = false;
+
+  if (this->PendingNodes.isEmpty() && this->RunningNodes.isEmpty())
+    {
+    emit q->finished();
+    q->deleteLater();
+    }
+}
+
+// --------------------------------------------------------------------------
+// voWorkflowScheduler methods
+
+// --------------------------------------------------------------------------
+voWorkflowScheduler::voWorkflowScheduler(voAnalysisDriver* driver)
+  : Superclass(driver), d_ptr(new voWorkflowSchedulerPrivate(*this))
+{
+  Q_D(voWorkflowScheduler);
+  Q_ASSERT(driver);
+  d->Driver = driver;
+  QSettings settings("Kitware", "Visomics");
+  d->MaximumConcurrentAnalyses = qMax(1,
+    settings.value("maximumConcurrentWorkflowAnalyses", d->MaximumConcurrentAnalyses).toInt());
+
+  connect(driver, SIGNAL(analysisAddedToObjectModel(voAnalysis*)),
+          this, SLOT(onAnalysisAddedToObjectModel(voAnalysis*)));
+  connect(driver, SIGNAL(analysisFailed(voAnalysis*)),
+          this, SLOT(onAnalysisFailed(voAnalysis*)));
+}
+
+// --------------------------------------------------------------------------
+voWorkflowScheduler::~voWorkflowScheduler()
+{
+}
+
+// --------------------------------------------------------------------------
+void voWorkflowScheduler::addAnalysis(const QString& uuid, const QString& analysisName,
+                                      const QHash<QString, QVariant>& parameters,
+                                      const QString& parent,
+                                      const QString& parentUuid,
+                                      const QString& parentOutputName)
+{
+  Q_D(voWorkflowScheduler);
+  voWorkflowSchedulerPrivate::Node node;
+  node.Uuid = uuid.isEmpty() ? QString("node-%1").arg(d->Uuids.size()) : uuid;
+  if (uuid.isEmpty())
+    {
+    // The input may be computed by any earlier analysis
+    node.PreviousUuid = d->LastUuid;
+    }
+  node.AnalysisName = analysisName;
+  node.Parameters = parameters;
+  node.Parent = parent;
+  node.ParentUuid = parentUuid;
+  node.ParentOutputName = parentOutputName;
+  d->PendingNodes << node;
+  d->Uuids << node.Uuid;
+  d->LastUuid = node.Uuid;
+}
+
+// --------------------------------------------------------------------------
+int voWorkflowScheduler::maximumConcurrentAnalyses()const
+{
+  Q_D(const voWorkflowScheduler);
+  return d->MaximumConcurrentAnalyses;
+}
+
+// --------------------------------------------------------------------------
+void voWorkflowScheduler::setMaximumConcurrentAnalyses(int maximum)
+{
+  Q_D(voWorkflowScheduler);
+  d->MaximumConcurrentAnalyses = qMax(1, maximum);
+}
+
+// --------------------------------------------------------------------------
+void voWorkflowScheduler::start()
+{
+  Q_D(voWorkflowScheduler);
+  d->schedule();
+}
+
+// --------------------------------------------------------------------------
+void voWorkflowScheduler::onAnalysisAddedToObjectModel(voAnalysis* analysis)
+{
+  Q_D(voWorkflowScheduler);
+  if (!d->RunningNodes.contains(analysis))
+    {
+    return;
+    }
+  d->CompletedAnalyses.insert(d->RunningNodes.take(analysis).Uuid, analysis);
+  d->schedule();
+}
+
+// --------------------------------------------------------------------------
+void voWorkflowScheduler::onAnalysisFailed(voAnalysis* analysis)
+{
+  Q_D(voWorkflowScheduler);
+  if (!d->RunningNodes.contains(analysis))
+    {
+    return;
+    }
+  d->FailedUuids << d->RunningNodes.take(analysis).Uuid;
+  d->schedule();
+}
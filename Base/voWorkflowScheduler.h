@@ -0,0 +1,85 @@
+/*=========================================================================
+
+  Program: Visomics
+
+  Copyright (c) Kitware, Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+=========================================================================*/
+
+#ifndef __voWorkflowScheduler_h
+#define __voWorkflowScheduler_h
+
+// Qt includes
+#include <QHash>
+#include <QObject>
+#include <QScopedPointer>
+#include <QVariant>
+
+class voAnalysis;
+class voAnalysisDriver;
+class voWorkflowSchedulerPrivate;
+
+/// Run the analyses of a saved workflow in dependency order.
+///
+/// An analysis depends on the analysis producing its input, if any. The
+/// analyses whose inputs are available are started at once, up to
+/// maximumConcurrentAnalyses(), and the others as soon as their input is
+/// produced. Analyses depending on a failed analysis are skipped.
+///
+/// Analyses already run with the same inputs and parameters are restored
+/// from the analysis result cache by the driver.
+///
+/// The scheduler deletes itself once every analysis is done.
+class voWorkflowScheduler : public QObject
+{
+  Q_OBJECT
+public:
+  typedef QObject Superclass;
+  voWorkflowScheduler(voAnalysisDriver* driver);
+  virtual ~voWorkflowScheduler();
+
+  /// Add an analysis of type \a analysisName identified by \a uuid.
+  /// Its input is the output \a parentOutputName of the analysis
+  /// \a parentUuid or, if \a parentUuid is empty, the item named \a parent.
+  /// Analyses added without \a uuid, as saved by older versions, run after
+  /// the analysis added before them.
+  void addAnalysis(const QString& uuid, const QString& analysisName,
+                   const QHash<QString, QVariant>& parameters,
+                   const QString& parent,
+                   const QString& parentUuid = QString(),
+                   const QString& parentOutputName = QString());
+
+  int maximumConcurrentAnalyses()const;
+  void setMaximumConcurrentAnalyses(int maximum);
+
+  /// Start the analyses whose inputs are available.
+  void start();
+
+signals:
+  void finished();
+
+protected slots:
+  void onAnalysisAddedToObjectModel(voAnalysis* analysis);
+  void onAnalysisFailed(voAnalysis* analysis);
+
+protected:
+  QScopedPointer<voWorkflowSchedulerPrivate> d_ptr;
+
+private:
+  Q_DECLARE_PRIVATE(voWorkflowScheduler);
+  Q_DISABLE_COPY(voWorkflowScheduler);
+};
+
+#endif
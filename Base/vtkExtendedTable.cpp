@@ -145,6 +145,19 @@ void vtkExtendedTable::Dump()
   std::cout << std::endl;
 }
 
+//----------------------------------------------------------------------------
+void vtkExtendedTable::ShallowCopy(vtkDataObject* src)
+{
+  this->Superclass::ShallowCopy(src);
+  vtkExtendedTable * extendedTable = vtkExtendedTable::SafeDownCast(src);
+  if (!extendedTable || extendedTable == this)
+    {
+    return;
+    }
+  *this->Internal = *extendedTable->Internal;
+  this->Modified();
+}
+
 //----------------------------------------------------------------------------
 vtkIdType vtkExtendedTable::GetTotalNumberOfRows()
 {
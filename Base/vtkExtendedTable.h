@@ -67,6 +67,9 @@ public:
 
   void Dump();
 
+  /// Also share the meta data tables and labels of \a src
+  virtual void ShallowCopy(vtkDataObject* src);
+
   vtkIdType GetTotalNumberOfRows();
 
   vtkIdType GetTotalNumberOfColumns();
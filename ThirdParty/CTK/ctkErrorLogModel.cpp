@@ -28,6 +28,7 @@
 #include <QPointer>
 #include <QStandardItem>
 #include <QStatusBar>
+#include <QThread>
 
 // CTK includes
 #include "ctkErrorLogModel.h"
@@ -302,6 +303,16 @@ void ctkErrorLogModel::addEntry(ctkErrorLogModel::LogLevel logLevel,
 {
   Q_D(ctkErrorLogModel);
 
+  // The model is not thread safe and is shown by the GUI: entries logged
+  // by worker threads are added from the thread of the model.
+  if (QThread::currentThread() != this->thread())
+    {
+    QMetaObject::invokeMethod(this, "addQueuedEntry", Qt::QueuedConnection,
+                              Q_ARG(int, logLevel), Q_ARG(QString, origin),
+                              Q_ARG(QByteArray, QByteArray(text)));
+    return;
+    }
+
   if (d->AddingEntry)
     {
 //    QFile f("/tmp/ctkErrorLogModel-AddingEntry-true.txt");
@@ -415,6 +426,12 @@ void ctkErrorLogModel::addEntry(ctkErrorLogModel::LogLevel logLevel,
   d->AddingEntry = false;
 }
 
+//------------------------------------------------------------------------------
+void ctkErrorLogModel::addQueuedEntry(int logLevel, const QString& origin, const QByteArray& text)
+{
+  this->addEntry(static_cast<ctkErrorLogModel::LogLevel>(logLevel), origin, text.constData());
+}
+
 //------------------------------------------------------------------------------
 void ctkErrorLogModel::clear()
 {
@@ -141,6 +141,10 @@ public:
 signals:
   void logLevelFilterChanged();
 
+protected slots:
+  /// Add an entry logged from another thread, see addEntry()
+  void addQueuedEntry(int logLevel, const QString& origin, const QByteArray& text);
+
 protected:
   QScopedPointer<ctkErrorLogModelPrivate> d_ptr;
 